@@ -0,0 +1,22 @@
+//
+// Created by jens on 19/10/26.
+//
+
+#ifndef COMPILER_ALLOCATIONCOUNTER_H
+#define COMPILER_ALLOCATIONCOUNTER_H
+
+#include <cstddef>
+
+/**
+ * Counts the heap allocations of the whole program, for tests that a phase allocates nothing.
+ *
+ * AllocationCounter.cpp replaces the global operator new, so only the test program links it (compiler_tests, which
+ * defines COMPILER_COUNT_ALLOCATIONS); the compiler keeps the allocator of the standard library.
+ */
+class AllocationCounter {
+public:
+    static std::size_t count();
+};
+
+
+#endif //COMPILER_ALLOCATIONCOUNTER_H
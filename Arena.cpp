@@ -0,0 +1,45 @@
+//
+// Created by jens on 19/10/26.
+//
+
+#include <algorithm>
+#include <cstdint>
+#include "Arena.h"
+
+Arena::Arena(std::size_t blockSize) : blockSize(blockSize) {}
+
+void Arena::grow(std::size_t atLeast) {
+    std::size_t size = std::max(blockSize, atLeast);
+    blocks.emplace_back(new char[size]);
+    reserved += size;
+    cursor = blocks.back().get();
+    end = cursor + size;
+}
+
+void *Arena::allocate(std::size_t size, std::size_t alignment) {
+    auto address = reinterpret_cast<std::uintptr_t>(cursor);
+    std::size_t padding = (alignment - address % alignment) % alignment;
+    if (cursor == nullptr || padding + size > (std::size_t) (end - cursor)) {
+        grow(size + alignment);
+        address = reinterpret_cast<std::uintptr_t>(cursor);
+        padding = (alignment - address % alignment) % alignment;
+    }
+    char *result = cursor + padding;
+    cursor = result + size;
+    used += size;
+    return result;
+}
+
+void Arena::release() {
+    blocks.clear();
+    cursor = end = nullptr;
+    used = reserved = 0;
+}
+
+std::size_t Arena::bytesUsed() const {
+    return used;
+}
+
+std::size_t Arena::bytesReserved() const {
+    return reserved;
+}
@@ -0,0 +1,57 @@
+//
+// Created by jens on 19/10/26.
+//
+
+#ifndef COMPILER_ARENA_H
+#define COMPILER_ARENA_H
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/**
+ * Bump allocator: memory is handed out from large blocks by advancing a cursor and is only given back all at once,
+ * by release() or the destructor. Objects are never destroyed one by one, so only trivially destructible types
+ * can be made in it.
+ */
+class Arena {
+private:
+    std::vector<std::unique_ptr<char[]>> blocks;
+    std::size_t blockSize;
+    char *cursor = nullptr;
+    char *end = nullptr;
+    std::size_t used = 0;
+    std::size_t reserved = 0;
+
+    void grow(std::size_t atLeast);
+
+public:
+    explicit Arena(std::size_t blockSize = 1 << 16);
+    Arena(const Arena &) = delete;
+    Arena &operator=(const Arena &) = delete;
+
+    void *allocate(std::size_t size, std::size_t alignment = alignof(std::max_align_t));
+    void release();
+    [[nodiscard]] std::size_t bytesUsed() const;
+    [[nodiscard]] std::size_t bytesReserved() const;
+
+    template<typename Type, typename... Args>
+    Type *make(Args &&... args) {
+        static_assert(std::is_trivially_destructible_v<Type>, "arena objects are never destroyed");
+        return new(allocate(sizeof(Type), alignof(Type))) Type(std::forward<Args>(args)...);
+    }
+
+    template<typename Type>
+    Type *makeArray(std::size_t count) {
+        static_assert(std::is_trivially_destructible_v<Type>, "arena objects are never destroyed");
+        Type *array = static_cast<Type *>(allocate(sizeof(Type) * count, alignof(Type)));
+        for (std::size_t i = 0; i < count; i++) new(array + i) Type();
+        return array;
+    }
+};
+
+
+#endif //COMPILER_ARENA_H
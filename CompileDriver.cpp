@@ -0,0 +1,206 @@
+//
+// Created by jens on 19/10/26.
+//
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include "CompileDriver.h"
+#include "Stats.h"
+#include "Trace.h"
+#include "WorkStealingPool.h"
+
+namespace {
+    CompiledGrammar compileGrammar(const std::vector<Production> &productions, const CompileDriver::Options &options) {
+        ContextFreeGrammar grammar(productions);
+        if (!options.parsingTable.isEmpty() && !grammar.useParsingTable(options.parsingTable)) {
+            throw std::runtime_error("the parsing table does not fit the grammar");
+        }
+        if (!options.grammarCache.empty()) grammar.useAnalysisCache(options.grammarCache);
+        return CompiledGrammar(grammar);
+    }
+}
+
+CompileDriver::CompileDriver(const std::vector<Production> &productions, const Options &options)
+        : grammar(compileGrammar(productions, options)), options(options) {}
+
+/**
+ * expands the inputs into a sorted list of files without duplicates:
+ * a directory stands for the files below it (with the extension, if one is set), `@list` for the paths listed in
+ * the file `list`, one per line, anything else for itself
+ */
+std::vector<std::string> CompileDriver::collect(const std::vector<std::string> &inputs) const {
+    namespace fs = std::filesystem;
+    std::vector<std::string> files;
+    std::vector<std::string> pending(inputs.rbegin(), inputs.rend());
+    while (!pending.empty()) {
+        std::string input = pending.back();
+        pending.pop_back();
+        if (!input.empty() && input[0] == '@') {
+            std::ifstream list(input.substr(1));
+            if (!list.is_open()) throw std::runtime_error("Could not open file list " + input.substr(1));
+            std::vector<std::string> listed;
+            for (std::string line; std::getline(list, line);) {
+                if (!line.empty()) listed.push_back(line);
+            }
+            pending.insert(pending.end(), listed.rbegin(), listed.rend());
+        } else if (fs::is_directory(input)) {
+            for (const fs::directory_entry &entry: fs::recursive_directory_iterator(input)) {
+                std::string path = entry.path().string();
+                bool matches = path.size() >= options.extension.size()
+                               && path.compare(path.size() - options.extension.size(), std::string::npos,
+                                               options.extension) == 0;
+                if (entry.is_regular_file() && matches) files.push_back(path);
+            }
+        } else {
+            files.push_back(input);     // a missing file is reported by compile
+        }
+    }
+    std::sort(files.begin(), files.end());
+    files.erase(std::unique(files.begin(), files.end()), files.end());
+    return files;
+}
+
+CompileDriver::Result CompileDriver::compile(const std::string &path) const {
+    Result result{path, {}};
+    Trace::Sample sample(Trace::sample());
+    Trace::Span span("driver", "compile", path);
+    try {
+        InputBuffer inputBuffer(path);
+        SymbolTable symbolTable;
+        Lexer lexer(&inputBuffer, &symbolTable);
+        Parser parser(grammar, &lexer, &symbolTable);
+        parser.setRecovery(options.recovery);
+        try {
+            parser.parse();
+            result.diagnostics = parser.getDiagnostics();
+        } catch (const SyntacticalError &e) {
+            result.diagnostics.push_back({e.std::runtime_error::what(), e.getLine(), e.getColumn()});
+        } catch (const LexicalError &e) {
+            // the lexer cannot go on, keep what the parser found up to here
+            result.diagnostics = parser.getDiagnostics();
+            result.diagnostics.push_back({e.std::runtime_error::what(), e.getLine(), e.getColumn()});
+        }
+    } catch (const std::exception &e) {
+        result.diagnostics.push_back({e.what(), 0, 0});
+    }
+    return result;
+}
+
+/**
+ * compiles every file, one job per file, and returns the results in the order of `files`
+ */
+std::vector<CompileDriver::Result> CompileDriver::compile(const std::vector<std::string> &files) const {
+    std::vector<Result> results(files.size());
+    WorkStealingPool pool(options.threads);
+    for (std::size_t i = 0; i < files.size(); i++) {
+        pool.submit([this, &files, &results, i]() { results[i] = compile(files[i]); });
+    }
+    pool.wait();
+    return results;
+}
+
+/**
+ * one line per diagnostic, `path:line:column: message`
+ */
+void CompileDriver::print(std::ostream &out, const std::vector<Result> &results) {
+    for (const Result &result: results) {
+        for (const SyntaxDiagnostic &d: result.diagnostics) {
+            out << result.path << ":" << d.line << ":" << d.column << ": " << d.message << "\n";
+        }
+    }
+    out.flush();
+}
+
+/**
+ * the command line driver: `compiler [--threads n] [--ext suffix] [--recovery none|panic|phrase] [--stats text|json]
+ * [--trace file] [--trace-sample rate] [--grammar-cache file] input...`, the statistics go to stderr after the
+ * diagnostics, the timeline of the sampled share of the files to the trace file
+ * @param parsingTable adopted for `productions` when not empty, see Options::parsingTable
+ * @return 0 if every file parsed without errors, 1 if some did not, 2 on bad arguments
+ */
+int CompileDriver::main(const std::vector<std::string> &arguments, const std::vector<Production> &productions,
+                        const CompressedParsingTable &parsingTable) {
+    Options options;
+    options.parsingTable = parsingTable;
+    std::string stats;
+    std::string trace;
+    double sampleRate = 1;
+    std::vector<std::string> inputs;
+    try {
+        for (std::size_t i = 0; i < arguments.size(); i++) {
+            const std::string &argument = arguments[i];
+            bool hasValue = i + 1 < arguments.size();
+            if (argument == "--threads" && hasValue) {
+                options.threads = (unsigned) std::stoul(arguments[++i]);
+            } else if (argument == "--ext" && hasValue) {
+                options.extension = arguments[++i];
+            } else if (argument == "--recovery" && hasValue) {
+                const std::string &mode = arguments[++i];
+                if (mode == "none") options.recovery = Parser::NO_RECOVERY;
+                else if (mode == "panic") options.recovery = Parser::PANIC_MODE;
+                else if (mode == "phrase") options.recovery = Parser::PHRASE_LEVEL;
+                else throw std::invalid_argument("unknown recovery " + mode);
+            } else if (argument == "--stats" && hasValue) {
+                stats = arguments[++i];
+                if (stats != "text" && stats != "json") throw std::invalid_argument("unknown stats format " + stats);
+            } else if (argument == "--trace" && hasValue) {
+                trace = arguments[++i];
+            } else if (argument == "--grammar-cache" && hasValue) {
+                options.grammarCache = arguments[++i];
+            } else if (argument == "--trace-sample" && hasValue) {
+                sampleRate = std::stod(arguments[++i]);
+                if (sampleRate < 0 || sampleRate > 1) throw std::invalid_argument("--trace-sample must be from 0 to 1");
+            } else if (argument.size() > 1 && argument.compare(0, 2, "--") == 0) {
+                throw std::invalid_argument("unknown option " + argument);
+            } else {
+                inputs.push_back(argument);
+            }
+        }
+        if (inputs.empty()) throw std::invalid_argument("no input");
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << std::endl
+                  << "usage: compiler [--threads n] [--ext suffix] [--recovery none|panic|phrase] [--stats text|json] "
+                     "[--trace file] [--trace-sample rate] [--grammar-cache file] <file | directory | @list>..."
+                  << std::endl;
+        return 2;
+    }
+
+    if (!trace.empty()) Trace::start(sampleRate);
+    std::unique_ptr<CompileDriver> driver;
+    std::vector<std::string> files;
+    try {
+        driver = std::make_unique<CompileDriver>(productions, options);     // an unwritable grammar cache throws
+        files = driver->collect(inputs);
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << std::endl;
+        return 2;
+    }
+    std::vector<Result> results = driver->compile(files);
+    if (!trace.empty()) {
+        Trace::stop();
+        std::ofstream out(trace, std::ios::out | std::ios::trunc);
+        if (!out) {
+            std::cerr << "cannot write " << trace << std::endl;
+            return 2;
+        }
+        Trace::write(out);
+    }
+    print(std::cout, results);
+    std::size_t errors = 0, failed = 0;
+    for (const Result &result: results) {
+        errors += result.diagnostics.size();
+        failed += !result.diagnostics.empty();
+    }
+    std::cerr << files.size() << " files, " << failed << " with errors, " << errors << " errors" << std::endl;
+    if (!stats.empty() && !COMPILER_STATS) {
+        std::cerr << "statistics are compiled out, configure with -DCOMPILER_STATS=ON" << std::endl;
+    } else if (stats == "text") {
+        Stats::print(std::cerr, Stats::collect());
+    } else if (stats == "json") {
+        Stats::printJson(std::cerr, Stats::collect());
+    }
+    return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,54 @@
+//
+// Created by jens on 19/10/26.
+//
+
+#ifndef COMPILER_COMPILEDRIVER_H
+#define COMPILER_COMPILEDRIVER_H
+
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "ContextFreeGrammar.h"
+#include "CompiledGrammar.h"
+#include "Parser.h"
+
+/**
+ * Lexes and parses many source files in parallel against one grammar.
+ *
+ * The grammar is compiled once in the constructor and shared by all jobs, every file is a job of its own
+ * (InputBuffer, SymbolTable, Lexer, Parser) on a WorkStealingPool. Results are returned, and printed,
+ * in the sorted order of the file names, so the output does not depend on the number of threads or on timing.
+ */
+class CompileDriver {
+public:
+    struct Options {
+        unsigned threads = std::thread::hardware_concurrency();
+        std::string extension;     // only files ending with it are taken from directories, empty for all
+        Parser::Recovery recovery = Parser::PHRASE_LEVEL;
+        std::string grammarCache;  // grammar image loaded instead of analysing the grammar, written if missing or stale
+        CompressedParsingTable parsingTable;   // adopted instead of computing the LL(1) table, e.g. grammar_def.h's
+    };
+
+    struct Result {
+        std::string path;
+        std::vector<SyntaxDiagnostic> diagnostics;
+    };
+
+private:
+    CompiledGrammar grammar;
+    Options options;
+
+    [[nodiscard]] Result compile(const std::string &path) const;
+
+public:
+    CompileDriver(const std::vector<Production> &productions, const Options &options);
+    [[nodiscard]] std::vector<std::string> collect(const std::vector<std::string> &inputs) const;
+    [[nodiscard]] std::vector<Result> compile(const std::vector<std::string> &files) const;
+    static void print(std::ostream &out, const std::vector<Result> &results);
+    static int main(const std::vector<std::string> &arguments, const std::vector<Production> &productions,
+                    const CompressedParsingTable &parsingTable = CompressedParsingTable());
+};
+
+
+#endif //COMPILER_COMPILEDRIVER_H
@@ -0,0 +1,323 @@
+//
+// Created by jens on 19/10/26.
+//
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <stdexcept>
+#include "CompiledGrammar.h"
+#include "LookaheadSet.h"
+#include "Stats.h"
+#include "Trace.h"
+
+CompiledGrammar::CompiledGrammar(ContextFreeGrammar &grammar, int lookahead) {
+    if (lookahead < 1 || lookahead > MAX_LOOKAHEAD) {
+        throw std::runtime_error("lookahead must be from 1 to " + std::to_string(MAX_LOOKAHEAD));
+    }
+    STATS_PHASE(ANALYSIS);
+    Trace::Span span("analysis", "compile grammar");
+    auto built = std::make_shared<Tables>();
+    built->lookahead = lookahead;
+    built->productions = grammar.getProductions();
+    built->nonTerminals = grammar.getNonTerminals();
+    built->start = grammar.getSymbolId(grammar.getStartSymbol());
+    for (const Production &p: built->productions) {
+        built->heads.push_back(grammar.getSymbolId(p.head));
+        built->bodies.emplace_back();
+        for (const GrammarSymbol &s: p.body) {
+            if (s.isEpsilon()) continue;
+            std::int32_t id = grammar.getSymbolId(s);
+            if (id < 0) throw std::runtime_error("non-terminal " + s.toString() + " has no production");
+            built->bodies.back().push_back(id);
+        }
+    }
+
+    if (Token::TOKEN_TYPE_COUNT + built->nonTerminals.size() > INT16_MAX) {
+        throw std::runtime_error("too many non-terminals for 16-bit symbol ids");
+    }
+
+    std::vector<std::vector<int>> matrix = grammar.getParsingTableMatrix();
+    built->table = CompressedParsingTable(matrix, std::vector<int>(matrix.size(), CompressedParsingTable::NO_ENTRY));
+
+    // FIRST and FOLLOW hold terminals, EPSILON and EOF, all of which are columns
+    auto toBits = [](const std::unordered_set<GrammarSymbol> &set) {
+        terminal_set_t bits;
+        for (const GrammarSymbol &s: set) bits.set(s.getTerminal());
+        return bits;
+    };
+    const ContextFreeGrammar::first_set_terminal_t &first = grammar.getFirstSets();
+    const ContextFreeGrammar::follow_set_t &follow = grammar.getFollowSets();
+    for (const GrammarSymbol &nt: built->nonTerminals) {
+        auto f = first.find(nt);
+        built->first.push_back(f == first.end() ? terminal_set_t() : toBits(f->second));
+        auto g = follow.find(nt);
+        built->follow.push_back(g == follow.end() ? terminal_set_t() : toBits(g->second));
+    }
+    findOperatorLevels(*built);
+    findConflicts(*built);
+    findLookahead(*built);
+    tables = std::move(built);
+}
+
+/**
+ * finds the levels A ::= B A', A' ::= op B A' | ... | epsilon (one production for A, every one of A' but the empty
+ * one starting with a terminal operator, B not nullable) and chains every level to the tighter ones below it
+ */
+void CompiledGrammar::findOperatorLevels(Tables &built) {
+    const auto T = Token::TOKEN_TYPE_COUNT;
+    std::size_t count = built.nonTerminals.size();
+    std::vector<std::vector<int>> productionsOf(count);
+    for (int p = 0; p < (int) built.productions.size(); p++) {
+        for (std::size_t n = 0; n < count; n++) {
+            if (built.nonTerminals[n] == built.productions[p].head) productionsOf[n].push_back(p);
+        }
+    }
+
+    std::vector<std::int32_t> operandOf(count, -1), tailOf(count, -1);
+    std::vector<terminal_set_t> operatorsOf(count);
+    for (std::size_t a = 0; a < count; a++) {
+        if (productionsOf[a].size() != 1) continue;
+        const std::vector<std::int32_t> &body = built.bodies[productionsOf[a][0]];
+        if (body.size() != 2 || isTerminal(body[1]) || body[1] == (std::int32_t) (T + a)) continue;
+        std::int32_t operand = body[0], tail = body[1];
+        if (!isTerminal(operand) && built.first[operand - T].test(Token::TokenType::EPSILON)) continue;
+        terminal_set_t operators;
+        int empty = 0;
+        bool level = true;
+        for (int p: productionsOf[tail - T]) {
+            const std::vector<std::int32_t> &alternative = built.bodies[p];
+            if (alternative.empty()) {
+                empty++;
+            } else if (alternative.size() == 3 && isTerminal(alternative[0]) && alternative[1] == operand
+                       && alternative[2] == tail) {
+                operators.set(alternative[0]);
+            } else {
+                level = false;
+            }
+        }
+        if (!level || empty != 1 || operators.none()) continue;
+        operandOf[a] = operand;
+        tailOf[a] = tail;
+        operatorsOf[a] = operators;
+    }
+
+    built.levels.resize(count);
+    for (std::size_t a = 0; a < count; a++) {
+        OperatorLevels &levels = built.levels[a];
+        for (std::int32_t n = (std::int32_t) (T + a);
+             !isTerminal(n) && tailOf[n - T] >= 0 && levels.tails.size() < count; n = operandOf[n - T]) {
+            levels.heads.push_back(n);
+            levels.tails.push_back(tailOf[n - T]);
+            levels.operators |= operatorsOf[n - T];
+            levels.operand = operandOf[n - T];
+            for (int t = 0; t < T; t++) {
+                if (operatorsOf[n - T].test(t)) levels.next[t] = operandOf[n - T];
+            }
+        }
+        if (levels.tails.size() == count) levels = OperatorLevels();     // cyclic, left as it is
+    }
+}
+
+/**
+ * the entries of the LL(1) table that more than one production claims: FIRST of the body, or FOLLOW of the head for
+ * an epsilon production, as findParsingTableLL1 fills them
+ */
+void CompiledGrammar::findConflicts(Tables &built) {
+    const auto T = Token::TOKEN_TYPE_COUNT;
+    std::vector<terminal_set_t> claimed(built.nonTerminals.size());
+    built.conflicts.assign(built.nonTerminals.size(), terminal_set_t());
+    for (std::size_t p = 0; p < built.productions.size(); p++) {
+        std::size_t head = built.heads[p] - T;
+        terminal_set_t predicts;
+        if (built.bodies[p].empty()) predicts = built.follow[head];
+        for (std::int32_t s: built.bodies[p]) {
+            if (isTerminal(s)) {
+                predicts.set(s);
+                break;
+            }
+            predicts |= built.first[s - T];
+            if (!built.first[s - T].test(Token::TokenType::EPSILON)) break;
+        }
+        predicts.reset(Token::TokenType::EPSILON);
+        built.conflicts[head] |= claimed[head] & predicts;
+        claimed[head] |= predicts;
+    }
+    for (const terminal_set_t &conflicts: built.conflicts) built.conflicted |= conflicts.any();
+}
+
+/**
+ * FIRST_k and FOLLOW_k by fixpoint iteration, then, for every conflict (A, a), the strings of k terminals starting
+ * with a that each production of A predicts (FIRST_k of the body followed by FOLLOW_k(A)), laid out as a decision
+ * trie: a node where one production is left decides, a node with several at the end of its strings is UNDECIDED.
+ * Grammars without conflicts skip all of it.
+ */
+void CompiledGrammar::findLookahead(Tables &built) {
+    const auto T = Token::TOKEN_TYPE_COUNT;
+    const int k = built.lookahead;
+    const std::size_t N = built.nonTerminals.size();
+    std::vector<std::vector<int>> rootRows(N, std::vector<int>(T, CompressedParsingTable::NO_ENTRY));
+    if (k == 1) {
+        // one token decides nothing more, every conflict is undecided
+        built.lookaheadNodes.push_back({UNDECIDED, 0, 0});
+        for (std::size_t a = 0; a < N; a++) {
+            for (int t = 0; t < T; t++) {
+                if (built.conflicts[a].test(t)) rootRows[a][t] = 0;
+            }
+            built.undecided += built.conflicts[a].count();
+        }
+    }
+    if (!built.conflicted || k == 1) {
+        built.lookaheadRoots = CompressedParsingTable(rootRows, std::vector<int>(N, CompressedParsingTable::NO_ENTRY));
+        return;
+    }
+
+    std::vector<LookaheadSet> first(N, LookaheadSet(k)), follow(N, LookaheadSet(k));
+    auto firstOf = [&](const std::vector<std::int32_t> &body, std::size_t from) {
+        LookaheadSet set = LookaheadSet::epsilon(k);
+        for (std::size_t i = from; i < body.size() && set.hasOpen(); i++) {
+            set = isTerminal(body[i]) ? set.concat(body[i]) : set.concat(first[body[i] - T]);
+        }
+        return set;
+    };
+    for (bool changed = true; changed;) {
+        changed = false;
+        for (std::size_t p = 0; p < built.productions.size(); p++) {
+            changed |= first[built.heads[p] - T].insertAll(firstOf(built.bodies[p], 0));
+        }
+    }
+    // FIRST_k of every suffix after a non-terminal, which the FOLLOW_k iterations read again and again
+    std::vector<std::vector<LookaheadSet>> suffixes(built.productions.size());
+    for (std::size_t p = 0; p < built.productions.size(); p++) {
+        const std::vector<std::int32_t> &body = built.bodies[p];
+        for (std::size_t i = 0; i < body.size(); i++) suffixes[p].push_back(firstOf(body, i + 1));
+    }
+    follow[built.start - T].insert({Token::TokenType::END_OF_FILE});
+    for (bool changed = true; changed;) {
+        changed = false;
+        for (std::size_t p = 0; p < built.productions.size(); p++) {
+            const std::vector<std::int32_t> &body = built.bodies[p];
+            for (std::size_t i = 0; i < body.size(); i++) {
+                if (isTerminal(body[i])) continue;
+                changed |= follow[body[i] - T].insertAll(suffixes[p][i].concat(follow[built.heads[p] - T]));
+            }
+        }
+    }
+
+    using predicted_t = std::pair<std::vector<int>, int>;     // (lookahead string, production)
+    std::vector<std::vector<predicted_t>> strings(T);
+    // lays out the decision trie of strings[from, to), which agree on their first `depth` terminals
+    std::function<std::uint32_t(std::vector<predicted_t> &, std::size_t, std::size_t, std::size_t, bool &)> layOut;
+    layOut = [&](std::vector<predicted_t> &sorted, std::size_t from, std::size_t to, std::size_t depth,
+                 bool &undecided) {
+        auto node = (std::uint32_t) built.lookaheadNodes.size();
+        built.lookaheadNodes.push_back({sorted[from].second, 0, 0});
+        bool one = std::all_of(sorted.begin() + (std::ptrdiff_t) from, sorted.begin() + (std::ptrdiff_t) to,
+                               [&](const predicted_t &s) { return s.second == sorted[from].second; });
+        if (one) return node;
+        if (sorted[from].first.size() == depth) {
+            built.lookaheadNodes[node].production = UNDECIDED;
+            undecided = true;
+            return node;
+        }
+        std::vector<std::pair<std::int32_t, std::uint32_t>> children;
+        for (std::size_t i = from; i < to;) {
+            int terminal = sorted[i].first[depth];
+            std::size_t j = i;
+            while (j < to && sorted[j].first[depth] == terminal) j++;
+            children.emplace_back(terminal, layOut(sorted, i, j, depth + 1, undecided));
+            i = j;
+        }
+        built.lookaheadNodes[node] = {LOOK_FURTHER, (std::uint32_t) built.lookaheadEdges.size(),
+                                      (std::uint32_t) children.size()};
+        for (const auto &child: children) built.lookaheadEdges.push_back({child.first, child.second});
+        return node;
+    };
+
+    for (std::size_t a = 0; a < N; a++) {
+        if (built.conflicts[a].none()) continue;
+        for (std::vector<predicted_t> &list: strings) list.clear();
+        for (std::size_t p = 0; p < built.productions.size(); p++) {
+            if (built.heads[p] != (std::int32_t) (T + a)) continue;
+            firstOf(built.bodies[p], 0).concat(follow[a]).forEach([&](const std::vector<int> &string) {
+                if (!string.empty() && built.conflicts[a].test(string[0])) strings[string[0]].emplace_back(string, p);
+            });
+        }
+        for (int t = 0; t < T; t++) {
+            if (!built.conflicts[a].test(t)) continue;
+            if (strings[t].empty()) continue;   // no production reaches it with k terminals, the table's entry stays
+            std::sort(strings[t].begin(), strings[t].end());
+            bool undecided = false;
+            rootRows[a][t] = (int) layOut(strings[t], 0, strings[t].size(), 1, undecided);
+            if (undecided) built.undecided++;
+        }
+    }
+    built.lookaheadRoots = CompressedParsingTable(rootRows, std::vector<int>(N, CompressedParsingTable::NO_ENTRY));
+}
+
+/**
+ * the number of conflicts where k terminals of lookahead do not always decide, 0 for an LL(k) grammar
+ */
+std::size_t CompiledGrammar::getUndecidedCount() const {
+    return tables->undecided;
+}
+
+bool CompiledGrammar::inFirst(std::int32_t symbol, int terminal) const {
+    if (isTerminal(symbol)) return symbol == terminal;
+    return tables->first[symbol - Token::TOKEN_TYPE_COUNT].test(terminal);
+}
+
+bool CompiledGrammar::inFollow(std::int32_t nonTerminal, int terminal) const {
+    return tables->follow[nonTerminal - Token::TOKEN_TYPE_COUNT].test(terminal);
+}
+
+bool CompiledGrammar::isNullable(std::int32_t symbol) const {
+    return !isTerminal(symbol) && tables->first[symbol - Token::TOKEN_TYPE_COUNT].test(Token::TokenType::EPSILON);
+}
+
+/**
+ * as ContextFreeGrammar::predict on a missing entry: give up the non-terminal on a token in its FOLLOW set
+ * (or at the end of the input), otherwise skip the token
+ */
+ErrorStrategy CompiledGrammar::errorStrategy(std::int32_t nonTerminal, int terminal) const {
+    bool synch = terminal == Token::TokenType::END_OF_FILE || inFollow(nonTerminal, terminal);
+    return {"unexpected " + Token::tokenTypeAsString((Token::TokenType) terminal) + " while parsing "
+            + getSymbol(nonTerminal).toString(),
+            synch ? ErrorStrategy::POP_NON_TERMINAL : ErrorStrategy::SKIP_INPUT};
+}
+
+/**
+ * the symbol an id stands for, for messages and traces
+ */
+GrammarSymbol CompiledGrammar::getSymbol(std::int32_t symbol) const {
+    if (isTerminal(symbol)) return GrammarSymbol::createTerminal((Token::TokenType) symbol);
+    return tables->nonTerminals[symbol - Token::TOKEN_TYPE_COUNT];
+}
+
+const Production &CompiledGrammar::getProduction(int production) const {
+    return tables->productions[production];
+}
+
+const std::vector<Production> &CompiledGrammar::getProductions() const {
+    return tables->productions;
+}
+
+const std::vector<GrammarSymbol> &CompiledGrammar::getNonTerminals() const {
+    return tables->nonTerminals;
+}
+
+/**
+ * bytes used by the parsing tables, the bodies, the sets, the conflicts and the operator levels, shared by every copy
+ */
+std::size_t CompiledGrammar::memoryUsage() const {
+    std::size_t bytes = tables->table.memoryUsage();
+    for (const std::vector<std::int32_t> &body: tables->bodies) bytes += body.size() * sizeof(std::int32_t);
+    bytes += tables->heads.size() * sizeof(std::int32_t);
+    bytes += (tables->first.size() + tables->follow.size() + tables->conflicts.size()) * sizeof(terminal_set_t);
+    bytes += tables->lookaheadRoots.memoryUsage() + tables->lookaheadNodes.size() * sizeof(LookaheadNode)
+             + tables->lookaheadEdges.size() * sizeof(LookaheadEdge);
+    for (const OperatorLevels &levels: tables->levels) {
+        bytes += sizeof(OperatorLevels) + (levels.heads.size() + levels.tails.size()) * sizeof(std::int32_t);
+    }
+    return bytes;
+}
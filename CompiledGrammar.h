@@ -0,0 +1,165 @@
+//
+// Created by jens on 19/10/26.
+//
+
+#ifndef COMPILER_COMPILEDGRAMMAR_H
+#define COMPILER_COMPILEDGRAMMAR_H
+
+#include <array>
+#include <bitset>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "ContextFreeGrammar.h"
+#include "CompressedParsingTable.h"
+
+/**
+ * Frozen snapshot of an analysed ContextFreeGrammar: the LL(1) table, the bodies as symbol ids and FIRST and FOLLOW
+ * as bitsets, all computed in the constructor.
+ *
+ * Every method is const and neither computes nor allocates, so any number of threads may use one snapshot.
+ * Copies are handles sharing the same tables, as cheap to pass around as a shared_ptr.
+ *
+ * Chains of operator precedence levels, as left recursion elimination leaves them, are recognised so a parser
+ * can take an expression as a flat sequence of operands and operators, see OperatorLevels.
+ *
+ * The table keeps the first production of a colliding entry as findParsingTableLL1 does; every such entry is
+ * recorded as a conflict. Only there are up to k terminals of lookahead used: FIRST_k and FOLLOW_k of the grammar
+ * (as LookaheadSet tries) give the strings each production of the row can start with, and the strings starting
+ * with the entry's terminal are laid out as a small decision trie (strong LL(k)). Where k terminals do not decide
+ * either, a parser can hand the input to EarleyParser instead.
+ *
+ * Symbols are ids as in ContextFreeGrammar::getSymbolId: terminals are their Token::TokenType,
+ * non-terminals Token::TOKEN_TYPE_COUNT + their index; productions are their index in getProductions().
+ * Every id, and its negation, fits in 16 bits.
+ */
+class CompiledGrammar {
+public:
+    using terminal_set_t = std::bitset<Token::TOKEN_TYPE_COUNT>;
+
+    static constexpr int DEFAULT_LOOKAHEAD = 3;
+    static constexpr int MAX_LOOKAHEAD = 4;
+    static constexpr int UNDECIDED = -2;    // k terminals of lookahead fit more than one production
+
+    /**
+     * the precedence levels below a non-terminal A ::= B A', A' ::= op B A' | ... | epsilon, where B is the next
+     * tighter level or the operand. Whatever the number of levels, A derives operand (op operand)* with an operator
+     * of any of them.
+     */
+    struct OperatorLevels {
+        std::int32_t operand = 0;           // the symbol below the tightest level, e.g. <factor>
+        terminal_set_t operators;           // of A's level and every tighter one
+        std::vector<std::int32_t> heads;    // A first, then every tighter level; empty if A is no level
+        std::vector<std::int32_t> tails;    // A' first, then the tails of the tighter levels
+        std::array<std::int32_t, Token::TOKEN_TYPE_COUNT> next{};   // per operator, the level (or operand) after it
+    };
+
+private:
+    static constexpr std::int32_t LOOK_FURTHER = -3;
+
+    struct LookaheadNode {
+        std::int32_t production;    // the one production left, UNDECIDED, or LOOK_FURTHER along an edge
+        std::uint32_t firstEdge;
+        std::uint32_t edgeCount;
+    };
+
+    struct LookaheadEdge {
+        std::int32_t terminal;
+        std::uint32_t node;
+    };
+
+    struct Tables {
+        std::vector<Production> productions;
+        std::vector<GrammarSymbol> nonTerminals;
+        std::vector<std::vector<std::int32_t>> bodies;  // symbol ids without epsilon
+        std::vector<std::int32_t> heads;                // per production
+        std::int32_t start = 0;
+        CompressedParsingTable table;       // without defaults, errors are found on the non-terminal
+        std::vector<terminal_set_t> first;  // per non-terminal, EPSILON for nullable ones
+        std::vector<terminal_set_t> follow;
+        std::vector<OperatorLevels> levels; // per non-terminal
+        std::vector<terminal_set_t> conflicts;  // per non-terminal, the terminals predicting several productions
+        bool conflicted = false;
+        int lookahead = 1;                  // k
+        CompressedParsingTable lookaheadRoots;      // per conflict, its root in lookaheadNodes
+        std::vector<LookaheadNode> lookaheadNodes;
+        std::vector<LookaheadEdge> lookaheadEdges;  // of a node together, by terminal
+        std::size_t undecided = 0;          // conflicts where some k terminals fit several productions
+    };
+
+    std::shared_ptr<const Tables> tables;
+
+    static void findOperatorLevels(Tables &built);
+    static void findConflicts(Tables &built);
+    static void findLookahead(Tables &built);
+
+public:
+    explicit CompiledGrammar(ContextFreeGrammar &grammar, int lookahead = DEFAULT_LOOKAHEAD);
+
+    [[nodiscard]] static inline bool isTerminal(std::int32_t symbol) { return symbol < Token::TOKEN_TYPE_COUNT; }
+
+    /**
+     * the production predicted for a non-terminal on a terminal, or CompressedParsingTable::NO_ENTRY
+     */
+    [[nodiscard]] inline int predict(std::int32_t nonTerminal, int terminal) const {
+        return tables->table.lookup(nonTerminal - Token::TOKEN_TYPE_COUNT, terminal);
+    }
+
+    /**
+     * predict() with more lookahead on a conflict: the terminals after `terminal` are asked for as peek(1), peek(2),
+     * ... until one production is left, at most k - 1 of them. Any other entry costs the one lookup.
+     * @return UNDECIDED if k terminals fit several productions; the table's entry if the input fits none of them
+     */
+    template<typename Peek>
+    [[nodiscard]] int predict(std::int32_t nonTerminal, int terminal, Peek &&peek) const {
+        int root = tables->lookaheadRoots.lookup(nonTerminal - Token::TOKEN_TYPE_COUNT, terminal);
+        if (root == CompressedParsingTable::NO_ENTRY) return predict(nonTerminal, terminal);
+        const LookaheadNode *node = &tables->lookaheadNodes[root];
+        for (int depth = 1; node->production == LOOK_FURTHER; depth++) {
+            int next = peek(depth);
+            const LookaheadEdge *edge = tables->lookaheadEdges.data() + node->firstEdge;
+            const LookaheadEdge *last = edge + node->edgeCount;
+            while (edge != last && edge->terminal != next) ++edge;
+            if (edge == last) return predict(nonTerminal, terminal);
+            node = &tables->lookaheadNodes[edge->node];
+        }
+        return node->production;
+    }
+
+    [[nodiscard]] inline int getLookahead() const { return tables->lookahead; }
+
+    [[nodiscard]] inline const std::vector<std::int32_t> &getBody(int production) const {
+        return tables->bodies[production];
+    }
+
+    [[nodiscard]] inline std::int32_t getHead(int production) const { return tables->heads[production]; }
+
+    [[nodiscard]] inline std::int32_t getStart() const { return tables->start; }
+
+    /**
+     * whether more than one production of the non-terminal fits the terminal, predict() returns the first of them
+     */
+    [[nodiscard]] inline bool hasConflict(std::int32_t nonTerminal, int terminal) const {
+        return tables->conflicts[nonTerminal - Token::TOKEN_TYPE_COUNT].test(terminal);
+    }
+
+    [[nodiscard]] inline bool hasConflicts() const { return tables->conflicted; }
+
+    [[nodiscard]] inline const OperatorLevels &getOperatorLevels(std::int32_t nonTerminal) const {
+        return tables->levels[nonTerminal - Token::TOKEN_TYPE_COUNT];
+    }
+
+    [[nodiscard]] std::size_t getUndecidedCount() const;
+    [[nodiscard]] bool inFirst(std::int32_t symbol, int terminal) const;
+    [[nodiscard]] bool inFollow(std::int32_t nonTerminal, int terminal) const;
+    [[nodiscard]] bool isNullable(std::int32_t symbol) const;
+    [[nodiscard]] ErrorStrategy errorStrategy(std::int32_t nonTerminal, int terminal) const;
+    [[nodiscard]] GrammarSymbol getSymbol(std::int32_t symbol) const;
+    [[nodiscard]] const Production &getProduction(int production) const;
+    [[nodiscard]] const std::vector<Production> &getProductions() const;
+    [[nodiscard]] const std::vector<GrammarSymbol> &getNonTerminals() const;
+    [[nodiscard]] std::size_t memoryUsage() const;
+};
+
+
+#endif //COMPILER_COMPILEDGRAMMAR_H
@@ -0,0 +1,125 @@
+//
+// Created by jens on 19/10/26.
+//
+
+#include <algorithm>
+#include <stdexcept>
+#include "CompressedParsingTable.h"
+
+CompressedParsingTable::CompressedParsingTable(const std::vector<std::vector<int>> &rows,
+                                               const std::vector<int> &defaults)
+        : rowCount((int) rows.size()), columnCount(rows.empty() ? 0 : (int) rows[0].size()) {
+    if (defaults.size() != rows.size()) {
+        throw std::runtime_error("a default entry is required for each row");
+    }
+
+    // columns of each row that cannot be served by the default entry
+    // NOTE: error entries are served by the default as well, a row with an epsilon production then predicts it on
+    // any unexpected terminal and the error surfaces when the next terminal on the stack fails to match
+    std::vector<std::vector<int>> significant(rowCount);
+    for (int r = 0; r < rowCount; r++) {
+        if ((int) rows[r].size() != columnCount) {
+            throw std::runtime_error("parsing table rows must have the same length");
+        }
+        for (int c = 0; c < columnCount; c++) {
+            if (rows[r][c] != NO_ENTRY && rows[r][c] != defaults[r]) {
+                significant[r].push_back(c);
+            }
+        }
+    }
+
+    // place the densest rows first, the sparse ones then fill the gaps left between them (first fit)
+    std::vector<int> order(rowCount);
+    for (int r = 0; r < rowCount; r++) order[r] = r;
+    std::stable_sort(order.begin(), order.end(), [&significant](int a, int b) {
+        return significant[a].size() > significant[b].size();
+    });
+
+    std::vector<std::int32_t> bases(rowCount, 0);
+    std::vector<bool> occupied;
+    int highestBase = 0;
+    for (int r: order) {
+        if (significant[r].empty()) continue;   // everything comes from the default, base 0 never matches check
+        int b = 0;
+        while (true) {
+            bool fits = true;
+            for (int c: significant[r]) {
+                if (b + c < (int) occupied.size() && occupied[b + c]) {
+                    fits = false;
+                    break;
+                }
+            }
+            if (fits) break;
+            b++;
+        }
+        bases[r] = b;
+        highestBase = std::max(highestBase, b);
+        if ((int) occupied.size() < b + columnCount) occupied.resize(b + columnCount, false);
+        for (int c: significant[r]) occupied[b + c] = true;
+    }
+
+    // every base + column stays in range, so lookup needs no bounds check
+    slotCount = highestBase + columnCount;
+    std::vector<std::int32_t> checks(slotCount, NO_ENTRY);
+    std::vector<std::int32_t> nexts(slotCount, NO_ENTRY);
+    for (int r = 0; r < rowCount; r++) {
+        for (int c: significant[r]) {
+            checks[bases[r] + c] = r;
+            nexts[bases[r] + c] = rows[r][c];
+        }
+    }
+
+    auto owned = std::make_shared<std::vector<std::vector<std::int32_t>>>();
+    owned->push_back(std::move(bases));
+    owned->emplace_back(defaults.begin(), defaults.end());
+    owned->push_back(std::move(checks));
+    owned->push_back(std::move(nexts));
+    this->base = (*owned)[0].data();
+    this->defaults = (*owned)[1].data();
+    this->check = (*owned)[2].data();
+    this->next = (*owned)[3].data();
+    this->storage = owned;
+}
+
+CompressedParsingTable::CompressedParsingTable(int rowCount, int columnCount, int slotCount,
+                                               const std::int32_t *base, const std::int32_t *defaults,
+                                               const std::int32_t *check, const std::int32_t *next,
+                                               std::shared_ptr<const void> storage)
+        : rowCount(rowCount), columnCount(columnCount), slotCount(slotCount),
+          base(base), defaults(defaults), check(check), next(next), storage(std::move(storage)) {}
+
+bool CompressedParsingTable::isEmpty() const {
+    return base == nullptr;
+}
+
+int CompressedParsingTable::getRowCount() const {
+    return rowCount;
+}
+
+int CompressedParsingTable::getColumnCount() const {
+    return columnCount;
+}
+
+int CompressedParsingTable::getSlotCount() const {
+    return slotCount;
+}
+
+const std::int32_t *CompressedParsingTable::getBase() const {
+    return base;
+}
+
+const std::int32_t *CompressedParsingTable::getDefaults() const {
+    return defaults;
+}
+
+const std::int32_t *CompressedParsingTable::getCheck() const {
+    return check;
+}
+
+const std::int32_t *CompressedParsingTable::getNext() const {
+    return next;
+}
+
+std::size_t CompressedParsingTable::memoryUsage() const {
+    return (2 * (std::size_t) rowCount + 2 * (std::size_t) slotCount) * sizeof(std::int32_t);
+}
@@ -0,0 +1,84 @@
+//
+// Created by jens on 19/10/26.
+//
+
+#ifndef COMPILER_COMPRESSEDPARSINGTABLE_H
+#define COMPILER_COMPRESSEDPARSINGTABLE_H
+
+#include <vector>
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * LL(1) parsing table compressed by row displacement (comb vector).
+ *
+ * Rows (non-terminals) are overlaid onto one shared `next` array, row r starting at offset `base[r]`.
+ * `check[i]` records the row owning slot i, so a lookup is a single probe:
+ * ```
+ *      i = base[row] + column
+ *      check[i] == row ? next[i] : defaults[row]
+ * ```
+ * Entries predicting the epsilon production of a row are not stored, they are served by `defaults[row]`.
+ * Rows without an epsilon production default to NO_ENTRY (error).
+ *
+ * The table is immutable once built. The arrays are either owned by the table or borrowed from a memory-mapped
+ * GrammarImage, in both cases copies share them.
+ */
+class CompressedParsingTable {
+public:
+    static constexpr int NO_ENTRY = -1;
+
+private:
+    int rowCount = 0;
+    int columnCount = 0;
+    int slotCount = 0;
+    const std::int32_t *base = nullptr;       // per row: offset into next/check
+    const std::int32_t *defaults = nullptr;   // per row: production used when the row has no entry on the column
+    const std::int32_t *check = nullptr;      // per slot: row owning the slot, NO_ENTRY if free
+    const std::int32_t *next = nullptr;       // per slot: production index
+    std::shared_ptr<const void> storage;      // keeps the arrays above alive
+
+public:
+    CompressedParsingTable() = default;
+
+    /**
+     * @param rows dense table, rows[nonTerminal][terminal] = production index or NO_ENTRY
+     * @param defaults default production index of each row or NO_ENTRY
+     */
+    CompressedParsingTable(const std::vector<std::vector<int>> &rows, const std::vector<int> &defaults);
+
+    /**
+     * borrows arrays laid out by another owner (e.g. a memory-mapped file), `storage` keeps them alive
+     */
+    CompressedParsingTable(int rowCount, int columnCount, int slotCount,
+                           const std::int32_t *base, const std::int32_t *defaults,
+                           const std::int32_t *check, const std::int32_t *next,
+                           std::shared_ptr<const void> storage);
+
+    [[nodiscard]] inline int lookup(int row, int column) const {
+        int i = base[row] + column;
+        return check[i] == row ? next[i] : defaults[row];
+    }
+
+    /**
+     * the entry stored for the row and column, NO_ENTRY where lookup() falls back to the row's default
+     */
+    [[nodiscard]] inline int lookupStored(int row, int column) const {
+        int i = base[row] + column;
+        return check[i] == row ? next[i] : NO_ENTRY;
+    }
+
+    [[nodiscard]] bool isEmpty() const;
+    [[nodiscard]] int getRowCount() const;
+    [[nodiscard]] int getColumnCount() const;
+    [[nodiscard]] int getSlotCount() const;
+    [[nodiscard]] const std::int32_t *getBase() const;
+    [[nodiscard]] const std::int32_t *getDefaults() const;
+    [[nodiscard]] const std::int32_t *getCheck() const;
+    [[nodiscard]] const std::int32_t *getNext() const;
+    [[nodiscard]] std::size_t memoryUsage() const;     // bytes used by the four arrays
+};
+
+
+#endif //COMPILER_COMPRESSEDPARSINGTABLE_H
@@ -7,8 +7,12 @@
 #include <algorithm>
 #include <iomanip>
 #include <fstream>
+#include <functional>
+#include <bitset>
 #include "ContextFreeGrammar.h"
-#include "logger.h"
+#include "Stats.h"
+#include "ThreadPool.h"
+#include "Trace.h"
 
 // -------------------- CHANGE DETECTOR DEF START --------------------
 // It can detect multiple changes in a single loop and is used to detect changes in the FIRST and FOLLOW sets.
@@ -63,75 +67,405 @@ ContextFreeGrammar::ContextFreeGrammar(const std::vector<Production> &production
         }
         this->terminals.insert(GrammarSymbol::eof());   // end marker is also in the terminals
     }
+    indexNonTerminals();
 }
 
-ContextFreeGrammar &ContextFreeGrammar::eliminateDirectLeftRecursive() {
+/**
+ * numbers the non-terminals in order of their first appearance as a head,
+ * the number is used as the row of the parsing table in its matrix and compressed forms
+ */
+void ContextFreeGrammar::indexNonTerminals() {
+    nonTerminalList.clear();
+    nonTerminalIndex.clear();
+    for (const Production &p: productions) {
+        if (nonTerminalIndex.count(p.head) == 0) {
+            nonTerminalIndex.insert({p.head, (int) nonTerminalList.size()});
+            nonTerminalList.push_back(p.head);
+        }
+    }
+}
+
+// -------------------- GRAMMAR TRANSFORMATIONS START --------------------
+// The transformations work on the productions grouped by head, in order of first appearance, and write them back
+// through replaceProductions. Every production is visited a bounded number of times so they stay near linear in
+// the size of the grammar, except for the ordered substitution in eliminateLeftRecursive which is confined to the
+// non-terminals that are actually mutually left recursive.
+
+namespace {
+    using body_t = std::vector<GrammarSymbol>;
+
+    /**
+     * Tarjan's strongly connected components, iterative so deep grammars do not overflow the stack.
+     * A component is numbered after every component it has an edge to.
+     */
+    std::vector<int> stronglyConnectedComponents(const std::vector<std::vector<int>> &edges, int &components) {
+        const int count = (int) edges.size();
+        std::vector<int> component(count, -1), low(count, 0), order(count, -1), stack;
+        std::vector<bool> onStack(count, false);
+        int counter = 0;
+        components = 0;
+        for (int root = 0; root < count; root++) {
+            if (order[root] >= 0) continue;
+            std::vector<std::pair<int, int>> frames{{root, 0}};
+            while (!frames.empty()) {
+                int v = frames.back().first;
+                int &edge = frames.back().second;
+                if (edge == 0) {
+                    order[v] = low[v] = counter++;
+                    stack.push_back(v);
+                    onStack[v] = true;
+                }
+                if (edge < edges[v].size()) {
+                    int w = edges[v][edge++];
+                    if (order[w] < 0) {
+                        frames.emplace_back(w, 0);
+                    } else if (onStack[w]) {
+                        low[v] = std::min(low[v], order[w]);
+                    }
+                    continue;
+                }
+                if (low[v] == order[v]) {
+                    while (true) {
+                        int w = stack.back();
+                        stack.pop_back();
+                        onStack[w] = false;
+                        component[w] = components;
+                        if (w == v) break;
+                    }
+                    components++;
+                }
+                frames.pop_back();
+                if (!frames.empty()) low[frames.back().first] = std::min(low[frames.back().first], low[v]);
+            }
+        }
+        return component;
+    }
+
+    struct RuleSet {
+        std::vector<GrammarSymbol> heads;
+        std::unordered_map<GrammarSymbol, int> index;
+        std::unordered_set<std::string> names;
+        std::vector<std::vector<body_t>> bodies;
+
+        explicit RuleSet(const std::vector<Production> &productions) {
+            for (const Production &p: productions) {
+                bodies[add(p.head)].push_back(p.body);
+                for (const GrammarSymbol &s: p.body) {
+                    if (!s.isTerminal()) names.insert(s.getNonTerminal());
+                }
+            }
+        }
+
+        int add(const GrammarSymbol &head) {
+            auto it = index.find(head);
+            if (it != index.end()) return it->second;
+            index.insert({head, (int) heads.size()});
+            names.insert(head.getNonTerminal());
+            heads.push_back(head);
+            bodies.emplace_back();
+            return (int) heads.size() - 1;
+        }
 
-    std::vector<Production> newProductions;
+        // A', A'', ... whichever is not taken yet
+        int fresh(int of) {
+            std::string name = heads[of].getNonTerminal() + "'";
+            while (names.count(name)) name += "'";
+            return add(GrammarSymbol::createNonTerminal(name));
+        }
 
-    // split productions into direct left recursive and non left recursive
-    std::unordered_map<GrammarSymbol, std::vector<Production>> directLeftRecursiveProductions;
-    std::unordered_map<GrammarSymbol, std::vector<Production>> nonLeftRecursiveProductions;
+        [[nodiscard]] int indexOf(const GrammarSymbol &symbol) const {
+            if (symbol.isTerminal()) return -1;
+            auto it = index.find(symbol);
+            return it == index.end() ? -1 : it->second;
+        }
+
+        static bool isEpsilonBody(const body_t &body) {
+            return body.size() == 1 && body[0].isEpsilon();
+        }
+
+        // A ::= A u1 | ... | v1 | ...  becomes  A ::= v1 A' | ...,  A' ::= u1 A' | ... | epsilon
+        void eliminateDirect(int A) {
+            std::vector<body_t> recursive, others;
+            for (body_t &body: bodies[A]) {
+                if (body[0] == heads[A]) {
+                    if (body.size() > 1) recursive.emplace_back(body.begin() + 1, body.end());   // A ::= A is a cycle
+                } else {
+                    others.push_back(std::move(body));
+                }
+            }
+            if (recursive.empty()) {
+                bodies[A] = std::move(others);
+                return;
+            }
+            int A_ = fresh(A);
+            for (body_t &body: others) {
+                if (isEpsilonBody(body)) body.clear();
+                body.push_back(heads[A_]);
+            }
+            for (body_t &body: recursive) {
+                body.push_back(heads[A_]);
+            }
+            recursive.push_back({GrammarSymbol::epsilon()});
+            bodies[A] = std::move(others);
+            bodies[A_] = std::move(recursive);
+        }
 
+        [[nodiscard]] std::vector<Production> toProductions() const {
+            std::vector<Production> productions;
+            for (int A = 0; A < heads.size(); A++) {
+                for (const body_t &body: bodies[A]) {
+                    productions.emplace_back(heads[A], body);
+                }
+            }
+            return productions;
+        }
+    };
+}
 
-    // for each production, check if it is direct left recursive
-    // if so, put it into directLeftRecursiveProductions
-    // otherwise put it into nonLeftRecursiveProductions
+/**
+ * installs a transformed production list: the symbol sets and indices are rebuilt,
+ * the analysis of the old productions (sets, tables, image) is dropped since none of it holds any more
+ */
+void ContextFreeGrammar::replaceProductions(const std::vector<Production> &newProductions) {
+    if (newProductions.empty()) {
+        throw std::runtime_error("productions cannot be empty");
+    }
+    this->productions = newProductions;
+    this->nonTermimals.clear();
+    this->terminals.clear();
     for (const Production &p: productions) {
-        if (p.head == p.body[0]) {
-            directLeftRecursiveProductions[p.head].push_back(p);
-        } else {
-            nonLeftRecursiveProductions[p.head].push_back(p);
+        this->nonTermimals.insert(p.head);
+        for (const GrammarSymbol &s: p.body) {
+            if (s.isTerminal() && !s.isEpsilon()) {
+                this->terminals.insert(s);
+            }
         }
     }
+    this->terminals.insert(GrammarSymbol::eof());
+    this->FIRST.clear();
+    this->FIRST_P.clear();
+    this->FOLLOW.clear();
+    this->PARSING_TABLE.clear();
+    this->status = INITIAL;
+    this->image.reset();
+    this->compressedTable = CompressedParsingTable();
+    indexNonTerminals();
+}
+
+ContextFreeGrammar &ContextFreeGrammar::eliminateDirectLeftRecursive() {
+    RuleSet rules(productions);
+    int count = (int) rules.heads.size();   // the new A' never need it
+    for (int A = 0; A < count; A++) {
+        rules.eliminateDirect(A);
+    }
+    replaceProductions(rules.toProductions());
+    return *this;
+}
 
-    // for every recorded non-left-recursive production
-    // check if its head has a production that is left recursive
-    for (auto it: nonLeftRecursiveProductions) {
-        GrammarSymbol s = it.first;
-        // if it doesn't have a left recursive production, just copy it
-        if (directLeftRecursiveProductions.count(s) == 0) {
-            newProductions.insert(newProductions.end(), it.second.begin(), it.second.end());
+/**
+ * removes direct and indirect left recursion by ordered substitution (Aho et al., algorithm 4.19):
+ * with the non-terminals ordered A1 ... An, every Ai ::= Aj u with j < i is expanded with the productions of Aj,
+ * then the direct left recursion of Ai is eliminated.
+ *
+ * Only the non-terminals of a strongly connected component of the left corner graph (A -> B when A ::= B ...)
+ * can be mutually left recursive, so the substitution runs per component and everything else is copied untouched.
+ * Left recursion hidden behind a nullable prefix (A ::= B A with B nullable) is not detected.
+ */
+ContextFreeGrammar &ContextFreeGrammar::eliminateLeftRecursive() {
+    RuleSet rules(productions);
+    const int count = (int) rules.heads.size();
+
+    // left corner graph
+    std::vector<std::vector<int>> corners(count);
+    for (int A = 0; A < count; A++) {
+        for (const body_t &body: rules.bodies[A]) {
+            int B = rules.indexOf(body[0]);
+            if (B >= 0) corners[A].push_back(B);
         }
     }
 
-    // for every symbol that has a left recursive production
-    for (auto it: directLeftRecursiveProductions) {
-        // create a new non-terminal A'
-        GrammarSymbol A_ = GrammarSymbol::createNonTerminal(it.first.getNonTerminal() + "'");
-        this->nonTermimals.insert(A_);
+    int components = 0;
+    std::vector<int> component = stronglyConnectedComponents(corners, components);
+
+    std::vector<std::vector<int>> members(components);
+    for (int A = 0; A < count; A++) {
+        members[component[A]].push_back(A);     // ascending, i.e. in order of first appearance
+    }
 
-        // for every left-recursive production A ::= A u
-        // add a new production A ::= u A'
-        for (const Production &p: it.second) {
-            std::vector<GrammarSymbol> newBody = p.body;
-            newBody.erase(newBody.begin());
-            newBody.push_back(A_);
-            newProductions.emplace_back(A_, newBody);
+    for (const std::vector<int> &scc: members) {
+        for (int i = 0; i < scc.size(); i++) {
+            int Ai = scc[i];
+            for (int j = 0; j < i; j++) {
+                int Aj = scc[j];
+                // Ai ::= Aj u  becomes  Ai ::= v u  for every Aj ::= v
+                std::vector<body_t> expanded;
+                for (body_t &body: rules.bodies[Ai]) {
+                    if (body[0] != rules.heads[Aj]) {
+                        expanded.push_back(std::move(body));
+                        continue;
+                    }
+                    for (const body_t &v: rules.bodies[Aj]) {
+                        body_t substituted;
+                        if (!RuleSet::isEpsilonBody(v)) substituted = v;
+                        substituted.insert(substituted.end(), body.begin() + 1, body.end());
+                        if (substituted.empty()) substituted.push_back(GrammarSymbol::epsilon());
+                        expanded.push_back(std::move(substituted));
+                    }
+                }
+                rules.bodies[Ai] = std::move(expanded);
+            }
+            rules.eliminateDirect(Ai);
         }
+    }
+    replaceProductions(rules.toProductions());
+    return *this;
+}
 
-        // for every non-left-recursive production A ::= u
-        // add a new production A' ::= u
-        for (const Production &p: nonLeftRecursiveProductions[it.first]) {
-            std::vector<GrammarSymbol> newBody = p.body;
-            newBody.push_back(A_);
-            newProductions.emplace_back(it.first, newBody);
+/**
+ * left factoring: A ::= u v1 | u v2 | ... with the longest common prefix u becomes A ::= u A', A' ::= v1 | v2 | ...
+ * The new A' are factored in turn, so every production is split at most once per shared prefix.
+ */
+ContextFreeGrammar &ContextFreeGrammar::leftFactor() {
+    RuleSet rules(productions);
+    for (int A = 0; A < rules.heads.size(); A++) {     // heads grows while factoring
+        // group the bodies by their first symbol, keeping the order of the productions
+        std::vector<std::vector<body_t>> groups;
+        std::unordered_map<GrammarSymbol, int> groupOf;
+        for (body_t &body: rules.bodies[A]) {
+            auto it = groupOf.find(body[0]);
+            if (it == groupOf.end() || body[0].isEpsilon()) {
+                groupOf[body[0]] = (int) groups.size();
+                groups.emplace_back();
+                groups.back().push_back(std::move(body));
+            } else {
+                groups[it->second].push_back(std::move(body));
+            }
         }
-        newProductions.push_back(Production(A_, {GrammarSymbol::epsilon()}));
+
+        std::vector<body_t> factored;
+        for (std::vector<body_t> &group: groups) {
+            // identical alternatives are one, otherwise each would leave an A' ::= EPSILON of its own
+            std::vector<body_t> distinct;
+            for (body_t &body: group) {
+                if (std::find(distinct.begin(), distinct.end(), body) == distinct.end()) {
+                    distinct.push_back(std::move(body));
+                }
+            }
+            group = std::move(distinct);
+            if (group.size() == 1) {
+                factored.push_back(std::move(group[0]));
+                continue;
+            }
+            size_t prefix = group[0].size();
+            for (const body_t &body: group) {
+                size_t i = 0;
+                while (i < prefix && i < body.size() && body[i] == group[0][i]) i++;
+                prefix = i;
+            }
+            int A_ = rules.fresh(A);
+            body_t common(group[0].begin(), group[0].begin() + prefix);
+            common.push_back(rules.heads[A_]);
+            factored.push_back(std::move(common));
+            for (const body_t &body: group) {
+                body_t suffix(body.begin() + prefix, body.end());
+                if (suffix.empty()) suffix.push_back(GrammarSymbol::epsilon());
+                rules.bodies[A_].push_back(std::move(suffix));
+            }
+        }
+        rules.bodies[A] = std::move(factored);
     }
-    this->productions = newProductions;
-    this->status = INITIAL;
+    replaceProductions(rules.toProductions());
     return *this;
 }
 
+/**
+ * removes unproductive non-terminals (they derive no terminal string) with every production using them,
+ * then the non-terminals unreachable from the start symbol. Both passes are linear: a production becomes productive
+ * when its counter of not yet productive body symbols drops to 0.
+ */
+ContextFreeGrammar &ContextFreeGrammar::removeUselessSymbols() {
+    const int P = (int) productions.size();
+    std::unordered_map<GrammarSymbol, std::vector<int>> occurrences;   // non-terminal -> productions using it
+    std::vector<int> pending(P, 0);
+    std::vector<int> ready;
+    for (int p = 0; p < P; p++) {
+        for (const GrammarSymbol &s: productions[p].body) {
+            if (!s.isTerminal()) {
+                occurrences[s].push_back(p);
+                pending[p]++;
+            }
+        }
+        if (pending[p] == 0) ready.push_back(p);
+    }
+    std::unordered_set<GrammarSymbol> productive;
+    while (!ready.empty()) {
+        int p = ready.back();
+        ready.pop_back();
+        if (!productive.insert(productions[p].head).second) continue;
+        for (int q: occurrences[productions[p].head]) {
+            if (--pending[q] == 0) ready.push_back(q);
+        }
+    }
+    if (productive.count(startSymbol) == 0) {
+        throw std::runtime_error("the start symbol " + startSymbol.toString() + " derives no terminal string");
+    }
+
+    std::unordered_map<GrammarSymbol, std::vector<int>> productionsOf;
+    for (int p = 0; p < P; p++) {
+        if (pending[p] == 0) productionsOf[productions[p].head].push_back(p);
+    }
+    std::unordered_set<GrammarSymbol> reachable{startSymbol};
+    std::vector<GrammarSymbol> frontier{startSymbol};
+    while (!frontier.empty()) {
+        GrammarSymbol A = frontier.back();
+        frontier.pop_back();
+        for (int p: productionsOf[A]) {
+            for (const GrammarSymbol &s: productions[p].body) {
+                if (!s.isTerminal() && reachable.insert(s).second) frontier.push_back(s);
+            }
+        }
+    }
+
+    std::vector<Production> useful;
+    for (int p = 0; p < P; p++) {
+        if (pending[p] == 0 && reachable.count(productions[p].head)) useful.push_back(productions[p]);
+    }
+    if (useful.size() != productions.size()) replaceProductions(useful);
+    return *this;
+}
+
+/**
+ * the whole pipeline to get a textbook grammar closer to LL(1)
+ */
+ContextFreeGrammar &ContextFreeGrammar::prepareForLL1() {
+    return removeUselessSymbols().eliminateLeftRecursive().leftFactor().removeUselessSymbols();
+}
+
+// -------------------- GRAMMAR TRANSFORMATIONS END --------------------
+
+/**
+ * the loops below stop at the first symbol that is not nullable, so reaching the end of a body only tells that the
+ * symbols before the last one are nullable, the last one still has to be checked
+ */
+bool ContextFreeGrammar::isNullable(const GrammarSymbol &symbol) {
+    if (symbol.isTerminal()) {
+        return symbol.isEpsilon();
+    }
+    return FIRST[symbol].count(GrammarSymbol::epsilon()) != 0;
+}
+
 /**
  * this function finds the FIRST set for each non-terminals
  */
 void ContextFreeGrammar::findFirstForNonTerminals() {
     if (this->status >= FIRST_COMPUTED) return;
+    if (image) return loadSetsFromImage();
+    STATS_PHASE(ANALYSIS);
+    Trace::Span span("analysis", "FIRST");
     INSTALL_CHANGE_DETECTOR(unsigned)
         while (CHANGE_DETECTOR_LOOP_CONDITION) {    // repeat until no set grows in size
             RESET_CHANGE_DETECTOR
+            STATS_ADD(firstIterations, 1);
 
             for (const Production &p: productions) {
                 const GrammarSymbol &firstSymbol = p.body[0];
@@ -185,7 +519,7 @@ void ContextFreeGrammar::findFirstForNonTerminals() {
                         }
                     }
 
-                    if (i == p.body.size()) {   // if all symbols in the body are nullable
+                    if (i == p.body.size() && isNullable(p.body.back())) {  // if all symbols in the body are nullable
                         FIRST[p.head].insert(GrammarSymbol::epsilon());
                     }
 
@@ -203,6 +537,9 @@ void ContextFreeGrammar::findFirstForNonTerminals() {
 void ContextFreeGrammar::findFirstForProductions() {
     if (this->status >= FIRST_P_COMPUTED) return;
     if (this->status < FIRST_COMPUTED) findFirstForNonTerminals();
+    if (image) return loadSetsFromImage();
+    STATS_PHASE(ANALYSIS);
+    Trace::Span span("analysis", "FIRST of productions");
 
     for (const Production &p: productions) {
 
@@ -245,7 +582,7 @@ void ContextFreeGrammar::findFirstForProductions() {
                 }
             }
         }
-        if (i == p.body.size()) {   // if all symbols in the body are nullable
+        if (i == p.body.size() && isNullable(p.body.back())) {  // if all symbols in the body are nullable
             FIRST_P[p].insert(GrammarSymbol::epsilon());
         }
     }
@@ -253,92 +590,626 @@ void ContextFreeGrammar::findFirstForProductions() {
     if (this->status < FIRST_P_COMPUTED) this->status = FIRST_P_COMPUTED;
 }
 
+/**
+ * adds FIRST of the symbol sequence, without epsilon, to `into`
+ * @return whether the whole sequence is nullable
+ */
+bool ContextFreeGrammar::findFirstOfSequence(const std::vector<GrammarSymbol> &symbols, first_set_entry_t &into) {
+    for (const GrammarSymbol &s: symbols) {
+        if (s.isEpsilon()) continue;
+        if (s.isTerminal()) {
+            into.insert(s);
+            return false;
+        }
+        const first_set_entry_t &first = FIRST[s];
+        if (&first != &into) {
+            for (const GrammarSymbol &t: first) {
+                if (!t.isEpsilon()) into.insert(t);
+            }
+        }
+        if (first.count(GrammarSymbol::epsilon()) == 0) return false;
+    }
+    return true;
+}
+
+/**
+ * applies the FOLLOW rules of one production A ::= u B v:
+ * FIRST(v) without epsilon is a subset of FOLLOW[B], and so is FOLLOW[A] if v is nullable
+ * @param grown if given, receives the non-terminals whose FOLLOW set grew
+ * @return whether any FOLLOW set grew
+ */
+bool ContextFreeGrammar::findFollowOfProduction(const Production &p, std::vector<GrammarSymbol> *grown) {
+    bool changed = false;
+    first_set_entry_t suffixFirst;  // FIRST of the body right of the current symbol
+    bool nullableSuffix = true;     // the last symbol in the body always has a nullable suffix
+    for (int i = (int) p.body.size() - 1; i >= 0; i--) {  // backward scan of the body
+        const GrammarSymbol &current = p.body[i];
+
+        if (!current.isTerminal()) {
+            follow_set_entry_t &follow = FOLLOW[current];
+            std::size_t before = follow.size();
+            follow.insert(suffixFirst.begin(), suffixFirst.end());
+            if (nullableSuffix && current != p.head) {
+                const follow_set_entry_t &headFollow = FOLLOW[p.head];
+                follow.insert(headFollow.begin(), headFollow.end());
+            }
+            if (follow.size() != before) {
+                changed = true;
+                if (grown) grown->push_back(current);
+            }
+        }
+
+        // extend the suffix by the current symbol
+        if (current.isEpsilon()) continue;
+        if (current.isTerminal() || FIRST[current].count(GrammarSymbol::epsilon()) == 0) {
+            suffixFirst.clear();
+            nullableSuffix = false;
+        }
+        if (current.isTerminal()) {
+            suffixFirst.insert(current);
+        } else {
+            for (const GrammarSymbol &s: FIRST[current]) {
+                if (!s.isEpsilon()) suffixFirst.insert(s);
+            }
+        }
+    }
+    return changed;
+}
+
 void ContextFreeGrammar::findFollow() {
     if (this->status >= FOLLOW_COMPUTED) return;
     if (this->status < FIRST_P_COMPUTED) findFirstForProductions();
+    if (image) return loadSetsFromImage();
+    STATS_PHASE(ANALYSIS);
+    Trace::Span span("analysis", "FOLLOW");
 
-    // the endmarker eof belongs to FIRST[start]
+    // the endmarker eof belongs to FOLLOW[start]
     FOLLOW[getStartSymbol()].insert(GrammarSymbol::eof());
-    INSTALL_CHANGE_DETECTOR(unsigned)
-        while (CHANGE_DETECTOR_LOOP_CONDITION) {    // repeat until no set grows in size
-            RESET_CHANGE_DETECTOR
+    bool changed = true;
+    while (changed) {    // repeat until no set grows in size
+        changed = false;
+        STATS_ADD(followIterations, 1);
+        for (const Production &p: productions) {
+            changed |= findFollowOfProduction(p, nullptr);
+        }
+    }
 
-            for (const Production &p: productions) {
+    if (this->status < FOLLOW_COMPUTED) this->status = FOLLOW_COMPUTED;
+}
 
-                bool nullableSuffix = true;     // the last symbol in the body always has a nullable suffix
-                for (int i = p.body.size() - 1; i >= 0; i--) {  // backward scan of the body
-                    const GrammarSymbol &current = p.body[i];
-
-                    if (nullableSuffix && !current.isTerminal()) {
-                        // if the current symbol has a nullable suffix, FOLLOW[head] is a subset of FOLLOW[current]
-                        DETECT_CHANGE_BEGIN(FOLLOW[current].size())
-                            FOLLOW[current].insert(FOLLOW[p.head].begin(),
-                                                   FOLLOW[p.head].end());   // head is guaranteed to be non-terminal by CFG
-                            FOLLOW[current].erase(GrammarSymbol::epsilon());
-                        DETECT_CHANGE_END(FOLLOW[current].size())
-                    }
+/**
+ * builds the row of the parsing table for one non-terminal
+ * @param indices positions in the production list of the productions of `s`, in order
+ */
+void ContextFreeGrammar::findParsingTableRow(const GrammarSymbol &s, const std::vector<int> &indices) {
+    parsing_table_entry_t entryForS;
+    for (int index: indices) {
+        const Production &p = productions[index];
+        // for each production with head s
 
-                    if (i - 1 >= 0 && !p.body[i - 1].isTerminal()) {
-                        // if the symbol right to the current symbol exists and is non-terminal,
-                        // FIRST[current] is a subset of FOLLOW[current - 1]
-                        DETECT_CHANGE_BEGIN(FOLLOW[p.body[i - 1]].size())
-                            if (current.isTerminal()) {
-                                FOLLOW[p.body[i - 1]].insert(current);
-                            } else {
-                                FOLLOW[p.body[i - 1]].insert(FIRST[current].begin(), FIRST[current].end());
-                            }
-                            FOLLOW[p.body[i - 1]].erase(GrammarSymbol::epsilon());
-                        DETECT_CHANGE_END(FOLLOW[p.body[i - 1]].size())
-                    }
+        // NOTE: Had there been any collision when
+        // (1) epsilon is in FIRST[s] and
+        // (2) FIRST[s] intersect FOLLOW[s] is not empty,
+        // place the production of preference as the first occurrence of its kind
+        // so that it can override the latter (since latter cannot be inserted again into the set)
 
-                    // update if the suffix containing current symbol is nullable
-                    if (current.isTerminal() || FIRST[current].count(GrammarSymbol::epsilon()) == 0) {
-                        nullableSuffix = false;
+        if (p.isEpsilonProduction()) {
+            // for productions such as A ::= epsilon, we add it to columns with respect to their FOLLOW set
+            for (const GrammarSymbol &nt: FOLLOW[s]) {
+                entryForS.insert({nt, p});
+            }
+        } else {
+            for (const GrammarSymbol &nt: FIRST_P[p]) {  // for each lookahead of this production, assuming LL(1)
+                entryForS.insert({nt, p});   // add to the appropriate column: entry[terminal] = production
+            }
+        }
+    }
+    PARSING_TABLE[s] = entryForS;   // set entry to the corresponding head: PARSING_TABLE[non-terminal] = entry
+}
+
+void ContextFreeGrammar::findParsingTableLL1() {
+    if (this->status >= PARSING_TABLE_COMPUTED) return;
+    if (this->status < FOLLOW_COMPUTED) findFollow();
+    STATS_PHASE(ANALYSIS);
+    Trace::Span span("analysis", "LL(1) table");
+
+    std::vector<std::vector<int>> productionsOf(nonTerminalList.size());
+    for (int i = 0; i < productions.size(); i++) {
+        productionsOf[nonTerminalIndex.at(productions[i].head)].push_back(i);
+    }
+    for (int row = 0; row < nonTerminalList.size(); row++) {
+        findParsingTableRow(nonTerminalList[row], productionsOf[row]);
+    }
+    if (this->status < PARSING_TABLE_COMPUTED) this->status = PARSING_TABLE_COMPUTED;
+}
+
+// -------------------- PARALLEL ANALYSIS START --------------------
+
+/**
+ * computes FIRST, FIRST_P, FOLLOW and the parsing table on a thread pool, with the same result as the sequential
+ * findParsingTableLL1.
+ *
+ * Instead of iterating over all productions until nothing changes, each set is solved once its inputs are final:
+ * FIRST[A] depends on FIRST[B] for the B in a nullable prefix of a body of A, FOLLOW[B] on FOLLOW[A] for the B with a
+ * nullable suffix in a body of A. The strongly connected components of each dependency graph are grouped into levels
+ * (a component is one level above the highest component it depends on); the components of a level do not depend on
+ * each other and are solved in parallel, iterating only over their own productions. The sets are bitsets over the
+ * token types while solving, and are written to the hash sets at the end, one set per task.
+ */
+void ContextFreeGrammar::analyseInParallel(ThreadPool &pool) {
+    STATS_PHASE(ANALYSIS);
+    Trace::Span span("analysis", "parallel analysis");
+    using set_t = std::bitset<Token::TOKEN_TYPE_COUNT>;
+    const int T = Token::TOKEN_TYPE_COUNT;
+    const int N = (int) nonTerminalList.size();
+    const int P = (int) productions.size();
+    const int EPSILON = Token::TokenType::EPSILON;
+
+    // bodies as symbol ids without epsilon, -1 for a non-terminal without productions
+    std::vector<std::vector<int>> bodies(P);
+    std::vector<int> heads(P);
+    std::vector<std::vector<int>> productionsOf(N);
+    for (int p = 0; p < P; p++) {
+        heads[p] = nonTerminalIndex.at(productions[p].head);
+        productionsOf[heads[p]].push_back(p);
+        for (const GrammarSymbol &s: productions[p].body) {
+            if (!s.isEpsilon()) bodies[p].push_back(getSymbolId(s));
+        }
+    }
+
+    // nullable non-terminals: a production becomes nullable when its count of not yet nullable symbols drops to 0
+    std::vector<bool> nullable(N, false);
+    {
+        std::vector<int> pending(P, 0), ready;
+        std::vector<std::vector<int>> occurrences(N);
+        for (int p = 0; p < P; p++) {
+            for (int id: bodies[p]) {
+                pending[p]++;
+                if (id >= T) occurrences[id - T].push_back(p);
+            }
+            if (pending[p] == 0) ready.push_back(p);
+        }
+        while (!ready.empty()) {
+            int A = heads[ready.back()];
+            ready.pop_back();
+            if (nullable[A]) continue;
+            nullable[A] = true;
+            for (int p: occurrences[A]) {
+                if (--pending[p] == 0) ready.push_back(p);
+            }
+        }
+    }
+    auto isNullableId = [&](int id) { return id >= T && nullable[id - T]; };
+
+    // solves the components of `edges` (A -> B: the set of A depends on the set of B) level by level
+    auto solveByLevels = [&](const std::vector<std::vector<int>> &edges, const std::function<bool(int)> &solve) {
+        int components = 0;
+        std::vector<int> component = stronglyConnectedComponents(edges, components);
+        std::vector<int> level(components, 0);
+        std::vector<std::vector<int>> members(components);
+        for (int A = 0; A < N; A++) members[component[A]].push_back(A);
+        int levels = 0;
+        for (int c = 0; c < components; c++) {     // dependencies come first in component order
+            for (int A: members[c]) {
+                for (int B: edges[A]) {
+                    if (component[B] != c) level[c] = std::max(level[c], level[component[B]] + 1);
+                }
+            }
+            levels = std::max(levels, level[c] + 1);
+        }
+        std::vector<std::vector<int>> byLevel(levels);
+        for (int c = 0; c < components; c++) byLevel[level[c]].push_back(c);
+        for (const std::vector<int> &current: byLevel) {
+            pool.parallelFor(current.size(), [&](std::size_t begin, std::size_t end) {
+                for (std::size_t i = begin; i < end; i++) {
+                    const std::vector<int> &scc = members[current[i]];
+                    bool cyclic = scc.size() > 1 || std::count(edges[scc[0]].begin(), edges[scc[0]].end(), scc[0]);
+                    bool changed = true;
+                    while (changed) {   // a single pass unless the component is a cycle
+                        changed = false;
+                        for (int A: scc) changed |= solve(A);
+                        changed &= cyclic;
                     }
                 }
+            }, 64);
+        }
+    };
 
+    // FIRST of body[from...] into `into`, returns whether that suffix is nullable
+    std::vector<set_t> first(N);
+    auto firstOfSuffix = [&](int p, std::size_t from, set_t &into) {
+        for (std::size_t i = from; i < bodies[p].size(); i++) {
+            int id = bodies[p][i];
+            if (id < 0) return false;
+            if (id < T) {
+                into.set(id);
+                return false;
             }
+            set_t other = first[id - T];
+            other.reset(EPSILON);
+            into |= other;
+            if (!nullable[id - T]) return false;
         }
-    UNINSTALL_CHANGE_DETECTOR
+        return true;
+    };
 
-    if (this->status < FOLLOW_COMPUTED) this->status = FOLLOW_COMPUTED;
+    // ---------------- FIRST ----------------
+    std::vector<std::vector<int>> firstEdges(N);
+    for (int p = 0; p < P; p++) {
+        for (int id: bodies[p]) {
+            if (id >= T) firstEdges[heads[p]].push_back(id - T);
+            if (!isNullableId(id)) break;
+        }
+    }
+    solveByLevels(firstEdges, [&](int A) {
+        set_t before = first[A];
+        for (int p: productionsOf[A]) {
+            if (firstOfSuffix(p, 0, first[A])) first[A].set(EPSILON);
+        }
+        return first[A] != before;
+    });
+
+    // ---------------- FIRST_P and the FIRST of every suffix ----------------
+    std::vector<set_t> firstP(P);
+    std::vector<std::vector<set_t>> suffixFirst(P);         // suffixFirst[p][i]: FIRST of body[i...] without epsilon
+    std::vector<std::vector<bool>> suffixNullable(P);
+    pool.parallelFor(P, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t p = begin; p < end; p++) {
+            std::size_t length = bodies[p].size();
+            suffixFirst[p].assign(length + 1, set_t());
+            suffixNullable[p].assign(length + 1, true);
+            for (std::size_t i = length; i-- > 0;) {
+                int id = bodies[p][i];
+                if (id >= 0 && id < T) {
+                    suffixFirst[p][i].set(id);
+                    suffixNullable[p][i] = false;
+                    continue;
+                }
+                if (id >= T) {
+                    suffixFirst[p][i] = first[id - T];
+                    suffixFirst[p][i].reset(EPSILON);
+                }
+                suffixNullable[p][i] = isNullableId(id) && suffixNullable[p][i + 1];
+                if (isNullableId(id)) suffixFirst[p][i] |= suffixFirst[p][i + 1];
+            }
+            firstP[p] = suffixFirst[p][0];
+            if (suffixNullable[p][0]) firstP[p].set(EPSILON);
+        }
+    }, 256);
+
+    // ---------------- FOLLOW ----------------
+    std::vector<std::vector<std::pair<int, int>>> occurrences(N);   // (production, position) of every non-terminal
+    std::vector<std::vector<int>> followEdges(N);
+    for (int p = 0; p < P; p++) {
+        for (int i = 0; i < bodies[p].size(); i++) {
+            int id = bodies[p][i];
+            if (id < T) continue;
+            occurrences[id - T].emplace_back(p, i);
+            if (suffixNullable[p][i + 1] && id - T != heads[p]) followEdges[id - T].push_back(heads[p]);
+        }
+    }
+    std::vector<set_t> follow(N);
+    int start = nonTerminalIndex.count(startSymbol) ? nonTerminalIndex.at(startSymbol) : -1;
+    if (start >= 0) follow[start].set(Token::TokenType::END_OF_FILE);
+    solveByLevels(followEdges, [&](int B) {
+        set_t before = follow[B];
+        for (const auto &occurrence: occurrences[B]) {
+            int p = occurrence.first, i = occurrence.second;
+            follow[B] |= suffixFirst[p][i + 1];
+            if (suffixNullable[p][i + 1] && heads[p] != B) follow[B] |= follow[heads[p]];
+        }
+        return follow[B] != before;
+    });
+
+    // ---------------- publish: the keys are inserted first so the tasks only fill distinct sets ----------------
+    FIRST.clear();
+    FIRST_P.clear();
+    FOLLOW.clear();
+    PARSING_TABLE.clear();
+    std::vector<first_set_entry_t *> firstOut(N), followOut(N);
+    std::vector<parsing_table_entry_t *> rowOut(N);
+    std::vector<first_set_entry_t *> firstPOut(P);
+    for (int A = 0; A < N; A++) {
+        firstOut[A] = &FIRST[nonTerminalList[A]];
+        followOut[A] = &FOLLOW[nonTerminalList[A]];
+        rowOut[A] = &PARSING_TABLE[nonTerminalList[A]];
+    }
+    for (int p = 0; p < P; p++) firstPOut[p] = &FIRST_P[productions[p]];
+
+    auto publish = [T](const set_t &set, first_set_entry_t &into) {
+        for (int t = 0; t < T; t++) {
+            if (set.test(t)) into.insert(GrammarSymbol::createTerminal((Token::TokenType) t));
+        }
+    };
+    pool.parallelFor(N, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t A = begin; A < end; A++) {
+            publish(first[A], *firstOut[A]);
+            publish(follow[A], *followOut[A]);
+            // the first production claiming a column keeps it, as in findParsingTableRow
+            for (int p: productionsOf[A]) {
+                const set_t &columns = productions[p].isEpsilonProduction() ? follow[A] : firstP[p];
+                for (int t = 0; t < T; t++) {
+                    if (columns.test(t)) rowOut[A]->insert({GrammarSymbol::createTerminal((Token::TokenType) t),
+                                                            productions[p]});
+                }
+            }
+        }
+    }, 16);
+    pool.parallelFor(P, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t p = begin; p < end; p++) publish(firstP[p], *firstPOut[p]);
+    }, 256);
+
+    image.reset();
+    compressedTable = CompressedParsingTable();
+    status = PARSING_TABLE_COMPUTED;
 }
 
-void ContextFreeGrammar::findParsingTableLL1() {
-    if (this->status >= PARSING_TABLE_COMPUTED) return;
-    if (this->status < FOLLOW_COMPUTED) findFollow();
+// -------------------- PARALLEL ANALYSIS END --------------------
 
-    for (const GrammarSymbol &s: nonTermimals) {
-        // find all productions of this symbol
-        parsing_table_entry_t entryForS;
-        for (const Production &p: productions) {
-            if (p.head != s) continue;
-            // for each production with head s
-
-            // NOTE: Had there been any collision when
-            // (1) epsilon is in FIRST[s] and
-            // (2) FIRST[s] intersect FOLLOW[s] is not empty,
-            // place the production of preference as the first occurrence of its kind
-            // so that it can override the latter (since latter cannot be inserted again into the set)
-
-            if (p.isEpsilonProduction()) {
-                // for productions such as A ::= epsilon, we add it to columns with respect to their FOLLOW set
-                for (const GrammarSymbol &nt: FOLLOW[s]) {
-                    entryForS.insert({nt, p});
+// -------------------- INCREMENTAL ANALYSIS START --------------------
+
+/**
+ * appends productions to the grammar. FIRST and FOLLOW only grow when productions are added, so the sets computed so
+ * far are kept and only the entries reachable from the new productions in the dependency graph are extended,
+ * see updateAnalysis
+ */
+ContextFreeGrammar &ContextFreeGrammar::addProductions(const std::vector<Production> &added) {
+    productions.insert(productions.end(), added.begin(), added.end());
+    for (const Production &p: added) {
+        nonTermimals.insert(p.head);
+        for (const GrammarSymbol &s: p.body) {
+            if (s.isTerminal() && !s.isEpsilon()) terminals.insert(s);
+        }
+    }
+    updateAnalysis(added, false);
+    return *this;
+}
+
+/**
+ * removes every production with the same head and body as one of `removed`
+ */
+ContextFreeGrammar &ContextFreeGrammar::removeProductions(const std::vector<Production> &removed) {
+    std::vector<Production> kept, dropped;
+    for (const Production &p: productions) {
+        bool match = std::any_of(removed.begin(), removed.end(), [&](const Production &r) {
+            return r.head == p.head && r.body == p.body;
+        });
+        (match ? dropped : kept).push_back(p);
+    }
+    if (dropped.empty()) return *this;
+    if (kept.empty()) {
+        throw std::runtime_error("productions cannot be empty");
+    }
+    productions = kept;
+    nonTermimals.clear();
+    terminals.clear();
+    for (const Production &p: productions) {
+        nonTermimals.insert(p.head);
+        for (const GrammarSymbol &s: p.body) {
+            if (s.isTerminal() && !s.isEpsilon()) terminals.insert(s);
+        }
+    }
+    terminals.insert(GrammarSymbol::eof());
+    for (const Production &p: dropped) FIRST_P.erase(p);
+    updateAnalysis(dropped, true);
+    return *this;
+}
+
+/**
+ * brings the analysis up to date after `changed` productions were added (shrinking = false) or removed.
+ *
+ * The dependency graph links a non-terminal B to the productions using it in their body: FIRST[B] flows into the
+ * head of those productions, FOLLOW[A] flows from a head into the non-terminals of its bodies.
+ * After an addition the sets only grow, so a worklist of productions seeded with the new ones is run to a fixpoint.
+ * After a removal the sets may shrink: every set that can depend on a changed head is cleared and rebuilt by the same
+ * worklist, the sets outside that region are still exact and are only read.
+ * The parse table rows of the non-terminals whose productions, FIRST_P or FOLLOW changed are then rebuilt.
+ */
+void ContextFreeGrammar::updateAnalysis(const std::vector<Production> &changed, bool shrinking) {
+    InternalStatus analysed = status;
+    image.reset();
+    compressedTable = CompressedParsingTable();
+    indexNonTerminals();
+    if (analysed < FOLLOW_COMPUTED) {
+        // nothing worth keeping, analyse from scratch when asked
+        FIRST.clear();
+        FIRST_P.clear();
+        FOLLOW.clear();
+        PARSING_TABLE.clear();
+        status = INITIAL;
+        return;
+    }
+
+    // dependency graph over the current productions
+    const int P = (int) productions.size();
+    std::unordered_map<GrammarSymbol, std::vector<int>> productionsOf;
+    std::unordered_map<GrammarSymbol, std::vector<int>> usedIn;
+    for (int i = 0; i < P; i++) {
+        productionsOf[productions[i].head].push_back(i);
+        std::unordered_set<GrammarSymbol> seen;
+        for (const GrammarSymbol &s: productions[i].body) {
+            if (!s.isTerminal() && seen.insert(s).second) usedIn[s].push_back(i);
+        }
+    }
+    std::vector<bool> queued(P, false);
+    std::vector<int> worklist;
+    auto enqueue = [&](const std::vector<int> &indices) {
+        for (int i: indices) {
+            if (!queued[i]) {
+                queued[i] = true;
+                worklist.push_back(i);
+            }
+        }
+    };
+    auto indicesOf = [](std::unordered_map<GrammarSymbol, std::vector<int>> &graph, const GrammarSymbol &s)
+            -> const std::vector<int> & { return graph[s]; };
+
+    // closure of `seeds` over an edge function, the symbols returned are the region to clear
+    auto closure = [&](std::vector<GrammarSymbol> seeds, const std::function<void(const GrammarSymbol &,
+            std::vector<GrammarSymbol> &)> &successors) {
+        std::unordered_set<GrammarSymbol> region(seeds.begin(), seeds.end());
+        while (!seeds.empty()) {
+            GrammarSymbol s = seeds.back();
+            seeds.pop_back();
+            std::vector<GrammarSymbol> next;
+            successors(s, next);
+            for (const GrammarSymbol &t: next) {
+                if (region.insert(t).second) seeds.push_back(t);
+            }
+        }
+        return region;
+    };
+
+    // ---------------- FIRST ----------------
+    std::unordered_set<GrammarSymbol> firstChanged;
+    std::vector<GrammarSymbol> changedHeads;
+    for (const Production &p: changed) changedHeads.push_back(p.head);
+    if (shrinking) {
+        // heads that can reach a changed head through a nullable prefix of a body, nullable as before the removal
+        std::unordered_set<GrammarSymbol> region = closure(changedHeads, [&](const GrammarSymbol &B,
+                                                                             std::vector<GrammarSymbol> &next) {
+            for (int i: indicesOf(usedIn, B)) {
+                for (const GrammarSymbol &s: productions[i].body) {
+                    if (s == B) {
+                        next.push_back(productions[i].head);
+                        break;
+                    }
+                    if (!isNullable(s)) break;
                 }
-            } else {
-                for (const GrammarSymbol &nt: FIRST_P[p]) {  // for each lookahead of this production, assuming LL(1)
-                    entryForS.insert({nt, p});   // add to the appropriate column: entry[terminal] = production
+            }
+        });
+        std::unordered_map<GrammarSymbol, first_set_entry_t> old;
+        for (const GrammarSymbol &A: region) {
+            old[A] = std::move(FIRST[A]);
+            FIRST.erase(A);
+            enqueue(indicesOf(productionsOf, A));
+        }
+        while (!worklist.empty()) {
+            int i = worklist.back();
+            worklist.pop_back();
+            queued[i] = false;
+            const Production &p = productions[i];
+            first_set_entry_t &first = FIRST[p.head];
+            std::size_t before = first.size();
+            if (findFirstOfSequence(p.body, first)) first.insert(GrammarSymbol::epsilon());
+            if (first.size() != before) enqueue(indicesOf(usedIn, p.head));
+        }
+        for (const auto &entry: old) {
+            if (FIRST[entry.first] != entry.second) firstChanged.insert(entry.first);
+        }
+    } else {
+        for (int i = P - (int) changed.size(); i < P; i++) enqueue({i});
+        while (!worklist.empty()) {
+            int i = worklist.back();
+            worklist.pop_back();
+            queued[i] = false;
+            const Production &p = productions[i];
+            first_set_entry_t &first = FIRST[p.head];
+            std::size_t before = first.size();
+            if (findFirstOfSequence(p.body, first)) first.insert(GrammarSymbol::epsilon());
+            if (first.size() != before) {
+                firstChanged.insert(p.head);
+                enqueue(indicesOf(usedIn, p.head));
+            }
+        }
+    }
+
+    // ---------------- FIRST_P ----------------
+    std::unordered_set<GrammarSymbol> rows(changedHeads.begin(), changedHeads.end());
+    std::vector<int> stale;
+    if (!shrinking) {
+        for (int i = P - (int) changed.size(); i < P; i++) stale.push_back(i);
+    }
+    for (const GrammarSymbol &B: firstChanged) {
+        const std::vector<int> &indices = indicesOf(usedIn, B);
+        stale.insert(stale.end(), indices.begin(), indices.end());
+    }
+    for (int i: stale) {
+        first_set_entry_t &first = FIRST_P[productions[i]];
+        first.clear();
+        if (findFirstOfSequence(productions[i].body, first)) first.insert(GrammarSymbol::epsilon());
+        rows.insert(productions[i].head);
+    }
+
+    // ---------------- FOLLOW ----------------
+    // FOLLOW can change for the non-terminals in the body of a changed production
+    // and for those left of a non-terminal whose FIRST changed
+    std::vector<GrammarSymbol> seeds;
+    for (const Production &p: changed) {
+        for (const GrammarSymbol &s: p.body) {
+            if (!s.isTerminal()) seeds.push_back(s);
+        }
+    }
+    for (const GrammarSymbol &B: firstChanged) {
+        for (int i: indicesOf(usedIn, B)) {
+            const std::vector<GrammarSymbol> &body = productions[i].body;
+            auto last = std::find(body.rbegin(), body.rend(), B);
+            for (auto it = std::next(last); it != body.rend(); it++) {
+                if (!it->isTerminal()) seeds.push_back(*it);
+            }
+        }
+    }
+    std::unordered_set<GrammarSymbol> followChanged;
+    std::vector<GrammarSymbol> grown;
+    auto runFollow = [&]() {
+        while (!worklist.empty()) {
+            int i = worklist.back();
+            worklist.pop_back();
+            queued[i] = false;
+            grown.clear();
+            findFollowOfProduction(productions[i], &grown);
+            for (const GrammarSymbol &B: grown) {
+                if (!shrinking) followChanged.insert(B);
+                enqueue(indicesOf(productionsOf, B));
+            }
+        }
+    };
+    if (shrinking) {
+        // FOLLOW[A] flows into the non-terminals of the bodies of A that have a nullable suffix
+        std::unordered_set<GrammarSymbol> region = closure(seeds, [&](const GrammarSymbol &A,
+                                                                      std::vector<GrammarSymbol> &next) {
+            for (int i: indicesOf(productionsOf, A)) {
+                const std::vector<GrammarSymbol> &body = productions[i].body;
+                for (auto it = body.rbegin(); it != body.rend(); it++) {
+                    if (!it->isTerminal()) next.push_back(*it);
+                    if (!isNullable(*it)) break;
                 }
             }
+        });
+        std::unordered_map<GrammarSymbol, follow_set_entry_t> old;
+        for (const GrammarSymbol &B: region) {
+            old[B] = std::move(FOLLOW[B]);
+            FOLLOW.erase(B);
+            enqueue(indicesOf(usedIn, B));
+        }
+        if (region.count(startSymbol)) FOLLOW[startSymbol].insert(GrammarSymbol::eof());
+        runFollow();
+        for (const auto &entry: old) {
+            if (FOLLOW[entry.first] != entry.second) followChanged.insert(entry.first);
         }
+    } else {
+        for (int i = P - (int) changed.size(); i < P; i++) enqueue({i});
+        for (const GrammarSymbol &B: firstChanged) enqueue(indicesOf(usedIn, B));
+        runFollow();
+    }
+    rows.insert(followChanged.begin(), followChanged.end());
 
-        PARSING_TABLE.insert(
-                {s, entryForS});   // set entry to the corresponding head: PARSING_TABLE[non-terminal] = entry
+    // ---------------- parsing table ----------------
+    status = FOLLOW_COMPUTED;
+    if (analysed < PARSING_TABLE_COMPUTED) return;
+    for (const GrammarSymbol &A: rows) {
+        auto it = productionsOf.find(A);
+        if (it == productionsOf.end() || it->second.empty()) {
+            PARSING_TABLE.erase(A);     // no production left
+        } else {
+            findParsingTableRow(A, it->second);
+        }
     }
-    if (this->status < PARSING_TABLE_COMPUTED) this->status = PARSING_TABLE_COMPUTED;
+    status = PARSING_TABLE_COMPUTED;
 }
 
+// -------------------- INCREMENTAL ANALYSIS END --------------------
+
 void ContextFreeGrammar::printParsingTable() {
     if (this->status < PARSING_TABLE_COMPUTED) findParsingTableLL1();
 
@@ -424,15 +1295,138 @@ GrammarSymbol &ContextFreeGrammar::getStartSymbol() {
     return startSymbol;
 }
 
+const std::vector<Production> &ContextFreeGrammar::getProductions() const {
+    return productions;
+}
+
+const std::vector<GrammarSymbol> &ContextFreeGrammar::getNonTerminals() const {
+    return nonTerminalList;
+}
+
+int ContextFreeGrammar::getNonTerminalIndex(const GrammarSymbol &nonTerminal) const {
+    auto it = nonTerminalIndex.find(nonTerminal);
+    return it == nonTerminalIndex.end() ? -1 : it->second;
+}
+
+/**
+ * numbers all symbols in one space: a terminal is its Token::TokenType,
+ * a non-terminal is Token::TOKEN_TYPE_COUNT + its non-terminal index, -1 if it is not a head of any production
+ */
+int ContextFreeGrammar::getSymbolId(const GrammarSymbol &symbol) const {
+    if (symbol.isTerminal()) {
+        return symbol.getTerminal();
+    }
+    int index = getNonTerminalIndex(symbol);
+    return index < 0 ? -1 : Token::TOKEN_TYPE_COUNT + index;
+}
+
+const ContextFreeGrammar::first_set_terminal_t &ContextFreeGrammar::getFirstSets() {
+    if (status < FIRST_COMPUTED) findFirstForNonTerminals();
+    return FIRST;
+}
+
+const ContextFreeGrammar::first_set_production_t &ContextFreeGrammar::getFirstSetsForProductions() {
+    if (status < FIRST_P_COMPUTED) findFirstForProductions();
+    return FIRST_P;
+}
+
+const ContextFreeGrammar::follow_set_t &ContextFreeGrammar::getFollowSets() {
+    if (status < FOLLOW_COMPUTED) findFollow();
+    return FOLLOW;
+}
+
+/**
+ * the parsing table as a dense matrix:
+ * matrix[getNonTerminalIndex(A)][a] is the index in getProductions() of the production predicted for A on terminal a,
+ * or CompressedParsingTable::NO_ENTRY on error.
+ * A table adopted from an image or with useParsingTable is expanded instead of computing the table again; the
+ * epsilon production it serves as a row's default predicts on FOLLOW of the row, as findParsingTableLL1 fills it.
+ */
+std::vector<std::vector<int>> ContextFreeGrammar::getParsingTableMatrix() {
+    if (!compressedTable.isEmpty()) {
+        std::vector<std::vector<int>> matrix(nonTerminalList.size(), std::vector<int>(Token::TOKEN_TYPE_COUNT));
+        for (int row = 0; row < nonTerminalList.size(); row++) {
+            int fallback = compressedTable.getDefaults()[row];
+            const follow_set_entry_t *follow = nullptr;
+            if (fallback != CompressedParsingTable::NO_ENTRY) {
+                auto it = getFollowSets().find(nonTerminalList[row]);
+                if (it != FOLLOW.end()) follow = &it->second;
+            }
+            for (int t = 0; t < Token::TOKEN_TYPE_COUNT; t++) {
+                int production = compressedTable.lookupStored(row, t);
+                if (production == CompressedParsingTable::NO_ENTRY && follow
+                    && follow->count(T((Token::TokenType) t))) {
+                    production = fallback;
+                }
+                matrix[row][t] = production;
+            }
+        }
+        return matrix;
+    }
+    if (this->status < PARSING_TABLE_COMPUTED) findParsingTableLL1();
+
+    std::unordered_map<int, int> productionIndex;   // production id -> position in the production list
+    for (int i = 0; i < productions.size(); i++) {
+        productionIndex[productions[i].getId()] = i;
+    }
+
+    std::vector<std::vector<int>> matrix(nonTerminalList.size(),
+                                         std::vector<int>(Token::TOKEN_TYPE_COUNT, CompressedParsingTable::NO_ENTRY));
+    for (int row = 0; row < nonTerminalList.size(); row++) {
+        for (const auto &entry: PARSING_TABLE[nonTerminalList[row]]) {
+            matrix[row][entry.first.getTerminal()] = productionIndex.at(entry.second.getId());
+        }
+    }
+    return matrix;
+}
+
+/**
+ * compresses the parsing table by row displacement,
+ * the epsilon production of a non-terminal (if it has one) becomes the default entry of its row
+ */
+CompressedParsingTable ContextFreeGrammar::compressParsingTable() {
+    std::vector<std::vector<int>> matrix = getParsingTableMatrix();
+    std::vector<int> defaults(nonTerminalList.size(), CompressedParsingTable::NO_ENTRY);
+    for (int i = 0; i < productions.size(); i++) {
+        if (productions[i].isEpsilonProduction()) {
+            int row = nonTerminalIndex.at(productions[i].head);
+            if (defaults[row] == CompressedParsingTable::NO_ENTRY) defaults[row] = i;
+        }
+    }
+    return {matrix, defaults};
+}
+
 std::variant<Production, ErrorStrategy>
 ContextFreeGrammar::predict(const GrammarSymbol &current, const GrammarSymbol &onInput) {
+    if (!compressedTable.isEmpty()) {
+        // analysis loaded from an image, predict without ever building the hash table
+        int row = getNonTerminalIndex(current);
+        int production = row < 0 ? CompressedParsingTable::NO_ENTRY : compressedTable.lookup(row, onInput.getTerminal());
+        if (production == CompressedParsingTable::NO_ENTRY) {
+            return errorStrategy(current, onInput);
+        }
+        return productions[production];
+    }
     if (this->status < PARSING_TABLE_COMPUTED) findParsingTableLL1();
-    const Production &p = PARSING_TABLE[current][onInput];
-
-    if (!p.isValid()) {
-        return ErrorStrategy("error, do nothing");
+    // find, not [], so that predicting on an analysed grammar never writes to it
+    auto row = PARSING_TABLE.find(current);
+    if (row != PARSING_TABLE.end()) {
+        auto entry = row->second.find(onInput);
+        if (entry != row->second.end() && entry->second.isValid()) return entry->second;
     }
-    return p;
+    return errorStrategy(current, onInput);
+}
+
+/**
+ * FOLLOW[current] is the synchronisation set: on a token in it (or at the end of the input) the non-terminal is given
+ * up, any other token is skipped. Only reached on errors, so FOLLOW is computed here if prediction never needed it.
+ */
+ErrorStrategy ContextFreeGrammar::errorStrategy(const GrammarSymbol &current, const GrammarSymbol &onInput) {
+    const follow_set_t &follow = getFollowSets();
+    auto it = follow.find(current);
+    bool synch = onInput.isEOF() || (it != follow.end() && it->second.count(onInput));
+    return {"unexpected " + onInput.toString() + " while parsing " + current.toString(),
+            synch ? ErrorStrategy::POP_NON_TERMINAL : ErrorStrategy::SKIP_INPUT};
 }
 
 void ContextFreeGrammar::printProductions() {
@@ -441,3 +1435,67 @@ void ContextFreeGrammar::printProductions() {
         std::cout << p << std::endl;
     }
 }
+
+/**
+ * decodes FIRST, FIRST_P and FOLLOW from the image instead of running the fixpoint iterations,
+ * only needed when the sets themselves are asked for: prediction reads the image's table directly
+ */
+void ContextFreeGrammar::loadSetsFromImage() {
+    if (this->status >= FOLLOW_COMPUTED) return;
+    for (int nt = 0; nt < nonTerminalList.size(); nt++) {
+        for (int t = 0; t < Token::TOKEN_TYPE_COUNT; t++) {
+            if (image->inFirst(nt, t)) FIRST[nonTerminalList[nt]].insert(T((Token::TokenType) t));
+            if (image->inFollow(nt, t)) FOLLOW[nonTerminalList[nt]].insert(T((Token::TokenType) t));
+        }
+    }
+    for (int p = 0; p < productions.size(); p++) {
+        for (int t = 0; t < Token::TOKEN_TYPE_COUNT; t++) {
+            if (image->inFirstOfProduction(p, t)) FIRST_P[productions[p]].insert(T((Token::TokenType) t));
+        }
+    }
+    this->status = FOLLOW_COMPUTED;
+}
+
+/**
+ * predicts with a precomputed table from now on, e.g. StaticLL1Table::parsingTable(),
+ * its rows and production indices must follow getNonTerminals() and getProductions()
+ * @return whether the table has the shape of this grammar's table
+ */
+bool ContextFreeGrammar::useParsingTable(const CompressedParsingTable &table) {
+    if (table.getRowCount() != nonTerminalList.size() || table.getColumnCount() != Token::TOKEN_TYPE_COUNT) {
+        return false;
+    }
+    this->compressedTable = table;
+    return true;
+}
+
+/**
+ * adopts the analysis from a grammar image if it was written for exactly this production list,
+ * FIRST, FOLLOW and the parsing table are then never computed
+ * @return whether the image was loaded
+ */
+bool ContextFreeGrammar::loadAnalysis(const std::string &filename) {
+    std::shared_ptr<const GrammarImage> loaded = GrammarImage::load(filename, GrammarImage::hashProductions(productions));
+    if (!loaded || loaded->getNonTerminalCount() != nonTerminalList.size()
+        || loaded->getProductionCount() != productions.size()) {
+        return false;
+    }
+    this->image = loaded;
+    this->compressedTable = loaded->getParsingTable();
+    return true;
+}
+
+void ContextFreeGrammar::saveAnalysis(const std::string &filename) {
+    GrammarImage::write(filename, *this);
+}
+
+/**
+ * loads the analysis from `filename`, or computes it and writes the image there when no matching image exists
+ */
+ContextFreeGrammar &ContextFreeGrammar::useAnalysisCache(const std::string &filename) {
+    if (!loadAnalysis(filename)) {
+        saveAnalysis(filename);
+        loadAnalysis(filename);
+    }
+    return *this;
+}
@@ -8,14 +8,33 @@
 
 #include <unordered_set>
 #include <variant>
+#include <memory>
 #include "GrammarSymbol.h"
 #include "Production.h"
+#include "CompressedParsingTable.h"
+#include "GrammarImage.h"
 
+class ThreadPool;
+
+/**
+ * what predict suggests when the table has no entry: the blank and "synch" entries of panic-mode recovery
+ */
 class ErrorStrategy {
+public:
+    using Action = enum {
+        SKIP_INPUT,         // the input token cannot follow the non-terminal, discard it
+        POP_NON_TERMINAL    // the input token is in FOLLOW of the non-terminal, give up on the non-terminal
+    };
+
 private:
     std::string message;
+    Action action;
 public:
-    ErrorStrategy(const std::string &message): message(message) {}
+    ErrorStrategy(const std::string &message, Action action = SKIP_INPUT): message(message), action(action) {}
+
+    [[nodiscard]] const std::string &getMessage() const { return message; }
+
+    [[nodiscard]] Action getAction() const { return action; }
 };
 
 class ContextFreeGrammar {
@@ -33,21 +52,41 @@ private:
     std::unordered_set<GrammarSymbol> nonTermimals;
     std::unordered_set<GrammarSymbol> terminals;
     std::vector<Production> productions;
+    std::vector<GrammarSymbol> nonTerminalList;     // non-terminals in order of first appearance as a head
+    std::unordered_map<GrammarSymbol, int> nonTerminalIndex;
     using InternalStatus = enum {INITIAL, FIRST_COMPUTED, FIRST_P_COMPUTED, FOLLOW_COMPUTED, PARSING_TABLE_COMPUTED};
     InternalStatus status = INITIAL;
     first_set_terminal_t FIRST;
     first_set_production_t FIRST_P;
     follow_set_t FOLLOW;
     parsing_table_t PARSING_TABLE;
+    std::shared_ptr<const GrammarImage> image;  // analysis loaded from a precompiled grammar image, if any
+    CompressedParsingTable compressedTable;     // used by predict when the table is precomputed (image or constexpr)
 
+    void indexNonTerminals();
+    void loadSetsFromImage();
+    void replaceProductions(const std::vector<Production> &newProductions);
+    bool isNullable(const GrammarSymbol &symbol);
+    bool findFirstOfSequence(const std::vector<GrammarSymbol> &symbols, first_set_entry_t &into);
+    bool findFollowOfProduction(const Production &p, std::vector<GrammarSymbol> *grown);
+    ErrorStrategy errorStrategy(const GrammarSymbol &current, const GrammarSymbol &onInput);
+    void findParsingTableRow(const GrammarSymbol &s, const std::vector<int> &indices);
+    void updateAnalysis(const std::vector<Production> &changed, bool shrinking);
 
 public:
     explicit ContextFreeGrammar(const std::vector<Production> &productions);
     ContextFreeGrammar &eliminateDirectLeftRecursive();
+    ContextFreeGrammar &eliminateLeftRecursive();
+    ContextFreeGrammar &leftFactor();
+    ContextFreeGrammar &removeUselessSymbols();
+    ContextFreeGrammar &prepareForLL1();
+    ContextFreeGrammar &addProductions(const std::vector<Production> &added);
+    ContextFreeGrammar &removeProductions(const std::vector<Production> &removed);
     void findFirstForNonTerminals();
     void findFirstForProductions();
     void findFollow();
     void findParsingTableLL1();
+    void analyseInParallel(ThreadPool &pool);
     void printFirstSetForNonTerminals();
     void printFirstSetForProductions();
     void printFollowSet();
@@ -55,9 +94,23 @@ public:
     void printProductions();
 
     GrammarSymbol &getStartSymbol();
+    [[nodiscard]] const std::vector<Production> &getProductions() const;
+    [[nodiscard]] const std::vector<GrammarSymbol> &getNonTerminals() const;
+    [[nodiscard]] int getNonTerminalIndex(const GrammarSymbol &nonTerminal) const;
+    [[nodiscard]] int getSymbolId(const GrammarSymbol &symbol) const;
+    const first_set_terminal_t &getFirstSets();
+    const first_set_production_t &getFirstSetsForProductions();
+    const follow_set_t &getFollowSets();
+    std::vector<std::vector<int>> getParsingTableMatrix();
+    CompressedParsingTable compressParsingTable();
     std::variant<Production, ErrorStrategy> predict(const GrammarSymbol &current, const GrammarSymbol &onInput);
 
     void exportParsingTableAsCsv(const std::string &filename);
+
+    bool useParsingTable(const CompressedParsingTable &table);
+    bool loadAnalysis(const std::string &filename);
+    void saveAnalysis(const std::string &filename);
+    ContextFreeGrammar &useAnalysisCache(const std::string &filename);
 };
 
 #endif //COMPILER_CONTEXTFREEGRAMMAR_H
@@ -0,0 +1,390 @@
+//
+// Created by jens on 19/10/26.
+//
+
+#include <algorithm>
+#include "EarleyParser.h"
+
+EarleyParser::EarleyParser(const CompiledGrammar &grammar) : grammar(grammar) {
+    const auto T = Token::TOKEN_TYPE_COUNT;
+    const int P = (int) grammar.getProductions().size();
+    const int N = (int) grammar.getNonTerminals().size();
+    productionsOf.resize(N);
+    for (int p = 0; p < P; p++) {
+        std::int32_t head = grammar.getHead(p);
+        heads.push_back(head);
+        productionsOf[head - T].push_back(p);
+        ruleStart.push_back((std::uint32_t) rules.size());
+        for (std::int32_t s: grammar.getBody(p)) rules.push_back({s, p});
+        rules.push_back({-1 - head, p});
+    }
+    goalHead = T + N;
+    heads.push_back(goalHead);
+    ruleStart.push_back((std::uint32_t) rules.size());
+    goalRule = (std::uint32_t) rules.size();
+    goalBody = {grammar.getStart()};
+    rules.push_back({grammar.getStart(), P});
+    rules.push_back({-1 - goalHead, P});
+    predicted.assign(N, 0);
+    slots.resize(256);
+    slotStamps.assign(slots.size(), 0);
+}
+
+/**
+ * with Leo's optimisation (the default) right recursion takes linear time, without it quadratic
+ */
+void EarleyParser::setLeo(bool leo) {
+    this->leo = leo;
+}
+
+/**
+ * recognises `goal` on a prefix of the input: `first`, then the tokens next() returns. Every set is extended while
+ * any item can go on, so the longest prefix derived from `goal` is found; canEnd(terminal) tells whether the token
+ * after that prefix may follow it, else a shorter prefix is taken.
+ * @return the number of tokens `goal` derives, or NO_PARSE; getTokens() holds every token read, getDerivation()
+ * the leftmost derivation of the prefix
+ */
+std::int32_t EarleyParser::parse(std::int32_t goal, const Token &first, const std::function<Token()> &next,
+                                 const std::function<bool(int)> &canEnd) {
+    tokens.clear();
+    items.clear();
+    setStart.assign(1, 0);
+    leoCompletions.clear();
+    topmost.clear();
+    derivation.clear();
+    std::fill(predicted.begin(), predicted.end(), 0);
+    goalBody[0] = goal;
+    rules[goalRule].next = goal;
+
+    tokens.push_back(first);
+    std::int32_t end = NO_PARSE;
+    startSet();
+    add(goalRule, 0);
+    for (std::uint32_t j = 0;; j++) {
+        build(j);
+        std::sort(items.begin() + setStart[j], items.end(), [this](const Item &a, const Item &b) {
+            return less(a, b);
+        });
+        setStart.push_back((std::uint32_t) items.size());
+
+        int terminal = tokens[j].getTokenType();
+        if (contains(j, goalRule + 1, 0) && canEnd(terminal)) end = (std::int32_t) j;
+        if (terminal == Token::TokenType::END_OF_FILE) break;
+
+        // the scanner: the next set starts with the items waiting for the token
+        startSet();
+        std::pair<const Item *, const Item *> scanned = waiting(j, terminal);
+        std::uint32_t from = (std::uint32_t) (scanned.first - items.data());
+        std::uint32_t to = (std::uint32_t) (scanned.second - items.data());
+        for (std::uint32_t i = from; i < to; i++) add(items[i].rule + 1, items[i].origin);
+        if (items.size() == setStart.back()) break;     // no item can go on
+        tokens.push_back(next());
+    }
+    if (end != NO_PARSE && !derive((std::uint32_t) end)) end = NO_PARSE;
+    return end;
+}
+
+/**
+ * the order of a complete set: by the symbol after the dot (complete items first, by head), then by origin
+ */
+bool EarleyParser::less(const Item &a, const Item &b) const {
+    std::int32_t x = keyOf(a.rule), y = keyOf(b.rule);
+    if (x != y) return x < y;
+    return a.origin != b.origin ? a.origin < b.origin : a.rule < b.rule;
+}
+
+const std::vector<std::int32_t> &EarleyParser::bodyOf(int production) const {
+    return production < (int) heads.size() - 1 ? grammar.getBody(production) : goalBody;
+}
+
+void EarleyParser::startSet() {
+    if (++stamp == 0) {     // the stamps wrapped around, no slot may look used
+        std::fill(slotStamps.begin(), slotStamps.end(), 0);
+        stamp = 1;
+    }
+}
+
+/**
+ * adds an item to the set being built unless it is there already
+ */
+void EarleyParser::add(std::uint32_t rule, std::uint32_t origin) {
+    std::size_t count = items.size() - setStart.back();
+    if (2 * (count + 1) > slots.size()) {
+        // rehash the items of the set into a table twice the size
+        slots.assign(slots.size() * 2, 0);
+        slotStamps.assign(slots.size(), 0);
+        stamp = 1;
+        std::vector<Item> current(items.begin() + setStart.back(), items.end());
+        items.resize(setStart.back());
+        for (const Item &item: current) add(item.rule, item.origin);
+    }
+    std::uint64_t key = (std::uint64_t) rule << 32 | origin;
+    std::size_t mask = slots.size() - 1;
+    std::size_t h = (std::size_t) ((key * 0x9E3779B97F4A7C15ULL) >> 32) & mask;
+    while (slotStamps[h] == stamp) {
+        if (slots[h] == key) return;
+        h = (h + 1) & mask;
+    }
+    slotStamps[h] = stamp;
+    slots[h] = key;
+    items.push_back({rule, origin});
+}
+
+/**
+ * the predictor and the completer on the set being built, until no item is added
+ */
+void EarleyParser::build(std::uint32_t set) {
+    const auto T = Token::TOKEN_TYPE_COUNT;
+    for (std::size_t i = setStart[set]; i < items.size(); i++) {
+        Item item = items[i];
+        std::int32_t next = keyOf(item.rule);
+        if (next >= T) {
+            if (predicted[next - T] != set + 1) {
+                predicted[next - T] = set + 1;
+                for (int p: productionsOf[next - T]) add(ruleStart[p], set);
+            }
+            if (grammar.isNullable(next)) add(item.rule + 1, item.origin);
+        } else if (next < 0 && item.origin != set) {
+            // an item completed in the set it started in is nullable, the predictor passed over it already
+            complete(set, -1 - next, item.origin);
+        }
+    }
+}
+
+/**
+ * `symbol` derives the input from `origin` to `set`: advances the items waiting for it in set `origin`, or adds the
+ * topmost item of the deterministic reduction path above it
+ */
+void EarleyParser::complete(std::uint32_t set, std::int32_t symbol, std::uint32_t origin) {
+    if (leo) {
+        Item top = findTopmost(origin, symbol);
+        if (top.rule != NONE) {
+            add(top.rule, top.origin);
+            leoCompletions.push_back({set, origin, symbol});
+            return;
+        }
+    }
+    std::pair<const Item *, const Item *> range = waiting(origin, symbol);
+    std::uint32_t from = (std::uint32_t) (range.first - items.data());
+    std::uint32_t to = (std::uint32_t) (range.second - items.data());
+    for (std::uint32_t i = from; i < to; i++) add(items[i].rule + 1, items[i].origin);
+}
+
+/**
+ * the items of a sorted range with `key` after the dot and an origin of at least `minOrigin`
+ */
+std::pair<const EarleyParser::Item *, const EarleyParser::Item *>
+EarleyParser::waiting(const Item *first, const Item *last, std::int32_t key, std::uint32_t minOrigin) const {
+    const Item *lo = std::lower_bound(first, last, key, [this, minOrigin](const Item &item, std::int32_t k) {
+        return keyOf(item.rule) < k || (keyOf(item.rule) == k && item.origin < minOrigin);
+    });
+    const Item *hi = std::upper_bound(lo, last, key, [this](std::int32_t k, const Item &item) {
+        return k < keyOf(item.rule);
+    });
+    return {lo, hi};
+}
+
+std::pair<const EarleyParser::Item *, const EarleyParser::Item *>
+EarleyParser::waiting(std::uint32_t set, std::int32_t key) const {
+    return waiting(items.data() + setStart[set], items.data() + setStart[set + 1], key);
+}
+
+bool EarleyParser::contains(std::uint32_t set, std::uint32_t rule, std::uint32_t origin) const {
+    const Item *first = items.data() + setStart[set], *last = items.data() + setStart[set + 1];
+    Item item{rule, origin};
+    const Item *found = std::lower_bound(first, last, item, [this](const Item &a, const Item &b) {
+        return less(a, b);
+    });
+    return found != last && found->rule == rule && found->origin == origin;
+}
+
+/**
+ * Leo's topmost item for `symbol` completed in `set`: while exactly one item of the set waits for the symbol and
+ * the symbol ends its body, the path goes up to that item's origin and head. Every set on the path is complete,
+ * so the result is kept for the whole path.
+ * @return the completed item at the top of the path, rule NONE if there is no path
+ */
+EarleyParser::Item EarleyParser::findTopmost(std::uint32_t set, std::int32_t symbol) {
+    std::vector<std::uint64_t> path;
+    Item top{NONE, 0};
+    while (true) {
+        std::uint64_t key = (std::uint64_t) set << 16 | (std::uint32_t) symbol;
+        auto found = topmost.find(key);
+        if (found != topmost.end()) {
+            if (found->second.rule != NONE) top = found->second;
+            break;
+        }
+        std::pair<const Item *, const Item *> range = waiting(set, symbol);
+        if (range.second - range.first != 1 || keyOf(range.first->rule + 1) >= 0) {
+            topmost[key] = {NONE, 0};
+            break;
+        }
+        Item waiter = *range.first;
+        path.push_back(key);
+        topmost[key] = {NONE, 0};   // until the top is known, which also ends a cycle of unit productions
+        top = {waiter.rule + 1, waiter.origin};
+        set = waiter.origin;
+        symbol = headOf(waiter.rule);
+    }
+    for (std::uint64_t key: path) topmost[key] = top;
+    return top;
+}
+
+/**
+ * the completed items Leo's optimisation left out of a set with an origin of at least `minOrigin`, sorted as the set
+ * is: the items on the path of each Leo completion there. Origins only fall going up a path, so each path is walked
+ * as far as the lowest origin asked for yet, and later on from where it stopped.
+ */
+const std::vector<EarleyParser::Item> &
+EarleyParser::skippedIn(std::uint32_t set, std::uint32_t minOrigin,
+                        std::unordered_map<std::uint32_t, Skipped> &skipped) {
+    static const std::vector<Item> none;
+    auto first = std::lower_bound(leoCompletions.begin(), leoCompletions.end(), set,
+                                  [](const LeoCompletion &c, std::uint32_t s) { return c.set < s; });
+    if (first == leoCompletions.end() || first->set != set) return none;
+    auto found = skipped.find(set);
+    if (found == skipped.end()) {
+        found = skipped.emplace(set, Skipped()).first;
+        for (auto c = first; c != leoCompletions.end() && c->set == set; ++c) {
+            found->second.paths.push_back({c->origin, c->symbol});
+        }
+    }
+    Skipped &left = found->second;
+    if (minOrigin >= left.reached) return left.list;
+    left.reached = minOrigin;
+    std::size_t sorted = left.list.size();
+    for (Path &path: left.paths) {
+        while (path.set != NONE) {
+            Item top = topmost.at((std::uint64_t) path.set << 16 | (std::uint32_t) path.symbol);
+            std::pair<const Item *, const Item *> range = waiting(path.set, path.symbol);
+            if (range.second - range.first != 1) {
+                path.set = NONE;
+                break;
+            }
+            Item waiter = *range.first;
+            if (waiter.origin < minOrigin) break;
+            left.list.push_back({waiter.rule + 1, waiter.origin});
+            if (waiter.rule + 1 == top.rule && waiter.origin == top.origin) {
+                path.set = NONE;
+            } else {
+                path.set = waiter.origin;
+                path.symbol = headOf(waiter.rule);
+            }
+        }
+    }
+    auto order = [this](const Item &a, const Item &b) { return less(a, b); };
+    std::sort(left.list.begin() + (std::ptrdiff_t) sorted, left.list.end(), order);
+    std::inplace_merge(left.list.begin(), left.list.begin() + (std::ptrdiff_t) sorted, left.list.end(), order);
+    left.list.erase(std::unique(left.list.begin(), left.list.end(), [](const Item &a, const Item &b) {
+        return a.rule == b.rule && a.origin == b.origin;
+    }), left.list.end());
+    return left.list;
+}
+
+/**
+ * reads the leftmost derivation of the goal over the first `end` tokens off the chart, top-down: a non-terminal
+ * takes its first production completed over its span, and the body is matched right to left, each symbol ending
+ * where the next one starts and starting where the item before it was. Every item in the chart derives what it
+ * spans, so no choice is ever taken back; only a cycle of productions over the same span is refused.
+ */
+bool EarleyParser::derive(std::uint32_t end) {
+    std::unordered_map<std::uint32_t, Skipped> skipped;
+    std::vector<Span> spans{{goalBody[0], 0, end, NONE}};
+    std::vector<std::uint32_t> work{0};
+    std::vector<int> candidates;
+    std::vector<Span> children;
+
+    // the completed items of `symbol` in `set` with an origin of at least `minOrigin`, by origin, in two ranges
+    auto completed = [&](std::uint32_t set, std::int32_t symbol, std::uint32_t minOrigin) {
+        const std::vector<Item> &left = skippedIn(set, minOrigin, skipped);
+        auto inSet = waiting(items.data() + setStart[set], items.data() + setStart[set + 1], -1 - symbol, minOrigin);
+        auto inSkipped = waiting(left.data(), left.data() + left.size(), -1 - symbol, minOrigin);
+        return std::make_pair(inSet, inSkipped);
+    };
+    auto onPath = [&](std::int32_t symbol, std::uint32_t s) {
+        for (std::uint32_t a = s; a != NONE && spans[a].from == spans[s].from && spans[a].to == spans[s].to;
+             a = spans[a].parent) {
+            if (spans[a].symbol == symbol) return true;
+        }
+        return false;
+    };
+    auto split = [&](int production, std::uint32_t s) {
+        const Span span = spans[s];
+        const std::vector<std::int32_t> &body = bodyOf(production);
+        children.clear();
+        std::uint32_t pos = span.to;
+        for (std::size_t d = body.size(); d-- > 0;) {
+            std::int32_t symbol = body[d];
+            std::uint32_t prefix = ruleStart[production] + (std::uint32_t) d;
+            auto fits = [&](std::uint32_t k) {
+                return d == 0 ? k == span.from : k >= span.from && contains(k, prefix, span.from);
+            };
+            std::uint32_t from = NONE;
+            if (CompiledGrammar::isTerminal(symbol)) {
+                if (pos > span.from && tokens[pos - 1].getTokenType() == symbol && fits(pos - 1)) from = pos - 1;
+            } else {
+                auto ranges = completed(pos, symbol, span.from);
+                for (auto range: {ranges.first, ranges.second}) {
+                    for (const Item *item = range.first; item != range.second && from == NONE; ++item) {
+                        std::uint32_t k = item->origin;
+                        if (k > pos || !fits(k)) continue;
+                        if (k == span.from && pos == span.to && onPath(symbol, s)) continue;
+                        from = k;
+                    }
+                }
+            }
+            if (from == NONE) return false;
+            children.push_back({symbol, from, pos, s});
+            pos = from;
+        }
+        return pos == span.from;
+    };
+
+    while (!work.empty()) {
+        std::uint32_t s = work.back();
+        work.pop_back();
+        if (CompiledGrammar::isTerminal(spans[s].symbol)) continue;
+        // the productions completed over exactly this span, the first one that splits is taken
+        candidates.clear();
+        auto ranges = completed(spans[s].to, spans[s].symbol, spans[s].from);
+        for (auto range: {ranges.first, ranges.second}) {
+            for (const Item *item = range.first; item != range.second && item->origin == spans[s].from; ++item) {
+                candidates.push_back(rules[item->rule].production);
+            }
+        }
+        std::sort(candidates.begin(), candidates.end());
+        int chosen = NO_PARSE;
+        for (int production: candidates) {
+            if (split(production, s)) {
+                chosen = production;
+                break;
+            }
+        }
+        if (chosen == NO_PARSE) return false;
+        derivation.push_back(chosen);
+        // children were found right to left, so the leftmost ends on top of the work stack
+        for (const Span &child: children) {
+            work.push_back((std::uint32_t) spans.size());
+            spans.push_back(child);
+        }
+    }
+    return true;
+}
+
+/**
+ * the tokens read by the last parse: the derived prefix, then at least the token after it
+ */
+const std::vector<Token> &EarleyParser::getTokens() const {
+    return tokens;
+}
+
+/**
+ * the productions of the last parse in the order a leftmost derivation (and so the LL driver) expands them
+ */
+const std::vector<int> &EarleyParser::getDerivation() const {
+    return derivation;
+}
+
+std::size_t EarleyParser::getItemCount() const {
+    return items.size();
+}
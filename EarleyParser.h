@@ -0,0 +1,123 @@
+//
+// Created by jens on 19/10/26.
+//
+
+#ifndef COMPILER_EARLEYPARSER_H
+#define COMPILER_EARLEYPARSER_H
+
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+#include "CompiledGrammar.h"
+#include "Token.h"
+
+/**
+ * Earley recogniser for any context-free grammar, on the symbol ids of a CompiledGrammar. Parser hands it the
+ * input at the entries of the LL(1) table that have a conflict, so it only runs where one token of lookahead
+ * cannot decide.
+ *
+ * An item is a dotted rule (production and dot, numbered once for the grammar) and an origin, 8 bytes; the items
+ * of a set lie together in one array and are sorted once the set is complete, by the symbol after the dot, so
+ * the completer and the scanner find what they advance by binary search. Nullable symbols are passed over when
+ * predicted (Aycock and Horspool), so a set never has to be processed twice.
+ *
+ * With Leo's optimisation, a completion along a deterministic reduction path (a chain of items, each the only one
+ * waiting for the symbol it ends with) adds the topmost item of the chain at once instead of every item on it, so
+ * right recursion costs a constant number of items per token and the recogniser runs in linear time on LR-regular
+ * grammars. The skipped items are recovered from the chain when the derivation is read off the chart.
+ */
+class EarleyParser {
+public:
+    static constexpr std::int32_t NO_PARSE = -1;
+
+private:
+    struct Item {
+        std::uint32_t rule;     // dotted rule, see Rule
+        std::uint32_t origin;   // the set the item was predicted in
+    };
+
+    struct Rule {
+        std::int32_t next;          // the symbol after the dot, -(1 + head) once the dot is at the end
+        std::int32_t production;
+    };
+
+    struct Span {
+        std::int32_t symbol;
+        std::uint32_t from;
+        std::uint32_t to;
+        std::uint32_t parent;       // index in spans, NONE for the goal
+    };
+
+    struct LeoCompletion {
+        std::uint32_t set;          // where the topmost item was added
+        std::uint32_t origin;       // of the completed item at the bottom of the chain
+        std::int32_t symbol;        // its head
+    };
+
+    static constexpr std::uint32_t NONE = UINT32_MAX;
+
+    struct Path {
+        std::uint32_t set;          // where the walk up a Leo path goes on, NONE once at the top
+        std::int32_t symbol;
+    };
+
+    struct Skipped {
+        std::vector<Path> paths;    // one per Leo completion in the set
+        std::vector<Item> list;
+        std::uint32_t reached = NONE;   // the lowest origin walked down to
+    };
+
+    CompiledGrammar grammar;
+    std::vector<Rule> rules;                    // rule of production p with the dot before symbol d: ruleStart[p] + d
+    std::vector<std::uint32_t> ruleStart;       // per production, the goal production S' ::= goal last
+    std::vector<std::int32_t> heads;            // per production, goal included
+    std::vector<std::vector<int>> productionsOf;    // per non-terminal
+    std::int32_t goalHead;                      // S', an id past every non-terminal
+    std::uint32_t goalRule;                     // S' ::= . goal
+    std::vector<std::int32_t> goalBody;         // {goal}
+    bool leo = true;
+
+    // the chart of the last parse
+    std::vector<Token> tokens;
+    std::vector<Item> items;
+    std::vector<std::uint32_t> setStart;        // set j is items[setStart[j], setStart[j + 1])
+    std::vector<std::uint32_t> predicted;       // per non-terminal, 1 + the last set it was predicted in
+    std::vector<LeoCompletion> leoCompletions;
+    std::unordered_map<std::uint64_t, Item> topmost;    // per (set, symbol), rule NONE without a path
+    std::vector<int> derivation;
+
+    // items of the set being built, open addressing; a slot is in use if its stamp is the current one
+    std::vector<std::uint64_t> slots;
+    std::vector<std::uint32_t> slotStamps;
+    std::uint32_t stamp = 0;
+
+    [[nodiscard]] inline std::int32_t keyOf(std::uint32_t rule) const { return rules[rule].next; }
+    [[nodiscard]] inline std::int32_t headOf(std::uint32_t rule) const { return heads[rules[rule].production]; }
+    [[nodiscard]] bool less(const Item &a, const Item &b) const;
+    [[nodiscard]] const std::vector<std::int32_t> &bodyOf(int production) const;
+    void startSet();
+    void add(std::uint32_t rule, std::uint32_t origin);
+    void build(std::uint32_t set);
+    void complete(std::uint32_t set, std::int32_t symbol, std::uint32_t origin);
+    [[nodiscard]] std::pair<const Item *, const Item *> waiting(const Item *first, const Item *last, std::int32_t key,
+                                                               std::uint32_t minOrigin = 0) const;
+    [[nodiscard]] std::pair<const Item *, const Item *> waiting(std::uint32_t set, std::int32_t key) const;
+    [[nodiscard]] bool contains(std::uint32_t set, std::uint32_t rule, std::uint32_t origin) const;
+    [[nodiscard]] Item findTopmost(std::uint32_t set, std::int32_t symbol);
+    const std::vector<Item> &skippedIn(std::uint32_t set, std::uint32_t minOrigin,
+                                       std::unordered_map<std::uint32_t, Skipped> &skipped);
+    bool derive(std::uint32_t end);
+
+public:
+    explicit EarleyParser(const CompiledGrammar &grammar);
+    void setLeo(bool leo);
+    std::int32_t parse(std::int32_t goal, const Token &first, const std::function<Token()> &next,
+                       const std::function<bool(int)> &canEnd);
+    [[nodiscard]] const std::vector<Token> &getTokens() const;
+    [[nodiscard]] const std::vector<int> &getDerivation() const;
+    [[nodiscard]] std::size_t getItemCount() const;
+};
+
+
+#endif //COMPILER_EARLEYPARSER_H
@@ -0,0 +1,157 @@
+//
+// generated by ParserGenerator from the grammar starting with <expr>
+// do not edit, regenerate instead
+//
+
+#ifndef COMPILER_EXPRESSIONPARSER_H
+#define COMPILER_EXPRESSIONPARSER_H
+
+#include "Lexer.h"
+#include "Parser.h"
+
+class ExpressionParser {
+private:
+    Lexer *lexer;
+    Token token = Token(Token::TokenType::INVALID_TOKEN);
+
+    void advance() {
+        do {
+            token = lexer->nextToken();
+        } while (token.isWhitespace());
+    }
+
+    void match(int type) {
+        if (token.getTokenType() != type) {
+            throw SyntacticalError("error: expected " + Token::tokenTypeAsString((Token::TokenType) type) + " got " + Token::tokenTypeAsString(token.getTokenType()), token.getLine(), token.getColumn());
+        }
+        advance();
+    }
+
+    void error() {
+        throw SyntacticalError("error", token.getLine(), token.getColumn());
+    }
+
+    // <expr>
+    void parse_expr() {
+        switch (token.getTokenType()) {
+            case 26:    // id
+            case 27:    // int_literal
+            case 28:    // float_literal
+            case 69:    // (
+                // <expr> ::= <term> <expr_p>
+                parse_term();
+                parse_expr_p();
+                return;
+            default:
+                error();
+        }
+    }
+
+    // <expr_p>
+    void parse_expr_p() {
+        while (true) {
+            switch (token.getTokenType()) {
+                case 32:    // +
+                    // <expr_p> ::= + <term> <expr_p>
+                    advance();
+                    parse_term();
+                    continue;
+                case 33:    // -
+                    // <expr_p> ::= - <term> <expr_p>
+                    advance();
+                    parse_term();
+                    continue;
+                case 70:    // )
+                case 76:    // EOF
+                    // <expr_p> ::= EPSILON
+                    return;
+                default:
+                    error();
+            }
+        }
+    }
+
+    // <term>
+    void parse_term() {
+        switch (token.getTokenType()) {
+            case 26:    // id
+            case 27:    // int_literal
+            case 28:    // float_literal
+            case 69:    // (
+                // <term> ::= <factor> <term_p>
+                parse_factor();
+                parse_term_p();
+                return;
+            default:
+                error();
+        }
+    }
+
+    // <term_p>
+    void parse_term_p() {
+        while (true) {
+            switch (token.getTokenType()) {
+                case 34:    // *
+                    // <term_p> ::= * <factor> <term_p>
+                    advance();
+                    parse_factor();
+                    continue;
+                case 35:    // /
+                    // <term_p> ::= / <factor> <term_p>
+                    advance();
+                    parse_factor();
+                    continue;
+                case 36:    // %
+                    // <term_p> ::= % <factor> <term_p>
+                    advance();
+                    parse_factor();
+                    continue;
+                case 32:    // +
+                case 33:    // -
+                case 70:    // )
+                case 76:    // EOF
+                    // <term_p> ::= EPSILON
+                    return;
+                default:
+                    error();
+            }
+        }
+    }
+
+    // <factor>
+    void parse_factor() {
+        switch (token.getTokenType()) {
+            case 69:    // (
+                // <factor> ::= ( <expr> )
+                advance();
+                parse_expr();
+                match(70);    // )
+                return;
+            case 27:    // int_literal
+                // <factor> ::= int_literal
+                advance();
+                return;
+            case 28:    // float_literal
+                // <factor> ::= float_literal
+                advance();
+                return;
+            case 26:    // id
+                // <factor> ::= id
+                advance();
+                return;
+            default:
+                error();
+        }
+    }
+
+public:
+    explicit ExpressionParser(Lexer *lexer) : lexer(lexer) {}
+
+    void parse() {
+        advance();
+        parse_expr();
+        match(76);    // EOF
+    }
+};
+
+#endif //COMPILER_EXPRESSIONPARSER_H
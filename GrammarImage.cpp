@@ -0,0 +1,293 @@
+//
+// Created by jens on 19/10/26.
+//
+
+#include <cstring>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "GrammarImage.h"
+#include "ContextFreeGrammar.h"
+
+static const char MAGIC[8] = {'L', 'L', '1', 'G', 'R', 'A', 'M', '\0'};
+
+// FNV-1a, stable across runs and platforms unlike std::hash
+static void fnv1a(std::uint64_t &hash, const void *bytes, std::size_t length) {
+    const auto *p = static_cast<const unsigned char *>(bytes);
+    for (std::size_t i = 0; i < length; i++) {
+        hash ^= p[i];
+        hash *= 1099511628211ULL;
+    }
+}
+
+static void hashSymbol(std::uint64_t &hash, const GrammarSymbol &symbol) {
+    std::int32_t type = symbol.getType();
+    fnv1a(hash, &type, sizeof(type));
+    if (symbol.isTerminal()) {
+        std::int32_t terminal = symbol.getTerminal();
+        fnv1a(hash, &terminal, sizeof(terminal));
+    } else {
+        std::string name = symbol.getNonTerminal();
+        fnv1a(hash, name.c_str(), name.size() + 1);
+    }
+}
+
+std::uint64_t GrammarImage::hashProductions(const std::vector<Production> &productions) {
+    std::uint64_t hash = 14695981039346656037ULL;
+    std::uint32_t version = VERSION;
+    std::uint32_t terminalCount = Token::TOKEN_TYPE_COUNT;
+    fnv1a(hash, &version, sizeof(version));
+    fnv1a(hash, &terminalCount, sizeof(terminalCount));
+    for (const Production &p: productions) {
+        hashSymbol(hash, p.head);
+        std::uint32_t length = p.body.size();
+        fnv1a(hash, &length, sizeof(length));
+        for (const GrammarSymbol &s: p.body) {
+            hashSymbol(hash, s);
+        }
+    }
+    return hash;
+}
+
+void GrammarImage::write(const std::string &filename, ContextFreeGrammar &grammar) {
+    const std::vector<Production> &productions = grammar.getProductions();
+    const std::vector<GrammarSymbol> &nonTerminals = grammar.getNonTerminals();
+    const auto &FIRST = grammar.getFirstSets();
+    const auto &FIRST_P = grammar.getFirstSetsForProductions();
+    const auto &FOLLOW = grammar.getFollowSets();
+    CompressedParsingTable table = grammar.compressParsingTable();
+
+    std::vector<char> out(sizeof(Header), '\0');
+    auto align = [&out]() { out.resize((out.size() + 7) & ~(std::size_t) 7, '\0'); };
+    auto append = [&out](const void *bytes, std::size_t length) {
+        out.insert(out.end(), static_cast<const char *>(bytes), static_cast<const char *>(bytes) + length);
+    };
+    auto appendSet = [&append](const std::unordered_set<GrammarSymbol> *set) {
+        std::uint64_t words[SET_WORDS] = {};
+        if (set != nullptr) {
+            for (const GrammarSymbol &s: *set) {
+                words[s.getTerminal() / 64] |= 1ULL << (s.getTerminal() % 64);
+            }
+        }
+        append(words, sizeof(words));
+    };
+
+    Header header{};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.terminalCount = Token::TOKEN_TYPE_COUNT;
+    header.productionHash = hashProductions(productions);
+    header.nonTerminalCount = nonTerminals.size();
+    header.productionCount = productions.size();
+    header.slotCount = table.getSlotCount();
+
+    // names
+    align();
+    header.namesOffset = out.size();
+    std::vector<std::int32_t> nameOffsets{0};
+    std::string names;
+    for (const GrammarSymbol &nt: nonTerminals) {
+        names += nt.getNonTerminal();
+        nameOffsets.push_back((std::int32_t) names.size());
+    }
+    append(nameOffsets.data(), nameOffsets.size() * sizeof(std::int32_t));
+    append(names.data(), names.size());
+
+    // productions
+    align();
+    header.productionsOffset = out.size();
+    std::vector<std::int32_t> heads, bodyOffsets{0}, bodies;
+    for (const Production &p: productions) {
+        heads.push_back(grammar.getSymbolId(p.head));
+        for (const GrammarSymbol &s: p.body) {
+            bodies.push_back(grammar.getSymbolId(s));
+        }
+        bodyOffsets.push_back((std::int32_t) bodies.size());
+    }
+    header.bodySymbolCount = bodies.size();
+    append(heads.data(), heads.size() * sizeof(std::int32_t));
+    append(bodyOffsets.data(), bodyOffsets.size() * sizeof(std::int32_t));
+    append(bodies.data(), bodies.size() * sizeof(std::int32_t));
+
+    // FIRST, FIRST_P, FOLLOW
+    align();
+    header.setsOffset = out.size();
+    for (const GrammarSymbol &nt: nonTerminals) {
+        auto it = FIRST.find(nt);
+        appendSet(it == FIRST.end() ? nullptr : &it->second);
+    }
+    for (const Production &p: productions) {
+        auto it = FIRST_P.find(p);
+        appendSet(it == FIRST_P.end() ? nullptr : &it->second);
+    }
+    for (const GrammarSymbol &nt: nonTerminals) {
+        auto it = FOLLOW.find(nt);
+        appendSet(it == FOLLOW.end() ? nullptr : &it->second);
+    }
+
+    // parsing table
+    align();
+    header.tableOffset = out.size();
+    append(table.getBase(), nonTerminals.size() * sizeof(std::int32_t));
+    append(table.getDefaults(), nonTerminals.size() * sizeof(std::int32_t));
+    append(table.getCheck(), table.getSlotCount() * sizeof(std::int32_t));
+    append(table.getNext(), table.getSlotCount() * sizeof(std::int32_t));
+
+    header.fileSize = out.size();
+    std::memcpy(out.data(), &header, sizeof(Header));
+
+    std::string temporary = filename + ".tmp" + std::to_string(getpid());
+    std::ofstream fout(temporary, std::ios::out | std::ios::trunc | std::ios::binary);
+    if (!fout.is_open()) {
+        throw std::runtime_error("Could not open file " + temporary);
+    }
+    fout.write(out.data(), (std::streamsize) out.size());
+    fout.close();
+    if (!fout || std::rename(temporary.c_str(), filename.c_str()) != 0) {
+        std::remove(temporary.c_str());
+        throw std::runtime_error("Could not write grammar image " + filename);
+    }
+}
+
+std::shared_ptr<const GrammarImage> GrammarImage::load(const std::string &filename, std::uint64_t expectedHash) {
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) return nullptr;
+    struct stat st{};
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t) sizeof(Header)) {
+        close(fd);
+        return nullptr;
+    }
+    void *mapping = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);  // the mapping stays valid after the descriptor is closed
+    if (mapping == MAP_FAILED) return nullptr;
+
+    const Header &h = *static_cast<const Header *>(mapping);
+    std::uint64_t setBytes = (2 * (std::uint64_t) h.nonTerminalCount + h.productionCount) * SET_WORDS * 8;
+    std::uint64_t tableBytes = (2 * (std::uint64_t) h.nonTerminalCount + 2 * (std::uint64_t) h.slotCount) * 4;
+    bool valid = std::memcmp(h.magic, MAGIC, sizeof(MAGIC)) == 0
+                 && h.version == VERSION
+                 && h.terminalCount == Token::TOKEN_TYPE_COUNT
+                 && h.productionHash == expectedHash
+                 && h.fileSize == (std::uint64_t) st.st_size
+                 && h.namesOffset <= h.productionsOffset
+                 && h.productionsOffset + (2 * (std::uint64_t) h.productionCount + 1 + h.bodySymbolCount) * 4
+                    <= h.setsOffset
+                 && h.setsOffset + setBytes <= h.tableOffset
+                 && h.tableOffset + tableBytes <= h.fileSize
+                 && (h.namesOffset | h.productionsOffset | h.setsOffset | h.tableOffset) % 8 == 0
+                 && h.namesOffset + ((std::uint64_t) h.nonTerminalCount + 1) * 4 <= h.productionsOffset
+                 && hasValidContents(static_cast<const char *>(mapping));
+    if (!valid) {
+        munmap(mapping, st.st_size);
+        return nullptr;
+    }
+    return std::shared_ptr<const GrammarImage>(new GrammarImage(static_cast<const char *>(mapping), st.st_size));
+}
+
+/**
+ * the header is known to be consistent with the file size; checks that every offset, symbol id and production index
+ * in the sections stays within them, so a corrupt image is rejected rather than read out of bounds
+ */
+bool GrammarImage::hasValidContents(const char *data) {
+    const Header &h = *reinterpret_cast<const Header *>(data);
+    const auto N = (std::int64_t) h.nonTerminalCount, P = (std::int64_t) h.productionCount;
+    const std::int64_t T = Token::TOKEN_TYPE_COUNT;
+
+    const auto *nameOffsets = reinterpret_cast<const std::int32_t *>(data + h.namesOffset);
+    std::uint64_t namesEnd = h.namesOffset + ((std::uint64_t) N + 1) * 4;
+    if (nameOffsets[0] != 0) return false;
+    for (std::int64_t i = 0; i < N; i++) {
+        if (nameOffsets[i + 1] < nameOffsets[i]) return false;
+    }
+    if (namesEnd + (std::uint64_t) nameOffsets[N] > h.productionsOffset) return false;
+
+    const auto *heads = reinterpret_cast<const std::int32_t *>(data + h.productionsOffset);
+    const std::int32_t *bodyOffsets = heads + P;
+    const std::int32_t *bodies = bodyOffsets + P + 1;
+    if (bodyOffsets[0] != 0 || bodyOffsets[P] != (std::int64_t) h.bodySymbolCount) return false;
+    for (std::int64_t p = 0; p < P; p++) {
+        if (heads[p] < T || heads[p] >= T + N || bodyOffsets[p + 1] < bodyOffsets[p]) return false;
+    }
+    for (std::uint32_t i = 0; i < h.bodySymbolCount; i++) {
+        if (bodies[i] < 0 || bodies[i] >= T + N) return false;
+    }
+
+    const auto *table = reinterpret_cast<const std::int32_t *>(data + h.tableOffset);
+    const std::int32_t *base = table, *defaults = table + N, *check = table + 2 * N, *next = check + h.slotCount;
+    auto isProduction = [P](std::int32_t p) { return p == CompressedParsingTable::NO_ENTRY || (p >= 0 && p < P); };
+    for (std::int64_t r = 0; r < N; r++) {
+        if (base[r] < 0 || base[r] + T > (std::int64_t) h.slotCount || !isProduction(defaults[r])) return false;
+    }
+    for (std::uint32_t i = 0; i < h.slotCount; i++) {
+        if (check[i] < CompressedParsingTable::NO_ENTRY || check[i] >= N || !isProduction(next[i])) return false;
+    }
+    return true;
+}
+
+GrammarImage::GrammarImage(const char *data, std::size_t size) : data(data), size(size) {
+    header = reinterpret_cast<const Header *>(data);
+    nameOffsets = reinterpret_cast<const std::int32_t *>(data + header->namesOffset);
+    names = reinterpret_cast<const char *>(nameOffsets + header->nonTerminalCount + 1);
+    heads = reinterpret_cast<const std::int32_t *>(data + header->productionsOffset);
+    bodyOffsets = heads + header->productionCount;
+    bodies = bodyOffsets + header->productionCount + 1;
+    first = reinterpret_cast<const std::uint64_t *>(data + header->setsOffset);
+    firstP = first + (std::size_t) header->nonTerminalCount * SET_WORDS;
+    follow = firstP + (std::size_t) header->productionCount * SET_WORDS;
+    table = reinterpret_cast<const std::int32_t *>(data + header->tableOffset);
+}
+
+GrammarImage::~GrammarImage() {
+    munmap(const_cast<char *>(data), size);
+}
+
+bool GrammarImage::testBit(const std::uint64_t *set, int bit) {
+    return (set[bit / 64] >> (bit % 64)) & 1;
+}
+
+int GrammarImage::getNonTerminalCount() const {
+    return (int) header->nonTerminalCount;
+}
+
+int GrammarImage::getProductionCount() const {
+    return (int) header->productionCount;
+}
+
+std::string GrammarImage::getNonTerminalName(int nonTerminal) const {
+    return {names + nameOffsets[nonTerminal], names + nameOffsets[nonTerminal + 1]};
+}
+
+int GrammarImage::getProductionHead(int production) const {
+    return heads[production];
+}
+
+int GrammarImage::getProductionBodySize(int production) const {
+    return bodyOffsets[production + 1] - bodyOffsets[production];
+}
+
+const std::int32_t *GrammarImage::getProductionBody(int production) const {
+    return bodies + bodyOffsets[production];
+}
+
+bool GrammarImage::inFirst(int nonTerminal, int terminal) const {
+    return testBit(first + (std::size_t) nonTerminal * SET_WORDS, terminal);
+}
+
+bool GrammarImage::inFirstOfProduction(int production, int terminal) const {
+    return testBit(firstP + (std::size_t) production * SET_WORDS, terminal);
+}
+
+bool GrammarImage::inFollow(int nonTerminal, int terminal) const {
+    return testBit(follow + (std::size_t) nonTerminal * SET_WORDS, terminal);
+}
+
+CompressedParsingTable GrammarImage::getParsingTable() const {
+    int rows = (int) header->nonTerminalCount;
+    int slots = (int) header->slotCount;
+    return {rows, Token::TOKEN_TYPE_COUNT, slots, table, table + rows, table + 2 * rows, table + 2 * rows + slots,
+            shared_from_this()};
+}
@@ -0,0 +1,110 @@
+//
+// Created by jens on 19/10/26.
+//
+
+#ifndef COMPILER_GRAMMARIMAGE_H
+#define COMPILER_GRAMMARIMAGE_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "Production.h"
+#include "CompressedParsingTable.h"
+
+class ContextFreeGrammar;
+
+/**
+ * Precompiled, versioned binary image of an analysed grammar: non-terminal names, productions,
+ * FIRST / FIRST_P / FOLLOW sets and the compressed parsing table.
+ *
+ * The file is keyed by a hash of the production list and loaded through mmap, nothing is parsed on load:
+ * the sets and the table are read in place.
+ *
+ * Layout (native byte order, every section aligned to 8 bytes):
+ * ```
+ *      Header
+ *      int32  nameOffsets[nonTerminalCount + 1]    followed by the name characters
+ *      int32  heads[productionCount]               symbol ids, see ContextFreeGrammar::getSymbolId
+ *      int32  bodyOffsets[productionCount + 1]     followed by int32 bodies[bodySymbolCount]
+ *      uint64 first[nonTerminalCount][setWords]    bitsets over terminal columns
+ *      uint64 firstP[productionCount][setWords]
+ *      uint64 follow[nonTerminalCount][setWords]
+ *      int32  base[nonTerminalCount], defaults[nonTerminalCount], check[slotCount], next[slotCount]
+ * ```
+ */
+class GrammarImage : public std::enable_shared_from_this<GrammarImage> {
+public:
+    static constexpr std::uint32_t VERSION = 1;
+    static constexpr int SET_WORDS = (Token::TOKEN_TYPE_COUNT + 63) / 64;
+
+    struct Header {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t terminalCount;    // Token::TOKEN_TYPE_COUNT when written, the token set must not have changed
+        std::uint64_t productionHash;
+        std::uint32_t nonTerminalCount;
+        std::uint32_t productionCount;
+        std::uint32_t bodySymbolCount;
+        std::uint32_t slotCount;
+        std::uint64_t namesOffset;
+        std::uint64_t productionsOffset;
+        std::uint64_t setsOffset;
+        std::uint64_t tableOffset;
+        std::uint64_t fileSize;
+    };
+
+private:
+    const char *data = nullptr;
+    std::size_t size = 0;
+    const Header *header = nullptr;
+    const std::int32_t *nameOffsets = nullptr;
+    const char *names = nullptr;
+    const std::int32_t *heads = nullptr;
+    const std::int32_t *bodyOffsets = nullptr;
+    const std::int32_t *bodies = nullptr;
+    const std::uint64_t *first = nullptr;
+    const std::uint64_t *firstP = nullptr;
+    const std::uint64_t *follow = nullptr;
+    const std::int32_t *table = nullptr;
+
+    GrammarImage(const char *data, std::size_t size);
+
+    static bool testBit(const std::uint64_t *set, int bit);
+    static bool hasValidContents(const char *data);
+
+public:
+    GrammarImage(const GrammarImage &) = delete;
+    GrammarImage &operator=(const GrammarImage &) = delete;
+    ~GrammarImage();
+
+    static std::uint64_t hashProductions(const std::vector<Production> &productions);
+
+    /**
+     * analyses the grammar (if it has not been) and writes its image,
+     * the file is written to a temporary name first and renamed so concurrent readers never see a partial image
+     */
+    static void write(const std::string &filename, ContextFreeGrammar &grammar);
+
+    /**
+     * maps the image, returns nullptr if the file does not exist, is malformed,
+     * or was written for another version, token set or production list
+     */
+    static std::shared_ptr<const GrammarImage> load(const std::string &filename, std::uint64_t expectedHash);
+
+    [[nodiscard]] int getNonTerminalCount() const;
+    [[nodiscard]] int getProductionCount() const;
+    [[nodiscard]] std::string getNonTerminalName(int nonTerminal) const;
+    [[nodiscard]] int getProductionHead(int production) const;
+    [[nodiscard]] int getProductionBodySize(int production) const;
+    [[nodiscard]] const std::int32_t *getProductionBody(int production) const;
+
+    [[nodiscard]] bool inFirst(int nonTerminal, int terminal) const;
+    [[nodiscard]] bool inFirstOfProduction(int production, int terminal) const;
+    [[nodiscard]] bool inFollow(int nonTerminal, int terminal) const;
+
+    [[nodiscard]] CompressedParsingTable getParsingTable() const;  // borrows the mapping, keeps the image alive
+};
+
+
+#endif //COMPILER_GRAMMARIMAGE_H
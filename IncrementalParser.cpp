@@ -0,0 +1,399 @@
+//
+// Created by jens on 19/10/26.
+//
+
+#include <algorithm>
+#include <sstream>
+#include "IncrementalParser.h"
+#include "InputBuffer.h"
+#include "Lexer.h"
+#include "Trace.h"
+
+IncrementalParser::IncrementalParser(const CompiledGrammar &grammar) : grammar(grammar) {
+    setText("");
+}
+
+/**
+ * the tokens of one line, without whitespace
+ */
+std::vector<Token> IncrementalParser::lex(const std::string &line) {
+    std::istringstream in(line);
+    InputBuffer inputBuffer(in, "<line>");
+    Lexer lexer(&inputBuffer, &symbolTable);
+    std::vector<Token> tokens;
+    for (Token token = lexer.nextToken(); token.getTokenType() != Token::TokenType::END_OF_FILE;
+         token = lexer.nextToken()) {
+        if (!token.isWhitespace()) tokens.push_back(std::move(token));
+    }
+    return tokens;
+}
+
+/**
+ * lexes `text`, the lines from line `first` on, into `lexed`
+ * @return false on a lexical error, which is then the one getError() reports
+ */
+bool IncrementalParser::lexLines(const std::vector<std::string> &text, std::size_t first,
+                                 std::vector<std::vector<Token>> &lexed) {
+    for (std::size_t i = 0; i < text.size(); i++) {
+        try {
+            lexed.push_back(lex(text[i]));
+        } catch (LexicalError &e) {
+            error = {std::string("error: ") + e.getReason(), (int) (first + i) + e.getLine(), e.getColumn() + 1};
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * replaces the whole document, the next parse starts from scratch
+ * @return false on a lexical error, see getError(); the document is then left as it was
+ */
+bool IncrementalParser::setText(const std::string &text) {
+    Trace::Span span("lex", "lex document");
+    std::vector<std::string> newLines;
+    std::size_t from = 0;
+    while (true) {
+        std::size_t end = text.find('\n', from);
+        newLines.push_back(text.substr(from, end == std::string::npos ? std::string::npos : end - from));
+        if (end == std::string::npos) break;
+        from = end + 1;
+    }
+    std::vector<std::vector<Token>> lexed;
+    if (!lexLines(newLines, 0, lexed)) return false;
+    lines = std::move(newLines);
+    lineTokens = std::move(lexed);
+    types.clear();
+    for (const std::vector<Token> &tokens: lineTokens) {
+        for (const Token &token: tokens) types.push_back(token.getTokenType());
+    }
+    types.push_back(Token::TokenType::END_OF_FILE);
+    indexTokens();
+    nodes.clear();
+    root = NONE;
+    liveNodes = 0;
+    edited = false;
+    return true;
+}
+
+void IncrementalParser::indexTokens() {
+    lineStart.resize(lines.size() + 1);
+    lineStart[0] = 0;
+    for (std::size_t i = 0; i < lines.size(); i++) lineStart[i + 1] = lineStart[i] + lineTokens[i].size();
+}
+
+/**
+ * replaces `count` lines from line `first` (0-based) by `replacement`, lexing only the new lines
+ * @return false on a lexical error, see getError(); the document is then left as it was
+ */
+bool IncrementalParser::replaceLines(std::size_t first, std::size_t count, const std::vector<std::string> &replacement) {
+    if (first + count > lines.size()) throw std::out_of_range("replaceLines beyond the end of the document");
+    std::vector<std::vector<Token>> lexed;
+    if (!lexLines(replacement, first, lexed)) return false;
+    std::vector<std::int32_t> newTypes;
+    for (const std::vector<Token> &tokens: lexed) {
+        for (const Token &token: tokens) newTypes.push_back(token.getTokenType());
+    }
+    std::size_t begin = lineStart[first], end = lineStart[first + count];
+    types.erase(types.begin() + (std::ptrdiff_t) begin, types.begin() + (std::ptrdiff_t) end);
+    types.insert(types.begin() + (std::ptrdiff_t) begin, newTypes.begin(), newTypes.end());
+    lines.erase(lines.begin() + (std::ptrdiff_t) first, lines.begin() + (std::ptrdiff_t) (first + count));
+    lines.insert(lines.begin() + (std::ptrdiff_t) first, replacement.begin(), replacement.end());
+    lineTokens.erase(lineTokens.begin() + (std::ptrdiff_t) first,
+                     lineTokens.begin() + (std::ptrdiff_t) (first + count));
+    lineTokens.insert(lineTokens.begin() + (std::ptrdiff_t) first, std::make_move_iterator(lexed.begin()),
+                      std::make_move_iterator(lexed.end()));
+    indexTokens();
+    markDirty(begin, end, newTypes.size());
+    return true;
+}
+
+/**
+ * adds the replacement of tokens [begin, end) by `inserted` tokens to the changes since the last tree
+ */
+void IncrementalParser::markDirty(std::size_t begin, std::size_t end, std::size_t inserted) {
+    std::ptrdiff_t change = (std::ptrdiff_t) inserted - (std::ptrdiff_t) (end - begin);
+    if (!edited) {
+        edited = true;
+        dirtyBegin = begin;
+        dirtyEnd = begin + inserted;
+    } else {
+        // where the current end of the changes moves to, then the union of both changes
+        std::size_t movedEnd = dirtyEnd <= begin ? dirtyEnd
+                                                 : dirtyEnd >= end ? (std::size_t) ((std::ptrdiff_t) dirtyEnd + change)
+                                                                   : begin + inserted;
+        dirtyBegin = std::min(dirtyBegin, begin);
+        dirtyEnd = std::max(movedEnd, begin + inserted);
+    }
+    delta += change;
+}
+
+/**
+ * whether a node of the previous tree that started at `oldStart` and consumed `length` tokens is still what the
+ * parse would build at `position`: its tokens and its lookahead are unchanged and it moved to `position`
+ */
+bool IncrementalParser::reusable(std::size_t oldStart, std::uint32_t length, std::size_t position) const {
+    if (!edited) return oldStart == position;
+    if (oldStart + length < dirtyBegin) return oldStart == position;
+    if ((std::ptrdiff_t) oldStart >= (std::ptrdiff_t) dirtyEnd - delta) {
+        return (std::ptrdiff_t) oldStart + delta == (std::ptrdiff_t) position;
+    }
+    return false;
+}
+
+/**
+ * moves the cursor over the old tree to the token `position` maps to and returns an old node of `symbol` starting
+ * there that can be taken over, or NONE. The cursor only moves forward, so the old tree is walked once per parse.
+ */
+std::uint32_t IncrementalParser::takeOver(std::int32_t symbol, std::size_t position) {
+    if (cursor.empty() || (position >= dirtyBegin && position < dirtyEnd)) return NONE;
+    std::size_t target = position < dirtyBegin ? position : (std::size_t) ((std::ptrdiff_t) position - delta);
+    while (!cursor.empty() && cursor.back().second < target) {
+        auto [node, start] = cursor.back();
+        cursor.pop_back();
+        const Node &n = nodes[node];
+        if (start + n.length > target) {   // contains the target, descend
+            std::size_t end = start + n.length;
+            for (std::uint32_t i = n.childCount; i-- > 0;) {
+                end -= nodes[n.firstChild + i].length;
+                cursor.emplace_back(n.firstChild + i, end);
+            }
+        }
+    }
+    if (cursor.empty() || cursor.back().second != target) return NONE;
+
+    // the old nodes starting at the target are the top and its first descendants
+    std::uint32_t candidate = cursor.back().first;
+    int depth = 0;
+    while (nodes[candidate].symbol != symbol) {
+        if (nodes[candidate].childCount == 0) return NONE;
+        candidate = nodes[candidate].firstChild;
+        depth++;
+    }
+    if (!reusable(target, nodes[candidate].length, position)) return NONE;
+    for (; depth > 0; depth--) {
+        auto [node, start] = cursor.back();
+        cursor.pop_back();
+        const Node &n = nodes[node];
+        std::size_t end = start + n.length;
+        for (std::uint32_t i = n.childCount; i-- > 0;) {
+            end -= nodes[n.firstChild + i].length;
+            cursor.emplace_back(n.firstChild + i, end);
+        }
+    }
+    cursor.pop_back();
+    return candidate;
+}
+
+/**
+ * parses `symbol` from token `position` into a new node, walking the old subtree `old` (which started at old token
+ * `oldStart`) alongside to take over its unchanged parts
+ * @return the new node, or NONE on a syntax error (see error); `position` is moved past the tokens consumed
+ */
+std::uint32_t IncrementalParser::parseSubtree(std::int32_t symbol, std::uint32_t old, std::size_t oldStart,
+                                              std::size_t &position) {
+    std::uint32_t top = (std::uint32_t) nodes.size();
+    nodes.push_back({symbol, -1, 0, NONE, 0});
+    cursor.clear();
+    if (old != NONE) cursor.emplace_back(old, oldStart);
+    stack.clear();
+    stack.push_back({symbol, top, 0});
+    while (!stack.empty()) {
+        Entry e = stack.back();
+        stack.pop_back();
+        if (e.symbol == REDUCE) {
+            nodes[e.slot].length = (std::uint32_t) (position - e.start);
+            continue;
+        }
+        if (CompiledGrammar::isTerminal(e.symbol)) {
+            if (types[position] != e.symbol) {
+                fail("error: expected " + grammar.getSymbol(e.symbol).toString() + " got "
+                     + Token::tokenTypeAsString((Token::TokenType) types[position]), position);
+                return NONE;
+            }
+            nodes[e.slot] = {e.symbol, -1, 1, NONE, 0};
+            position++;
+            continue;
+        }
+        std::uint32_t previous = takeOver(e.symbol, position);
+        if (previous != NONE) {
+            nodes[e.slot] = nodes[previous];    // the subtree below is shared
+            position += nodes[previous].length;
+            reusedNodes++;
+            continue;
+        }
+
+        int production = grammar.predict(e.symbol, types[position]);
+        if (production == CompressedParsingTable::NO_ENTRY) {
+            fail("error: " + grammar.errorStrategy(e.symbol, types[position]).getMessage(), position);
+            return NONE;
+        }
+        const std::vector<std::int32_t> &body = grammar.getBody(production);
+        auto children = (std::uint32_t) body.size();
+        auto first = (std::uint32_t) nodes.size();
+        nodes.resize(nodes.size() + children);
+        nodes[e.slot] = {e.symbol, production, 0, children == 0 ? NONE : first, children};
+        builtNodes++;
+        stack.push_back({REDUCE, e.slot, position});
+        for (std::uint32_t i = children; i-- > 0;) stack.push_back({body[i], first + i, 0});
+    }
+    return top;
+}
+
+void IncrementalParser::fail(const std::string &message, std::size_t position) {
+    std::size_t line = getLineOf(position);
+    int column = position < types.size() - 1 ? getToken(position).getColumn() + 1 : (int) lines[line].size() + 1;
+    error = {message, (int) line + 1, column};
+}
+
+/**
+ * brings the tree up to date with the document.
+ *
+ * The previous tree is descended to the innermost node that starts before the changed tokens and whose tokens and
+ * lookahead reach past them; only that node is parsed again (taking over its unchanged children), and if it then
+ * ends where it ended before, shifted by the change, it replaces the old node and the enclosing nodes just grow.
+ * Otherwise the next enclosing node is tried, up to the root.
+ * @return false on a syntax error, see getError(); the last tree that parsed is kept
+ */
+bool IncrementalParser::parse() {
+    if (root != NONE && !edited) return true;
+    reusedNodes = builtNodes = 0;
+    std::size_t mark = nodes.size();
+
+    path.clear();
+    if (root != NONE && dirtyBegin > 0) {
+        std::size_t oldDirtyEnd = (std::size_t) ((std::ptrdiff_t) dirtyEnd - delta);
+        path.emplace_back(root, 0);
+        while (true) {
+            const Node &node = nodes[path.back().first];
+            std::size_t start = path.back().second;
+            bool deeper = false;
+            for (std::uint32_t i = 0; i < node.childCount; i++) {
+                const Node &child = nodes[node.firstChild + i];
+                if (start >= dirtyBegin) break;
+                if (child.production >= 0 && start + child.length >= oldDirtyEnd) {
+                    path.emplace_back(node.firstChild + i, start);
+                    deeper = true;
+                    break;
+                }
+                start += child.length;
+            }
+            if (!deeper) break;
+        }
+    }
+
+    for (std::size_t i = path.size(); i-- > 0;) {
+        std::uint32_t old = path[i].first;
+        Node previous = nodes[old];
+        std::size_t position = path[i].second;
+        std::uint32_t parsed = parseSubtree(previous.symbol, old, path[i].second, position);
+        if (parsed != NONE && (std::ptrdiff_t) position == (std::ptrdiff_t) (path[i].second + previous.length) + delta
+            && (i > 0 || types[position] == Token::TokenType::END_OF_FILE)) {
+            nodes[old] = nodes[parsed];     // in place, the parent keeps pointing at it
+            for (std::size_t j = 0; j < i; j++) {
+                nodes[path[j].first].length = (std::uint32_t) ((std::ptrdiff_t) nodes[path[j].first].length + delta);
+            }
+            edited = false;
+            delta = 0;
+            compact();
+            return true;
+        }
+        nodes.resize(mark);
+        if (i == 0 && parsed != NONE) fail("error: expected EOF got " + Token::tokenTypeAsString(
+                (Token::TokenType) types[position]), position);
+        if (i == 0) return false;
+    }
+
+    // no tree yet, or the change starts at the first token
+    std::size_t position = 0;
+    std::uint32_t parsed = parseSubtree(grammar.getStart(), root, 0, position);
+    if (parsed != NONE && types[position] != Token::TokenType::END_OF_FILE) {
+        fail("error: expected EOF got " + Token::tokenTypeAsString((Token::TokenType) types[position]), position);
+        parsed = NONE;
+    }
+    if (parsed == NONE) {
+        nodes.resize(mark);
+        return false;
+    }
+    if (root == NONE) liveNodes = nodes.size();
+    root = parsed;
+    edited = false;
+    delta = 0;
+    compact();
+    return true;
+}
+
+/**
+ * copies the tree to fresh storage, dropping the nodes of replaced subtrees, once they make up half of the storage
+ */
+void IncrementalParser::compact() {
+    if (nodes.size() <= 2 * liveNodes + 1024) return;
+    std::vector<Node> live;
+    live.reserve(liveNodes + builtNodes + 1);
+    live.push_back(nodes[root]);
+    for (std::size_t i = 0; i < live.size(); i++) {
+        Node &node = live[i];
+        if (node.childCount == 0) continue;
+        auto first = (std::uint32_t) live.size();
+        for (std::uint32_t c = 0; c < node.childCount; c++) live.push_back(nodes[node.firstChild + c]);
+        live[i].firstChild = first;     // `node` may have moved with the pushes
+    }
+    nodes = std::move(live);
+    root = 0;
+    liveNodes = nodes.size();
+}
+
+/**
+ * the error of the last parse or edit that failed
+ */
+const SyntaxDiagnostic &IncrementalParser::getError() const {
+    return error;
+}
+
+std::uint32_t IncrementalParser::getRoot() const {
+    return root;
+}
+
+const IncrementalParser::Node &IncrementalParser::operator[](std::uint32_t node) const {
+    return nodes[node];
+}
+
+/**
+ * the token at a position counted without whitespace; its line is that of getLineOf, its column is kept
+ */
+const Token &IncrementalParser::getToken(std::size_t position) const {
+    std::size_t line = getLineOf(position);
+    return lineTokens[line][position - lineStart[line]];
+}
+
+/**
+ * the line (0-based) of the token at `position`, the last line for END_OF_FILE
+ */
+std::size_t IncrementalParser::getLineOf(std::size_t position) const {
+    auto it = std::upper_bound(lineStart.begin(), lineStart.end() - 1, position);
+    std::size_t line = (std::size_t) (it - lineStart.begin()) - 1;
+    while (line + 1 < lines.size() && lineStart[line + 1] == position && lineTokens[line].size() == 0) line++;
+    return std::min(line, lines.size() - 1);
+}
+
+std::size_t IncrementalParser::getTokenCount() const {
+    return types.size() - 1;
+}
+
+std::size_t IncrementalParser::getLineCount() const {
+    return lines.size();
+}
+
+/**
+ * nodes taken over from the previous tree by the last parse (each with its whole subtree)
+ */
+std::size_t IncrementalParser::getReusedNodes() const {
+    return reusedNodes;
+}
+
+/**
+ * nodes the last parse had to expand again
+ */
+std::size_t IncrementalParser::getBuiltNodes() const {
+    return builtNodes;
+}
@@ -0,0 +1,102 @@
+//
+// Created by jens on 19/10/26.
+//
+
+#ifndef COMPILER_INCREMENTALPARSER_H
+#define COMPILER_INCREMENTALPARSER_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "CompiledGrammar.h"
+#include "Parser.h"
+#include "SymbolTable.h"
+
+/**
+ * Keeps a document, its tokens and its parse tree, and after an edit reparses reusing every subtree the edit
+ * cannot have changed.
+ *
+ * A node records how many tokens it consumed. In an LL(1) parse the expansion of a node depends on nothing but those
+ * tokens and the one token after them (the lookahead that ended it). After an edit only the innermost node whose
+ * first token and lookahead lie outside the edited tokens is parsed again; if it ends where it ended before, it is
+ * replaced in place and the nodes enclosing it just grow or shrink by the change, otherwise the next enclosing node
+ * is tried. While a node is parsed again the old one is walked alongside in preorder, and an old node of the
+ * expected non-terminal starting at the same token (shifted by the edit) is taken over whole when its tokens and
+ * lookahead are unchanged.
+ *
+ * Lines are lexed on their own, so tokens cannot span lines (a multi-line comment is a lexical error here). An edit
+ * with a lexical error is not applied and is reported by getError() as a syntax error is. Edits that fail to parse
+ * are accumulated against the last tree that parsed, which stays the one reused.
+ */
+class IncrementalParser {
+public:
+    struct Node {
+        std::int32_t symbol;        // symbol id, see CompiledGrammar
+        std::int32_t production;    // production index of an inner node, -1 for a leaf
+        std::uint32_t length;       // number of tokens consumed
+        std::uint32_t firstChild;   // children are consecutive
+        std::uint32_t childCount;
+    };
+
+    static constexpr std::uint32_t NONE = UINT32_MAX;
+
+private:
+    CompiledGrammar grammar;
+    SymbolTable symbolTable;
+    std::vector<std::string> lines;
+    std::vector<std::vector<Token>> lineTokens;     // without whitespace
+    std::vector<std::size_t> lineStart;             // index of the first token of each line
+    std::vector<std::int32_t> types;                // every token type in order, END_OF_FILE last
+    std::vector<Node> nodes;                        // the tree, replaced subtrees until compact()
+    std::uint32_t root = NONE;
+    std::size_t liveNodes = 0;                      // nodes of the tree after the last compaction
+
+    // the tokens changed since `root` was parsed: [dirtyBegin, dirtyEnd) now, [dirtyBegin, dirtyEnd - delta) then
+    bool edited = false;
+    std::size_t dirtyBegin = 0;
+    std::size_t dirtyEnd = 0;
+    std::ptrdiff_t delta = 0;
+
+    struct Entry {
+        std::int32_t symbol;        // REDUCE once the children of `slot` are parsed
+        std::uint32_t slot;         // node to fill in
+        std::size_t start;          // token where `slot` started, for REDUCE
+    };
+    static constexpr std::int32_t REDUCE = -1;
+    std::vector<Entry> stack;
+    std::vector<std::pair<std::uint32_t, std::size_t>> path;    // nodes enclosing the edit and their first token
+    std::vector<std::pair<std::uint32_t, std::size_t>> cursor;  // old nodes not passed yet, next in preorder on top
+
+    SyntaxDiagnostic error;
+    std::size_t reusedNodes = 0;
+    std::size_t builtNodes = 0;
+
+    std::vector<Token> lex(const std::string &line);
+    bool lexLines(const std::vector<std::string> &text, std::size_t first, std::vector<std::vector<Token>> &lexed);
+    void markDirty(std::size_t begin, std::size_t end, std::size_t inserted);
+    void indexTokens();
+    [[nodiscard]] bool reusable(std::size_t oldStart, std::uint32_t length, std::size_t position) const;
+    std::uint32_t takeOver(std::int32_t symbol, std::size_t position);
+    std::uint32_t parseSubtree(std::int32_t symbol, std::uint32_t old, std::size_t oldStart, std::size_t &position);
+    void fail(const std::string &message, std::size_t position);
+    void compact();
+
+public:
+    explicit IncrementalParser(const CompiledGrammar &grammar);
+    bool setText(const std::string &text);
+    bool replaceLines(std::size_t first, std::size_t count, const std::vector<std::string> &replacement);
+    bool parse();
+
+    [[nodiscard]] const SyntaxDiagnostic &getError() const;
+    [[nodiscard]] std::uint32_t getRoot() const;
+    [[nodiscard]] const Node &operator[](std::uint32_t node) const;
+    [[nodiscard]] const Token &getToken(std::size_t position) const;
+    [[nodiscard]] std::size_t getLineOf(std::size_t position) const;
+    [[nodiscard]] std::size_t getTokenCount() const;
+    [[nodiscard]] std::size_t getLineCount() const;
+    [[nodiscard]] std::size_t getReusedNodes() const;
+    [[nodiscard]] std::size_t getBuiltNodes() const;
+};
+
+
+#endif //COMPILER_INCREMENTALPARSER_H
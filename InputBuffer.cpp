@@ -4,15 +4,28 @@
 
 #include <iostream>
 #include "InputBuffer.h"
+#include "Stats.h"
+#include "Trace.h"
 
-InputBuffer::InputBuffer(const std::string &filename) {
+InputBuffer::InputBuffer(const std::string &filename) : in(&fin) {
+    Trace::Span span("load", "open", filename);
     this->filename = filename;
 
     this->fin.open(filename);
     if (!fin.is_open()) {
         throw std::runtime_error("Could not open file " + filename);
     }
+    init();
+}
+
+/**
+ * e.g. a std::istringstream over text held in memory; `name` is reported as the filename
+ */
+InputBuffer::InputBuffer(std::istream &in, const std::string &name) : filename(name), in(&in) {
+    init();
+}
 
+void InputBuffer::init() {
     // buffer is initialised to 0's before
     // set sentinels
     this->buffer[FIRST_HALF_SENTINEL] = EOF;
@@ -21,7 +34,6 @@ InputBuffer::InputBuffer(const std::string &filename) {
     // load first half
     loadFirstHalf();
     loadSecondHalf();
-
 }
 
 InputBuffer::~InputBuffer() {
@@ -29,27 +41,37 @@ InputBuffer::~InputBuffer() {
 }
 
 void InputBuffer::loadFirstHalf() {
+    STATS_PHASE(LOAD);
+    Trace::Span span("load", "refill");
     char ch;
-    for (int i = FIRST_HALF_HEAD; i <= FIRST_HALF_TAIL; i++) {
-        if (fin.get(ch)) {
+    int i = FIRST_HALF_HEAD;
+    for (; i <= FIRST_HALF_TAIL; i++) {
+        if (in->get(ch)) {
             buffer[i] = ch;
         } else {
             buffer[i] = EOF;
             break;
         }
     }
+    STATS_ADD(bytesRead, i - FIRST_HALF_HEAD);
+    STATS_ADD(refills, 1);
 }
 
 void InputBuffer::loadSecondHalf() {
+    STATS_PHASE(LOAD);
+    Trace::Span span("load", "refill");
     char ch;
-    for (int i = SECOND_HALF_HEAD; i <= SECOND_HALF_TAIL; i++) {
-        if (fin.get(ch)) {
+    int i = SECOND_HALF_HEAD;
+    for (; i <= SECOND_HALF_TAIL; i++) {
+        if (in->get(ch)) {
             buffer[i] = ch;
         } else {
             buffer[i] = EOF;
             break;
         }
     }
+    STATS_ADD(bytesRead, i - SECOND_HALF_HEAD);
+    STATS_ADD(refills, 1);
 }
 
 void InputBuffer::printBuffer() const {
@@ -84,10 +106,26 @@ std::string InputBuffer::getFilename() const {
 }
 
 char InputBuffer::getChar() {
-    return buffer[current];
+    return replay == LIVE ? buffer[current] : retained[replay];
 }
 
 void InputBuffer::next() {
+    position++;
+    if (replay != LIVE) {
+        // after a rewind, up to the furthest character read
+        char ch = retained[++replay];
+        if (replay + 1 == (long) retained.size()) {
+            replay = LIVE;
+            if (!retaining) retained.clear();
+        }
+        if (ch == '\n') {
+            line++;
+            column = 0;
+        } else {
+            column++;
+        }
+        return;
+    }
     current++;
     if (buffer[current] == EOF) {
         if (current == FIRST_HALF_SENTINEL) {
@@ -100,6 +138,8 @@ void InputBuffer::next() {
         // else, EOF as character not as sentinel
     }
 
+    if (retaining) retained.push_back(buffer[current]);
+
     // update line and column
     if (buffer[current] == '\n') {
         line++;
@@ -116,6 +156,7 @@ char InputBuffer::getNextChar() {
 }
 
 char InputBuffer::peek() {
+    if (replay != LIVE) return retained[replay + 1];
     if (current + 1 == FIRST_HALF_SENTINEL) {
         return buffer[SECOND_HALF_HEAD];
     } else if (current + 1 == SECOND_HALF_SENTINEL) {
@@ -124,3 +165,45 @@ char InputBuffer::peek() {
     return buffer[current + 1];
 
 }
+
+/**
+ * O(1): from now on the characters read are kept until release(), so the input can be rewound here any number of
+ * times without reading it again
+ */
+InputBuffer::Checkpoint InputBuffer::checkpoint() {
+    if (!retaining && replay == LIVE) {
+        retaining = true;
+        retained.clear();
+        retainedFrom = position;
+        if (position > 0) retained.push_back(buffer[current]);
+        else retainedFrom = 1;    // nothing read yet, the first character will be the first one kept
+    }
+    retaining = true;
+    return {position, line, column};
+}
+
+/**
+ * goes back to a checkpoint taken since the last release(); next() then replays the kept characters until it is
+ * past the furthest one read, and reads the input again from there
+ */
+void InputBuffer::rewind(const Checkpoint &checkpoint) {
+    std::size_t furthest = retainedFrom + retained.size() - 1;
+    if (!retaining || checkpoint.position + 1 < retainedFrom || checkpoint.position > furthest) {
+        throw std::runtime_error("rewind to a checkpoint that was released or is ahead of the input");
+    }
+    position = checkpoint.position;
+    line = checkpoint.line;
+    column = checkpoint.column;
+    replay = position == furthest ? LIVE : (long) position - (long) retainedFrom;
+}
+
+/**
+ * drops every checkpoint and stops keeping characters; those still to be replayed are kept until they are read
+ */
+void InputBuffer::release() {
+    retaining = false;
+    if (replay == LIVE) {
+        retained.clear();
+        retained.shrink_to_fit();
+    }
+}
@@ -6,12 +6,23 @@
 #define COMPILER_INPUTBUFFER_H
 
 
+#include <cstddef>
 #include <string>
 #include <fstream>
 
 class InputBuffer {
 public:
     static int const BUFFER_SIZE = 1024;
+
+    /**
+     * a position to come back to with rewind(): the number of characters moved past and the line and column there
+     */
+    struct Checkpoint {
+        std::size_t position;
+        int line;
+        int column;
+    };
+
 private:
     // index arithmetics
     static int const HALF_BUFFER_SIZE = BUFFER_SIZE;
@@ -31,8 +42,20 @@ private:
 
     int current = -1;   // index of the current character in the buffer
 
+    // speculation: while checkpoints are kept, every character read is also appended to `retained`, so a rewind
+    // replays them from there instead of reading the input again
+    static const long LIVE = -2;
+    std::size_t position = 0;       // characters moved past, the current one is character position - 1
+    std::string retained;           // the characters from position retainedFrom on, up to the furthest one read
+    std::size_t retainedFrom = 0;
+    bool retaining = false;
+    long replay = LIVE;             // index in retained of the current character after a rewind, LIVE if none
+
     std::string filename;
     std::fstream fin;
+    std::istream *in;   // fin, or the stream given to the constructor
+
+    void init();
 
 private:
     void loadFirstHalf();
@@ -40,6 +63,7 @@ private:
 
 public:
     explicit InputBuffer(const std::string& filename);
+    InputBuffer(std::istream &in, const std::string &name);  // reads from a stream the caller keeps alive
     ~InputBuffer();
 
     char getChar();
@@ -52,6 +76,10 @@ public:
 
     std::string getFilename() const;
 
+    Checkpoint checkpoint();
+    void rewind(const Checkpoint &checkpoint);
+    void release();
+
     void printBuffer() const;
 
 };
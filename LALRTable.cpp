@@ -0,0 +1,292 @@
+//
+// Created by jens on 19/10/26.
+//
+
+#include <algorithm>
+#include <bitset>
+#include <climits>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_map>
+#include "LALRTable.h"
+
+namespace {
+    using terminal_set_t = std::bitset<Token::TOKEN_TYPE_COUNT>;
+    using item_t = std::pair<int, int>;   // (production, dot)
+
+    /**
+     * DeRemer and Pennello's digraph algorithm: F[x] = F'[x] united with F[y] for every y reachable from x through R,
+     * computed in one traversal where every strongly connected component shares a single set
+     */
+    class Digraph {
+    private:
+        const std::vector<std::vector<int>> &relation;
+        std::vector<terminal_set_t> &sets;
+        std::vector<int> depth;
+        std::vector<int> stack;
+
+        void traverse(int x) {
+            stack.push_back(x);
+            int d = (int) stack.size();
+            depth[x] = d;
+            for (int y: relation[x]) {
+                if (depth[y] == 0) traverse(y);
+                depth[x] = std::min(depth[x], depth[y]);
+                sets[x] |= sets[y];
+            }
+            if (depth[x] == d) {
+                while (true) {
+                    int top = stack.back();
+                    stack.pop_back();
+                    depth[top] = INT_MAX;
+                    sets[top] = sets[x];
+                    if (top == x) break;
+                }
+            }
+        }
+
+    public:
+        Digraph(const std::vector<std::vector<int>> &relation, std::vector<terminal_set_t> &sets)
+                : relation(relation), sets(sets), depth(sets.size(), 0) {
+            for (int x = 0; x < sets.size(); x++) {
+                if (depth[x] == 0) traverse(x);
+            }
+        }
+    };
+}
+
+LALRTable::LALRTable(ContextFreeGrammar &grammar) : productions(grammar.getProductions()) {
+    const int T = Token::TOKEN_TYPE_COUNT;
+    const int N = (int) grammar.getNonTerminals().size();
+    const int P = (int) productions.size();
+    const int AUGMENTED = P;   // S' ::= S EOF
+
+    // bodies as symbol ids without epsilon
+    std::vector<std::vector<int>> bodies(P + 1);
+    std::vector<std::vector<int>> productionsOf(N + 1);
+    for (int p = 0; p < P; p++) {
+        heads.push_back(grammar.getNonTerminalIndex(productions[p].head));
+        for (const GrammarSymbol &s: productions[p].body) {
+            if (s.isEpsilon()) continue;
+            int id = grammar.getSymbolId(s);
+            if (id < 0) throw std::runtime_error("non-terminal " + s.toString() + " has no production");
+            bodies[p].push_back(id);
+        }
+        lengths.push_back((int) bodies[p].size());
+        productionsOf[heads[p]].push_back(p);
+    }
+    heads.push_back(N);
+    bodies[AUGMENTED] = {grammar.getSymbolId(grammar.getStartSymbol()), Token::TokenType::END_OF_FILE};
+    lengths.push_back(2);
+    productionsOf[N].push_back(AUGMENTED);
+    auto isNonTerminal = [T](int symbol) { return symbol >= T; };
+
+    // nullable non-terminals
+    std::vector<bool> nullable(N + 1, false);
+    for (bool changed = true; changed;) {
+        changed = false;
+        for (int p = 0; p < P; p++) {
+            if (nullable[heads[p]]) continue;
+            bool all = std::all_of(bodies[p].begin(), bodies[p].end(), [&](int s) {
+                return isNonTerminal(s) && nullable[s - T];
+            });
+            if (all) nullable[heads[p]] = changed = true;
+        }
+    }
+
+    // ------------------------------------------ LR(0) automaton ------------------------------------------
+    std::vector<std::vector<item_t>> kernels;
+    std::map<std::vector<item_t>, int> stateOf;
+    std::vector<std::map<int, int>> transitions;    // per state: symbol -> state
+    std::vector<std::vector<item_t>> closures;
+
+    auto closure = [&](const std::vector<item_t> &kernel) {
+        std::vector<item_t> items = kernel;
+        std::vector<bool> added(N + 1, false);
+        for (int i = 0; i < items.size(); i++) {
+            const std::vector<int> &body = bodies[items[i].first];
+            if (items[i].second == body.size() || !isNonTerminal(body[items[i].second])) continue;
+            int B = body[items[i].second] - T;
+            if (added[B]) continue;
+            added[B] = true;
+            for (int q: productionsOf[B]) items.emplace_back(q, 0);
+        }
+        return items;
+    };
+
+    kernels.push_back({{AUGMENTED, 0}});
+    stateOf[kernels[0]] = 0;
+    for (int s = 0; s < kernels.size(); s++) {
+        closures.push_back(closure(kernels[s]));
+        std::map<int, std::vector<item_t>> successors;
+        for (const item_t &item: closures[s]) {
+            const std::vector<int> &body = bodies[item.first];
+            if (item.second < body.size()) {
+                successors[body[item.second]].emplace_back(item.first, item.second + 1);
+            }
+        }
+        transitions.emplace_back();
+        for (auto &successor: successors) {
+            std::sort(successor.second.begin(), successor.second.end());
+            auto it = stateOf.find(successor.second);
+            int target;
+            if (it == stateOf.end()) {
+                target = (int) kernels.size();
+                stateOf.insert({successor.second, target});
+                kernels.push_back(successor.second);
+            } else {
+                target = it->second;
+            }
+            transitions[s][successor.first] = target;
+        }
+    }
+    stateCount = (int) kernels.size();
+
+    // ------------------------------------------ lookaheads ------------------------------------------
+    // number the non-terminal transitions (p, A)
+    std::vector<std::pair<int, int>> ntTransitions;
+    std::map<std::pair<int, int>, int> ntTransitionOf;
+    for (int s = 0; s < stateCount; s++) {
+        for (const auto &t: transitions[s]) {
+            if (isNonTerminal(t.first)) {
+                ntTransitionOf[{s, t.first}] = (int) ntTransitions.size();
+                ntTransitions.emplace_back(s, t.first);
+            }
+        }
+    }
+    const int X = (int) ntTransitions.size();
+
+    // DR(p, A): terminals shifted right after the transition; reads: (p, A) reads (r, C) when r = goto(p, A), C nullable
+    std::vector<terminal_set_t> sets(X);
+    std::vector<std::vector<int>> reads(X);
+    for (int x = 0; x < X; x++) {
+        int r = transitions[ntTransitions[x].first].at(ntTransitions[x].second);
+        for (const auto &t: transitions[r]) {
+            if (!isNonTerminal(t.first)) {
+                sets[x].set(t.first);
+            } else if (nullable[t.first - T]) {
+                reads[x].push_back(ntTransitionOf.at({r, t.first}));
+            }
+        }
+    }
+    Digraph readSets(reads, sets);         // sets = Read
+
+    // includes: (p, A) includes (p', B) when B ::= u A v, v nullable and p' --u--> p
+    // lookback: (q, A ::= w) looks back to (p, A) when p --w--> q
+    std::vector<std::vector<int>> includes(X);
+    std::vector<std::vector<std::pair<int, int>>> lookback(X);   // per transition: (state, production) reducing into it
+    for (int x = 0; x < X; x++) {
+        int from = ntTransitions[x].first;
+        int B = ntTransitions[x].second - T;
+        for (int q: productionsOf[B]) {
+            const std::vector<int> &body = bodies[q];
+            int state = from;
+            for (int i = 0; i < body.size(); i++) {
+                if (isNonTerminal(body[i])) {
+                    bool nullableSuffix = std::all_of(body.begin() + i + 1, body.end(), [&](int s) {
+                        return isNonTerminal(s) && nullable[s - T];
+                    });
+                    if (nullableSuffix) includes[ntTransitionOf.at({state, body[i]})].push_back(x);
+                }
+                state = transitions[state].at(body[i]);
+            }
+            lookback[x].emplace_back(state, q);
+        }
+    }
+    Digraph followSets(includes, sets);    // sets = Follow
+
+    std::map<std::pair<int, int>, terminal_set_t> lookaheads;  // (state, production) -> LA
+    for (int x = 0; x < X; x++) {
+        for (const auto &reduction: lookback[x]) {
+            lookaheads[reduction] |= sets[x];
+        }
+    }
+
+    // ------------------------------------------ tables ------------------------------------------
+    acceptAction = (AUGMENTED << 1) | 1;
+    std::vector<std::vector<int>> actionRows(stateCount, std::vector<int>(T, ERROR));
+    std::vector<std::vector<int>> gotoRows(stateCount, std::vector<int>(N, ERROR));
+    std::vector<int> defaults(stateCount, ERROR);
+    for (int s = 0; s < stateCount; s++) {
+        for (const auto &t: transitions[s]) {
+            if (isNonTerminal(t.first)) {
+                if (t.first - T < N) gotoRows[s][t.first - T] = t.second;
+            } else {
+                const std::vector<item_t> &kernel = kernels[t.second];
+                bool accepts = t.first == Token::TokenType::END_OF_FILE && kernel.size() == 1
+                               && kernel[0].first == AUGMENTED;
+                actionRows[s][t.first] = accepts ? acceptAction : t.second << 1;
+            }
+        }
+        std::map<int, int> reductionCount;
+        for (const item_t &item: closures[s]) {
+            if (item.second != bodies[item.first].size() || item.first == AUGMENTED) continue;
+            auto la = lookaheads.find({s, item.first});
+            if (la == lookaheads.end()) continue;
+            int reduce = (item.first << 1) | 1;
+            for (int t = 0; t < T; t++) {
+                if (!la->second.test(t)) continue;
+                int &entry = actionRows[s][t];
+                if (entry == ERROR) {
+                    entry = reduce;
+                } else if (entry != reduce) {
+                    // shift wins over reduce, the earlier production wins over the later one
+                    int kept = isShift(entry) || entry == acceptAction || entry < reduce ? entry : reduce;
+                    int discarded = kept == entry ? reduce : entry;
+                    conflicts.push_back({s, t, kept, discarded});
+                    entry = kept;
+                }
+            }
+        }
+        for (int t = 0; t < T; t++) {
+            if (actionRows[s][t] != ERROR && !isShift(actionRows[s][t]) && actionRows[s][t] != acceptAction) {
+                reductionCount[actionRows[s][t]]++;
+            }
+        }
+        int most = 0;
+        for (const auto &count: reductionCount) {
+            if (count.second > most) {
+                most = count.second;
+                defaults[s] = count.first;
+            }
+        }
+    }
+    actions = CompressedParsingTable(actionRows, defaults);
+    gotos = CompressedParsingTable(gotoRows, std::vector<int>(stateCount, ERROR));
+}
+
+const Production &LALRTable::getProduction(int production) const {
+    return productions.at(production);
+}
+
+int LALRTable::getStateCount() const {
+    return stateCount;
+}
+
+std::size_t LALRTable::memoryUsage() const {
+    return actions.memoryUsage() + gotos.memoryUsage();
+}
+
+const std::vector<LALRTable::Conflict> &LALRTable::getConflicts() const {
+    return conflicts;
+}
+
+std::string LALRTable::describeAction(int action) const {
+    if (isShift(action)) {
+        return "shift " + std::to_string(target(action));
+    }
+    std::ostringstream os;
+    os << "reduce " << productions[target(action)];
+    std::string text = os.str();
+    return text.substr(0, text.find_last_not_of(' ') + 1);
+}
+
+void LALRTable::printConflicts() const {
+    for (const Conflict &c: conflicts) {
+        std::cout << "state " << c.state << " on " << Token::tokenTypeAsString((Token::TokenType) c.terminal) << ": "
+                  << (isShift(c.kept) ? "shift/reduce" : "reduce/reduce") << " conflict, kept "
+                  << describeAction(c.kept) << ", discarded " << describeAction(c.discarded) << std::endl;
+    }
+}
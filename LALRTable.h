@@ -0,0 +1,79 @@
+//
+// Created by jens on 19/10/26.
+//
+
+#ifndef COMPILER_LALRTABLE_H
+#define COMPILER_LALRTABLE_H
+
+#include <vector>
+#include <string>
+#include "ContextFreeGrammar.h"
+#include "CompressedParsingTable.h"
+
+/**
+ * LALR(1) action and goto tables of a ContextFreeGrammar.
+ *
+ * The LR(0) automaton is built first, lookaheads are then computed by DeRemer and Pennello's relations
+ * (direct reads, reads, includes, lookback) over the non-terminal transitions, so no LR(1) item sets are formed.
+ * Left recursive grammars are taken as they are, no left recursion elimination is needed.
+ *
+ * Both tables are stored as CompressedParsingTable; the most frequent reduction of a state is its default action,
+ * which replaces the error entries of that row (the error is then found before the next shift).
+ *
+ * Conflicts are resolved as yacc does, shift over reduce and the earlier production over the later one,
+ * and every resolution is recorded in getConflicts().
+ */
+class LALRTable {
+public:
+    // action encoding: shift s is s << 1, reduce p is (p << 1) | 1, reducing the augmented production accepts
+    static constexpr int ERROR = CompressedParsingTable::NO_ENTRY;
+
+    struct Conflict {
+        int state;
+        int terminal;
+        int kept;       // action kept in the table
+        int discarded;  // action dropped
+    };
+
+private:
+    std::vector<Production> productions;
+    std::vector<int> heads;         // non-terminal index of the head of each production, augmented one last
+    std::vector<int> lengths;       // body length without epsilon
+    int acceptAction = ERROR;
+    int stateCount = 0;
+    CompressedParsingTable actions;
+    CompressedParsingTable gotos;
+    std::vector<Conflict> conflicts;
+
+    [[nodiscard]] std::string describeAction(int action) const;
+
+public:
+    explicit LALRTable(ContextFreeGrammar &grammar);
+
+    [[nodiscard]] inline int action(int state, int terminal) const {
+        return actions.lookup(state, terminal);
+    }
+
+    [[nodiscard]] inline int go(int state, int nonTerminal) const {
+        return gotos.lookup(state, nonTerminal);
+    }
+
+    [[nodiscard]] static inline bool isShift(int action) { return (action & 1) == 0; }
+
+    [[nodiscard]] static inline int target(int action) { return action >> 1; }   // state or production
+
+    [[nodiscard]] inline bool isAccept(int action) const { return action == acceptAction; }
+
+    [[nodiscard]] inline int getHead(int production) const { return heads[production]; }
+
+    [[nodiscard]] inline int getLength(int production) const { return lengths[production]; }
+
+    [[nodiscard]] const Production &getProduction(int production) const;
+    [[nodiscard]] int getStateCount() const;
+    [[nodiscard]] std::size_t memoryUsage() const;
+    [[nodiscard]] const std::vector<Conflict> &getConflicts() const;
+    void printConflicts() const;
+};
+
+
+#endif //COMPILER_LALRTABLE_H
@@ -0,0 +1,36 @@
+//
+// Created by jens on 19/10/26.
+//
+
+#include "LRParser.h"
+
+void LRParser::parse() {
+    std::vector<int> stack;
+    stack.push_back(0);     // the initial state is the bottom of the stack
+
+    Token token = lexer->nextToken();
+    while (token.isWhitespace()) token = lexer->nextToken();
+
+    while (true) {
+        int action = table.action(stack.back(), token.getTokenType());
+        if (action == LALRTable::ERROR) {
+            throw SyntacticalError("error: unexpected " + Token::tokenTypeAsString(token.getTokenType()),
+                                   token.getLine(), token.getColumn());
+        }
+        if (table.isAccept(action)) {
+            return;
+        }
+        if (LALRTable::isShift(action)) {
+            stack.push_back(LALRTable::target(action));
+            token = lexer->nextToken();
+            while (token.isWhitespace()) token = lexer->nextToken();
+        } else {
+            // reduce A ::= w: pop |w| states and take the goto of the exposed state on A
+            int production = LALRTable::target(action);
+            stack.resize(stack.size() - table.getLength(production));
+            stack.push_back(table.go(stack.back(), table.getHead(production)));
+        }
+    }
+}
+
+LRParser::LRParser(const LALRTable &table, Lexer *lexer) : table(table), lexer(lexer) {}
@@ -0,0 +1,27 @@
+//
+// Created by jens on 19/10/26.
+//
+
+#ifndef COMPILER_LRPARSER_H
+#define COMPILER_LRPARSER_H
+
+
+#include "LALRTable.h"
+#include "Lexer.h"
+#include "Parser.h"
+
+/**
+ * shift-reduce driver for an LALRTable, the counterpart of the LL(1) Parser.
+ * The stack holds states only; the table must outlive the parser.
+ */
+class LRParser {
+private:
+    const LALRTable &table;
+    Lexer *lexer;
+public:
+    LRParser(const LALRTable &table, Lexer *lexer);
+    void parse();
+};
+
+
+#endif //COMPILER_LRPARSER_H
@@ -6,10 +6,11 @@
 #include <iostream>
 #include "Lexer.h"
 #include "InputBuffer.h"
+#include "Stats.h"
 
 #define THROW_LEXICAL_ERROR(message) throw LexicalError(message, commitLexeme(), inputBuffer->getLine(), inputBuffer->getColumn())
 
-std::unordered_map<std::string, Token::TokenType> Lexer::KEYWORDS = {
+const std::unordered_map<std::string, Token::TokenType> Lexer::KEYWORDS = {
         {"if",         Token::IF},
         {"else",       Token::ELSE},
         {"while",      Token::WHILE},
@@ -117,12 +118,66 @@ char Lexer::currentChar() {
 }
 
 
+Token Lexer::nextToken() {
+    if (replayed < retained.size()) {
+        tokenCount++;
+        Token token = retained[replayed++];
+        if (!retaining && replayed == retained.size()) {
+            retained.clear();
+            replayed = 0;
+        }
+        return token;
+    }
+    STATS_PHASE(LEX);
+    Token token = scanToken();
+    tokenCount++;
+    STATS_ADD(tokens[token.getTokenType()], 1);
+    if (retaining) {
+        retained.push_back(token);
+        replayed++;
+    }
+    return token;
+}
+
+/**
+ * O(1): from now on the tokens returned are kept until release(), so the lexer can be rewound here any number of
+ * times without lexing the input again
+ */
+Lexer::Checkpoint Lexer::checkpoint() {
+    if (retained.empty()) retainedFrom = tokenCount;
+    retaining = true;
+    return {tokenCount};
+}
+
+/**
+ * goes back to a checkpoint taken since the last release(); nextToken() then returns the kept tokens before it lexes
+ * again
+ */
+void Lexer::rewind(const Checkpoint &checkpoint) {
+    if (!retaining || checkpoint.token < retainedFrom || checkpoint.token > retainedFrom + retained.size()) {
+        throw std::runtime_error("rewind to a checkpoint that was released or is ahead of the input");
+    }
+    tokenCount = checkpoint.token;
+    replayed = checkpoint.token - retainedFrom;
+}
+
+/**
+ * drops every checkpoint and stops keeping tokens; those still to be replayed are kept until they are returned
+ */
+void Lexer::release() {
+    retaining = false;
+    if (replayed == retained.size()) {
+        retained.clear();
+        replayed = 0;
+    }
+}
+
 // NOTE:
 // main routines are named as handle<state> and return a token
 // when calling main routines, the current character is not consumed (we are just choosing which state to go to)
 // which means that the automata is before the start node: YOU_ARE_HERE -> StartState --(ch)--> NextState
 // when calling subroutines, the current character is consumed (we are moving to the next state)
-Token Lexer::nextToken() {
+Token Lexer::scanToken() {
     char ch = peek();
     if (isLetter(ch) || ch == '_' || ch == '$') {
         return handleIdentifier();
@@ -139,7 +194,7 @@ Token Lexer::nextToken() {
     } else if (ch == '\'') {
         return handleCharLiteral();
     } else if (ch == EOF) {
-        return Token(Token::TokenType::END_OF_FILE);
+        return Token(Token::TokenType::END_OF_FILE, inputBuffer->getLine(), inputBuffer->getColumn());
     } else {
         THROW_LEXICAL_ERROR("unexpected character");
     }
@@ -196,8 +251,9 @@ Token Lexer::handleIdentifier() {
     // accept
     std::string lexeme = commitLexeme();
     // check if the lexeme falls into keywords
-    if (KEYWORDS.find(lexeme) != KEYWORDS.end()) {
-        return Token(KEYWORDS[lexeme]);
+    auto keyword = KEYWORDS.find(lexeme);
+    if (keyword != KEYWORDS.end()) {
+        return Token(keyword->second, inputBuffer->getLine(), inputBuffer->getColumn());
     }
     // add to symbol table and get an index
     int index = symbolTable->addSymbol(lexeme);
@@ -310,11 +366,14 @@ Token Lexer::handleCharLiteral() {
     if (peek() == '\\') {
         forward();
         handleEscapeSubroutine();
-        return Token(Token::TokenType::CHAR_LITERAL, commitLexeme(), inputBuffer->getLine(), inputBuffer->getColumn());
     } else {
         forward();
-        return Token(Token::TokenType::CHAR_LITERAL, commitLexeme(), inputBuffer->getLine(), inputBuffer->getColumn());
     }
+    if (peek() != '\'') {
+        THROW_LEXICAL_ERROR("Unterminated char literal");
+    }
+    forwardIgnore();    // do not take the closing ' either
+    return Token(Token::TokenType::CHAR_LITERAL, commitLexeme(), inputBuffer->getLine(), inputBuffer->getColumn());
 }
 
 
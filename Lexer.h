@@ -6,13 +6,22 @@
 #define COMPILER_LEXER_H
 
 #include <unordered_map>
+#include <vector>
 #include "Token.h"
 #include "InputBuffer.h"
 #include "SymbolTable.h"
 
 class Lexer {
 public:
-    static std::unordered_map<std::string, Token::TokenType> KEYWORDS;
+    /**
+     * a token to come back to with rewind(): the number of tokens returned before it
+     */
+    struct Checkpoint {
+        std::size_t token;
+    };
+
+
+    static const std::unordered_map<std::string, Token::TokenType> KEYWORDS;
     static bool isDigit(char c);
     static bool isLetter(char c);
     static bool isWhitespace(char c);
@@ -26,6 +35,16 @@ private:
     SymbolTable *symbolTable;
 
     int forwardIdx = 0;
+
+    // speculation: while checkpoints are kept, every token returned is also appended to `retained`, so a rewind
+    // returns them again without lexing
+    std::size_t tokenCount = 0;         // tokens returned
+    std::vector<Token> retained;        // the tokens from number retainedFrom on
+    std::size_t retainedFrom = 0;
+    std::size_t replayed = 0;           // index in retained of the next token to return
+    bool retaining = false;
+
+    Token scanToken();
     char currentChar();
     char peek();
     void forward();
@@ -48,6 +67,9 @@ private:
 public:
     Lexer(InputBuffer *inputBuffer, SymbolTable *symbolTable);
     Token nextToken();
+    Checkpoint checkpoint();
+    void rewind(const Checkpoint &checkpoint);
+    void release();
 
 };
 
@@ -68,6 +90,7 @@ public:
     }
     [[nodiscard]] int getLine() const { return this->line; }
     [[nodiscard]] int getColumn() const { return this->column; }
+    [[nodiscard]] const char *getReason() const { return std::runtime_error::what(); }    // without the position
 };
 
 
@@ -0,0 +1,84 @@
+//
+// Created by jens on 19/10/26.
+//
+
+#include "LookaheadSet.h"
+#include "Token.h"
+
+LookaheadSet::LookaheadSet(int k) : k(k), nodes(1) {}
+
+/**
+ * the set of the empty string, what a nullable sequence starts with
+ */
+LookaheadSet LookaheadSet::epsilon(int k) {
+    LookaheadSet set(k);
+    set.insert({});
+    return set;
+}
+
+bool LookaheadSet::isComplete(const std::vector<int> &string) const {
+    return (int) string.size() >= k || (!string.empty() && string.back() == Token::TokenType::END_OF_FILE);
+}
+
+/**
+ * @return whether the string was not in the set yet
+ */
+bool LookaheadSet::insert(const std::vector<int> &string) {
+    std::int32_t node = 0;
+    for (int terminal: string) {
+        std::int32_t *link = &nodes[node].child;
+        while (*link >= 0 && nodes[*link].terminal != terminal) link = &nodes[*link].sibling;
+        if (*link >= 0) {
+            node = *link;
+            continue;
+        }
+        node = *link = (std::int32_t) nodes.size();     // before the push, which may move the nodes
+        nodes.emplace_back();
+        nodes.back().terminal = (std::int16_t) terminal;
+    }
+    if (nodes[node].end) return false;
+    nodes[node].end = true;
+    count++;
+    if (!isComplete(string)) open++;
+    return true;
+}
+
+/**
+ * @return whether any string was added
+ */
+bool LookaheadSet::insertAll(const LookaheadSet &other) {
+    bool changed = false;
+    other.forEach([&](const std::vector<int> &string) { changed |= insert(string); });
+    return changed;
+}
+
+/**
+ * the k-concatenation: every complete string as it is, every open one followed by each string of `next` and cut
+ * to k terminals
+ */
+LookaheadSet LookaheadSet::concat(const LookaheadSet &next) const {
+    LookaheadSet result(k);
+    std::vector<int> joined;
+    forEach([&](const std::vector<int> &string) {
+        if (isComplete(string)) {
+            result.insert(string);
+            return;
+        }
+        next.forEach([&](const std::vector<int> &suffix) {
+            joined = string;
+            for (std::size_t i = 0; i < suffix.size() && (int) joined.size() < k; i++) joined.push_back(suffix[i]);
+            result.insert(joined);
+        });
+    });
+    return result;
+}
+
+LookaheadSet LookaheadSet::concat(int terminal) const {
+    LookaheadSet next(k);
+    next.insert({terminal});
+    return concat(next);
+}
+
+std::size_t LookaheadSet::memoryUsage() const {
+    return nodes.size() * sizeof(Node);
+}
@@ -0,0 +1,80 @@
+//
+// Created by jens on 19/10/26.
+//
+
+#ifndef COMPILER_LOOKAHEADSET_H
+#define COMPILER_LOOKAHEADSET_H
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * A set of terminal strings of length at most k, kept as a trie: strings sharing a prefix share its nodes, and a
+ * node is 12 bytes (first child, next sibling, terminal, whether a string ends there).
+ *
+ * FIRST_k and FOLLOW_k are such sets. A string is complete when it has k terminals or ends with EOF, nothing is
+ * read after either. A shorter one is open: in FIRST_k of a sequence it is all that a nullable rest derives, and
+ * concat() goes on with the strings of the next set.
+ */
+class LookaheadSet {
+private:
+    struct Node {
+        std::int32_t child = -1;
+        std::int32_t sibling = -1;
+        std::int16_t terminal = -1;
+        bool end = false;           // a string of the set ends here
+    };
+
+    int k;
+    std::vector<Node> nodes;        // the root, the empty prefix, first
+    std::size_t count = 0;
+    std::size_t open = 0;
+
+public:
+    explicit LookaheadSet(int k);
+    static LookaheadSet epsilon(int k);
+
+    [[nodiscard]] bool isComplete(const std::vector<int> &string) const;
+    bool insert(const std::vector<int> &string);
+    bool insertAll(const LookaheadSet &other);
+    [[nodiscard]] LookaheadSet concat(const LookaheadSet &next) const;
+    [[nodiscard]] LookaheadSet concat(int terminal) const;
+
+    [[nodiscard]] inline std::size_t size() const { return count; }
+
+    [[nodiscard]] inline bool hasOpen() const { return open > 0; }
+
+    [[nodiscard]] std::size_t memoryUsage() const;
+
+    /**
+     * calls f(string) on every string of the set, in the order of the trie
+     */
+    template<typename F>
+    void forEach(F &&f) const {
+        std::vector<int> string;
+        std::vector<std::int32_t> path{0};     // the node of every prefix of `string`
+        if (nodes[0].end) f(string);
+        std::int32_t node = nodes[0].child;
+        while (true) {
+            if (node >= 0) {
+                string.push_back(nodes[node].terminal);
+                path.push_back(node);
+                if (nodes[node].end) f(string);
+                node = nodes[node].child;
+                continue;
+            }
+            // back up to the next sibling of the deepest prefix that has one
+            while (path.size() > 1 && nodes[path.back()].sibling < 0) {
+                path.pop_back();
+                string.pop_back();
+            }
+            if (path.size() == 1) return;
+            node = nodes[path.back()].sibling;
+            path.pop_back();
+            string.pop_back();
+        }
+    }
+};
+
+
+#endif //COMPILER_LOOKAHEADSET_H
@@ -0,0 +1,35 @@
+//
+// Created by jens on 19/10/26.
+//
+
+#include <algorithm>
+#include "ParseStack.h"
+
+ParseStack::ParseStack(std::size_t capacity) : buffer(std::max<std::size_t>(capacity, 1)) {
+    top = buffer.data();
+    limit = buffer.data() + buffer.size();
+}
+
+ParseStack::ParseStack(const ParseStack &other) : buffer(other.buffer) {
+    top = buffer.data() + other.size();
+    limit = buffer.data() + buffer.size();
+}
+
+ParseStack &ParseStack::operator=(const ParseStack &other) {
+    if (this != &other) {
+        buffer = other.buffer;
+        top = buffer.data() + other.size();
+        limit = buffer.data() + buffer.size();
+    }
+    return *this;
+}
+
+/**
+ * out of line, only reached when the stack is deeper than ever before
+ */
+void ParseStack::grow(std::size_t needed) {
+    std::size_t size = this->size();
+    buffer.resize(std::max(needed, buffer.size() * 2));
+    top = buffer.data() + size;
+    limit = buffer.data() + buffer.size();
+}
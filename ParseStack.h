@@ -0,0 +1,69 @@
+//
+// Created by jens on 19/10/26.
+//
+
+#ifndef COMPILER_PARSESTACK_H
+#define COMPILER_PARSESTACK_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Stack of 16-bit symbol ids for the LL drivers.
+ *
+ * The buffer is allocated once and kept between parses; it only grows, doubling, when a push overflows it,
+ * so after the first parse of an input of similar depth no step allocates.
+ */
+class ParseStack {
+public:
+    using symbol_t = std::int16_t;
+
+private:
+    std::vector<symbol_t> buffer;
+    symbol_t *top;      // one past the top symbol
+    symbol_t *limit;    // one past the end of the buffer
+
+    void grow(std::size_t needed);
+
+public:
+    explicit ParseStack(std::size_t capacity = 256);
+    ParseStack(const ParseStack &other);
+    ParseStack &operator=(const ParseStack &other);
+
+    inline void push_back(symbol_t symbol) {
+        if (top == limit) grow(size() + 1);
+        *top++ = symbol;
+    }
+
+    /**
+     * pushes *first, ..., *(last - 1) in this order, pass reverse iterators to push a body with its first symbol on top
+     */
+    template<typename Iterator>
+    void append(Iterator first, Iterator last) {
+        for (; first != last; ++first) push_back((symbol_t) *first);
+    }
+
+    inline symbol_t &back() { return top[-1]; }
+
+    inline void pop_back() { top--; }
+
+    [[nodiscard]] inline symbol_t operator[](std::size_t i) const { return buffer.data()[i]; }
+
+    [[nodiscard]] inline std::size_t size() const { return (std::size_t) (top - buffer.data()); }
+
+    [[nodiscard]] inline bool empty() const { return top == buffer.data(); }
+
+    [[nodiscard]] inline std::size_t capacity() const { return buffer.size(); }
+
+    inline void resize(std::size_t size) { top = buffer.data() + size; }     // shrinks only
+
+    inline void clear() { top = buffer.data(); }
+
+    [[nodiscard]] inline const symbol_t *begin() const { return buffer.data(); }
+
+    [[nodiscard]] inline const symbol_t *end() const { return top; }
+};
+
+
+#endif //COMPILER_PARSESTACK_H
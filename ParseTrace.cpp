@@ -0,0 +1,144 @@
+//
+// Created by jens on 19/10/26.
+//
+
+#include "ParseTrace.h"
+#include "ContextFreeGrammar.h"
+
+// -------------------- TEXT --------------------
+
+TextTraceSink::TextTraceSink(std::ostream &out, std::size_t capacity) : out(out), capacity(capacity) {}
+
+TextTraceSink::~TextTraceSink() {
+    flush();
+}
+
+void TextTraceSink::flush() {
+    out << buffer.str();
+    out.flush();
+    buffer.str("");
+}
+
+void TextTraceSink::endLine() {
+    buffer << '\n';
+    if ((std::size_t) buffer.tellp() >= capacity) {
+        out << buffer.str();
+        buffer.str("");
+    }
+}
+
+void TextTraceSink::onToken(const Token &token) {
+    buffer << "got token: " << token;
+    endLine();
+}
+
+void TextTraceSink::onStack(const std::vector<GrammarSymbol> &stack) {
+    buffer << "\tstack: ";
+    for (const GrammarSymbol &s: stack) buffer << s << " ";
+    endLine();
+}
+
+void TextTraceSink::onPredict(const GrammarSymbol &nonTerminal, const GrammarSymbol &input) {
+    buffer << "\t\tpredict: " << nonTerminal << " on " << input;
+    endLine();
+}
+
+void TextTraceSink::onExpand(const Production &production) {
+    buffer << "\t\texpand using: " << production;
+    endLine();
+}
+
+void TextTraceSink::onError(const Token &token) {
+    buffer << "error at token: " << token;
+    endLine();
+}
+
+void TextTraceSink::onAccept() {
+    buffer << "accept";
+    endLine();
+}
+
+// -------------------- BINARY --------------------
+
+BinaryTraceSink::BinaryTraceSink(std::ostream &out, const ContextFreeGrammar &grammar, std::size_t capacity)
+        : out(out), grammar(grammar), capacity(capacity) {
+    const std::vector<Production> &productions = grammar.getProductions();
+    for (int i = 0; i < productions.size(); i++) {
+        productionIndex[productions[i].getId()] = i;
+    }
+    buffer.reserve(capacity);
+    const char magic[8] = {'P', 'T', 'R', 'A', 'C', 'E', '1', '\0'};
+    buffer.insert(buffer.end(), magic, magic + 8);
+}
+
+BinaryTraceSink::~BinaryTraceSink() {
+    flush();
+}
+
+void BinaryTraceSink::flush() {
+    out.write(buffer.data(), (std::streamsize) buffer.size());
+    out.flush();
+    buffer.clear();
+}
+
+// a record is at most a few dozen bytes except a stack dump, so the buffer is only checked between records
+void BinaryTraceSink::full() {
+    if (buffer.size() >= capacity) {
+        out.write(buffer.data(), (std::streamsize) buffer.size());
+        buffer.clear();
+    }
+}
+
+void BinaryTraceSink::varint(std::uint64_t value) {
+    while (value >= 0x80) {
+        buffer.push_back((char) (value | 0x80));
+        value >>= 7;
+    }
+    buffer.push_back((char) value);
+}
+
+void BinaryTraceSink::symbol(const GrammarSymbol &symbol) {
+    varint((std::uint64_t) (grammar.getSymbolId(symbol) + 1));
+}
+
+void BinaryTraceSink::token(Tag tag, const Token &token) {
+    buffer.push_back((char) tag);
+    varint(token.getTokenType());
+    varint(token.getLine());
+    varint(token.getColumn());
+    full();
+}
+
+void BinaryTraceSink::onToken(const Token &token) {
+    this->token(TOKEN, token);
+}
+
+void BinaryTraceSink::onStack(const std::vector<GrammarSymbol> &stack) {
+    buffer.push_back((char) STACK);
+    varint(stack.size());
+    for (const GrammarSymbol &s: stack) symbol(s);
+    full();
+}
+
+void BinaryTraceSink::onPredict(const GrammarSymbol &nonTerminal, const GrammarSymbol &input) {
+    buffer.push_back((char) PREDICT);
+    symbol(nonTerminal);
+    symbol(input);
+    full();
+}
+
+void BinaryTraceSink::onExpand(const Production &production) {
+    buffer.push_back((char) EXPAND);
+    auto it = productionIndex.find(production.getId());
+    varint(it == productionIndex.end() ? 0 : it->second);
+    full();
+}
+
+void BinaryTraceSink::onError(const Token &token) {
+    this->token(ERROR, token);
+}
+
+void BinaryTraceSink::onAccept() {
+    buffer.push_back((char) ACCEPT);
+    full();
+}
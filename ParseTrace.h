@@ -0,0 +1,126 @@
+//
+// Created by jens on 19/10/26.
+//
+
+#ifndef COMPILER_PARSETRACE_H
+#define COMPILER_PARSETRACE_H
+
+#include <cstdint>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "Token.h"
+#include "GrammarSymbol.h"
+#include "Production.h"
+
+class ContextFreeGrammar;
+
+// compile-time trace levels, each includes the events of the levels below
+#define PARSER_TRACE_OFF 0
+#define PARSER_TRACE_TOKENS 1       // tokens, errors, accept
+#define PARSER_TRACE_EXPANSIONS 2   // predictions and expansions
+#define PARSER_TRACE_STACK 3        // the whole stack before every step
+
+// debug builds can trace everything, release builds (NDEBUG) compile tracing away unless asked for
+#ifndef PARSER_TRACE_LEVEL
+#ifdef NDEBUG
+#define PARSER_TRACE_LEVEL PARSER_TRACE_OFF
+#else
+#define PARSER_TRACE_LEVEL PARSER_TRACE_STACK
+#endif
+#endif
+
+// reports an event to the observer if tracing is compiled in at that level; above the level it generates no code
+#define PARSER_TRACE(level, observer, event) do { \
+    if constexpr (PARSER_TRACE_LEVEL >= (level)) { \
+        if (observer) (observer)->event; \
+    } \
+} while (false)
+
+/**
+ * receives the events of a parse, every method does nothing by default
+ */
+class ParseObserver {
+public:
+    virtual ~ParseObserver() = default;
+    virtual void onToken(const Token &token) {}
+    virtual void onStack(const std::vector<GrammarSymbol> &stack) {}
+    virtual void onPredict(const GrammarSymbol &nonTerminal, const GrammarSymbol &input) {}
+    virtual void onExpand(const Production &production) {}
+    virtual void onError(const Token &token) {}
+    virtual void onAccept() {}
+};
+
+/**
+ * writes the events as text, one line each as the parser used to print them,
+ * buffered and written out when the buffer is full, on flush() and on destruction
+ */
+class TextTraceSink : public ParseObserver {
+private:
+    std::ostream &out;
+    std::ostringstream buffer;
+    std::size_t capacity;
+
+    void endLine();
+
+public:
+    explicit TextTraceSink(std::ostream &out, std::size_t capacity = 1 << 16);
+    ~TextTraceSink() override;
+    void flush();
+
+    void onToken(const Token &token) override;
+    void onStack(const std::vector<GrammarSymbol> &stack) override;
+    void onPredict(const GrammarSymbol &nonTerminal, const GrammarSymbol &input) override;
+    void onExpand(const Production &production) override;
+    void onError(const Token &token) override;
+    void onAccept() override;
+};
+
+/**
+ * writes the events as compact binary records, buffered like TextTraceSink.
+ *
+ * The trace starts with the 8 bytes "PTRACE1\0", then one record per event: a tag byte followed by unsigned LEB128
+ * varints. Symbols are written as ContextFreeGrammar::getSymbolId + 1 (0 for an undefined non-terminal),
+ * productions as their position in getProductions().
+ * ```
+ *      TOKEN    1  type line column
+ *      STACK    2  depth symbol...       (bottom first)
+ *      PREDICT  3  non-terminal terminal
+ *      EXPAND   4  production
+ *      ERROR    5  type line column
+ *      ACCEPT   6
+ * ```
+ */
+class BinaryTraceSink : public ParseObserver {
+public:
+    enum Tag : std::uint8_t {TOKEN = 1, STACK, PREDICT, EXPAND, ERROR, ACCEPT};
+
+private:
+    std::ostream &out;
+    const ContextFreeGrammar &grammar;
+    std::unordered_map<int, int> productionIndex;   // production id -> position in the production list
+    std::vector<char> buffer;
+    std::size_t capacity;
+
+    void varint(std::uint64_t value);
+    void symbol(const GrammarSymbol &symbol);
+    void token(Tag tag, const Token &token);
+    void full();
+
+public:
+    BinaryTraceSink(std::ostream &out, const ContextFreeGrammar &grammar, std::size_t capacity = 1 << 16);
+    ~BinaryTraceSink() override;
+    void flush();
+
+    void onToken(const Token &token) override;
+    void onStack(const std::vector<GrammarSymbol> &stack) override;
+    void onPredict(const GrammarSymbol &nonTerminal, const GrammarSymbol &input) override;
+    void onExpand(const Production &production) override;
+    void onError(const Token &token) override;
+    void onAccept() override;
+};
+
+
+#endif //COMPILER_PARSETRACE_H
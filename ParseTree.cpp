@@ -0,0 +1,83 @@
+//
+// Created by jens on 19/10/26.
+//
+
+#include <cstring>
+#include <stdexcept>
+#include "ParseTree.h"
+
+std::uint32_t ParseTree::addNodes(std::uint32_t n) {
+    if (n > CHUNK) {
+        throw std::runtime_error("a node cannot have more than ParseTree::CHUNK children");
+    }
+    if (n == 0) return count;
+    // a run of siblings never straddles two chunks, the rest of a chunk that is too short stays unused
+    if (count % CHUNK + n > CHUNK || count == chunks.size() * CHUNK) {
+        if (count % CHUNK != 0) count = (std::uint32_t) chunks.size() * CHUNK;
+        chunks.push_back(arena.makeArray<Node>(CHUNK));
+    }
+    std::uint32_t first = count;
+    for (std::uint32_t i = first; i < first + n; i++) {
+        (*this)[i] = {Token::TokenType::INVALID_TOKEN, NONE, NONE, 0};
+    }
+    count += n;
+    return first;
+}
+
+/**
+ * keeps the token of a leaf, without the std::string of its lexeme: the characters are copied into the arena
+ * @return the index to store as the data of the leaf
+ */
+std::uint32_t ParseTree::addToken(const Token &token) {
+    if (leafCount == leafChunks.size() * CHUNK) leafChunks.push_back(arena.makeArray<Leaf>(CHUNK));
+    const std::string &lexeme = token.getLexeme();
+    char *characters = nullptr;
+    if (!lexeme.empty()) {
+        characters = static_cast<char *>(arena.allocate(lexeme.size(), 1));
+        std::memcpy(characters, lexeme.data(), lexeme.size());
+    }
+    Token::TokenType type = token.getTokenType();
+    leafChunks[leafCount / CHUNK][leafCount % CHUNK] = {
+            characters, (std::uint32_t) lexeme.size(), type, token.getLine(), token.getColumn(),
+            type == Token::TokenType::IDENTIFIER ? token.getSymbolTableIndex() : -1};
+    return leafCount++;
+}
+
+/**
+ * the token of a leaf as the lexer returned it, made again from its Leaf; getLeaf() and getLexeme() do not copy
+ */
+Token ParseTree::getToken(std::uint32_t index) const {
+    const Leaf &leaf = getLeaf(index);
+    auto type = (Token::TokenType) leaf.type;
+    std::string lexeme(leaf.lexeme ? leaf.lexeme : "", leaf.length);
+    switch (type) {
+        case Token::TokenType::IDENTIFIER:
+            return {type, lexeme, leaf.symbolTableIndex, leaf.line, leaf.column};
+        case Token::TokenType::INTEGER_LITERAL:
+            return Token::fromInteger(lexeme, leaf.line, leaf.column);
+        case Token::TokenType::FLOAT_LITERAL:
+            return Token::fromFloat(lexeme, leaf.line, leaf.column);
+        default:
+            return {type, lexeme, leaf.line, leaf.column};
+    }
+}
+
+std::uint32_t ParseTree::size() const {
+    return count;
+}
+
+std::size_t ParseTree::memoryUsage() const {
+    return arena.bytesReserved();
+}
+
+Arena &ParseTree::getArena() {
+    return arena;
+}
+
+void ParseTree::clear() {
+    arena.release();
+    chunks.clear();
+    count = 0;
+    leafChunks.clear();
+    leafCount = 0;
+}
@@ -0,0 +1,90 @@
+//
+// Created by jens on 19/10/26.
+//
+
+#ifndef COMPILER_PARSETREE_H
+#define COMPILER_PARSETREE_H
+
+#include <cstdint>
+#include <functional>
+#include <string_view>
+#include <vector>
+#include "Arena.h"
+#include "Token.h"
+
+/**
+ * Concrete syntax tree built by Parser, or any tree of the same shape (an AST built by reduction hooks).
+ *
+ * Nodes are 16 byte headers addressed by 32-bit indices. They are allocated in chunks of CHUNK nodes from an Arena,
+ * the children of a node are consecutive indices, and the whole tree is released at once by clear()
+ * or the destructor. Tokens of the leaves are kept aside and referenced by index, as Leaf records in the same arena:
+ * type, position and symbol table index, with the lexeme, if the token has one, copied into the arena as well.
+ */
+class ParseTree {
+public:
+    static constexpr std::uint32_t NONE = UINT32_MAX;
+    static constexpr std::uint32_t CHUNK = 4096;
+
+    struct Node {
+        std::int32_t symbol;        // Token::TokenType of a leaf, Token::TOKEN_TYPE_COUNT + non-terminal index otherwise
+        std::uint32_t data;         // production index of an inner node, token index of a leaf
+        std::uint32_t firstChild;
+        std::uint32_t childCount;
+    };
+
+    struct Leaf {
+        const char *lexeme;         // in the arena, not terminated, null if empty
+        std::uint32_t length;
+        std::int32_t type;          // Token::TokenType
+        std::int32_t line;
+        std::int32_t column;
+        std::int32_t symbolTableIndex;      // of an identifier
+    };
+
+private:
+    Arena arena;
+    std::vector<Node *> chunks;
+    std::uint32_t count = 0;
+    std::vector<Leaf *> leafChunks;     // CHUNK leaves each
+    std::uint32_t leafCount = 0;
+
+public:
+    ParseTree() = default;
+    ParseTree(const ParseTree &) = delete;
+    ParseTree &operator=(const ParseTree &) = delete;
+
+    /**
+     * @return the index of the first of `n` consecutive nodes, initialised to a leaf of no symbol
+     */
+    std::uint32_t addNodes(std::uint32_t n);
+    std::uint32_t addToken(const Token &token);
+
+    inline Node &operator[](std::uint32_t index) { return chunks[index / CHUNK][index % CHUNK]; }
+
+    inline const Node &operator[](std::uint32_t index) const { return chunks[index / CHUNK][index % CHUNK]; }
+
+    [[nodiscard]] inline const Leaf &getLeaf(std::uint32_t index) const {
+        return leafChunks[index / CHUNK][index % CHUNK];
+    }
+
+    [[nodiscard]] inline std::string_view getLexeme(std::uint32_t index) const {
+        const Leaf &leaf = getLeaf(index);
+        return {leaf.lexeme, leaf.length};
+    }
+
+    [[nodiscard]] Token getToken(std::uint32_t index) const;
+    [[nodiscard]] std::uint32_t size() const;
+    [[nodiscard]] std::size_t memoryUsage() const;
+    Arena &getArena();
+    void clear();
+};
+
+/**
+ * called when every symbol of a production has been parsed, with the values of its children: whatever the hook of a
+ * child returned, or the node index of a child without hook (leaves included). Its result is the value of the node.
+ */
+using ReductionHook = std::function<std::uint32_t(const ParseTree &tree, std::uint32_t node,
+                                                  const std::uint32_t *children)>;
+
+
+#endif //COMPILER_PARSETREE_H
@@ -2,58 +2,470 @@
 // Created by jens on 02/06/23.
 //
 
-#include <stack>
-#include <iostream>
+#include <thread>
 #include "Parser.h"
-
-#define PRINT_STACK(stack) std::cout << "\tstack: "; for (int i = 0; i < stack.size(); i++) std::cout << stack[i] << " "; std::cout << std::endl;
+#include "Stats.h"
+#include "Trace.h"
+#include "TokenRing.h"
 
 void Parser::parse() {
-    std::vector<GrammarSymbol> stack;
-    stack.push_back(GrammarSymbol::eof());  // add end marker to represent the bottom of the stack
-    stack.push_back(grammar.getStartSymbol());
+    start<false>(nullptr, nullptr);
+}
+
+/**
+ * parses and builds the parse tree into `tree` (root at index 0)
+ * @param hooks if given, hooks[i] is called on every node of production i once its subtree is parsed, see ReductionHook
+ * @return the value of the root: what its hook returned, or 0
+ */
+std::uint32_t Parser::parse(ParseTree &tree, const std::vector<ReductionHook> *hooks) {
+    return start<true>(&tree, hooks);
+}
+
+/**
+ * runs the driver on tokens pulled from the lexer, or, when pipelined, on tokens the lexer publishes from its own
+ * thread through a TokenRing; a LexicalError is rethrown here once the parser reaches it
+ */
+template<bool BUILD>
+std::uint32_t Parser::start(ParseTree *tree, const std::vector<ReductionHook> *hooks) {
+    STATS_PHASE(PARSE);
+    Trace::Span span("parse", "parse");
+    if (!pipelined) {
+        auto pull = [this]() { return lexer->nextToken(); };
+        return run<BUILD>(pull, tree, hooks);
+    }
+    TokenRing ring;
+    std::thread producer([this, &ring, traced = Trace::isTraced()]() {
+        Trace::Sample sample(traced);
+        Trace::Span span("lex", "lex");
+        try {
+            while (true) {
+                Token token = lexer->nextToken();
+                bool end = token.getTokenType() == Token::TokenType::END_OF_FILE;
+                if (!ring.push(std::move(token)) || end) break;
+            }
+            ring.close();
+        } catch (...) {
+            ring.close(std::current_exception());
+        }
+    });
+    auto pop = [&ring]() { return ring.pop(); };
+    std::uint32_t value;
+    try {
+        value = run<BUILD>(pop, tree, hooks);
+    } catch (...) {
+        ring.cancel();
+        producer.join();
+        throw;
+    }
+    ring.cancel();  // the parse may end before the input does
+    producer.join();
+    return value;
+}
+
+/**
+ * the LL(1) driver on the tokens returned by nextToken(); without BUILD every tree operation is compiled out.
+ * The stack holds symbol ids of the CompiledGrammar and is kept between parses, so once it is as deep as the input
+ * needs, a step allocates nothing.
+ * When building, `nodes` runs parallel to `stack` with the tree node of every symbol.
+ * With hooks, a REDUCE marker is pushed under the body of every expansion,
+ * it surfaces once the whole body is parsed and the children's values are on top of `values`.
+ *
+ * Without BUILD, a non-terminal heading operator precedence levels (see CompiledGrammar::OperatorLevels) is parsed
+ * as operand (operator operand)*: a marker -A under the operand takes the next operator or, on anything in
+ * FOLLOW(A), ends the expression, so an operand costs one prediction whatever the number of levels. On any other
+ * token the marker is replaced by the tails of the levels, which is exactly the stack the table-driven parse would
+ * have there, so errors and recovery are unchanged (see enterOperatorLevels for an operand that fails to start). The tree, when building, keeps the shape of the grammar.
+ *
+ * On an entry of the table with a conflict, the next tokens are peeked into the ring `ahead` until the
+ * grammar's lookahead decides (see CompiledGrammar::predict), at most k - 1 of them; every other entry is one
+ * lookup. Where k tokens do not decide, the input is handed to EarleyParser (see parseConflict), whose derivation
+ * then replaces the table until the non-terminal is parsed; the tokens it read ahead are taken again.
+ *
+ * When recovering, an error either gives up the symbol on top of the stack (a missing token or non-terminal,
+ * its node keeps data NONE and its value is NONE) or deletes the input token; each step discards a token or a
+ * stack symbol, so recovery always ends and no exception is thrown.
+ */
+template<bool BUILD, typename Source>
+std::uint32_t Parser::run(Source &nextToken, ParseTree *tree, const std::vector<ReductionHook> *hooks) {
+    std::vector<std::uint32_t> nodes;
+    std::vector<std::uint32_t> values;
+    stack.clear();
+    diagnostics.clear();
+    recovering = false;
+    replay.clear();
+    replayed = 0;
+    forced.clear();
+    forcedNext = 0;
+    aheadFirst = 0;
+    aheadCount = 0;
+    bool resolve = grammar.hasConflicts();
+    auto pull = [&]() {
+        if (aheadCount == 0) return replayed < replay.size() ? replay[replayed++] : nextToken();
+        Token next = ahead[aheadFirst];
+        aheadFirst = (aheadFirst + 1) & AHEAD_MASK;
+        aheadCount--;
+        return next;
+    };
+    auto peek = [&](int depth) {
+        while (aheadCount < (std::size_t) depth) {
+            Token next = replayed < replay.size() ? replay[replayed++] : nextToken();
+            if (next.isWhitespace()) continue;
+            ahead[(aheadFirst + aheadCount++) & AHEAD_MASK] = next;
+        }
+        return (int) ahead[(aheadFirst + depth - 1) & AHEAD_MASK].getTokenType();
+    };
+    auto giveUp = [&]() {
+        stack.pop_back();
+        if constexpr (BUILD) {
+            nodes.pop_back();
+            if (hooks) values.push_back(ParseTree::NONE);
+        }
+    };
+    stack.push_back(Token::TokenType::END_OF_FILE);  // add end marker to represent the bottom of the stack
+    stack.push_back((ParseStack::symbol_t) grammar.getStart());
+    if constexpr (BUILD) {
+        tree->clear();
+        std::uint32_t root = tree->addNodes(1);
+        (*tree)[root].symbol = grammar.getStart();
+        nodes.push_back(ParseTree::NONE);
+        nodes.push_back(root);
+    }
+    bool hasPeeked = false;     // phrase level looks one token ahead on errors
+    Token peeked(Token::TokenType::INVALID_TOKEN);
     while (!stack.empty()) {
-        const Token &token = lexer->nextToken();
-        std::cout << "got token: " << token << std::endl;
+        const Token &token = hasPeeked ? peeked : pull();
+        hasPeeked = false;
+        PARSER_TRACE(PARSER_TRACE_TOKENS, observer, onToken(token));
 
         if (token.isWhitespace()) continue; // ignoring whitespaces such as space, tab, newline
+        int terminal = token.getTokenType();
         while (true) {
-            const GrammarSymbol &node = stack.back();
-            PRINT_STACK(stack)
-            // create symbol using the current token in order to use prediction
-            GrammarSymbol inputSymbol = GrammarSymbol::createTerminal(token.getTokenType());
+            std::int32_t node = stack.back();
+            PARSER_TRACE(PARSER_TRACE_STACK, observer, onStack(symbolsOf(stack)));
+            if constexpr (BUILD) {
+                if (node == REDUCE) {
+                    // the body of this node is complete
+                    std::uint32_t n = nodes.back();
+                    const ParseTree::Node &reduced = (*tree)[n];
+                    std::uint32_t *children = values.data() + values.size() - reduced.childCount;
+                    const ReductionHook &hook = (*hooks)[reduced.data];
+                    std::uint32_t value = hook ? hook(*tree, n, children) : n;
+                    values.resize(values.size() - reduced.childCount);
+                    values.push_back(value);
+                    stack.pop_back();
+                    nodes.pop_back();
+                    continue;
+                }
+            }
 
-            if (node.isTerminal() && node == inputSymbol) {
+            if constexpr (!BUILD) {
+                if (node < REDUCE) {
+                    // after an operand: another operator of the levels, the end of the expression, or an error
+                    // which the tails of the levels report as the table-driven parse would
+                    const CompiledGrammar::OperatorLevels &levels = grammar.getOperatorLevels(-node);
+                    if (levels.operators.test(terminal)) {
+                        stack.push_back((ParseStack::symbol_t) levels.next[terminal]);
+                        STATS_MAX(peakStackDepth, stack.size());
+                        recovering = false;
+                        break;
+                    }
+                    stack.pop_back();
+                    if (!grammar.inFollow(-node, terminal)) {
+                        stack.append(levels.tails.begin(), levels.tails.end());
+                        STATS_MAX(peakStackDepth, stack.size());
+                    }
+                    continue;
+                }
+            }
+
+            if (node == terminal) {
                 stack.pop_back();
+                recovering = false;
+                if constexpr (BUILD) {
+                    std::uint32_t leaf = nodes.back();
+                    nodes.pop_back();
+                    if (leaf != ParseTree::NONE) {
+                        (*tree)[leaf].data = tree->addToken(token);
+                        if (hooks) values.push_back(leaf);
+                    }
+                }
                 break;
-            } else if (node.isTerminal() && !node.isEpsilon()) {
-                throw SyntacticalError("error: expected " + node.toString() + "got" + inputSymbol.toString() , token.getLine(), token.getColumn());
             }
 
-            // use parsing table to predict the next production
-            std::cout << "\t\tpredict: " << node << " on " << inputSymbol << std::endl;
-            std::variant<Production, ErrorStrategy> result = grammar.predict(node, inputSymbol);
+            std::string message;
+            ErrorStrategy::Action action = ErrorStrategy::POP_NON_TERMINAL;     // a missing terminal is given up
+            if (CompiledGrammar::isTerminal(node)) {
+                PARSER_TRACE(PARSER_TRACE_TOKENS, observer, onError(token));
+                message = "error: expected " + grammar.getSymbol(node).toString() + " got "
+                          + Token::tokenTypeAsString(token.getTokenType());
+                if (recovery == NO_RECOVERY) throw SyntacticalError(message, token.getLine(), token.getColumn());
+            } else {
+                if constexpr (!BUILD) {
+                    if (precedence && !grammar.getOperatorLevels(node).tails.empty() && forcedNext == forced.size()
+                        && enterOperatorLevels(grammar, stack, terminal)) {
+                        continue;
+                    }
+                }
+                // use parsing table to predict the next production
+                PARSER_TRACE(PARSER_TRACE_EXPANSIONS, observer,
+                             onPredict(grammar.getSymbol(node), GrammarSymbol::createTerminal(token.getTokenType())));
+                STATS_ADD(predictions, 1);
+                int production;
+                if (resolve && (forcedNext < forced.size() || grammar.hasConflict(node, terminal))) {
+                    if (forcedNext == forced.size() && hasPeeked) {
+                        // the token phrase level looked at comes next again
+                        aheadFirst = (aheadFirst - 1) & AHEAD_MASK;
+                        ahead[aheadFirst] = peeked;
+                        aheadCount++;
+                        hasPeeked = false;
+                    }
+                    if (forcedNext < forced.size()) {
+                        production = forced[forcedNext++];
+                    } else {
+                        production = grammar.predict(node, terminal, peek);
+                        if (production == CompiledGrammar::UNDECIDED) {
+                            production = !general ? grammar.predict(node, terminal) : parseConflict(node, token, [&]() {
+                                Token next = pull();
+                                while (next.isWhitespace()) next = pull();
+                                return next;
+                            });
+                        }
+                    }
+                } else {
+                    production = grammar.predict(node, terminal);
+                }
 
-            if (std::holds_alternative<Production>(result)) {
-                // use the predicted production to preceded
-                const Production &p = std::get<Production>(result);
-                stack.pop_back();
-                std::cout << "\t\texpand using: " << p << std::endl;
-                for (int i = p.body.size() - 1; i >= 0; i--) {
-                    // push to stack in reverse since left-most derivation
-                    if (!p.body[i].isEpsilon()) {
-                        stack.push_back(p.body[i]);
+                if (production != CompressedParsingTable::NO_ENTRY) {
+                    // use the predicted production to preceded
+                    const std::vector<std::int32_t> &body = grammar.getBody(production);
+                    stack.pop_back();
+                    PARSER_TRACE(PARSER_TRACE_EXPANSIONS, observer, onExpand(grammar.getProduction(production)));
+                    if constexpr (BUILD) {
+                        // the children of the expanded node are allocated together, one per body symbol
+                        std::uint32_t parent = nodes.back();
+                        nodes.pop_back();
+                        std::uint32_t first = tree->addNodes((std::uint32_t) body.size());
+                        ParseTree::Node &expanded = (*tree)[parent];
+                        expanded.data = production;
+                        expanded.firstChild = body.empty() ? ParseTree::NONE : first;
+                        expanded.childCount = (std::uint32_t) body.size();
+                        for (std::uint32_t i = 0; i < body.size(); i++) (*tree)[first + i].symbol = body[i];
+                        if (hooks) {
+                            stack.push_back(REDUCE);
+                            nodes.push_back(parent);
+                        }
+                        for (std::uint32_t i = (std::uint32_t) body.size(); i-- > 0;) nodes.push_back(first + i);
                     }
+                    // push to stack in reverse since left-most derivation
+                    stack.append(body.rbegin(), body.rend());
+                    STATS_ADD(expansions, 1);
+                    STATS_MAX(peakStackDepth, stack.size());
+                    continue;
                 }
-            } else if (std::holds_alternative<ErrorStrategy>(result)) {
-                // on error, might do recovery, isn't implemented
-                throw SyntacticalError("error", token.getLine(), token.getColumn());
+                PARSER_TRACE(PARSER_TRACE_TOKENS, observer, onError(token));
+                ErrorStrategy strategy = grammar.errorStrategy(node, terminal);
+                message = "error: " + strategy.getMessage();
+                if (recovery == NO_RECOVERY) throw SyntacticalError(message, token.getLine(), token.getColumn());
+                action = strategy.getAction();
             }
 
+            // recovery, only reached on errors
+            report(message, token);
+            bool atEnd = terminal == Token::TokenType::END_OF_FILE;
+            if (recovery == PHRASE_LEVEL && !atEnd) {
+                if (!hasPeeked) {
+                    do {
+                        peeked = pull();
+                    } while (peeked.isWhitespace());
+                    hasPeeked = true;
+                }
+                // deleting the token is preferred when the next one fits, then inserting the symbol on top
+                if (canStart(node, peeked.getTokenType())) {
+                    action = ErrorStrategy::SKIP_INPUT;
+                } else if (stackCanUse(stack, stack.size() - 1, terminal)) {
+                    action = ErrorStrategy::POP_NON_TERMINAL;
+                }
+            }
+            // the end marker is never given up and the end of the input never skipped
+            if (!atEnd && (node == Token::TokenType::END_OF_FILE || action == ErrorStrategy::SKIP_INPUT)) break;
+            giveUp();
         }
     }
-    std::cout << "accept" << std::endl;
+    PARSER_TRACE(PARSER_TRACE_TOKENS, observer, onAccept());
+    return values.empty() ? 0 : values.back();
 }
 
-Parser::Parser(const ContextFreeGrammar &grammar, Lexer *lexer, SymbolTable *symbolTable)
-        : grammar(grammar), lexer(lexer), symbolTable(symbolTable) {}
\ No newline at end of file
+/**
+ * shares the compiled grammar, a parser owns nothing but its stacks
+ */
+Parser::Parser(const CompiledGrammar &grammar, Lexer *lexer, SymbolTable *symbolTable)
+        : grammar(grammar), lexer(lexer), symbolTable(symbolTable),
+          ahead(CompiledGrammar::MAX_LOOKAHEAD, Token(Token::TokenType::INVALID_TOKEN)) {}
+
+/**
+ * the next parse reads from `lexer`, reusing the stack grown by the previous ones
+ */
+void Parser::setLexer(Lexer *lexer) {
+    this->lexer = lexer;
+}
+
+/**
+ * compiles a snapshot of `grammar` for this parser alone; the analysis is kept in `grammar`, so the next parser
+ * compiled from it does not repeat it. To share one snapshot between parsers, compile it once and pass the
+ * CompiledGrammar instead
+ */
+Parser::Parser(ContextFreeGrammar &grammar, Lexer *lexer, SymbolTable *symbolTable)
+        : Parser(CompiledGrammar(grammar), lexer, symbolTable) {}
+
+/**
+ * the observer receives the events of the following parses up to PARSER_TRACE_LEVEL, nullptr for none
+ */
+void Parser::setObserver(ParseObserver *observer) {
+    this->observer = observer;
+}
+
+/**
+ * with pipelining, the lexer runs on a thread of its own while the parser consumes its tokens
+ */
+void Parser::setPipelined(bool pipelined) {
+    this->pipelined = pipelined;
+}
+
+/**
+ * with precedence parsing (the default), expressions are parsed as flat sequences of operands and operators instead
+ * of expanding every precedence level of the grammar; it only applies to parse() without a tree
+ */
+void Parser::setPrecedenceParsing(bool precedence) {
+    this->precedence = precedence;
+}
+
+/**
+ * with general parsing (the default), the entries of the table where k tokens of lookahead do not decide are left
+ * to EarleyParser; without it, the table's first production is taken there, as findParsingTableLL1 leaves it
+ */
+void Parser::setGeneralParsing(bool general) {
+    this->general = general;
+}
+
+/**
+ * NO_RECOVERY (the default) throws SyntacticalError on the first error,
+ * the other modes collect every error in getDiagnostics() and parse to the end of the input
+ */
+void Parser::setRecovery(Recovery recovery) {
+    this->recovery = recovery;
+}
+
+/**
+ * the errors of the last parse, in input order
+ */
+const std::vector<SyntaxDiagnostic> &Parser::getDiagnostics() const {
+    return diagnostics;
+}
+
+/**
+ * with a level A of operator precedence on top of the stack and `terminal` next, replaces A by its operand under a
+ * marker -A (see CompiledGrammar::OperatorLevels), or by the operand alone right after an operator of a marker
+ * below. Right after an operator but on a terminal A cannot start with, the marker is replaced by the tails the
+ * table-driven parse would have there, so the table reports the error on A.
+ * @return whether the operand is on top now, false when the table is to be used on A
+ */
+bool Parser::enterOperatorLevels(const CompiledGrammar &grammar, ParseStack &stack, int terminal) {
+    std::int32_t node = stack.back();
+    const CompiledGrammar::OperatorLevels &levels = grammar.getOperatorLevels(node);
+    std::int32_t below = stack[stack.size() - 2];   // the end marker is always below a non-terminal
+    if (below < REDUCE) {
+        const CompiledGrammar::OperatorLevels &outer = grammar.getOperatorLevels(-below);
+        std::size_t level = outer.heads.size() - levels.heads.size();
+        if (levels.heads.size() < outer.heads.size() && outer.heads[level] == node) {
+            if (grammar.inFirst(node, terminal)) {
+                stack.back() = (ParseStack::symbol_t) levels.operand;
+                return true;
+            }
+            stack.resize(stack.size() - 2);
+            stack.append(outer.tails.begin(), outer.tails.begin() + (std::ptrdiff_t) level);
+            stack.push_back((ParseStack::symbol_t) node);
+            STATS_MAX(peakStackDepth, stack.size());
+            return false;
+        }
+    }
+    if (!grammar.inFirst(node, terminal)) return false;
+    stack.back() = (ParseStack::symbol_t) -node;
+    stack.push_back((ParseStack::symbol_t) levels.operand);
+    STATS_MAX(peakStackDepth, stack.size());
+    return true;
+}
+
+/**
+ * parses the non-terminal on top of the stack with EarleyParser from `token` on, taking the longest prefix it
+ * derives that the stack below can go on after. The rest of its derivation is queued in `forced`, and what it read
+ * after `token` is queued for replay, so the driver goes through the same tokens and builds the same tree as if the
+ * table had predicted each production.
+ * @return the production for the non-terminal; the table's, which then reports the error, if no prefix is derived
+ */
+int Parser::parseConflict(std::int32_t node, const Token &token, const std::function<Token()> &pull) {
+    if (!earley) earley = std::make_unique<EarleyParser>(grammar);
+    std::int32_t length = earley->parse(node, token, pull, [this](int terminal) {
+        return stackCanUse(stack, stack.size() - 1, terminal);
+    });
+    // what it read after `token` comes next, then what is left of the ring, then the rest of the replay
+    std::vector<Token> pending(earley->getTokens().begin() + 1, earley->getTokens().end());
+    for (; aheadCount > 0; aheadCount--) {
+        pending.push_back(ahead[aheadFirst]);
+        aheadFirst = (aheadFirst + 1) & AHEAD_MASK;
+    }
+    replay.erase(replay.begin(), replay.begin() + (std::ptrdiff_t) replayed);
+    replay.insert(replay.begin(), pending.begin(), pending.end());
+    replayed = 0;
+    if (length == EarleyParser::NO_PARSE) return grammar.predict(node, token.getTokenType());
+    const std::vector<int> &derivation = earley->getDerivation();
+    forced.assign(derivation.begin() + 1, derivation.end());
+    forcedNext = 0;
+    return derivation[0];
+}
+
+/**
+ * whether `input` is in FIRST of stack[0, below), read from the top down
+ */
+bool Parser::stackCanUse(const ParseStack &stack, std::size_t below, int input) const {
+    for (std::size_t i = below; i-- > 0;) {
+        std::int32_t s = stack[i];
+        if (s == REDUCE) continue;
+        if (s < REDUCE) {
+            if (grammar.getOperatorLevels(-s).operators.test(input)) return true;
+            continue;   // the tails are nullable
+        }
+        if (grammar.inFirst(s, input)) return true;
+        if (!grammar.isNullable(s)) return false;
+    }
+    return false;
+}
+
+/**
+ * whether `symbol` on top of the stack can go on with `input`
+ */
+bool Parser::canStart(std::int32_t symbol, int input) const {
+    if (CompiledGrammar::isTerminal(symbol)) return symbol == input;
+    return grammar.predict(symbol, input) != CompressedParsingTable::NO_ENTRY;
+}
+
+/**
+ * the stack as grammar symbols for the observer, REDUCE markers as invalid symbols and operator level markers as the
+ * tails they stand for
+ */
+std::vector<GrammarSymbol> Parser::symbolsOf(const ParseStack &stack) const {
+    std::vector<GrammarSymbol> symbols;
+    for (std::int32_t s: stack) {
+        if (s < REDUCE) {
+            for (std::int32_t tail: grammar.getOperatorLevels(-s).tails) symbols.push_back(grammar.getSymbol(tail));
+        } else {
+            symbols.push_back(s == REDUCE ? GrammarSymbol::invalid() : grammar.getSymbol(s));
+        }
+    }
+    return symbols;
+}
+
+void Parser::report(const std::string &message, const Token &token) {
+    if (recovering) return;
+    recovering = true;
+    diagnostics.push_back({message, token.getLine() + 1, token.getColumn() + 1});
+}
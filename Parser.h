@@ -7,18 +7,81 @@
 
 
 #include "ContextFreeGrammar.h"
+#include "CompiledGrammar.h"
 #include "SymbolTable.h"
 #include "Lexer.h"
+#include "ParseTrace.h"
+#include "ParseTree.h"
+#include "ParseStack.h"
+#include "EarleyParser.h"
+#include <memory>
 #include <stdexcept>
 
+/**
+ * a syntax error reported by a recovering parse, line and column are 1-based as in SyntacticalError
+ */
+struct SyntaxDiagnostic {
+    std::string message;
+    int line;
+    int column;
+};
+
 class Parser {
+public:
+    using Recovery = enum {
+        NO_RECOVERY,    // throw SyntacticalError on the first error
+        PANIC_MODE,     // synchronise on the FOLLOW sets, see ErrorStrategy
+        PHRASE_LEVEL    // delete the token or insert the expected symbol if one token of lookahead agrees, else panic
+    };
+
 private:
-    ContextFreeGrammar grammar;
+    static constexpr std::int32_t REDUCE = -1;     // marker under an expanded body while building with hooks
+    static constexpr std::size_t AHEAD_MASK = CompiledGrammar::MAX_LOOKAHEAD - 1;
+    static_assert((CompiledGrammar::MAX_LOOKAHEAD & AHEAD_MASK) == 0, "the lookahead ring is a power of two");
+    // -A, below REDUCE, stands for the tails of the operator levels of A while an expression is parsed flat
+
+    CompiledGrammar grammar;
     SymbolTable *symbolTable;
     Lexer *lexer;
+    ParseObserver *observer = nullptr;
+    Recovery recovery = NO_RECOVERY;
+    std::vector<SyntaxDiagnostic> diagnostics;
+    bool recovering = false;    // errors are not reported again until the next token is matched
+    bool pipelined = false;
+    bool precedence = true;
+    bool general = true;
+    ParseStack stack;
+    std::vector<Token> ahead;               // ring of the tokens peeked on a conflict, taken before all others
+    std::size_t aheadFirst = 0;
+    std::size_t aheadCount = 0;
+    std::unique_ptr<EarleyParser> earley;   // made on the first conflict
+    std::vector<Token> replay;              // tokens EarleyParser read ahead, taken before the source's
+    std::size_t replayed = 0;
+    std::vector<int> forced;                // the rest of EarleyParser's derivation, taken before the table's
+    std::size_t forcedNext = 0;
+
+    template<bool BUILD>
+    std::uint32_t start(ParseTree *tree, const std::vector<ReductionHook> *hooks);
+    template<bool BUILD, typename Source>
+    std::uint32_t run(Source &nextToken, ParseTree *tree, const std::vector<ReductionHook> *hooks);
+    [[nodiscard]] bool stackCanUse(const ParseStack &stack, std::size_t below, int input) const;
+    [[nodiscard]] bool canStart(std::int32_t symbol, int input) const;
+    [[nodiscard]] std::vector<GrammarSymbol> symbolsOf(const ParseStack &stack) const;
+    int parseConflict(std::int32_t node, const Token &token, const std::function<Token()> &pull);
+    void report(const std::string &message, const Token &token);
 public:
-    Parser(const ContextFreeGrammar &grammar, Lexer *lexer, SymbolTable *symbolTable);
+    Parser(const CompiledGrammar &grammar, Lexer *lexer, SymbolTable *symbolTable);
+    Parser(ContextFreeGrammar &grammar, Lexer *lexer, SymbolTable *symbolTable);
+    static bool enterOperatorLevels(const CompiledGrammar &grammar, ParseStack &stack, int terminal);
+    void setLexer(Lexer *lexer);
+    void setObserver(ParseObserver *observer);
+    void setRecovery(Recovery recovery);
+    void setPipelined(bool pipelined);
+    void setPrecedenceParsing(bool precedence);
+    void setGeneralParsing(bool general);
+    [[nodiscard]] const std::vector<SyntaxDiagnostic> &getDiagnostics() const;
     void parse();
+    std::uint32_t parse(ParseTree &tree, const std::vector<ReductionHook> *hooks = nullptr);
 };
 
 class SyntacticalError : public std::runtime_error {
@@ -0,0 +1,154 @@
+//
+// Created by jens on 19/10/26.
+//
+
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <unordered_set>
+#include "ParserGenerator.h"
+
+ParserGenerator::ParserGenerator(const ContextFreeGrammar &grammar, const std::string &className)
+        : grammar(grammar), className(className) {
+    std::unordered_set<std::string> used;
+    for (const GrammarSymbol &nt: this->grammar.getNonTerminals()) {
+        std::string name = "parse_" + sanitise(nt.getNonTerminal());
+        while (used.count(name)) name += "_";
+        used.insert(name);
+        functionNames.push_back(name);
+    }
+}
+
+/**
+ * turns a non-terminal such as <expr_p> or <term>' into an identifier fragment (expr_p, term_p)
+ */
+std::string ParserGenerator::sanitise(const std::string &name) {
+    std::string result;
+    for (char ch: name) {
+        if ((ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z') || (ch >= '0' && ch <= '9') || ch == '_') {
+            result += ch;
+        } else if (ch == '\'') {
+            result += "_p";
+        }
+    }
+    return result.empty() ? "nt" : result;
+}
+
+std::string ParserGenerator::describe(const Production &production) {
+    std::ostringstream os;
+    os << production;
+    std::string text = os.str();
+    return text.substr(0, text.find_last_not_of(' ') + 1);    // operator<< leaves a space after every symbol
+}
+
+std::string ParserGenerator::terminalName(int tokenType) {
+    auto it = Token::tokenName.find((Token::TokenType) tokenType);
+    return it == Token::tokenName.end() ? std::to_string(tokenType) : it->second;
+}
+
+void ParserGenerator::generateFunction(std::ostream &out, int row, const std::vector<int> &entries) {
+    const std::vector<Production> &productions = grammar.getProductions();
+    const GrammarSymbol &head = grammar.getNonTerminals()[row];
+
+    // group the lookahead terminals by the production they predict, keeping the order of the productions
+    std::map<int, std::vector<int>> cases;
+    bool loops = false;
+    for (int t = 0; t < Token::TOKEN_TYPE_COUNT; t++) {
+        if (entries[t] == CompressedParsingTable::NO_ENTRY) continue;
+        cases[entries[t]].push_back(t);
+        const Production &p = productions[entries[t]];
+        if (p.body.back() == head) loops = true;
+    }
+
+    std::string indent = loops ? "            " : "        ";
+    out << "    // " << head << std::endl;
+    out << "    void " << functionNames[row] << "() {" << std::endl;
+    if (loops) out << "        while (true) {" << std::endl;
+    out << indent << "switch (token.getTokenType()) {" << std::endl;
+    for (const auto &entry: cases) {
+        const Production &p = productions[entry.first];
+        for (int t: entry.second) {
+            out << indent << "    case " << t << ":    // " << terminalName(t) << std::endl;
+        }
+        out << indent << "        // " << describe(p) << std::endl;
+        bool tail = false;
+        for (int i = 0; i < p.body.size(); i++) {
+            const GrammarSymbol &s = p.body[i];
+            if (s.isEpsilon()) continue;
+            if (i == p.body.size() - 1 && s == head) {
+                tail = true;    // A ::= u A, loop instead of recursing
+            } else if (!s.isTerminal()) {
+                out << indent << "        " << functionNames[grammar.getNonTerminalIndex(s)] << "();" << std::endl;
+            } else if (i == 0) {
+                // the switch already checked the lookahead against the first terminal
+                out << indent << "        advance();" << std::endl;
+            } else {
+                out << indent << "        match(" << s.getTerminal() << ");    // " << terminalName(s.getTerminal())
+                    << std::endl;
+            }
+        }
+        out << indent << "        " << (tail ? "continue;" : "return;") << std::endl;
+    }
+    out << indent << "    default:" << std::endl;
+    out << indent << "        error();" << std::endl;
+    out << indent << "}" << std::endl;
+    if (loops) out << "        }" << std::endl;
+    out << "    }" << std::endl << std::endl;
+}
+
+void ParserGenerator::generate(std::ostream &out) {
+    std::vector<std::vector<int>> matrix = grammar.getParsingTableMatrix();
+    std::string guard = "COMPILER_" + className + "_H";
+    for (char &ch: guard) ch = (char) toupper(ch);
+
+    out << "//" << std::endl
+        << "// generated by ParserGenerator from the grammar starting with " << grammar.getStartSymbol() << std::endl
+        << "// do not edit, regenerate instead" << std::endl
+        << "//" << std::endl << std::endl
+        << "#ifndef " << guard << std::endl
+        << "#define " << guard << std::endl << std::endl
+        << "#include \"Lexer.h\"" << std::endl
+        << "#include \"Parser.h\"" << std::endl << std::endl
+        << "class " << className << " {" << std::endl
+        << "private:" << std::endl
+        << "    Lexer *lexer;" << std::endl
+        << "    Token token = Token(Token::TokenType::INVALID_TOKEN);" << std::endl << std::endl
+        << "    void advance() {" << std::endl
+        << "        do {" << std::endl
+        << "            token = lexer->nextToken();" << std::endl
+        << "        } while (token.isWhitespace());" << std::endl
+        << "    }" << std::endl << std::endl
+        << "    void match(int type) {" << std::endl
+        << "        if (token.getTokenType() != type) {" << std::endl
+        << "            throw SyntacticalError(\"error: expected \" + Token::tokenTypeAsString((Token::TokenType) type)"
+        << " + \" got \" + Token::tokenTypeAsString(token.getTokenType()), token.getLine(), token.getColumn());"
+        << std::endl
+        << "        }" << std::endl
+        << "        advance();" << std::endl
+        << "    }" << std::endl << std::endl
+        << "    void error() {" << std::endl
+        << "        throw SyntacticalError(\"error\", token.getLine(), token.getColumn());" << std::endl
+        << "    }" << std::endl << std::endl;
+
+    for (int row = 0; row < matrix.size(); row++) {
+        generateFunction(out, row, matrix[row]);
+    }
+
+    out << "public:" << std::endl
+        << "    explicit " << className << "(Lexer *lexer) : lexer(lexer) {}" << std::endl << std::endl
+        << "    void parse() {" << std::endl
+        << "        advance();" << std::endl
+        << "        " << functionNames[grammar.getNonTerminalIndex(grammar.getStartSymbol())] << "();" << std::endl
+        << "        match(" << Token::TokenType::END_OF_FILE << ");    // EOF" << std::endl
+        << "    }" << std::endl
+        << "};" << std::endl << std::endl
+        << "#endif //" << guard << std::endl;
+}
+
+void ParserGenerator::generate(const std::string &filename) {
+    std::ofstream fout(filename, std::ios::out | std::ios::trunc);
+    if (!fout.is_open()) {
+        throw std::runtime_error("Could not open file " + filename);
+    }
+    generate(fout);
+}
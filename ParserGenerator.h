@@ -0,0 +1,40 @@
+//
+// Created by jens on 19/10/26.
+//
+
+#ifndef COMPILER_PARSERGENERATOR_H
+#define COMPILER_PARSERGENERATOR_H
+
+#include <ostream>
+#include <string>
+#include <vector>
+#include "ContextFreeGrammar.h"
+
+/**
+ * Emits C++ source of a parser specialised for one grammar: a recursive descent parser with one function per
+ * non-terminal, each a `switch` on the lookahead token built from the LL(1) parsing table.
+ *
+ * The generated class is header-only and has the interface of Parser: it is constructed with a Lexer,
+ * `parse()` consumes the input and throws SyntacticalError at the same token the table-driven Parser would.
+ * A production whose body ends with its own head loops instead of recursing, so `<expr_p> ::= + <term> <expr_p>`
+ * does not grow the call stack with the number of operands.
+ */
+class ParserGenerator {
+private:
+    ContextFreeGrammar grammar;
+    std::string className;
+    std::vector<std::string> functionNames;     // per non-terminal index
+
+    static std::string sanitise(const std::string &name);
+    static std::string describe(const Production &production);
+    static std::string terminalName(int tokenType);
+    void generateFunction(std::ostream &out, int row, const std::vector<int> &entries);
+
+public:
+    ParserGenerator(const ContextFreeGrammar &grammar, const std::string &className);
+    void generate(std::ostream &out);
+    void generate(const std::string &filename);
+};
+
+
+#endif //COMPILER_PARSERGENERATOR_H
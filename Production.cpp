@@ -5,7 +5,7 @@
 #include <iostream>
 #include "Production.h"
 
-int Production::nextId = 0;
+std::atomic<int> Production::nextId{0};
 
 std::ostream &operator<<(std::ostream &os, const Production &production) {
     os << production.head << " ::= ";
@@ -22,8 +22,7 @@ Production::Production(const GrammarSymbol &head, const std::vector<GrammarSymbo
     if (this->body.size() == 0) {
         this->body.push_back(GrammarSymbol::epsilon());
     }
-    this->id = nextId;
-    nextId++;
+    this->id = nextId.fetch_add(1, std::memory_order_relaxed);
 }
 
 Production::Production(int id, const GrammarSymbol &head, const std::vector<GrammarSymbol> &body)
@@ -31,7 +30,9 @@ Production::Production(int id, const GrammarSymbol &head, const std::vector<Gram
     if (this->body.size() == 0) {
         this->body.push_back(GrammarSymbol::epsilon());
     }
-    nextId = id + 1;
+    // later productions are numbered after this one, ids already handed out are never reused
+    int next = nextId.load(std::memory_order_relaxed);
+    while (next <= id && !nextId.compare_exchange_weak(next, id + 1, std::memory_order_relaxed));
 }
 
 bool Production::operator==(const Production &other) const {
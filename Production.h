@@ -5,13 +5,14 @@
 #ifndef COMPILER_PRODUCTION_H
 #define COMPILER_PRODUCTION_H
 
+#include <atomic>
 #include <vector>
 #include "GrammarSymbol.h"
 
 class Production {
 private:
     int id;
-    static int nextId;
+    static std::atomic<int> nextId;     // productions may be created on several threads
 public:
     GrammarSymbol head;
     std::vector<GrammarSymbol> body;
@@ -0,0 +1,145 @@
+//
+// Created by jens on 19/10/26.
+//
+
+#include "PushParser.h"
+
+PushParser::PushParser(const CompiledGrammar &grammar) : grammar(grammar) {
+    reset();
+}
+
+/**
+ * starts a new parse, the grammar and the observer are kept
+ */
+void PushParser::reset() {
+    stack.clear();
+    stack.push_back(Token::TokenType::END_OF_FILE);  // end marker at the bottom of the stack
+    stack.push_back((ParseStack::symbol_t) grammar.getStart());
+    held.clear();
+    status = NEED_MORE;
+    error = {"", 0, 0};
+    line = column = 0;
+}
+
+void PushParser::setObserver(ParseObserver *observer) {
+    this->observer = observer;
+}
+
+/**
+ * expressions as flat sequences of operands and operators, see Parser::setPrecedenceParsing
+ */
+void PushParser::setPrecedenceParsing(bool precedence) {
+    this->precedence = precedence;
+}
+
+/**
+ * parses the next tokens; whitespace is skipped and an END_OF_FILE token finishes the input.
+ * Once ACCEPTED or FAILED, further tokens are ignored until reset().
+ */
+PushParser::Status PushParser::feed(const Token *tokens, std::size_t count) {
+    for (std::size_t i = 0; i < count && status == NEED_MORE; i++) {
+        PARSER_TRACE(PARSER_TRACE_TOKENS, observer, onToken(tokens[i]));
+        if (tokens[i].isWhitespace()) continue;
+        line = tokens[i].getLine();
+        column = tokens[i].getColumn();
+        held.push_back(tokens[i]);
+        while (!held.empty() && step(held.front())) {
+            if (held.front().getTokenType() == Token::TokenType::END_OF_FILE) {
+                status = ACCEPTED;
+                PARSER_TRACE(PARSER_TRACE_TOKENS, observer, onAccept());
+            }
+            held.erase(held.begin());
+        }
+    }
+    return status;
+}
+
+PushParser::Status PushParser::feed(const std::vector<Token> &tokens) {
+    return feed(tokens.data(), tokens.size());
+}
+
+/**
+ * ends the input, unless a fed END_OF_FILE token already did
+ */
+PushParser::Status PushParser::finish() {
+    if (status != NEED_MORE) return status;
+    Token eof(Token::TokenType::END_OF_FILE, line, column);
+    return feed(&eof, 1);
+}
+
+PushParser::Status PushParser::getStatus() const {
+    return status;
+}
+
+/**
+ * the error that FAILED the parse
+ */
+const SyntaxDiagnostic &PushParser::getError() const {
+    return error;
+}
+
+/**
+ * expands the stack until the token is matched, as Parser does for each token it pulls; the tokens held after it
+ * are the lookahead of a conflict. Stopping at a conflict leaves the stack as it was before the prediction, so the
+ * step is taken again with the same token once more tokens are held.
+ * @return false on a syntax error, or when a conflict needs lookahead that was not fed yet
+ */
+bool PushParser::step(const Token &token) {
+    int terminal = token.getTokenType();
+    bool starved = false;
+    auto peek = [&](int depth) {
+        if ((std::size_t) depth < held.size()) return (int) held[depth].getTokenType();
+        if (held.back().getTokenType() == Token::TokenType::END_OF_FILE) return (int) Token::TokenType::END_OF_FILE;
+        starved = true;
+        return (int) Token::TokenType::INVALID_TOKEN;
+    };
+    while (true) {
+        std::int32_t node = stack.back();
+        if (node < 0) {
+            // after an operand of the operator levels of -node, see Parser::run
+            const CompiledGrammar::OperatorLevels &levels = grammar.getOperatorLevels(-node);
+            if (levels.operators.test(terminal)) {
+                stack.push_back((ParseStack::symbol_t) levels.next[terminal]);
+                return true;
+            }
+            stack.pop_back();
+            if (!grammar.inFollow(-node, terminal)) stack.append(levels.tails.begin(), levels.tails.end());
+            continue;
+        }
+        if (node == terminal) {
+            stack.pop_back();
+            return true;
+        } else if (CompiledGrammar::isTerminal(node)) {
+            fail("error: expected " + grammar.getSymbol(node).toString() + " got "
+                 + Token::tokenTypeAsString(token.getTokenType()), token);
+            return false;
+        }
+
+        if (precedence && !grammar.getOperatorLevels(node).tails.empty()
+            && Parser::enterOperatorLevels(grammar, stack, terminal)) {
+            continue;
+        }
+        int production = grammar.predict(node, terminal);
+        if (grammar.hasConflicts() && grammar.hasConflict(node, terminal)) {
+            int decided = grammar.predict(node, terminal, peek);
+            if (starved) return false;
+            if (decided != CompiledGrammar::UNDECIDED) production = decided;
+        }
+        PARSER_TRACE(PARSER_TRACE_EXPANSIONS, observer,
+                     onPredict(grammar.getSymbol(node), GrammarSymbol::createTerminal(token.getTokenType())));
+        if (production == CompressedParsingTable::NO_ENTRY) {
+            fail("error: " + grammar.errorStrategy(node, terminal).getMessage(), token);
+            return false;
+        }
+        stack.pop_back();
+        PARSER_TRACE(PARSER_TRACE_EXPANSIONS, observer, onExpand(grammar.getProduction(production)));
+        const std::vector<std::int32_t> &body = grammar.getBody(production);
+        stack.append(body.rbegin(), body.rend());
+    }
+}
+
+void PushParser::fail(const std::string &message, const Token &token) {
+    PARSER_TRACE(PARSER_TRACE_TOKENS, observer, onError(token));
+    status = FAILED;
+    error = {message, token.getLine() + 1, token.getColumn() + 1};
+}
@@ -0,0 +1,56 @@
+//
+// Created by jens on 19/10/26.
+//
+
+#ifndef COMPILER_PUSHPARSER_H
+#define COMPILER_PUSHPARSER_H
+
+#include <cstddef>
+#include <vector>
+#include "CompiledGrammar.h"
+#include "Parser.h"
+#include "ParseStack.h"
+#include "ParseTrace.h"
+
+/**
+ * LL(1) parser driven by its caller: tokens are pushed in batches of any size with feed() as they arrive,
+ * finish() marks the end of the input. The parse stack is kept between calls, so one thread can interleave
+ * any number of parses, each costing only its stack; the CompiledGrammar is shared by all of them.
+ * On a conflicting entry the token is held back, with the ones fed after it, until the grammar's k tokens of
+ * lookahead decide, as Parser peeks them; where k tokens do not decide, the table's production is used.
+ */
+class PushParser {
+public:
+    using Status = enum {
+        NEED_MORE,  // every token so far is a prefix of a sentence
+        ACCEPTED,   // the input ended with a sentence
+        FAILED      // syntax error, see getError()
+    };
+
+private:
+    CompiledGrammar grammar;
+    ParseObserver *observer = nullptr;
+    ParseStack stack;                   // symbol ids, -A for the operator levels of A as in Parser
+    std::vector<Token> held;            // the token at a conflict that waits for lookahead, and those after it
+    bool precedence = true;
+    Status status = NEED_MORE;
+    SyntaxDiagnostic error;
+    int line = 0;       // position of the last token, where the end of the input is reported
+    int column = 0;
+
+    bool step(const Token &token);
+    void fail(const std::string &message, const Token &token);
+public:
+    explicit PushParser(const CompiledGrammar &grammar);
+    void setObserver(ParseObserver *observer);
+    void setPrecedenceParsing(bool precedence);
+    Status feed(const Token *tokens, std::size_t count);
+    Status feed(const std::vector<Token> &tokens);
+    Status finish();
+    void reset();
+    [[nodiscard]] Status getStatus() const;
+    [[nodiscard]] const SyntaxDiagnostic &getError() const;
+};
+
+
+#endif //COMPILER_PUSHPARSER_H
@@ -0,0 +1,302 @@
+//
+// Created by jens on 19/10/26.
+//
+
+#ifndef COMPILER_STATICGRAMMAR_H
+#define COMPILER_STATICGRAMMAR_H
+
+#include <cstdint>
+#include <initializer_list>
+#include <vector>
+#include "Token.h"
+#include "Production.h"
+#include "CompressedParsingTable.h"
+
+// constexpr counterparts of HEAD, NT and T
+#define STATIC_HEAD(x) StaticSymbol::createNonTerminal(x)
+#define STATIC_NT(x) StaticSymbol::createNonTerminal(x)
+#define STATIC_T(x) StaticSymbol::createTerminal(x)
+
+/**
+ * a grammar symbol usable in constant expressions, see GrammarSymbol
+ */
+struct StaticSymbol {
+    bool isTerminal = true;
+    const char *name = "";
+    int token = Token::TokenType::INVALID_TOKEN;    // the terminal, if isTerminal
+
+    static constexpr StaticSymbol createNonTerminal(const char *name) {
+        return {false, name, Token::TokenType::INVALID_TOKEN};
+    }
+
+    static constexpr StaticSymbol createTerminal(Token::TokenType token) {
+        return {true, "", token};
+    }
+
+    static constexpr StaticSymbol epsilon() {
+        return {true, "", Token::TokenType::EPSILON};
+    }
+
+    [[nodiscard]] constexpr bool isEpsilon() const {
+        return isTerminal && token == Token::TokenType::EPSILON;
+    }
+
+    [[nodiscard]] GrammarSymbol toGrammarSymbol() const {
+        return isTerminal ? GrammarSymbol::createTerminal((Token::TokenType) token)
+                          : GrammarSymbol::createNonTerminal(name);
+    }
+};
+
+/**
+ * a production usable in constant expressions, see Production
+ */
+struct StaticProduction {
+    static constexpr int MAX_BODY = 16;
+
+    const char *head = "";
+    int length = 0;
+    StaticSymbol body[MAX_BODY]{};
+
+    constexpr StaticProduction(const StaticSymbol &head, std::initializer_list<StaticSymbol> body) : head(head.name) {
+        for (const StaticSymbol &s: body) {
+            if (length == MAX_BODY) throw "production body is longer than StaticProduction::MAX_BODY";
+            this->body[length++] = s;
+        }
+        if (length == 0) {  // A ::= (nothing) means A ::= epsilon as in Production
+            this->body[length++] = StaticSymbol::epsilon();
+        }
+    }
+
+    [[nodiscard]] Production toProduction() const {
+        std::vector<GrammarSymbol> symbols;
+        for (int i = 0; i < length; i++) {
+            symbols.push_back(body[i].toGrammarSymbol());
+        }
+        return {GrammarSymbol::createNonTerminal(head), symbols};
+    }
+};
+
+constexpr bool staticNameEquals(const char *a, const char *b) {
+    while (*a != '\0' && *a == *b) {
+        a++;
+        b++;
+    }
+    return *a == *b;
+}
+
+/**
+ * number of distinct heads, i.e. the number of rows of the parsing table
+ */
+template<std::size_t N>
+constexpr int staticNonTerminalCount(const StaticProduction (&productions)[N]) {
+    int count = 0;
+    for (std::size_t i = 0; i < N; i++) {
+        bool seen = false;
+        for (std::size_t j = 0; j < i; j++) {
+            if (staticNameEquals(productions[i].head, productions[j].head)) seen = true;
+        }
+        if (!seen) count++;
+    }
+    return count;
+}
+
+template<std::size_t N>
+std::vector<Production> toProductions(const StaticProduction (&productions)[N]) {
+    std::vector<Production> result;
+    for (const StaticProduction &p: productions) {
+        result.push_back(p.toProduction());
+    }
+    return result;
+}
+
+/**
+ * FIRST, FOLLOW and the LL(1) parsing table computed entirely in a constant expression.
+ *
+ * Rows, productions and symbol ids are numbered exactly as ContextFreeGrammar numbers the productions returned by
+ * toProductions(): rows in order of first appearance as a head, productions by position,
+ * terminals by Token::TokenType and non-terminals by Token::TOKEN_TYPE_COUNT + row.
+ *
+ * Unlike findParsingTableLL1, which keeps the first production on a collision,
+ * every collision is counted in `conflicts` so it can be rejected with a static_assert.
+ *
+ * @tparam R number of non-terminals, staticNonTerminalCount(productions)
+ * @tparam N number of productions
+ */
+template<int R, std::size_t N>
+struct StaticLL1Table {
+    static constexpr int COLUMNS = Token::TOKEN_TYPE_COUNT;
+    static constexpr int WORDS = (COLUMNS + 63) / 64;
+
+    const char *nonTerminals[R]{};
+    int heads[N]{};                                 // row of the head of each production
+    int lengths[N]{};
+    int bodies[N][StaticProduction::MAX_BODY]{};    // symbol ids, -1 for an undefined non-terminal
+    std::uint64_t first[R][WORDS]{};                // contains EPSILON for nullable non-terminals
+    std::uint64_t firstP[N][WORDS]{};
+    std::uint64_t follow[R][WORDS]{};
+
+    // the table laid out as a CompressedParsingTable whose rows do not overlap
+    std::int32_t base[R]{};
+    std::int32_t defaults[R]{};
+    std::int32_t check[R * COLUMNS]{};
+    std::int32_t next[R * COLUMNS]{};
+
+    int conflicts = 0;
+    int undefinedNonTerminals = 0;
+
+    constexpr explicit StaticLL1Table(const StaticProduction (&productions)[N]) {
+        int rows = 0;
+        for (std::size_t p = 0; p < N; p++) {
+            heads[p] = rowOf(productions[p].head, rows);
+            if (heads[p] < 0) {
+                nonTerminals[rows] = productions[p].head;
+                heads[p] = rows++;
+            }
+        }
+        for (std::size_t p = 0; p < N; p++) {
+            lengths[p] = productions[p].length;
+            for (int i = 0; i < lengths[p]; i++) {
+                const StaticSymbol &s = productions[p].body[i];
+                int row = s.isTerminal ? -1 : rowOf(s.name, rows);
+                if (!s.isTerminal && row < 0) undefinedNonTerminals++;
+                bodies[p][i] = s.isTerminal ? s.token : (row < 0 ? -1 : COLUMNS + row);
+            }
+        }
+        findFirst();
+        findFollow();
+        findParsingTable();
+    }
+
+    [[nodiscard]] constexpr bool inSet(const std::uint64_t *set, int terminal) const {
+        return (set[terminal / 64] >> (terminal % 64)) & 1;
+    }
+
+    [[nodiscard]] constexpr int lookup(int row, int column) const {
+        return next[row * COLUMNS + column];
+    }
+
+    /**
+     * the table as a CompressedParsingTable borrowing the constant arrays (nothing is copied or allocated)
+     */
+    [[nodiscard]] CompressedParsingTable parsingTable() const {
+        return {R, COLUMNS, R * COLUMNS, base, defaults, check, next, nullptr};
+    }
+
+private:
+    [[nodiscard]] constexpr int rowOf(const char *name, int rows) const {
+        for (int r = 0; r < rows; r++) {
+            if (staticNameEquals(nonTerminals[r], name)) return r;
+        }
+        return -1;
+    }
+
+    static constexpr bool unite(std::uint64_t *into, const std::uint64_t *from, bool withEpsilon) {
+        bool changed = false;
+        for (int w = 0; w < WORDS; w++) {
+            std::uint64_t bits = from[w];
+            if (!withEpsilon && w == Token::TokenType::EPSILON / 64) {
+                bits &= ~(1ULL << (Token::TokenType::EPSILON % 64));
+            }
+            if ((into[w] | bits) != into[w]) {
+                into[w] |= bits;
+                changed = true;
+            }
+        }
+        return changed;
+    }
+
+    static constexpr bool insert(std::uint64_t *into, int terminal) {
+        std::uint64_t bit = 1ULL << (terminal % 64);
+        bool changed = (into[terminal / 64] & bit) == 0;
+        into[terminal / 64] |= bit;
+        return changed;
+    }
+
+    // FIRST of body[from...] into `into`, returns whether that suffix is nullable
+    constexpr bool firstOfSuffix(std::size_t p, int from, std::uint64_t *into, bool &changed) {
+        for (int i = from; i < lengths[p]; i++) {
+            int s = bodies[p][i];
+            if (s == Token::TokenType::EPSILON) continue;
+            if (s < 0) return false;
+            if (s < COLUMNS) {
+                changed |= insert(into, s);
+                return false;
+            }
+            changed |= unite(into, first[s - COLUMNS], false);
+            if (!inSet(first[s - COLUMNS], Token::TokenType::EPSILON)) return false;
+        }
+        return true;
+    }
+
+    constexpr void findFirst() {
+        bool changed = true;
+        while (changed) {   // repeat until no set grows
+            changed = false;
+            for (std::size_t p = 0; p < N; p++) {
+                if (firstOfSuffix(p, 0, first[heads[p]], changed)) {
+                    changed |= insert(first[heads[p]], Token::TokenType::EPSILON);
+                }
+            }
+        }
+        for (std::size_t p = 0; p < N; p++) {
+            bool unused = false;
+            if (firstOfSuffix(p, 0, firstP[p], unused)) {
+                insert(firstP[p], Token::TokenType::EPSILON);
+            }
+        }
+    }
+
+    constexpr void findFollow() {
+        if (R > 0) insert(follow[0], Token::TokenType::END_OF_FILE);   // the first head is the start symbol
+        bool changed = true;
+        while (changed) {
+            changed = false;
+            for (std::size_t p = 0; p < N; p++) {
+                for (int i = 0; i < lengths[p]; i++) {
+                    int s = bodies[p][i];
+                    if (s < COLUMNS) continue;
+                    // FIRST of what follows B in A ::= u B v is in FOLLOW[B], and FOLLOW[A] too if v is nullable
+                    if (firstOfSuffix(p, i + 1, follow[s - COLUMNS], changed)) {
+                        changed |= unite(follow[s - COLUMNS], follow[heads[p]], false);
+                    }
+                }
+            }
+        }
+    }
+
+    constexpr void place(int row, int column, int production) {
+        int i = row * COLUMNS + column;
+        if (next[i] != CompressedParsingTable::NO_ENTRY && next[i] != production) {
+            conflicts++;
+            return;
+        }
+        next[i] = production;
+    }
+
+    constexpr void findParsingTable() {
+        for (int r = 0; r < R; r++) {
+            base[r] = r * COLUMNS;
+            defaults[r] = CompressedParsingTable::NO_ENTRY;
+            for (int c = 0; c < COLUMNS; c++) {
+                check[r * COLUMNS + c] = r;
+                next[r * COLUMNS + c] = CompressedParsingTable::NO_ENTRY;
+            }
+        }
+        for (std::size_t p = 0; p < N; p++) {
+            for (int t = 0; t < COLUMNS; t++) {
+                if (t != Token::TokenType::EPSILON && inSet(firstP[p], t)) place(heads[p], t, (int) p);
+            }
+            if (inSet(firstP[p], Token::TokenType::EPSILON)) {
+                for (int t = 0; t < COLUMNS; t++) {
+                    if (inSet(follow[heads[p]], t)) place(heads[p], t, (int) p);
+                }
+            }
+        }
+    }
+};
+
+// analyses a constexpr array of StaticProduction: `static constexpr auto tables = STATIC_LL1_TABLE(productions);`
+#define STATIC_LL1_TABLE(productions) \
+    StaticLL1Table<staticNonTerminalCount(productions), sizeof(productions) / sizeof((productions)[0])>(productions)
+
+#endif //COMPILER_STATICGRAMMAR_H
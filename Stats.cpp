@@ -0,0 +1,166 @@
+//
+// Created by jens on 19/10/26.
+//
+
+#include <algorithm>
+#include <iomanip>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+#include <sys/resource.h>
+#include "Stats.h"
+
+namespace {
+    std::mutex retiredMutex;
+    Stats::Counters retired;        // the counters of the threads that ended
+    thread_local Stats::Scope *innermost = nullptr;
+    thread_local std::uint64_t lexScopes = 0;
+
+    std::string tokenTypeName(int type) {
+        auto name = Token::tokenName.find((Token::TokenType) type);
+        return name == Token::tokenName.end() ? std::to_string(type) : name->second;
+    }
+
+    /**
+     * the token types that occurred, most frequent first
+     */
+    std::vector<std::pair<int, std::uint64_t>> tokensByCount(const Stats::Counters &counters) {
+        std::vector<std::pair<int, std::uint64_t>> tokens;
+        for (int type = 0; type < Token::TOKEN_TYPE_COUNT; type++) {
+            if (counters.tokens[type] != 0) tokens.emplace_back(type, counters.tokens[type]);
+        }
+        std::stable_sort(tokens.begin(), tokens.end(),
+                         [](const auto &a, const auto &b) { return a.second > b.second; });
+        return tokens;
+    }
+}
+
+thread_local Stats::Local Stats::threadLocal;
+
+void Stats::Counters::merge(const Counters &other) {
+    bytesRead += other.bytesRead;
+    refills += other.refills;
+    for (int type = 0; type < Token::TOKEN_TYPE_COUNT; type++) tokens[type] += other.tokens[type];
+    lookups += other.lookups;
+    interned += other.interned;
+    probes += other.probes;
+    longestProbe = std::max(longestProbe, other.longestProbe);
+    firstIterations += other.firstIterations;
+    followIterations += other.followIterations;
+    predictions += other.predictions;
+    expansions += other.expansions;
+    peakStackDepth = std::max(peakStackDepth, other.peakStackDepth);
+    for (int phase = 0; phase < PHASE_COUNT; phase++) {
+        nanoseconds[phase] += other.nanoseconds[phase];
+        peakRssKb[phase] = std::max(peakRssKb[phase], other.peakRssKb[phase]);
+    }
+}
+
+Stats::Scope::Scope(Phase phase) : phase(phase), outer(innermost), begin(std::chrono::steady_clock::now()) {
+    innermost = this;
+}
+
+/**
+ * charges the time since construction less the nested scopes to the phase, and all of it to the enclosing scope as
+ * nested time, so the phases add up to the wall time
+ */
+Stats::Scope::~Scope() {
+    auto elapsed = (std::uint64_t) std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - begin).count();
+    Counters &counters = local();
+    counters.nanoseconds[phase] += elapsed - std::min(elapsed, nested);
+    if (outer) outer->nested += elapsed;
+    innermost = outer;
+    // a token is not worth a system call, lexing samples the peak on every RSS_PERIOD-th token
+    if (phase != LEX || lexScopes++ % RSS_PERIOD == 0) {
+        counters.peakRssKb[phase] = std::max(counters.peakRssKb[phase], peakRssKb());
+    }
+}
+
+Stats::Local::~Local() {
+    std::lock_guard<std::mutex> lock(retiredMutex);
+    retired.merge(counters);
+}
+
+/**
+ * the totals of the threads that ended and of the calling thread
+ */
+Stats::Counters Stats::collect() {
+    std::lock_guard<std::mutex> lock(retiredMutex);
+    Counters total = retired;
+    total.merge(local());
+    return total;
+}
+
+/**
+ * forgets the totals and the counters of the calling thread, other threads keep theirs until they end
+ */
+void Stats::reset() {
+    std::lock_guard<std::mutex> lock(retiredMutex);
+    retired = Counters();
+    local() = Counters();
+}
+
+/**
+ * the high-water mark of the resident set of the process so far
+ */
+std::uint64_t Stats::peakRssKb() {
+    rusage usage{};
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+#ifdef __APPLE__
+    return (std::uint64_t) usage.ru_maxrss / 1024;     // bytes there, kilobytes on Linux
+#else
+    return (std::uint64_t) usage.ru_maxrss;
+#endif
+}
+
+const char *Stats::phaseName(Phase phase) {
+    static const char *const names[PHASE_COUNT] = {"load", "lex", "analysis", "parse"};
+    return names[phase];
+}
+
+void Stats::print(std::ostream &out, const Counters &counters) {
+    std::uint64_t tokens = 0;
+    for (std::uint64_t count: counters.tokens) tokens += count;
+    out << std::left << std::setw(10) << "phase" << std::right << std::setw(12) << "time ms" << std::setw(16)
+        << "peak RSS KB" << "\n";
+    for (int phase = 0; phase < PHASE_COUNT; phase++) {
+        out << std::left << std::setw(10) << phaseName((Phase) phase) << std::right << std::setw(12) << std::fixed
+            << std::setprecision(3) << (double) counters.nanoseconds[phase] / 1e6 << std::setw(16)
+            << counters.peakRssKb[phase] << "\n";
+    }
+    out << "input: " << counters.bytesRead << " bytes read, " << counters.refills << " refills\n"
+        << "lexer: " << tokens << " tokens";
+    for (const auto &[type, count]: tokensByCount(counters)) out << ", " << tokenTypeName(type) << " " << count;
+    out << "\nsymbol table: " << counters.lookups << " lookups, " << counters.interned << " interned, mean probe "
+        << std::setprecision(2) << (counters.lookups == 0 ? 0.0 : (double) counters.probes / (double) counters.lookups)
+        << ", longest probe " << counters.longestProbe << "\n"
+        << "analysis: " << counters.firstIterations << " FIRST iterations, " << counters.followIterations
+        << " FOLLOW iterations\n"
+        << "parser: " << counters.predictions << " predictions, " << counters.expansions << " expansions, "
+        << "peak stack depth " << counters.peakStackDepth << "\n";
+    out.flush();
+}
+
+void Stats::printJson(std::ostream &out, const Counters &counters) {
+    out << "{\n  \"phases\": {";
+    for (int phase = 0; phase < PHASE_COUNT; phase++) {
+        out << (phase == 0 ? "\n" : ",\n") << "    \"" << phaseName((Phase) phase) << "\": {\"nanoseconds\": "
+            << counters.nanoseconds[phase] << ", \"peakRssKb\": " << counters.peakRssKb[phase] << "}";
+    }
+    out << "\n  },\n  \"input\": {\"bytesRead\": " << counters.bytesRead << ", \"refills\": " << counters.refills
+        << "},\n  \"tokens\": {";
+    bool first = true;
+    for (const auto &[type, count]: tokensByCount(counters)) {
+        out << (first ? "" : ", ") << "\"" << tokenTypeName(type) << "\": " << count;
+        first = false;
+    }
+    out << "},\n  \"symbolTable\": {\"lookups\": " << counters.lookups << ", \"interned\": " << counters.interned
+        << ", \"probes\": " << counters.probes << ", \"longestProbe\": " << counters.longestProbe
+        << "},\n  \"analysis\": {\"firstIterations\": " << counters.firstIterations << ", \"followIterations\": "
+        << counters.followIterations << "},\n  \"parser\": {\"predictions\": " << counters.predictions
+        << ", \"expansions\": " << counters.expansions << ", \"peakStackDepth\": " << counters.peakStackDepth
+        << "}\n}\n";
+    out.flush();
+}
@@ -0,0 +1,110 @@
+//
+// Created by jens on 19/10/26.
+//
+
+#ifndef COMPILER_STATS_H
+#define COMPILER_STATS_H
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include "Token.h"
+
+// the counters are compiled in with -DCOMPILER_STATS=1 (cmake -DCOMPILER_STATS=ON), without it the STATS_ macros
+// generate no code and the phases run as if they did not exist
+#ifndef COMPILER_STATS
+#define COMPILER_STATS 0
+#endif
+
+// adds n to a counter of the calling thread
+#define STATS_ADD(counter, n) do { \
+    if constexpr (COMPILER_STATS) Stats::local().counter += (n); \
+} while (false)
+
+// raises a counter of the calling thread to at least value
+#define STATS_MAX(counter, value) do { \
+    if constexpr (COMPILER_STATS) { \
+        Stats::Counters &statsCounters = Stats::local(); \
+        if ((std::uint64_t) (value) > statsCounters.counter) statsCounters.counter = (std::uint64_t) (value); \
+    } \
+} while (false)
+
+// charges the time up to the end of the enclosing block to a phase, less the phases nested in it
+#if COMPILER_STATS
+#define STATS_PHASE(phase) Stats::Scope statsScope(Stats::phase)
+#else
+#define STATS_PHASE(phase) do {} while (false)
+#endif
+
+/**
+ * Counts what every phase of the front end did, for a report after a compilation (compiler --stats).
+ *
+ * Each thread counts into counters of its own, without locks or atomics; they are added to the totals when the
+ * thread ends, so collect() after the workers are joined sees all of them. Times are exclusive: a phase that runs
+ * inside another (loading inside lexing) is not charged to the outer one.
+ */
+class Stats {
+public:
+    enum Phase {
+        LOAD, LEX, ANALYSIS, PARSE, PHASE_COUNT
+    };
+
+    struct Counters {
+        std::uint64_t bytesRead = 0;            // InputBuffer
+        std::uint64_t refills = 0;
+        std::array<std::uint64_t, Token::TOKEN_TYPE_COUNT> tokens{};     // Lexer, by Token::TokenType
+        std::uint64_t lookups = 0;              // SymbolTable
+        std::uint64_t interned = 0;
+        std::uint64_t probes = 0;               // entries compared, over all lookups
+        std::uint64_t longestProbe = 0;
+        std::uint64_t firstIterations = 0;      // ContextFreeGrammar, passes until the sets stop changing
+        std::uint64_t followIterations = 0;
+        std::uint64_t predictions = 0;          // Parser, table lookups
+        std::uint64_t expansions = 0;
+        std::uint64_t peakStackDepth = 0;
+        std::array<std::uint64_t, PHASE_COUNT> nanoseconds{};
+        std::array<std::uint64_t, PHASE_COUNT> peakRssKb{};     // of the process, when the phase last ended
+
+        void merge(const Counters &other);
+    };
+
+    /**
+     * times the phase from construction to destruction, see STATS_PHASE
+     */
+    class Scope {
+        static constexpr std::uint64_t RSS_PERIOD = 4096;
+
+        Phase phase;
+        Scope *outer;
+        std::chrono::steady_clock::time_point begin;
+        std::uint64_t nested = 0;       // nanoseconds of the scopes inside this one
+
+    public:
+        explicit Scope(Phase phase);
+        ~Scope();
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+    };
+
+private:
+    struct Local {
+        Counters counters;
+        ~Local();                       // adds the counters to the totals when the thread ends
+    };
+
+    static thread_local Local threadLocal;
+
+public:
+    static Counters &local() { return threadLocal.counters; }
+
+    static Counters collect();
+    static void reset();
+    static std::uint64_t peakRssKb();
+    static const char *phaseName(Phase phase);
+    static void print(std::ostream &out, const Counters &counters);
+    static void printJson(std::ostream &out, const Counters &counters);
+};
+
+
+#endif //COMPILER_STATS_H
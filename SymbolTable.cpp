@@ -3,6 +3,7 @@
 //
 
 #include "SymbolTable.h"
+#include "Stats.h"
 
 //int SymbolTable::add(const SymbolTableEntry &entry) {
 //    table.push_back(entry);
@@ -17,10 +18,17 @@ int SymbolTable::addSymbol(const std::string &symbol) {
     int i = 0;
     // this function is O(|table| * |symbol|)
     // for each adding of identifier
+    STATS_ADD(lookups, 1);
     for (; i < table.size(); i++) {
-        if (table.at(i).name == symbol)
+        if (table.at(i).name == symbol) {
+            STATS_ADD(probes, i + 1);
+            STATS_MAX(longestProbe, i + 1);
             return i;
+        }
     }
+    STATS_ADD(probes, table.size());
+    STATS_MAX(longestProbe, table.size());
+    STATS_ADD(interned, 1);
     table.emplace_back(symbol);
     // otherwise add
     return table.size() - 1;
@@ -0,0 +1,628 @@
+//
+// Created by jens on 19/10/26.
+//
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <unordered_map>
+#include "ContextFreeGrammar.h"
+#include "Lexer.h"
+#include "SyntheticCorpus.h"
+
+namespace {
+    const std::size_t BLOCK = 1 << 16;  // bytes collected before they are written out
+
+    const char *const NAME_STEMS[] = {"count", "index", "value", "node", "buffer", "item", "total", "offset", "size",
+                                      "result", "parent", "child", "key", "entry", "state", "limit"};
+    const char *const COMMENT_WORDS[] = {"the", "value", "is", "updated", "before", "each", "call", "returns", "when",
+                                         "cache", "empty", "and", "otherwise", "first", "entry", "of", "list", "next"};
+    const char *const TYPES[] = {"int", "long", "float", "double", "boolean", "char"};
+    const char *const BINARY_OPERATORS[] = {"+", "-", "*", "/", "%", "&", "|", "^", "<<", ">>"};
+    const char *const COMPARISONS[] = {"<", ">", "<=", ">=", "==", "!="};
+    const char *const ASSIGNMENTS[] = {"=", "+=", "-=", "*=", "/=", "%=", "&=", "|=", "^=", "<<=", ">>="};
+    const char *const CHARACTERS[] = {"a", "z", "0", "_", " ", "\\n", "\\t", "\\'", "\\\\", "\\\""};
+    const char *const LEXICAL_ERRORS[] = {"#", "`", "1e+", "3."};   // each followed by a space
+
+    template<typename Element, std::size_t N>
+    constexpr unsigned countOf(Element (&)[N]) { return (unsigned) N; }
+
+    /**
+     * how a terminal is written, empty for those the lexer has no spelling of (FOR is lexed as an identifier)
+     */
+    std::string spellingOf(int terminal) {
+        static const std::unordered_map<int, std::string> OPERATORS = {
+                {Token::PLUS, "+"}, {Token::MINUS, "-"}, {Token::STAR, "*"}, {Token::SLASH, "/"},
+                {Token::PERCENT, "%"}, {Token::CARET, "^"}, {Token::TILDE, "~"}, {Token::AMPERSAND, "&"},
+                {Token::PIPE, "|"}, {Token::EQUALS, "=="}, {Token::NOT_EQUALS, "!="}, {Token::LESS_THAN, "<"},
+                {Token::GREATER_THAN, ">"}, {Token::LESS_THAN_OR_EQUAL, "<="}, {Token::GREATER_THAN_OR_EQUAL, ">="},
+                {Token::LOGICAL_AND, "&&"}, {Token::LOGICAL_OR, "||"}, {Token::LOGICAL_NOT, "!"},
+                {Token::ASSIGNMENT, "="}, {Token::PLUS_ASSIGNMENT, "+="}, {Token::MINUS_ASSIGNMENT, "-="},
+                {Token::STAR_ASSIGNMENT, "*="}, {Token::SLASH_ASSIGNMENT, "/="}, {Token::PERCENT_ASSIGNMENT, "%="},
+                {Token::CARET_ASSIGNMENT, "^="}, {Token::AMPERSAND_ASSIGNMENT, "&="}, {Token::PIPE_ASSIGNMENT, "|="},
+                {Token::LEFT_SHIFT, "<<"}, {Token::RIGHT_SHIFT, ">>"}, {Token::LEFT_SHIFT_ASSIGNMENT, "<<="},
+                {Token::RIGHT_SHIFT_ASSIGNMENT, ">>="}, {Token::INCREMENT, "++"}, {Token::DECREMENT, "--"},
+                {Token::RIGHT_ARROW, "->"}, {Token::SEMICOLON, ";"}, {Token::COMMA, ","}, {Token::DOT, "."},
+                {Token::LEFT_PAREN, "("}, {Token::RIGHT_PAREN, ")"}, {Token::LEFT_BRACE, "{"},
+                {Token::RIGHT_BRACE, "}"}, {Token::LEFT_BRACKET, "["}, {Token::RIGHT_BRACKET, "]"}, {Token::AT, "@"}
+        };
+        auto op = OPERATORS.find(terminal);
+        if (op != OPERATORS.end()) return op->second;
+        if (terminal == Token::BOOL_LITERAL) return "";
+        for (const auto &keyword: Lexer::KEYWORDS) {
+            if (keyword.second == terminal) return keyword.first;
+        }
+        return "";
+    }
+
+    bool isLiteral(int terminal) {
+        return terminal == Token::IDENTIFIER || terminal == Token::INTEGER_LITERAL || terminal == Token::FLOAT_LITERAL
+               || terminal == Token::CHAR_LITERAL || terminal == Token::STRING_LITERAL
+               || terminal == Token::BOOL_LITERAL;
+    }
+}
+
+SyntheticCorpus::SyntheticCorpus(std::ostream &out, const Options &options)
+        : out(out), options(options), rng(options.seed) {
+    if (options.identifiers == 0) throw std::invalid_argument("at least one identifier is needed");
+    const unsigned stems = countOf(NAME_STEMS);
+    for (unsigned i = 0; i < options.identifiers; i++) {
+        names.push_back(NAME_STEMS[i % stems] + (i < stems ? "" : std::to_string(i / stems)));
+    }
+    buffer.reserve(BLOCK + 4096);
+}
+
+// ------------------------------------------ output ------------------------------------------
+
+bool SyntheticCorpus::chance(double probability) {
+    return (double) rng() < probability * 4294967296.0;
+}
+
+unsigned SyntheticCorpus::below(unsigned bound) {
+    return rng() % bound;
+}
+
+bool SyntheticCorpus::full() const {
+    return summary.bytes >= options.bytes;
+}
+
+/**
+ * appends text that does not end the line, indented if it starts one
+ */
+void SyntheticCorpus::put(const std::string &text) {
+    if (column == 0 && indent > 0) {
+        buffer.append(indent, ' ');
+        column = indent;
+        summary.bytes += indent;
+    }
+    buffer += text;
+    column += (unsigned) text.size();
+    summary.bytes += text.size();
+}
+
+void SyntheticCorpus::endLine() {
+    buffer += '\n';
+    summary.bytes++;
+    summary.lines++;
+    column = 0;
+    attach = false;
+    if (buffer.size() >= BLOCK) flush();
+}
+
+/**
+ * ends a line of code; the next one may get an error, and a comment may follow
+ */
+void SyntheticCorpus::newLine() {
+    endLine();
+    if (options.errorRate > 0 && chance(options.errorRate)) errorPending = true;
+    if (options.commentDensity > 0 && chance(options.commentDensity)) comment();
+}
+
+/**
+ * writes a token, after a space unless it is attached to the one before, and breaks the line before it when it would
+ * not fit
+ */
+void SyntheticCorpus::token(const std::string &text, bool space) {
+    if (column > indent && column + 1 + text.size() > options.lineLength) newLine();
+    if (errorPending) injectError();
+    if (column > indent && space && !attach) put(" ");
+    put(text);
+    attach = false;
+}
+
+/**
+ * a token the next one is attached to, e.g. ( or .
+ */
+void SyntheticCorpus::opening(const std::string &text, bool space) {
+    token(text, space);
+    attach = true;
+}
+
+void SyntheticCorpus::flush() {
+    out.write(buffer.data(), (std::streamsize) buffer.size());
+    buffer.clear();
+}
+
+void SyntheticCorpus::comment() {
+    unsigned width = std::max(options.lineLength, indent + 20) - indent;
+    auto words = [&](const std::string &prefix) {
+        std::string text = prefix;
+        unsigned length = 20 + below(width - 19);
+        while (text.size() < length) {
+            text += " ";
+            text += COMMENT_WORDS[below(countOf(COMMENT_WORDS))];
+        }
+        return text;
+    };
+    if (below(4) != 0) {
+        put(words("//"));
+        endLine();
+        return;
+    }
+    put("/**");
+    endLine();
+    for (unsigned lines = 1 + below(3); lines > 0; lines--) {
+        put(words(" *"));
+        endLine();
+    }
+    put(" */");
+    endLine();
+}
+
+void SyntheticCorpus::injectError() {
+    errorPending = false;
+    bool lexical = options.lexicalErrors && (!options.syntaxErrors || below(2) == 0);
+    if (!lexical && !options.syntaxErrors) return;
+    if (summary.firstErrorLine == 0) summary.firstErrorLine = summary.lines + 1;
+    if (lexical) {
+        summary.lexicalErrors++;
+        put(std::string(column > indent ? " " : "") + LEXICAL_ERRORS[below(countOf(LEXICAL_ERRORS))] + " ");
+        return;
+    }
+    summary.syntaxErrors++;
+    // an unmatched ) in the Java template, a terminal the grammar never uses in a sentence
+    std::string wrong = foreign.empty() ? ")" : foreign[below((unsigned) foreign.size())];
+    put(std::string(column > indent ? " " : "") + wrong + " ");
+}
+
+// ------------------------------------------ lexemes ------------------------------------------
+
+const std::string &SyntheticCorpus::identifier() {
+    return names[below((unsigned) names.size())];
+}
+
+std::string SyntheticCorpus::literal(int tokenType) {
+    switch (tokenType) {
+        case Token::INTEGER_LITERAL:
+            return std::to_string(below(8) == 0 ? rng() : below(1000));
+        case Token::FLOAT_LITERAL: {
+            std::string text = std::to_string(below(1000)) + "." + std::to_string(below(100));
+            if (below(4) == 0) text += (below(2) == 0 ? "e" : "e-") + std::to_string(1 + below(30));
+            return text;
+        }
+        case Token::CHAR_LITERAL:
+            return std::string("'") + CHARACTERS[below(countOf(CHARACTERS))] + "'";
+        case Token::STRING_LITERAL: {
+            std::string text = "\"";
+            for (unsigned words = 1 + below(6); words > 0; words--) {
+                if (text.size() > 1) text += below(8) == 0 ? "\\t" : " ";
+                text += COMMENT_WORDS[below(countOf(COMMENT_WORDS))];
+            }
+            if (below(4) == 0) text += "\\n";
+            return text + "\"";
+        }
+        case Token::BOOL_LITERAL:
+            return below(2) == 0 ? "true" : "false";
+        case Token::IDENTIFIER:
+            return identifier();
+        default:
+            throw std::runtime_error("terminal " + Token::tokenTypeAsString((Token::TokenType) tokenType)
+                                     + " cannot be written");
+    }
+}
+
+/**
+ * a literal of a kind drawn by the weights of the literal mix
+ */
+std::string SyntheticCorpus::anyLiteral() {
+    const LiteralMix &mix = options.literals;
+    const unsigned weights[] = {mix.integer, mix.floating, mix.character, mix.string, mix.boolean};
+    const int kinds[] = {Token::INTEGER_LITERAL, Token::FLOAT_LITERAL, Token::CHAR_LITERAL, Token::STRING_LITERAL,
+                         Token::BOOL_LITERAL};
+    unsigned total = 0;
+    for (unsigned weight: weights) total += weight;
+    if (total == 0) return literal(Token::INTEGER_LITERAL);
+    unsigned pick = below(total);
+    int kind = 0;
+    while (pick >= weights[kind]) pick -= weights[kind++];
+    return literal(kinds[kind]);
+}
+
+// ------------------------------------------ Java template ------------------------------------------
+
+void SyntheticCorpus::operand(unsigned depth) {
+    switch (below(8)) {
+        case 0:
+            if (depth < options.maxDepth) {
+                opening("(");
+                expression(depth + 1);
+                token(")", false);
+                return;
+            }
+            token(anyLiteral());
+            return;
+        case 1:
+            token(identifier());
+            opening("(", false);
+            if (depth < options.maxDepth && below(2) == 0) expression(depth + 1);
+            token(")", false);
+            return;
+        case 2:
+            token(identifier());
+            opening("[", false);
+            token(identifier());
+            token("]", false);
+            return;
+        case 3:
+        case 4:
+        case 5:
+            token(identifier());
+            return;
+        default:
+            token(anyLiteral());
+    }
+}
+
+void SyntheticCorpus::expression(unsigned depth) {
+    operand(depth);
+    for (unsigned operands = below(4); operands > 0; operands--) {
+        token(BINARY_OPERATORS[below(countOf(BINARY_OPERATORS))]);
+        operand(depth);
+    }
+}
+
+void SyntheticCorpus::condition() {
+    expression(0);
+    token(COMPARISONS[below(countOf(COMPARISONS))]);
+    expression(0);
+    if (below(4) == 0) {
+        token(below(2) == 0 ? "&&" : "||");
+        expression(0);
+        token(COMPARISONS[below(countOf(COMPARISONS))]);
+        expression(0);
+    }
+}
+
+void SyntheticCorpus::statement(unsigned depth) {
+    unsigned kind = below(10);
+    if (kind >= 7 && depth >= options.maxDepth) kind = 0;
+    switch (kind) {
+        case 0:
+        case 1:
+        case 2:
+            token(TYPES[below(countOf(TYPES))]);
+            token(identifier());
+            token("=");
+            expression(0);
+            break;
+        case 3:
+        case 4:
+            token(identifier());
+            token(ASSIGNMENTS[below(countOf(ASSIGNMENTS))]);
+            expression(0);
+            break;
+        case 5:
+            token(identifier());
+            opening(".", false);
+            token(identifier());
+            opening("(", false);
+            for (unsigned arguments = below(4), i = 0; i < arguments; i++) {
+                if (i > 0) token(",", false);
+                expression(0);
+            }
+            token(")", false);
+            break;
+        case 6:
+            token(identifier());
+            token(below(2) == 0 ? "++" : "--", false);
+            break;
+        case 7:
+        case 8:
+            token(kind == 7 ? "if" : "while");
+            opening("(");
+            condition();
+            token(")", false);
+            block(depth + 1);
+            if (kind == 7 && below(3) == 0) {
+                token("else");
+                block(depth + 1);
+            }
+            newLine();
+            return;
+        default:
+            token("return");
+            expression(0);
+            break;
+    }
+    token(";", false);
+    newLine();
+}
+
+/**
+ * { statements } without the line end after }, so that an else can follow
+ */
+void SyntheticCorpus::block(unsigned depth) {
+    token("{");
+    indent += 4;
+    newLine();
+    for (unsigned statements = 1 + below(5); statements > 0; statements--) statement(depth);
+    indent -= 4;
+    token("}");
+}
+
+void SyntheticCorpus::method() {
+    token(below(2) == 0 ? "public" : "private");
+    if (below(3) == 0) token("static");
+    token(below(4) == 0 ? "void" : TYPES[below(countOf(TYPES))]);
+    token(identifier());
+    opening("(", false);
+    for (unsigned parameters = below(4), i = 0; i < parameters; i++) {
+        if (i > 0) token(",", false);
+        token(TYPES[below(countOf(TYPES))]);
+        token(identifier());
+    }
+    token(")", false);
+    block(1);
+    newLine();
+    endLine();
+}
+
+void SyntheticCorpus::javaClass() {
+    token("public");
+    token("class");
+    token(identifier());
+    if (below(3) == 0) {
+        token("extends");
+        token(identifier());
+    }
+    token("{");
+    indent += 4;
+    newLine();
+    for (unsigned fields = below(4); fields > 0; fields--) {
+        token("private");
+        if (below(2) == 0) {
+            token("static");
+            token("final");
+        }
+        token(TYPES[below(countOf(TYPES))]);
+        token(identifier());
+        token("=");
+        token(anyLiteral());
+        token(";", false);
+        newLine();
+    }
+    endLine();
+    do {
+        method();
+    } while (!full() && below(8) != 0);
+    indent -= 4;
+    token("}");
+    newLine();
+    endLine();
+}
+
+/**
+ * classes of fields and methods until the size is reached, with a package and imports at the top
+ */
+SyntheticCorpus::Summary SyntheticCorpus::writeJava() {
+    token("package");
+    token(identifier());
+    opening(".", false);
+    token(identifier());
+    token(";", false);
+    newLine();
+    endLine();
+    for (unsigned imports = 1 + below(4); imports > 0; imports--) {
+        token("import");
+        token(identifier());
+        opening(".", false);
+        token(identifier());
+        token(";", false);
+        newLine();
+    }
+    endLine();
+    while (!full()) javaClass();
+    flush();
+    out.flush();
+    return summary;
+}
+
+// ------------------------------------------ grammar sentences ------------------------------------------
+
+/**
+ * one random sentence of the grammar. A symbol that ends a body keeps the depth of its head, so a list written as
+ * right recursion is not nesting. At the top level the list goes on until the size is reached; below maxDepth, or
+ * once the size is reached, every non-terminal takes the production that ends its derivation soonest.
+ */
+SyntheticCorpus::Summary SyntheticCorpus::writeSentences(const CompiledGrammar &grammar) {
+    const int T = Token::TOKEN_TYPE_COUNT;
+    const int N = (int) grammar.getNonTerminals().size();
+    const int P = (int) grammar.getProductions().size();
+    std::vector<bool> used(T, false);
+    for (int p = 0; p < P; p++) {
+        for (std::int32_t symbol: grammar.getBody(p)) {
+            if (CompiledGrammar::isTerminal(symbol)) used[symbol] = true;
+        }
+    }
+    foreign.clear();
+    for (int t = 0; t < T; t++) {
+        std::string spelling = spellingOf(t);
+        if (!used[t] && !spelling.empty()) foreign.push_back(spelling);
+    }
+    if (options.syntaxErrors && options.errorRate > 0 && foreign.empty()) {
+        throw std::runtime_error("the grammar uses every terminal, no syntax error can be injected");
+    }
+
+    // the height of the shortest derivation of every non-terminal, and the production it starts with
+    const int UNREACHED = INT32_MAX;
+    std::vector<int> height(N, UNREACHED), shortest(N, -1);
+    for (bool changed = true; changed;) {
+        changed = false;
+        for (int p = 0; p < P; p++) {
+            int h = 1;
+            for (std::int32_t symbol: grammar.getBody(p)) {
+                if (CompiledGrammar::isTerminal(symbol)) continue;
+                h = height[symbol - T] == UNREACHED ? UNREACHED : std::max(h, height[symbol - T] + 1);
+                if (h == UNREACHED) break;
+            }
+            int head = grammar.getHead(p) - T;
+            if (h < height[head]) {
+                height[head] = h;
+                shortest[head] = p;
+                changed = true;
+            }
+        }
+    }
+    if (shortest[grammar.getStart() - T] < 0) throw std::runtime_error("the start symbol derives no sentence");
+
+    // the productions to choose from, those whose non-terminals all derive a sentence
+    std::vector<std::vector<int>> productionsOf(N);
+    for (int p = 0; p < P; p++) {
+        const std::vector<std::int32_t> &body = grammar.getBody(p);
+        bool finite = std::all_of(body.begin(), body.end(), [&](std::int32_t symbol) {
+            return CompiledGrammar::isTerminal(symbol) || height[symbol - T] != UNREACHED;
+        });
+        if (finite) productionsOf[grammar.getHead(p) - T].push_back(p);
+    }
+
+    std::vector<std::pair<std::int32_t, unsigned>> pending{{grammar.getStart(), 0}};   // (symbol, depth)
+    while (!pending.empty()) {
+        auto [symbol, depth] = pending.back();
+        pending.pop_back();
+        if (CompiledGrammar::isTerminal(symbol)) {
+            std::string spelling = isLiteral(symbol) ? literal(symbol) : spellingOf(symbol);
+            if (spelling.empty()) {
+                throw std::runtime_error("terminal " + Token::tokenTypeAsString((Token::TokenType) symbol)
+                                         + " cannot be written");
+            }
+            token(spelling);
+            continue;
+        }
+        const std::vector<int> &alternatives = productionsOf[symbol - T];
+        int production = shortest[symbol - T];
+        if (!full() && depth < options.maxDepth) {
+            if (depth == 0 && alternatives.size() > 1) {
+                // any but the shortest, so the top-level list does not end before the size is reached
+                production = alternatives[below((unsigned) alternatives.size() - 1)];
+                if (production == shortest[symbol - T]) production = alternatives.back();
+            } else {
+                production = alternatives[below((unsigned) alternatives.size())];
+            }
+        }
+        const std::vector<std::int32_t> &body = grammar.getBody(production);
+        for (std::size_t i = body.size(); i-- > 0;) {
+            pending.emplace_back(body[i], i + 1 == body.size() ? depth : depth + 1);
+        }
+    }
+    newLine();
+    flush();
+    out.flush();
+    return summary;
+}
+
+// ------------------------------------------ command line ------------------------------------------
+
+/**
+ * compiler --generate java|grammar [options], see the README; writes to standard output unless --output is given
+ */
+int SyntheticCorpus::main(const std::vector<std::string> &arguments, const std::vector<Production> &productions) {
+    Options options;
+    std::string mode;
+    std::string output;
+    try {
+        auto size = [](const std::string &text) {
+            std::size_t end;
+            std::uint64_t value = std::stoull(text, &end);
+            std::string unit = text.substr(end);
+            if (unit == "k" || unit == "K") return value << 10;
+            if (unit == "m" || unit == "M") return value << 20;
+            if (unit == "g" || unit == "G") return value << 30;
+            if (!unit.empty()) throw std::invalid_argument("unknown unit " + unit);
+            return value;
+        };
+        for (std::size_t i = 0; i < arguments.size(); i++) {
+            const std::string &argument = arguments[i];
+            bool hasValue = i + 1 < arguments.size();
+            if (argument == "--bytes" && hasValue) {
+                options.bytes = size(arguments[++i]);
+            } else if (argument == "--seed" && hasValue) {
+                options.seed = (unsigned) std::stoul(arguments[++i]);
+            } else if (argument == "--identifiers" && hasValue) {
+                options.identifiers = (unsigned) std::stoul(arguments[++i]);
+            } else if (argument == "--comments" && hasValue) {
+                options.commentDensity = std::stod(arguments[++i]);
+            } else if (argument == "--literals" && hasValue) {
+                // integer,float,char,string,boolean
+                unsigned *weights[] = {&options.literals.integer, &options.literals.floating,
+                                       &options.literals.character, &options.literals.string,
+                                       &options.literals.boolean};
+                std::string list = arguments[++i] + ",";
+                std::size_t from = 0;
+                for (unsigned *weight: weights) {
+                    std::size_t comma = list.find(',', from);
+                    if (comma == std::string::npos) throw std::invalid_argument("--literals takes five weights");
+                    *weight = (unsigned) std::stoul(list.substr(from, comma - from));
+                    from = comma + 1;
+                }
+                if (from != list.size()) throw std::invalid_argument("--literals takes five weights");
+            } else if (argument == "--depth" && hasValue) {
+                options.maxDepth = (unsigned) std::stoul(arguments[++i]);
+            } else if (argument == "--line" && hasValue) {
+                options.lineLength = (unsigned) std::stoul(arguments[++i]);
+            } else if (argument == "--errors" && hasValue) {
+                options.errorRate = std::stod(arguments[++i]);
+            } else if (argument == "--error-kinds" && hasValue) {
+                const std::string &kinds = arguments[++i];
+                if (kinds != "lexical" && kinds != "syntax" && kinds != "both") {
+                    throw std::invalid_argument("unknown error kinds " + kinds);
+                }
+                options.lexicalErrors = kinds != "syntax";
+                options.syntaxErrors = kinds != "lexical";
+            } else if (argument == "--output" && hasValue) {
+                output = arguments[++i];
+            } else if (mode.empty() && (argument == "java" || argument == "grammar")) {
+                mode = argument;
+            } else {
+                throw std::invalid_argument("unknown argument " + argument);
+            }
+        }
+        if (mode.empty()) throw std::invalid_argument("java or grammar expected");
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << std::endl
+                  << "usage: compiler --generate java|grammar [--bytes n[k|m|g]] [--seed n] [--identifiers n] "
+                     "[--comments p] [--literals i,f,c,s,b] [--depth n] [--line n] [--errors p] "
+                     "[--error-kinds lexical|syntax|both] [--output file]" << std::endl;
+        return 2;
+    }
+
+    std::ofstream file;
+    if (!output.empty()) {
+        file.open(output, std::ios::out | std::ios::trunc | std::ios::binary);
+        if (!file) {
+            std::cerr << "cannot write " << output << std::endl;
+            return 2;
+        }
+    }
+    SyntheticCorpus corpus(output.empty() ? std::cout : file, options);
+    Summary summary;
+    if (mode == "java") {
+        summary = corpus.writeJava();
+    } else {
+        ContextFreeGrammar grammar(productions);
+        summary = corpus.writeSentences(CompiledGrammar(grammar));
+    }
+    std::cerr << summary.bytes << " bytes, " << summary.lines << " lines, " << summary.lexicalErrors
+              << " lexical and " << summary.syntaxErrors << " syntax errors" << std::endl;
+    return 0;
+}
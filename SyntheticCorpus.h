@@ -0,0 +1,100 @@
+//
+// Created by jens on 19/10/26.
+//
+
+#ifndef COMPILER_SYNTHETICCORPUS_H
+#define COMPILER_SYNTHETICCORPUS_H
+
+#include <cstdint>
+#include <ostream>
+#include <random>
+#include <string>
+#include <vector>
+#include "CompiledGrammar.h"
+#include "Production.h"
+
+/**
+ * Writes large generated inputs, from a kilobyte to gigabytes, for scaling and stress tests: Java-like classes from
+ * a template of the language subset the lexer knows, or sentences of any grammar (e.g. grammar_def.h) derived at
+ * random. The output is streamed, so its size is not bounded by memory, and it depends only on the options: the
+ * same seed gives the same bytes on every platform.
+ *
+ * Errors are injected at a given rate per line: a lexical error is a character or a number the lexer rejects, a
+ * syntax error in a grammar sentence is a terminal the grammar never uses, so both are always detected. The Java
+ * template drops or doubles a token instead, which only a Java parser can tell.
+ */
+class SyntheticCorpus {
+public:
+    struct LiteralMix {         // relative weights of the literal kinds in the Java template
+        unsigned integer = 4;
+        unsigned floating = 2;
+        unsigned character = 1;
+        unsigned string = 2;
+        unsigned boolean = 1;
+    };
+
+    struct Options {
+        std::uint64_t bytes = 1 << 20;  // ends after the method, or top-level list item, that reaches this size
+        unsigned seed = 42;
+        unsigned identifiers = 1000;    // distinct identifiers, used with equal frequency
+        double commentDensity = 0.1;    // chance of a comment after a line of code
+        LiteralMix literals;
+        unsigned maxDepth = 6;          // nested blocks, and parentheses; in a grammar, nested non-terminals
+        unsigned lineLength = 100;      // longer lines are broken after a token
+        double errorRate = 0;           // injected errors per line
+        bool lexicalErrors = true;
+        bool syntaxErrors = true;
+    };
+
+    struct Summary {
+        std::uint64_t bytes = 0;
+        std::uint64_t lines = 0;
+        std::uint64_t lexicalErrors = 0;
+        std::uint64_t syntaxErrors = 0;
+        std::uint64_t firstErrorLine = 0;   // 1-based, 0 without errors
+    };
+
+private:
+    std::ostream &out;
+    Options options;
+    std::mt19937 rng;
+    std::string buffer;             // written to `out` in blocks
+    Summary summary;
+    unsigned column = 0;
+    unsigned indent = 0;
+    bool attach = false;            // the next token follows the last one without a space
+    bool errorPending = false;      // the next token gets an error before it
+    std::vector<std::string> names;
+    std::vector<std::string> foreign;   // terminals a grammar never uses, written as its syntax errors
+
+    [[nodiscard]] bool chance(double probability);
+    [[nodiscard]] unsigned below(unsigned bound);
+    [[nodiscard]] bool full() const;
+    void put(const std::string &text);
+    void endLine();
+    void newLine();
+    void token(const std::string &text, bool space = true);
+    void opening(const std::string &text, bool space = true);
+    void flush();
+    void comment();
+    void injectError();
+    [[nodiscard]] const std::string &identifier();
+    [[nodiscard]] std::string literal(int tokenType);
+    [[nodiscard]] std::string anyLiteral();
+    void operand(unsigned depth);
+    void expression(unsigned depth);
+    void condition();
+    void statement(unsigned depth);
+    void block(unsigned depth);
+    void method();
+    void javaClass();
+
+public:
+    SyntheticCorpus(std::ostream &out, const Options &options);
+    Summary writeJava();
+    Summary writeSentences(const CompiledGrammar &grammar);
+    static int main(const std::vector<std::string> &arguments, const std::vector<Production> &productions);
+};
+
+
+#endif //COMPILER_SYNTHETICCORPUS_H
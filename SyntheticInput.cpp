@@ -0,0 +1,59 @@
+//
+// Created by jens on 19/10/26.
+//
+
+#include <fstream>
+#include <random>
+#include "SyntheticInput.h"
+
+/**
+ * writes a random well-formed expression with the given number of operands, 16 operands to a line
+ */
+void SyntheticInput::writeExpression(const std::string &pathname, int operands, unsigned seed) {
+    std::mt19937 rng(seed);
+    std::ofstream fout(pathname, std::ios::out | std::ios::trunc);
+    const char *operators[] = {" + ", " - ", " * ", " / ", " % "};
+    int open = 0;
+    for (int i = 0; i < operands; i++) {
+        if (i > 0) fout << operators[rng() % 5];
+        if (rng() % 4 == 0) {
+            fout << "(";
+            open++;
+        }
+        switch (rng() % 3) {
+            case 0: fout << "a" << rng() % 100; break;
+            case 1: fout << rng() % 1000; break;
+            default: fout << rng() % 100 << ".5"; break;
+        }
+        if (open > 0 && rng() % 3 == 0) {
+            fout << ")";
+            open--;
+        }
+        if (i % 16 == 15) fout << "\n";
+    }
+    while (open-- > 0) fout << ")";
+    fout << "\n";
+}
+
+/**
+ * generates a chain of non-terminals <n0> ... <n(count-1)>, each predicting the next one on a few random terminals
+ * and having an epsilon production, which is the shape of the sparse rows a full Java grammar produces
+ */
+std::vector<Production> SyntheticInput::grammar(int count, int productionsPerNonTerminal, unsigned seed) {
+    std::mt19937 rng(seed);
+    std::vector<Production> productions;
+    for (int i = 0; i < count; i++) {
+        GrammarSymbol head = HEAD("<n" + std::to_string(i) + ">");
+        for (int j = 0; j < productionsPerNonTerminal; j++) {
+            auto t = (Token::TokenType) (rng() % Token::TokenType::END_OF_FILE);
+            if (i + 1 < count) {
+                GrammarSymbol next = NT("<n" + std::to_string(i + 1) + ">");
+                productions.emplace_back(head, std::vector<GrammarSymbol>{T(t), next});
+            } else {
+                productions.emplace_back(head, std::vector<GrammarSymbol>{T(t)});
+            }
+        }
+        productions.emplace_back(head, std::vector<GrammarSymbol>{GrammarSymbol::epsilon()});
+    }
+    return productions;
+}
@@ -0,0 +1,23 @@
+//
+// Created by jens on 19/10/26.
+//
+
+#ifndef COMPILER_SYNTHETICINPUT_H
+#define COMPILER_SYNTHETICINPUT_H
+
+#include <string>
+#include <vector>
+#include "Production.h"
+
+/**
+ * Generated inputs for the tests and benchmarks, the same for the same seed on every platform (std::mt19937 alone,
+ * no distribution whose output the standard library may choose)
+ */
+class SyntheticInput {
+public:
+    static void writeExpression(const std::string &pathname, int operands, unsigned seed);
+    static std::vector<Production> grammar(int count, int productionsPerNonTerminal, unsigned seed);
+};
+
+
+#endif //COMPILER_SYNTHETICINPUT_H
@@ -0,0 +1,66 @@
+//
+// Created by jens on 19/10/26.
+//
+
+#ifndef COMPILER_THREADPOOL_H
+#define COMPILER_THREADPOOL_H
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Fixed set of worker threads running submitted tasks from one shared queue.
+ *
+ * `wait()` blocks until every task submitted so far has run, so a phase of work is
+ * `submit()` ... `wait()`; `parallelFor` does exactly that over an index range cut into chunks.
+ */
+class ThreadPool {
+private:
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable available;     // a task was queued or the pool stops
+    std::condition_variable idle;          // the last pending task finished
+    std::size_t pending = 0;               // queued or running
+    bool stopping = false;
+
+    void work();
+
+public:
+    explicit ThreadPool(unsigned threads = std::thread::hardware_concurrency());
+    ~ThreadPool();
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    void submit(std::function<void()> task);
+    void wait();
+    [[nodiscard]] unsigned size() const;
+
+    /**
+     * runs body(begin, end) over [0, count) in chunks of at least `grain` indices and waits for all of them
+     */
+    template<typename F>
+    void parallelFor(std::size_t count, F body, std::size_t grain = 1) {
+        std::size_t chunks = std::max<std::size_t>(1, std::min(count / std::max<std::size_t>(grain, 1),
+                                                               (std::size_t) size() * 4));
+        std::size_t step = (count + chunks - 1) / chunks;
+        for (std::size_t begin = 0; begin < count; begin += step) {
+            std::size_t end = std::min(count, begin + step);
+            if (end == count) {
+                body(begin, end);   // the calling thread takes the last chunk
+            } else {
+                submit([&body, begin, end]() { body(begin, end); });
+            }
+        }
+        wait();
+    }
+};
+
+
+#endif //COMPILER_THREADPOOL_H
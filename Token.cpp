@@ -108,8 +108,8 @@ const std::unordered_map<Token::TokenType, std::string> Token::tokenName = {
         {Token::TokenType::GREATER_THAN,          ">"},
         {Token::TokenType::LESS_THAN_OR_EQUAL,    "<="},
         {Token::TokenType::GREATER_THAN_OR_EQUAL, ">="},
-        {Token::TokenType::LOGICAL_AND,           "&"},
-        {Token::TokenType::LOGICAL_OR,            "|"},
+        {Token::TokenType::LOGICAL_AND,           "&&"},
+        {Token::TokenType::LOGICAL_OR,            "||"},
         {Token::TokenType::LOGICAL_NOT,           "!"},
         {Token::TokenType::INCREMENT,             "++"},
         {Token::TokenType::DECREMENT,             "--"},
@@ -122,6 +122,11 @@ const std::unordered_map<Token::TokenType, std::string> Token::tokenName = {
         {Token::TokenType::CARET_ASSIGNMENT,      "^="},
         {Token::TokenType::AMPERSAND_ASSIGNMENT,  "&="},
         {Token::TokenType::PIPE_ASSIGNMENT,       "|="},
+        {Token::TokenType::LEFT_SHIFT,            "<<"},
+        {Token::TokenType::RIGHT_SHIFT,           ">>"},
+        {Token::TokenType::LEFT_SHIFT_ASSIGNMENT, "<<="},
+        {Token::TokenType::RIGHT_SHIFT_ASSIGNMENT, ">>="},
+        {Token::TokenType::RIGHT_ARROW,           "->"},
         {Token::TokenType::LEFT_PAREN,            "("},
         {Token::TokenType::RIGHT_PAREN,           ")"},
         {Token::TokenType::LEFT_BRACE,            "{"},
@@ -131,6 +136,7 @@ const std::unordered_map<Token::TokenType, std::string> Token::tokenName = {
         {Token::TokenType::SEMICOLON,             ";"},
         {Token::TokenType::COMMA,                 ","},
         {Token::TokenType::DOT,                   "."},
+        {Token::TokenType::AT,                    "@"},
         {Token::TokenType::END_OF_FILE,           "EOF"},
         {Token::TokenType::ERROR,                 "ERROR"},
         {Token::TokenType::WHITESPACE,            "WHITESPACE"},
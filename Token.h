@@ -32,6 +32,8 @@ public:
         EPSILON, INVALID_TOKEN
     };
 
+    static constexpr int TOKEN_TYPE_COUNT = INVALID_TOKEN + 1;    // number of token types, used to size terminal columns
+
     static const std::unordered_map<TokenType, std::string> tokenName;
 
     static std::string tokenTypeAsString(const TokenType &tokenType);
@@ -0,0 +1,79 @@
+//
+// Created by jens on 19/10/26.
+//
+
+#include <thread>
+#include "TokenRing.h"
+
+/**
+ * @param capacity rounded up to a power of two, at least BATCH
+ */
+TokenRing::TokenRing(std::size_t capacity) {
+    std::size_t size = BATCH;
+    while (size < capacity) size <<= 1;
+    slots.assign(size, Token(Token::TokenType::INVALID_TOKEN));
+    mask = size - 1;
+}
+
+void TokenRing::backOff(int &spins) {
+    if (++spins < 64) return;
+    std::this_thread::yield();
+}
+
+/**
+ * appends a token, waiting while the ring is full
+ * @return false if the consumer cancelled, the token is then dropped and the producer should stop
+ */
+bool TokenRing::push(Token &&token) {
+    if (writeIndex - cachedHead == slots.size()) {
+        tail.store(writeIndex, std::memory_order_release);  // let the consumer drain what is written
+        int spins = 0;
+        while (writeIndex - (cachedHead = head.load(std::memory_order_acquire)) == slots.size()) {
+            if (cancelled.load(std::memory_order_relaxed)) return false;
+            backOff(spins);
+        }
+    }
+    slots[writeIndex & mask] = std::move(token);
+    if (++writeIndex % BATCH == 0) tail.store(writeIndex, std::memory_order_release);
+    return true;
+}
+
+/**
+ * publishes the remaining tokens and ends the stream; `error`, if any, is rethrown by pop once the tokens before it
+ * are consumed
+ */
+void TokenRing::close(std::exception_ptr error) {
+    this->error = std::move(error);
+    tail.store(writeIndex, std::memory_order_release);
+    closed.store(true, std::memory_order_release);
+}
+
+/**
+ * the next token, waiting while the ring is empty.
+ * After the end of the stream it rethrows the producer's error or returns END_OF_FILE.
+ */
+Token TokenRing::pop() {
+    if (readIndex == cachedTail) {
+        head.store(readIndex, std::memory_order_release);   // hand the consumed slots back before waiting
+        int spins = 0;
+        while ((cachedTail = tail.load(std::memory_order_acquire)) == readIndex) {
+            if (closed.load(std::memory_order_acquire)) {
+                // the tail was published before `closed`, read it again to not miss the last tokens
+                if ((cachedTail = tail.load(std::memory_order_acquire)) != readIndex) break;
+                if (error) std::rethrow_exception(error);
+                return Token(Token::TokenType::END_OF_FILE);
+            }
+            backOff(spins);
+        }
+    }
+    Token token = std::move(slots[readIndex & mask]);
+    if (++readIndex % BATCH == 0) head.store(readIndex, std::memory_order_release);
+    return token;
+}
+
+/**
+ * the consumer stops reading, a producer waiting for space returns from push
+ */
+void TokenRing::cancel() {
+    cancelled.store(true, std::memory_order_relaxed);
+}
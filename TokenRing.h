@@ -0,0 +1,62 @@
+//
+// Created by jens on 19/10/26.
+//
+
+#ifndef COMPILER_TOKENRING_H
+#define COMPILER_TOKENRING_H
+
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <vector>
+#include "Token.h"
+
+/**
+ * Lock-free single-producer single-consumer ring of tokens between a lexer thread and a parser thread.
+ *
+ * Both sides work on private indices and publish them in batches, so the shared indices are touched about
+ * once every BATCH tokens rather than once per token; each index sits on its own cache line.
+ * A full ring makes the producer wait (backpressure), an empty one the consumer.
+ * Waiting spins briefly, then yields the processor.
+ */
+class TokenRing {
+public:
+    static constexpr std::size_t CACHE_LINE = 64;
+    static constexpr std::size_t BATCH = 64;
+
+private:
+    std::vector<Token> slots;
+    std::size_t mask;
+
+    // written by the consumer
+    alignas(CACHE_LINE) std::atomic<std::size_t> head{0};
+    std::atomic<bool> cancelled{false};
+    // private to the consumer
+    alignas(CACHE_LINE) std::size_t readIndex = 0;
+    std::size_t cachedTail = 0;
+    // written by the producer
+    alignas(CACHE_LINE) std::atomic<std::size_t> tail{0};
+    std::atomic<bool> closed{false};
+    std::exception_ptr error;       // published by `closed`
+    // private to the producer
+    alignas(CACHE_LINE) std::size_t writeIndex = 0;
+    std::size_t cachedHead = 0;
+
+    static void backOff(int &spins);
+
+public:
+    explicit TokenRing(std::size_t capacity = 4096);
+    TokenRing(const TokenRing &) = delete;
+    TokenRing &operator=(const TokenRing &) = delete;
+
+    // producer
+    bool push(Token &&token);
+    void close(std::exception_ptr error = nullptr);
+
+    // consumer
+    Token pop();
+    void cancel();
+};
+
+
+#endif //COMPILER_TOKENRING_H
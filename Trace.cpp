@@ -0,0 +1,168 @@
+//
+// Created by jens on 19/10/26.
+//
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <mutex>
+#include "Trace.h"
+
+namespace {
+    std::mutex buffersMutex;    // registering a thread, start() and write(), never recording
+    std::atomic<std::uint32_t> generation{0};       // of the buffers, a thread registers again after start()
+    std::uint64_t epoch = 0;
+    double sampleRate = 1;
+    std::atomic<std::uint64_t> samples{0};
+    thread_local std::uint32_t currentGeneration = 0;
+
+    void writeQuoted(std::ostream &out, const std::string &text) {
+        out << '"';
+        for (char c: text) {
+            if (c == '"' || c == '\\') {
+                out << '\\' << c;
+            } else if ((unsigned char) c < 0x20) {
+                out << "\\u" << std::hex << std::setw(4) << std::setfill('0') << (int) c << std::dec
+                    << std::setfill(' ');
+            } else {
+                out << c;
+            }
+        }
+        out << '"';
+    }
+
+    /**
+     * microseconds since start(), the unit of the trace-event format
+     */
+    void writeMicroseconds(std::ostream &out, std::uint64_t nanoseconds) {
+        out << nanoseconds / 1000 << "." << std::setw(3) << std::setfill('0') << nanoseconds % 1000
+            << std::setfill(' ');
+    }
+}
+
+std::atomic<bool> Trace::recording{false};
+thread_local bool Trace::traced = true;
+std::vector<std::unique_ptr<Trace::Buffer>> Trace::buffers;
+thread_local Trace::Buffer *Trace::current = nullptr;
+
+Trace::Buffer::Buffer(std::uint32_t thread) : thread(thread), first(new Chunk), last(first) {}
+
+Trace::Buffer::~Buffer() {
+    for (Chunk *chunk = first; chunk;) {
+        Chunk *next = chunk->next.load(std::memory_order_relaxed);
+        delete chunk;
+        chunk = next;
+    }
+}
+
+Trace::Span::Span(const char *category, const char *name, const std::string &argument)
+        : category(category), name(name), active(isTraced()) {
+    if (!active) return;
+    Buffer &own = buffer();
+    own.arguments.push_back(argument);
+    this->argument = &own.arguments.back();
+    begin = now();
+}
+
+Trace::Sample::Sample(bool traced) : previous(Trace::traced) {
+    Trace::traced = traced;
+}
+
+Trace::Sample::~Sample() {
+    Trace::traced = previous;
+}
+
+/**
+ * the buffer of the calling thread, registered on its first span after start(); it is kept after the thread ends,
+ * until the next start()
+ */
+Trace::Buffer &Trace::buffer() {
+    std::uint32_t now = generation.load(std::memory_order_acquire);
+    if (current == nullptr || currentGeneration != now) {
+        std::lock_guard<std::mutex> lock(buffersMutex);
+        buffers.push_back(std::make_unique<Buffer>((std::uint32_t) buffers.size() + 1));
+        current = buffers.back().get();
+        currentGeneration = now;
+    }
+    return *current;
+}
+
+void Trace::record(const Event &event) {
+    Buffer &own = buffer();
+    Chunk *chunk = own.last;
+    std::size_t count = chunk->count.load(std::memory_order_relaxed);
+    if (count == Chunk::SIZE) {
+        Chunk *next = new Chunk;
+        chunk->next.store(next, std::memory_order_release);
+        own.last = chunk = next;
+        count = 0;
+    }
+    chunk->events[count] = event;
+    chunk->count.store(count + 1, std::memory_order_release);   // publishes the event to write()
+}
+
+/**
+ * drops the spans recorded so far and traces from now on; `rate` is the share of sample() that is traced.
+ * No thread may be recording while it runs.
+ */
+void Trace::start(double rate) {
+    std::lock_guard<std::mutex> lock(buffersMutex);
+    recording.store(false, std::memory_order_relaxed);
+    buffers.clear();
+    generation.fetch_add(1, std::memory_order_release);
+    epoch = now();
+    sampleRate = std::min(1.0, std::max(0.0, rate));
+    samples.store(0, std::memory_order_relaxed);
+    recording.store(true, std::memory_order_release);
+}
+
+void Trace::stop() {
+    recording.store(false, std::memory_order_release);
+}
+
+/**
+ * whether to trace the next unit of work, for a Sample around it: of n units, floor(n * rate) are, spread evenly
+ */
+bool Trace::sample() {
+    if (!recording.load(std::memory_order_acquire)) return false;
+    auto n = (double) samples.fetch_add(1, std::memory_order_relaxed);
+    return std::floor((n + 1) * sampleRate) > std::floor(n * sampleRate);
+}
+
+/**
+ * the events published so far as a JSON object of the trace-event format, one complete event ("X") per span and the
+ * name of every thread; a span still open is not in it
+ */
+void Trace::write(std::ostream &out) {
+    std::lock_guard<std::mutex> lock(buffersMutex);
+    out << "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [";
+    bool first = true;
+    for (const std::unique_ptr<Buffer> &buffer: buffers) {
+        out << (first ? "\n" : ",\n") << R"({"name": "thread_name", "ph": "M", "pid": 1, "tid": )" << buffer->thread
+            << R"(, "args": {"name": "thread )" << buffer->thread << "\"}}";
+        first = false;
+        for (const Chunk *chunk = buffer->first; chunk; chunk = chunk->next.load(std::memory_order_acquire)) {
+            std::size_t count = chunk->count.load(std::memory_order_acquire);
+            for (std::size_t i = 0; i < count; i++) {
+                const Event &event = chunk->events[i];
+                std::uint64_t begin = std::max(event.begin, epoch);
+                out << ",\n{\"name\": ";
+                writeQuoted(out, event.name);
+                out << ", \"cat\": ";
+                writeQuoted(out, event.category);
+                out << R"(, "ph": "X", "pid": 1, "tid": )" << buffer->thread << ", \"ts\": ";
+                writeMicroseconds(out, begin - epoch);
+                out << ", \"dur\": ";
+                writeMicroseconds(out, event.end - std::min(event.end, begin));
+                if (event.argument) {
+                    out << ", \"args\": {\"detail\": ";
+                    writeQuoted(out, *event.argument);
+                    out << "}";
+                }
+                out << "}";
+            }
+        }
+    }
+    out << "\n]}\n";
+    out.flush();
+}
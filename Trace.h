@@ -0,0 +1,117 @@
+//
+// Created by jens on 19/10/26.
+//
+
+#ifndef COMPILER_TRACE_H
+#define COMPILER_TRACE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/**
+ * A timeline of spans, which file and which phase ran when and on which thread, written as Chrome trace-event JSON
+ * (chrome://tracing, ui.perfetto.dev).
+ *
+ * A thread records into a buffer of its own, chunks of events that only it appends to and publishes with a
+ * release store, so recording takes no lock and allocates only once per chunk; write() can run at any time and
+ * takes the events published so far. Tracing is off until start(), and start(rate) traces only that share of the
+ * units of work that ask sample() (a file of the CompileDriver), so it can stay on in production at a low rate. A
+ * span outside any sample is recorded whenever tracing is on.
+ */
+class Trace {
+public:
+    struct Event {
+        const char *category;
+        const char *name;
+        std::uint64_t begin;            // nanoseconds of the steady clock
+        std::uint64_t end;
+        const std::string *argument;    // shown as args.detail, or null
+    };
+
+    /**
+     * records the time from construction to destruction if tracing is on for the thread when it is constructed
+     */
+    class Span {
+        const char *category;
+        const char *name;
+        const std::string *argument = nullptr;
+        std::uint64_t begin = 0;
+        bool active;
+
+    public:
+        Span(const char *category, const char *name) : category(category), name(name), active(isTraced()) {
+            if (active) begin = now();
+        }
+
+        Span(const char *category, const char *name, const std::string &argument);
+
+        ~Span() {
+            if (active) record({category, name, begin, now(), argument});
+        }
+
+        Span(const Span &) = delete;
+        Span &operator=(const Span &) = delete;
+    };
+
+    /**
+     * traces the spans of the thread up to its destruction or not, see sample(); the previous choice is restored
+     * afterwards
+     */
+    class Sample {
+        bool previous;
+
+    public:
+        explicit Sample(bool traced);
+        ~Sample();
+        Sample(const Sample &) = delete;
+        Sample &operator=(const Sample &) = delete;
+    };
+
+private:
+    struct Chunk {
+        static constexpr std::size_t SIZE = 4096;
+        Event events[SIZE];
+        std::atomic<std::size_t> count{0};
+        std::atomic<Chunk *> next{nullptr};
+    };
+
+    struct Buffer {
+        std::uint32_t thread;
+        Chunk *first;
+        Chunk *last;
+        std::deque<std::string> arguments;      // never moved, so the events can point into it
+
+        explicit Buffer(std::uint32_t thread);
+        ~Buffer();
+    };
+
+    static std::atomic<bool> recording;
+    static thread_local bool traced;
+    static std::vector<std::unique_ptr<Buffer>> buffers;
+    static thread_local Buffer *current;
+
+    static Buffer &buffer();
+    static void record(const Event &event);
+
+public:
+    static std::uint64_t now() {
+        return (std::uint64_t) std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    static bool isTraced() { return traced && recording.load(std::memory_order_relaxed); }
+
+    static void start(double rate = 1);
+    static void stop();
+    static bool sample();
+    static void write(std::ostream &out);
+};
+
+
+#endif //COMPILER_TRACE_H
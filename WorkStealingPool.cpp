@@ -0,0 +1,93 @@
+//
+// Created by jens on 19/10/26.
+//
+
+#include "WorkStealingPool.h"
+
+thread_local WorkStealingPool *WorkStealingPool::workerPool = nullptr;
+thread_local unsigned WorkStealingPool::workerIndex = 0;
+
+WorkStealingPool::WorkStealingPool(unsigned threads) {
+    if (threads == 0) threads = 1;
+    for (unsigned i = 0; i < threads; i++) {
+        queues.push_back(std::make_unique<Queue>());
+    }
+    for (unsigned i = 0; i < threads; i++) {
+        workers.emplace_back(&WorkStealingPool::work, this, i);
+    }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    available.notify_all();
+    for (std::thread &worker: workers) {
+        worker.join();
+    }
+}
+
+/**
+ * the newest task of the own deque, else the oldest of the first other deque that has one
+ */
+bool WorkStealingPool::take(unsigned self, std::function<void()> &task) {
+    for (unsigned i = 0; i < queues.size(); i++) {
+        Queue &queue = *queues[(self + i) % queues.size()];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.tasks.empty()) continue;
+        if (i == 0) {
+            task = std::move(queue.tasks.back());
+            queue.tasks.pop_back();
+        } else {
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+        }
+        queued.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+    }
+    return false;
+}
+
+void WorkStealingPool::work(unsigned self) {
+    workerPool = this;
+    workerIndex = self;
+    while (true) {
+        std::function<void()> task;
+        if (!take(self, task)) {
+            std::unique_lock<std::mutex> lock(mutex);
+            available.wait(lock, [this]() { return stopping || queued.load(std::memory_order_relaxed) > 0; });
+            if (queued.load(std::memory_order_relaxed) == 0) return;    // stopping and drained
+            continue;
+        }
+        task();
+        std::lock_guard<std::mutex> lock(mutex);
+        if (--pending == 0) idle.notify_all();
+    }
+}
+
+void WorkStealingPool::submit(std::function<void()> task) {
+    // a task submitting more work keeps it local, where it is most likely still in cache
+    unsigned target = workerPool == this ? workerIndex
+                                         : nextQueue.fetch_add(1, std::memory_order_relaxed) % queues.size();
+    {
+        // counted before it is queued, so it is never taken (or finished) before it is counted
+        std::lock_guard<std::mutex> lock(mutex);
+        queued.fetch_add(1, std::memory_order_relaxed);
+        pending++;
+    }
+    {
+        std::lock_guard<std::mutex> lock(queues[target]->mutex);
+        queues[target]->tasks.push_back(std::move(task));
+    }
+    available.notify_one();
+}
+
+void WorkStealingPool::wait() {
+    std::unique_lock<std::mutex> lock(mutex);
+    idle.wait(lock, [this]() { return pending == 0; });
+}
+
+unsigned WorkStealingPool::size() const {
+    return (unsigned) workers.size();
+}
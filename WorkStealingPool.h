@@ -0,0 +1,62 @@
+//
+// Created by jens on 19/10/26.
+//
+
+#ifndef COMPILER_WORKSTEALINGPOOL_H
+#define COMPILER_WORKSTEALINGPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Thread pool with one task deque per worker: a worker runs its own newest task first and, once its deque is empty,
+ * steals the oldest task of another worker. Tasks submitted from outside are dealt round robin,
+ * tasks submitted by a task go to the deque of the worker running it.
+ *
+ * Unlike ThreadPool, workers do not contend on one queue, so many small jobs of uneven size
+ * (files of very different lengths) keep every worker busy. `wait()` blocks until every submitted task has run.
+ */
+class WorkStealingPool {
+private:
+    struct alignas(64) Queue {     // one per worker, on its own cache line
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> workers;
+    std::mutex mutex;                       // guards sleeping and waking
+    std::condition_variable available;      // a task was queued or the pool stops
+    std::condition_variable idle;           // the last pending task finished
+    std::atomic<std::size_t> queued{0};     // in some deque, not yet taken
+    std::size_t pending = 0;                // queued or running, guarded by mutex
+    std::atomic<unsigned> nextQueue{0};
+    bool stopping = false;
+
+    // the pool and worker the calling thread belongs to, nullptr outside any pool
+    static thread_local WorkStealingPool *workerPool;
+    static thread_local unsigned workerIndex;
+
+    bool take(unsigned self, std::function<void()> &task);
+    void work(unsigned self);
+
+public:
+    explicit WorkStealingPool(unsigned threads = std::thread::hardware_concurrency());
+    ~WorkStealingPool();
+    WorkStealingPool(const WorkStealingPool &) = delete;
+    WorkStealingPool &operator=(const WorkStealingPool &) = delete;
+
+    void submit(std::function<void()> task);
+    void wait();
+    [[nodiscard]] unsigned size() const;
+};
+
+
+#endif //COMPILER_WORKSTEALINGPOOL_H
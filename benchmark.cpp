@@ -0,0 +1,264 @@
+//
+// Created by jens on 19/10/26.
+//
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "CompiledGrammar.h"
+#include "ContextFreeGrammar.h"
+#include "InputBuffer.h"
+#include "Lexer.h"
+#include "Parser.h"
+#include "SymbolTable.h"
+#include "SyntheticInput.h"
+#include "grammar_def.h"
+
+/*
+ * compiler_benchmark [--json <file>] [--label <text>] [--repeat <n>] [--scale <factor>]
+ *
+ * Measures the front end phase by phase on generated inputs. Every input comes from a fixed seed, so two builds do
+ * the same work and the JSON of two commits can be compared entry by entry; --label records which commit it was.
+ * A measurement is the fastest of --repeat runs, --scale multiplies the input sizes.
+ */
+
+namespace {
+    const unsigned SEED = 42;
+    const int OPERANDS = 500000;
+    const int GRAMMAR_SIZES[] = {256, 1024, 4096};
+
+    struct Options {
+        std::string json;
+        std::string label;
+        int repeat = 5;
+        double scale = 1;
+    };
+
+    struct Result {
+        std::string name;
+        std::string metric;
+        double value;
+        std::string unit;
+        std::vector<std::pair<std::string, long>> parameters;
+    };
+
+    // results are summed into it so the compiler cannot drop the measured loops
+    volatile long sink = 0;
+
+    /**
+     * the fastest of `repeat` runs of `run` in seconds, `setup` runs before each and is not timed
+     */
+    double fastest(int repeat, const std::function<void()> &setup, const std::function<void()> &run) {
+        double best = 0;
+        for (int i = 0; i < repeat; i++) {
+            setup();
+            auto start = std::chrono::steady_clock::now();
+            run();
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            if (i == 0 || seconds < best) best = seconds;
+        }
+        return best;
+    }
+
+    double fastest(int repeat, const std::function<void()> &run) {
+        return fastest(repeat, [] {}, run);
+    }
+
+    long fileSize(const std::string &pathname) {
+        std::ifstream in(pathname, std::ios::binary | std::ios::ate);
+        if (!in) throw std::runtime_error("cannot open " + pathname);
+        return (long) in.tellg();
+    }
+
+    void inputBufferBenchmark(const Options &options, const std::string &pathname, std::vector<Result> &results) {
+        long bytes = fileSize(pathname);
+        std::unique_ptr<InputBuffer> inputBuffer;
+        auto open = [&] { inputBuffer = std::make_unique<InputBuffer>(pathname); };
+        double next = fastest(options.repeat, open, [&] {
+            long sum = 0;
+            for (char ch; (ch = inputBuffer->getChar()) != EOF; inputBuffer->next()) sum += ch;
+            sink += sum;
+        });
+        double peek = fastest(options.repeat, open, [&] {
+            long sum = 0;
+            for (char ch; (ch = inputBuffer->peek()) != EOF; inputBuffer->next()) sum += ch;
+            sink += sum;
+        });
+        results.push_back({"InputBuffer::next", "latency", next * 1e9 / (double) bytes, "ns/char",
+                           {{"bytes", bytes}}});
+        results.push_back({"InputBuffer::peek", "latency", peek * 1e9 / (double) bytes, "ns/char",
+                           {{"bytes", bytes}}});
+    }
+
+    /**
+     * @return the number of tokens other than whitespace, what the parser consumes
+     */
+    long lexerBenchmark(const Options &options, const std::string &pathname, std::vector<Result> &results) {
+        long bytes = fileSize(pathname);
+        long tokens = 0;
+        long significant = 0;
+        double seconds = fastest(options.repeat, [&] {
+            InputBuffer inputBuffer(pathname);
+            SymbolTable symbolTable;
+            Lexer lexer(&inputBuffer, &symbolTable);
+            tokens = significant = 0;
+            for (Token token = lexer.nextToken();; token = lexer.nextToken()) {
+                tokens++;
+                if (!token.isWhitespace()) significant++;
+                if (token.isEOF()) break;
+            }
+        });
+        results.push_back({"Lexer::nextToken", "throughput", (double) bytes / 1e6 / seconds, "MB/s",
+                           {{"bytes", bytes}, {"tokens", tokens}}});
+        results.push_back({"Lexer::nextToken", "throughput", (double) tokens / seconds, "tokens/s",
+                           {{"bytes", bytes}, {"tokens", tokens}}});
+        return significant;
+    }
+
+    void grammarBenchmark(const Options &options, std::vector<Result> &results) {
+        for (int size: GRAMMAR_SIZES) {
+            int count = std::max(16, (int) (size * options.scale));
+            std::vector<Production> productions = SyntheticInput::grammar(count, 3, SEED);
+            std::unique_ptr<ContextFreeGrammar> grammar;
+            auto fresh = [&] { grammar = std::make_unique<ContextFreeGrammar>(productions); };
+            auto analysedUpTo = [&](const std::function<void(ContextFreeGrammar &)> &done) {
+                return [&, done] {
+                    fresh();
+                    done(*grammar);
+                };
+            };
+
+            // each phase on a grammar that has the phases before it done, FOLLOW needs FIRST of every production
+            double first = fastest(options.repeat, fresh, [&] { grammar->findFirstForNonTerminals(); });
+            double firstOfProductions = fastest(
+                    options.repeat, analysedUpTo([](ContextFreeGrammar &g) { g.findFirstForNonTerminals(); }),
+                    [&] { grammar->findFirstForProductions(); });
+            double follow = fastest(
+                    options.repeat, analysedUpTo([](ContextFreeGrammar &g) { g.findFirstForProductions(); }),
+                    [&] { grammar->findFollow(); });
+            double table = fastest(
+                    options.repeat, analysedUpTo([](ContextFreeGrammar &g) { g.findFollow(); }),
+                    [&] { grammar->findParsingTableLL1(); });
+
+            std::vector<std::pair<std::string, long>> parameters{{"non-terminals", count},
+                                                                 {"productions", (long) productions.size()}};
+            results.push_back({"FIRST", "time", first * 1e3, "ms", parameters});
+            results.push_back({"FIRST of productions", "time", firstOfProductions * 1e3, "ms", parameters});
+            results.push_back({"FOLLOW", "time", follow * 1e3, "ms", parameters});
+            results.push_back({"LL(1) table", "time", table * 1e3, "ms", parameters});
+        }
+    }
+
+    void parserBenchmark(const Options &options, const std::string &pathname, long tokens,
+                         std::vector<Result> &results) {
+        ContextFreeGrammar definition(grammarDefs);
+        CompiledGrammar grammar(definition);
+        double seconds = fastest(options.repeat, [&] {
+            InputBuffer inputBuffer(pathname);
+            SymbolTable symbolTable;
+            Lexer lexer(&inputBuffer, &symbolTable);
+            Parser(grammar, &lexer, &symbolTable).parse();
+        });
+        // lexing included, as a compilation runs it
+        results.push_back({"Parser::parse", "throughput", (double) tokens / seconds, "tokens/s",
+                           {{"bytes", fileSize(pathname)}, {"tokens", tokens}}});
+    }
+
+    std::string quoted(const std::string &text) {
+        std::string out = "\"";
+        for (char c: text) {
+            if (c == '"' || c == '\\') out += '\\';
+            out += c;
+        }
+        return out + "\"";
+    }
+
+    void writeJson(const Options &options, const std::vector<Result> &results) {
+        std::ofstream out(options.json, std::ios::out | std::ios::trunc);
+        if (!out) throw std::runtime_error("cannot write " + options.json);
+        out << std::fixed << std::setprecision(3)
+            << "{\n  \"label\": " << quoted(options.label) << ",\n  \"seed\": " << SEED
+            << ",\n  \"repeat\": " << options.repeat << ",\n  \"scale\": " << options.scale
+#ifdef NDEBUG
+            << ",\n  \"assertions\": false"
+#else
+            << ",\n  \"assertions\": true"
+#endif
+            << ",\n  \"results\": [";
+        for (std::size_t i = 0; i < results.size(); i++) {
+            const Result &r = results[i];
+            out << (i == 0 ? "\n" : ",\n") << "    {\"name\": " << quoted(r.name) << ", \"metric\": "
+                << quoted(r.metric) << ", \"value\": " << r.value << ", \"unit\": " << quoted(r.unit)
+                << ", \"parameters\": {";
+            for (std::size_t j = 0; j < r.parameters.size(); j++) {
+                out << (j == 0 ? "" : ", ") << quoted(r.parameters[j].first) << ": " << r.parameters[j].second;
+            }
+            out << "}}";
+        }
+        out << "\n  ]\n}\n";
+    }
+
+    void printResults(const std::vector<Result> &results) {
+        for (const Result &r: results) {
+            std::cout << std::left << std::setw(24) << r.name << std::right << std::setw(14) << std::fixed
+                      << std::setprecision(3) << r.value << " " << std::left << std::setw(9) << r.unit;
+            for (const auto &parameter: r.parameters) std::cout << " " << parameter.first << "=" << parameter.second;
+            std::cout << std::endl;
+        }
+    }
+
+    Options parseOptions(int argc, char **argv) {
+        Options options;
+        for (int i = 1; i < argc; i++) {
+            std::string option = argv[i];
+            if (i + 1 == argc) throw std::runtime_error("missing value of " + option);
+            std::string value = argv[++i];
+            if (option == "--json") {
+                options.json = value;
+            } else if (option == "--label") {
+                options.label = value;
+            } else if (option == "--repeat") {
+                options.repeat = std::max(1, std::stoi(value));
+            } else if (option == "--scale") {
+                options.scale = std::stod(value);
+                if (options.scale <= 0) throw std::runtime_error("--scale must be positive");
+            } else {
+                throw std::runtime_error("unknown option " + option);
+            }
+        }
+        return options;
+    }
+}
+
+int main(int argc, char **argv) {
+    Options options;
+    try {
+        options = parseOptions(argc, argv);
+    } catch (std::exception &e) {
+        std::cerr << e.what() << std::endl
+                  << "usage: compiler_benchmark [--json <file>] [--label <text>] [--repeat <n>] [--scale <factor>]"
+                  << std::endl;
+        return 2;
+    }
+
+    const std::string pathname = "benchmark_expression";
+    SyntheticInput::writeExpression(pathname, std::max(16, (int) (OPERANDS * options.scale)), SEED);
+    std::vector<Result> results;
+    inputBufferBenchmark(options, pathname, results);
+    long tokens = lexerBenchmark(options, pathname, results);
+    parserBenchmark(options, pathname, tokens, results);
+    grammarBenchmark(options, results);
+    std::remove(pathname.c_str());
+
+    printResults(results);
+    if (!options.json.empty()) writeJson(options, results);
+    return 0;
+}
@@ -7,31 +7,59 @@
 
 #include <vector>
 #include "Production.h"
+#include "StaticGrammar.h"
 
 
-std::vector<Production> grammarDefs =
+static constexpr StaticProduction staticGrammarDefs[] =
         {
                 // ---------------------------------------expression grammar -------------------------------------------
                 // <expr> ::= <term> <expr_p>
-                Production(HEAD("<expr>"), {NT("<term>"), NT("<expr_p>")}),
+                StaticProduction(STATIC_HEAD("<expr>"), {STATIC_NT("<term>"), STATIC_NT("<expr_p>")}),
                 // <expr_p> ::= + <term> <expr_p> | - <term> <expr_p> | epsilon
-                Production(HEAD("<expr_p>"), {T(Token::PLUS), NT("<term>"), NT("<expr_p>")}),
-                Production(HEAD("<expr_p>"), {T(Token::MINUS), NT("<term>"), NT("<expr_p>")}),
-                Production(HEAD("<expr_p>"), {GrammarSymbol::epsilon()}),
+                StaticProduction(STATIC_HEAD("<expr_p>"), {STATIC_T(Token::PLUS), STATIC_NT("<term>"), STATIC_NT("<expr_p>")}),
+                StaticProduction(STATIC_HEAD("<expr_p>"), {STATIC_T(Token::MINUS), STATIC_NT("<term>"), STATIC_NT("<expr_p>")}),
+                StaticProduction(STATIC_HEAD("<expr_p>"), {StaticSymbol::epsilon()}),
                 // <term> ::= <factor> <term_p>
-                Production(HEAD("<term>"), {NT("<factor>"), NT("<term_p>")}),
+                StaticProduction(STATIC_HEAD("<term>"), {STATIC_NT("<factor>"), STATIC_NT("<term_p>")}),
                 // <term_p> ::= * <factor> <term_p> | / <factor> <term_p> | % <factor> <term_p> | epsilon
-                Production(HEAD("<term_p>"), {T(Token::STAR), NT("<factor>"), NT("<term_p>")}),
-                Production(HEAD("<term_p>"), {T(Token::SLASH), NT("<factor>"), NT("<term_p>")}),
-                Production(HEAD("<term_p>"), {T(Token::PERCENT), NT("<factor>"), NT("<term_p>")}),
-                Production(HEAD("<term_p>"), {GrammarSymbol::epsilon()}),
+                StaticProduction(STATIC_HEAD("<term_p>"), {STATIC_T(Token::STAR), STATIC_NT("<factor>"), STATIC_NT("<term_p>")}),
+                StaticProduction(STATIC_HEAD("<term_p>"), {STATIC_T(Token::SLASH), STATIC_NT("<factor>"), STATIC_NT("<term_p>")}),
+                StaticProduction(STATIC_HEAD("<term_p>"), {STATIC_T(Token::PERCENT), STATIC_NT("<factor>"), STATIC_NT("<term_p>")}),
+                StaticProduction(STATIC_HEAD("<term_p>"), {StaticSymbol::epsilon()}),
+                // <factor> ::= ( <expr> ) | <int_lit> | <float_lit> | <id>
+                StaticProduction(STATIC_HEAD("<factor>"), {STATIC_T(Token::LEFT_PAREN), STATIC_NT("<expr>"), STATIC_T(Token::RIGHT_PAREN)}),
+                StaticProduction(STATIC_HEAD("<factor>"), {STATIC_T(Token::INTEGER_LITERAL)}),
+                StaticProduction(STATIC_HEAD("<factor>"), {STATIC_T(Token::FLOAT_LITERAL)}),
+                StaticProduction(STATIC_HEAD("<factor>"), {STATIC_T(Token::IDENTIFIER)}),
+                // -------------------------------------- statement grammar --------------------------------------------
+
+        };
+
+// FIRST, FOLLOW and the LL(1) table of the grammar above, computed by the compiler and placed in read-only data
+static constexpr auto grammarTables = STATIC_LL1_TABLE(staticGrammarDefs);
+static_assert(grammarTables.undefinedNonTerminals == 0, "grammar_def.h: a non-terminal is used but never defined");
+static_assert(grammarTables.conflicts == 0, "grammar_def.h: the grammar is not LL(1)");
+
+// the same grammar for ContextFreeGrammar, productions and rows in the order grammarTables uses
+std::vector<Production> grammarDefs = toProductions(staticGrammarDefs);
+
+// the expression grammar as written in textbooks, left recursive, for LALRTable which needs no rewriting
+std::vector<Production> leftRecursiveGrammarDefs =
+        {
+                // <expr> ::= <expr> + <term> | <expr> - <term> | <term>
+                Production(HEAD("<expr>"), {NT("<expr>"), T(Token::PLUS), NT("<term>")}),
+                Production(HEAD("<expr>"), {NT("<expr>"), T(Token::MINUS), NT("<term>")}),
+                Production(HEAD("<expr>"), {NT("<term>")}),
+                // <term> ::= <term> * <factor> | <term> / <factor> | <term> % <factor> | <factor>
+                Production(HEAD("<term>"), {NT("<term>"), T(Token::STAR), NT("<factor>")}),
+                Production(HEAD("<term>"), {NT("<term>"), T(Token::SLASH), NT("<factor>")}),
+                Production(HEAD("<term>"), {NT("<term>"), T(Token::PERCENT), NT("<factor>")}),
+                Production(HEAD("<term>"), {NT("<factor>")}),
                 // <factor> ::= ( <expr> ) | <int_lit> | <float_lit> | <id>
                 Production(HEAD("<factor>"), {T(Token::LEFT_PAREN), NT("<expr>"), T(Token::RIGHT_PAREN)}),
                 Production(HEAD("<factor>"), {T(Token::INTEGER_LITERAL)}),
                 Production(HEAD("<factor>"), {T(Token::FLOAT_LITERAL)}),
                 Production(HEAD("<factor>"), {T(Token::IDENTIFIER)}),
-                // -------------------------------------- statement grammar --------------------------------------------
-
         };
 
 #endif //COMPILER_GRAMMAR_DEF_H
@@ -1,31 +1,251 @@
 #include <iostream>
+#include <chrono>
+#include <random>
+#include <fstream>
+#include <functional>
+#include <array>
+#include <filesystem>
+#include <sstream>
+#include <unordered_set>
+#include <map>
+#include <set>
+#include <atomic>
+#include <cstring>
 #include "InputBuffer.h"
 #include "Lexer.h"
 #include "ContextFreeGrammar.h"
 #include "SymbolTable.h"
 #include "Parser.h"
 #include "grammar_def.h"
+#include "ParserGenerator.h"
+#include "ExpressionParser.h"
+#include "LALRTable.h"
+#include "LRParser.h"
+#include "ThreadPool.h"
+#include "ParseTrace.h"
+#include "ParseTree.h"
+#include "PushParser.h"
+#include "CompileDriver.h"
+#include "IncrementalParser.h"
+#include "EarleyParser.h"
+#include "SyntheticInput.h"
+#include "Stats.h"
+#include "Trace.h"
+#include "SyntheticCorpus.h"
+
+// the test program counts every heap allocation, see parseStackAllocationTest
+#ifndef COMPILER_COUNT_ALLOCATIONS
+#define COMPILER_COUNT_ALLOCATIONS 0
+#endif
+#if COMPILER_COUNT_ALLOCATIONS
+#include "AllocationCounter.h"
+#endif
 
 extern std::vector<Production> grammarDefs;
+extern std::vector<Production> leftRecursiveGrammarDefs;
 
 using std::cout;
 using std::endl;
 using std::string;
 
+/**
+ * fails the running test: `compiler --run <name>` reports `what` and exits with 1
+ */
+void check(bool condition, const std::string &what) {
+    if (!condition) throw std::runtime_error("check failed: " + what);
+}
+
+std::vector<std::pair<std::string, std::string>> traceEvents(const std::string &json);
+
+/**
+ * the names of the spans `run` records on the calling thread, e.g. which analysis passes it computed
+ */
+std::set<std::string> spansOf(const std::function<void()> &run) {
+    Trace::start();
+    run();
+    Trace::stop();
+    std::ostringstream out;
+    Trace::write(out);
+    std::set<std::string> names;
+    for (const auto &event: traceEvents(out.str())) names.insert(event.first);
+    return names;
+}
+
+/**
+ * whether two compiled grammars predict the same production on every entry
+ */
+bool samePredictions(const CompiledGrammar &a, const CompiledGrammar &b) {
+    if (a.getNonTerminals().size() != b.getNonTerminals().size()) return false;
+    for (std::size_t n = 0; n < a.getNonTerminals().size(); n++) {
+        for (int t = 0; t < Token::TOKEN_TYPE_COUNT; t++) {
+            auto symbol = (std::int32_t) (Token::TOKEN_TYPE_COUNT + n);
+            if (a.predict(symbol, t) != b.predict(symbol, t)) return false;
+        }
+    }
+    return true;
+}
+
 void inputBufferTest();
 
 void lexerTest();
 
+void checkpointTest();
+
+void checkpointBenchmark();
+
 void grammarTest();
 
 void parserTest();
 void leftRecursionEliminationTest();
 
-int main() {
-    leftRecursionEliminationTest();
-//    lexerTest();
-//    grammarTest();
-//    parserTest();
+void grammarTransformationTest();
+
+void incrementalAnalysisTest();
+
+void incrementalAnalysisBenchmark();
+
+void parallelAnalysisTest();
+
+void parallelAnalysisBenchmark();
+
+void parserTraceBenchmark();
+
+void parseTreeTest();
+
+void parseTreeBenchmark();
+
+void errorRecoveryTest();
+
+void errorRecoveryBenchmark();
+
+void pushParserTest();
+
+void pipelinedParserBenchmark();
+
+void compileDriverTest();
+
+void compileDriverBenchmark();
+
+void compiledGrammarBenchmark();
+
+void incrementalParserTest();
+
+void incrementalParserBenchmark();
+
+void precedenceParsingTest();
+
+void precedenceParsingBenchmark();
+
+void parseStackAllocationTest();
+
+void earleyParserTest();
+
+void earleyParserBenchmark();
+
+void lookaheadTest();
+
+void syntheticCorpusTest();
+
+void syntheticCorpusBenchmark();
+
+void statsTest();
+
+void traceTest();
+
+void traceBenchmark();
+
+void parsingTableBenchmark();
+
+void grammarImageTest();
+
+void staticGrammarTest();
+
+void generateExpressionParser();
+
+void generatedParserTest();
+
+void generatedParserBenchmark();
+
+void lalrTest();
+
+void lalrBenchmark();
+
+// every test and benchmark by name, newest first; `compiler --run <name>` runs one, ctest runs the tests
+static const std::vector<std::pair<std::string, void (*)()>> RUNNABLE = {
+        {"traceBenchmark",               traceBenchmark},
+        {"traceTest",                    traceTest},
+        {"statsTest",                    statsTest},
+        {"syntheticCorpusBenchmark",     syntheticCorpusBenchmark},
+        {"syntheticCorpusTest",          syntheticCorpusTest},
+        {"lookaheadTest",                lookaheadTest},
+        {"checkpointTest",               checkpointTest},
+        {"checkpointBenchmark",          checkpointBenchmark},
+        {"earleyParserBenchmark",        earleyParserBenchmark},
+        {"earleyParserTest",             earleyParserTest},
+        {"parseStackAllocationTest",     parseStackAllocationTest},
+        {"precedenceParsingBenchmark",   precedenceParsingBenchmark},
+        {"precedenceParsingTest",        precedenceParsingTest},
+        {"incrementalParserBenchmark",   incrementalParserBenchmark},
+        {"incrementalParserTest",        incrementalParserTest},
+        {"compiledGrammarBenchmark",     compiledGrammarBenchmark},
+        {"compileDriverTest",            compileDriverTest},
+        {"compileDriverBenchmark",       compileDriverBenchmark},
+        {"pipelinedParserBenchmark",     pipelinedParserBenchmark},
+        {"pushParserTest",               pushParserTest},
+        {"errorRecoveryTest",            errorRecoveryTest},
+        {"errorRecoveryBenchmark",       errorRecoveryBenchmark},
+        {"parseTreeTest",                parseTreeTest},
+        {"parseTreeBenchmark",           parseTreeBenchmark},
+        {"parserTraceBenchmark",         parserTraceBenchmark},
+        {"parallelAnalysisTest",         parallelAnalysisTest},
+        {"parallelAnalysisBenchmark",    parallelAnalysisBenchmark},
+        {"incrementalAnalysisTest",      incrementalAnalysisTest},
+        {"incrementalAnalysisBenchmark", incrementalAnalysisBenchmark},
+        {"grammarTransformationTest",    grammarTransformationTest},
+        {"leftRecursionEliminationTest", leftRecursionEliminationTest},
+        {"inputBufferTest",              inputBufferTest},
+        {"lexerTest",                    lexerTest},
+        {"grammarTest",                  grammarTest},
+        {"parserTest",                   parserTest},
+        {"parsingTableBenchmark",        parsingTableBenchmark},
+        {"grammarImageTest",             grammarImageTest},
+        {"staticGrammarTest",            staticGrammarTest},
+        {"generateExpressionParser",     generateExpressionParser},
+        {"generatedParserTest",          generatedParserTest},
+        {"generatedParserBenchmark",     generatedParserBenchmark},
+        {"lalrTest",                     lalrTest},
+        {"lalrBenchmark",                lalrBenchmark},
+};
+
+int main(int argc, char **argv) {
+    if (argc == 3 && std::string(argv[1]) == "--run") {
+        // the tests read ../test/..., so they run in a directory next to test/, as the build directory is
+        for (const auto &runnable: RUNNABLE) {
+            if (runnable.first == argv[2]) {
+                try {
+                    runnable.second();
+                } catch (const std::exception &e) {
+                    std::cerr << runnable.first << " failed: " << e.what() << std::endl;
+                    return 1;
+                }
+                return 0;
+            }
+        }
+        std::cerr << "no test or benchmark named " << argv[2] << std::endl;
+        return 2;
+    }
+    if (argc > 1 && std::string(argv[1]) == "--generate") {
+        // compiler --generate java|grammar [options], see SyntheticCorpus::main
+        return SyntheticCorpus::main(std::vector<std::string>(argv + 2, argv + argc), grammarDefs);
+    }
+    if (argc > 1) {
+        // compiler [options] <file | directory | @list>..., see CompileDriver::main
+        return CompileDriver::main(std::vector<std::string>(argv + 1, argv + argc), grammarDefs,
+                                   grammarTables.parsingTable());
+    }
+    cout << "usage: compiler --run <name>, compiler --generate java|grammar [options], "
+            "or compiler [options] <file | directory | @list>..." << endl;
+    for (const auto &runnable: RUNNABLE) cout << "\t" << runnable.first << endl;
     return 0;
 }
 
@@ -35,9 +255,289 @@ void parserTest() {
     SymbolTable symbolTable;
     Lexer lexer(&inputBuffer, &symbolTable);
     Parser parser(grammar, &lexer, &symbolTable);
+    TextTraceSink trace(cout);  // prints every step unless built with PARSER_TRACE_LEVEL below PARSER_TRACE_STACK
+    parser.setObserver(&trace);
     parser.parse();
 }
 
+void grammarImageTest() {
+    ContextFreeGrammar computed(grammarDefs);
+    computed.saveAnalysis("grammar_def.bin");
+
+    ContextFreeGrammar loaded(grammarDefs);
+    bool isLoaded = loaded.loadAnalysis("grammar_def.bin");
+    cout << "image loaded: " << std::boolalpha << isLoaded << endl;
+    check(isLoaded, "image loaded");
+    for (const GrammarSymbol &nt: computed.getNonTerminals()) {
+        for (int t = 0; t < Token::TOKEN_TYPE_COUNT; t++) {
+            auto expected = computed.predict(nt, T((Token::TokenType) t));
+            auto actual = loaded.predict(nt, T((Token::TokenType) t));
+            if (std::holds_alternative<Production>(expected)
+                && !(std::get<Production>(expected) == std::get<Production>(actual))) {
+                cout << "\tmismatch on " << nt << " " << t << endl;
+                check(false, "loaded table matches the computed one");
+            }
+        }
+    }
+
+    // a parser compiled from the loaded grammar takes its table and sets from the image, computing none of them
+    ContextFreeGrammar reloaded(grammarDefs);
+    reloaded.loadAnalysis("grammar_def.bin");
+    std::unique_ptr<CompiledGrammar> fromImage;
+    std::set<std::string> spans = spansOf([&]() { fromImage = std::make_unique<CompiledGrammar>(reloaded); });
+    bool computedNothing = spans.count("compile grammar") && !spans.count("FIRST") && !spans.count("FOLLOW")
+                           && !spans.count("LL(1) table");
+    cout << "compiled from the image without computing FIRST, FOLLOW or the table: " << computedNothing << endl;
+    check(computedNothing, "compiling a loaded grammar runs no FIRST, FOLLOW or table pass");
+    check(samePredictions(*fromImage, CompiledGrammar(computed)), "compiled from the image, the same predictions");
+
+    // an image written for another production list must be rejected
+    ContextFreeGrammar other({Production(HEAD("<expr>"), {T(Token::INTEGER_LITERAL)})});
+    bool staleLoaded = other.loadAnalysis("grammar_def.bin");
+    cout << "stale image loaded: " << staleLoaded << endl;
+    check(!staleLoaded, "stale image rejected");
+
+    // so must an image with a valid header whose sections point outside themselves
+    std::string image;
+    {
+        std::ifstream in("grammar_def.bin", std::ios::binary);
+        image.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+    GrammarImage::Header header{};
+    std::memcpy(&header, image.data(), sizeof(header));
+    std::uint64_t bodyOffsets = header.productionsOffset + (std::uint64_t) header.productionCount * 4;
+    std::uint64_t bodies = bodyOffsets + ((std::uint64_t) header.productionCount + 1) * 4;
+    const std::pair<const char *, std::uint64_t> corruptions[] = {
+            {"name offset",    header.namesOffset + (std::uint64_t) header.nonTerminalCount * 4},
+            {"head",           header.productionsOffset},
+            {"body offset",    bodyOffsets + 4},
+            {"body symbol",    bodies},
+            {"base",           header.tableOffset},
+            {"table check",    header.tableOffset + (std::uint64_t) header.nonTerminalCount * 8},
+    };
+    for (const auto &[what, offset]: corruptions) {
+        std::string corrupt = image;
+        std::int32_t value = 1 << 30;
+        std::memcpy(&corrupt[offset], &value, sizeof(value));
+        std::ofstream("grammar_corrupt.bin", std::ios::binary | std::ios::trunc) << corrupt;
+        ContextFreeGrammar corrupted(grammarDefs);
+        bool corruptLoaded = corrupted.loadAnalysis("grammar_corrupt.bin");
+        cout << "image with a corrupt " << what << " loaded: " << corruptLoaded << endl;
+        check(!corruptLoaded, std::string("image with a corrupt ") + what + " rejected");
+    }
+    std::remove("grammar_corrupt.bin");
+
+    InputBuffer inputBuffer("../test/parser_test_expression");
+    SymbolTable symbolTable;
+    Lexer lexer(&inputBuffer, &symbolTable);
+    Parser parser(loaded, &lexer, &symbolTable);
+    parser.parse();
+}
+
+void staticGrammarTest() {
+    // the table computed by the compiler must agree with the one computed at runtime
+    ContextFreeGrammar computed(grammarDefs);
+    std::vector<std::vector<int>> matrix = computed.getParsingTableMatrix();
+    int mismatches = 0;
+    for (int row = 0; row < matrix.size(); row++) {
+        for (int t = 0; t < Token::TOKEN_TYPE_COUNT; t++) {
+            if (matrix[row][t] != grammarTables.lookup(row, t)) mismatches++;
+        }
+    }
+    cout << "mismatches: " << mismatches << endl;
+    check(mismatches == 0, "the constexpr table matches the one computed at runtime");
+
+    ContextFreeGrammar grammar(grammarDefs);
+    bool adopted = grammar.useParsingTable(grammarTables.parsingTable());
+    cout << "table adopted: " << std::boolalpha << adopted << endl;
+    check(adopted, "the constexpr table is adopted");
+
+    // the parser predicts from the constexpr table: compiling the grammar builds no LL(1) table of its own
+    std::unique_ptr<CompiledGrammar> compiled;
+    std::set<std::string> spans = spansOf([&]() { compiled = std::make_unique<CompiledGrammar>(grammar); });
+    cout << "compiled without computing the table: " << !spans.count("LL(1) table") << endl;
+    check(spans.count("compile grammar") && !spans.count("LL(1) table"), "compiling adopts the constexpr table");
+    check(samePredictions(*compiled, CompiledGrammar(computed)), "the constexpr table, the same predictions");
+    InputBuffer inputBuffer("../test/parser_test_expression");
+    SymbolTable symbolTable;
+    Lexer lexer(&inputBuffer, &symbolTable);
+    Parser parser(*compiled, &lexer, &symbolTable);
+    parser.parse();
+
+    // and so does the command line driver, which is given grammarTables
+    CompileDriver::Options options;
+    options.threads = 1;
+    options.parsingTable = grammarTables.parsingTable();
+    spans = spansOf([&]() { CompileDriver driver(grammarDefs, options); });
+    check(!spans.count("LL(1) table"), "the driver adopts the constexpr table");
+}
+
+void generateExpressionParser() {
+    ContextFreeGrammar grammar(grammarDefs);
+    ParserGenerator(grammar, "ExpressionParser").generate("../ExpressionParser.h");
+}
+
+/**
+ * runs a parser on a file, returns "accept" or the syntax error
+ */
+template<typename P, typename... Args>
+std::string parseOutcome(const std::string &pathname, Args &&... args) {
+    InputBuffer inputBuffer(pathname);
+    SymbolTable symbolTable;
+    Lexer lexer(&inputBuffer, &symbolTable);
+    P parser(std::forward<Args>(args)..., &lexer, &symbolTable);
+    try {
+        parser.parse();
+    } catch (SyntacticalError &e) {
+        return "error at line " + std::to_string(e.getLine()) + " at column " + std::to_string(e.getColumn());
+    }
+    return "accept";
+}
+
+// ExpressionParser has no symbol table parameter
+struct ExpressionParserAdapter : public ExpressionParser {
+    ExpressionParserAdapter(Lexer *lexer, SymbolTable *) : ExpressionParser(lexer) {}
+};
+
+// neither has LRParser
+struct LRParserAdapter : public LRParser {
+    LRParserAdapter(const LALRTable &table, Lexer *lexer, SymbolTable *) : LRParser(table, lexer) {}
+};
+
+/**
+ * the generated parser accepts and rejects what the table-driven one does, at the same position: on the test inputs,
+ * on a synthetic expression and on copies of it with an error inserted at random places
+ */
+void generatedParserTest() {
+    ContextFreeGrammar grammar(grammarDefs);
+    auto compare = [&grammar](const std::string &pathname) {
+        std::string expected = parseOutcome<Parser>(pathname, grammar);
+        std::string actual = parseOutcome<ExpressionParserAdapter>(pathname);
+        check(expected == actual, pathname + ": table-driven " + expected + ", generated " + actual);
+        return expected;
+    };
+    for (const std::string &pathname: {"../test/parser_test_expression", "../test/parser_test_expression_error",
+                                       "../test/parser_test_expression_errors"}) {
+        cout << pathname << ": " << compare(pathname) << " by both" << endl;
+    }
+    check(compare("../test/parser_test_expression") == "accept", "the clean input is accepted");
+    check(compare("../test/parser_test_expression_error") != "accept", "the broken input is rejected");
+
+    const std::string pathname = "generated_test_expression";
+    SyntheticInput::writeExpression(pathname, 2000, 3);
+    std::string text;
+    {
+        std::ifstream in(pathname);
+        text.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+    check(compare(pathname) == "accept", "the synthetic expression is accepted");
+    std::vector<std::size_t> gaps;      // between tokens, so the inserted text never splits one
+    for (std::size_t i = 0; i < text.size(); i++) {
+        if (text[i] == ' ' || text[i] == '\n') gaps.push_back(i);
+    }
+    std::mt19937 rng(3);
+    const char *errors[] = {" * * ", " ( ", " ) ", " 1 "};
+    int rejected = 0;
+    for (int i = 0; i < 50; i++) {
+        std::string broken = text;
+        broken.insert(gaps[rng() % gaps.size()], errors[i % 4]);
+        std::ofstream(pathname, std::ios::out | std::ios::trunc) << broken;
+        rejected += compare(pathname) != "accept";
+    }
+    cout << "50 inputs with an inserted error, " << rejected << " rejected by both at the same position" << endl;
+    std::remove(pathname.c_str());
+}
+
+void generatedParserBenchmark() {
+    const std::string pathname = "parser_benchmark_expression";
+    SyntheticInput::writeExpression(pathname, 200000, 42);
+    ContextFreeGrammar grammar(grammarDefs);
+
+    auto measure = [&pathname](const std::function<void(Lexer *, SymbolTable *)> &run) {
+        InputBuffer inputBuffer(pathname);
+        SymbolTable symbolTable;
+        Lexer lexer(&inputBuffer, &symbolTable);
+        auto start = std::chrono::steady_clock::now();
+        run(&lexer, &symbolTable);
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    };
+
+    double lexOnly = measure([](Lexer *lexer, SymbolTable *) {
+        while (!lexer->nextToken().isEOF());
+    });
+    double generated = measure([](Lexer *lexer, SymbolTable *) {
+        ExpressionParser(lexer).parse();
+    });
+    double tableDriven = measure([&grammar](Lexer *lexer, SymbolTable *symbolTable) {
+        Parser(grammar, lexer, symbolTable).parse();
+    });
+
+    cout << "200000 operands" << endl
+         << "\tlexer only:   " << lexOnly << " ms" << endl
+         << "\ttable-driven: " << tableDriven << " ms (" << tableDriven - lexOnly << " ms parsing)" << endl
+         << "\tgenerated:    " << generated << " ms (" << generated - lexOnly << " ms parsing)" << endl;
+    std::remove(pathname.c_str());
+}
+
+void lalrTest() {
+    ContextFreeGrammar ll1(grammarDefs);
+    ContextFreeGrammar leftRecursive(leftRecursiveGrammarDefs);
+    LALRTable table(leftRecursive);
+    cout << "left recursive expression grammar: " << table.getStateCount() << " states, "
+         << table.getConflicts().size() << " conflicts" << endl;
+    check(table.getConflicts().empty(), "the left recursive expression grammar is LALR(1)");
+    for (const std::string &pathname: {"../test/parser_test_expression", "../test/parser_test_expression_error"}) {
+        std::string expected = parseOutcome<Parser>(pathname, ll1);
+        std::string actual = parseOutcome<LRParserAdapter>(pathname, table);
+        cout << pathname << endl << "\tLL(1):   " << expected << endl << "\tLALR(1): " << actual << endl;
+        check(expected == actual, pathname + ": LL(1) " + expected + ", LALR(1) " + actual);
+    }
+    check(parseOutcome<LRParserAdapter>("../test/parser_test_expression", table) == "accept",
+          "the clean input is accepted");
+
+    // dangling else, reported as a shift/reduce conflict resolved in favour of the nearest if
+    ContextFreeGrammar danglingElse(
+            {
+                    Production(HEAD("S"), {NT("F")}),
+                    Production(HEAD("S"), {NT("F"), T(Token::ELSE), NT("S")}),
+                    Production(HEAD("F"), {T(Token::IF), T(Token::LEFT_PAREN), NT("E"), T(Token::RIGHT_PAREN), NT("S")}),
+                    Production(HEAD("F"), {T(Token::INTEGER_LITERAL)}),
+                    Production(HEAD("E"), {T(Token::INTEGER_LITERAL)}),
+            });
+    LALRTable dangling(danglingElse);
+    dangling.printConflicts();
+    const std::vector<LALRTable::Conflict> &conflicts = dangling.getConflicts();
+    check(conflicts.size() == 1 && conflicts[0].terminal == Token::ELSE, "one conflict, on else");
+    check((conflicts[0].kept & 1) == 0 && (conflicts[0].discarded & 1) == 1, "the shift is kept over the reduce");
+}
+
+void lalrBenchmark() {
+    const std::string pathname = "lalr_benchmark_expression";
+    SyntheticInput::writeExpression(pathname, 200000, 42);
+    ContextFreeGrammar ll1(grammarDefs);
+    ContextFreeGrammar leftRecursive(leftRecursiveGrammarDefs);
+    LALRTable table(leftRecursive);
+
+    auto measure = [&pathname](const std::function<void(Lexer *, SymbolTable *)> &run) {
+        InputBuffer inputBuffer(pathname);
+        SymbolTable symbolTable;
+        Lexer lexer(&inputBuffer, &symbolTable);
+        auto start = std::chrono::steady_clock::now();
+        run(&lexer, &symbolTable);
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    };
+    double lalr = measure([&table](Lexer *lexer, SymbolTable *symbolTable) {
+        LRParser(table, lexer).parse();
+    });
+    double ll = measure([&ll1](Lexer *lexer, SymbolTable *symbolTable) {
+        Parser(ll1, lexer, symbolTable).parse();
+    });
+    cout << "200000 operands" << endl
+         << "\tLL(1), left recursion eliminated: " << ll << " ms" << endl
+         << "\tLALR(1), left recursive:          " << lalr << " ms, tables " << table.memoryUsage() << " bytes" << endl;
+    std::remove(pathname.c_str());
+}
+
 void leftRecursionEliminationTest() {
     ContextFreeGrammar grammar({
         Production(HEAD("<expr>"), {NT("<expr>"), T(Token::PLUS), NT("<term>")}),
@@ -56,6 +556,85 @@ void leftRecursionEliminationTest() {
     grammar.printProductions();
 }
 
+/**
+ * the productions of `grammar` as printProductions writes them, one string each
+ */
+std::vector<std::string> productionList(const ContextFreeGrammar &grammar) {
+    std::vector<std::string> list;
+    for (const Production &p: grammar.getProductions()) {
+        std::ostringstream out;
+        out << p;
+        list.push_back(out.str());
+    }
+    return list;
+}
+
+void grammarTransformationTest() {
+    // indirect left recursion: S ::= A a | b, A ::= A c | S d | epsilon
+    ContextFreeGrammar indirect({
+        Production(HEAD("S"), {NT("A"), T(Token::IDENTIFIER)}),
+        Production(HEAD("S"), {T(Token::INTEGER_LITERAL)}),
+        Production(HEAD("A"), {NT("A"), T(Token::PLUS)}),
+        Production(HEAD("A"), {NT("S"), T(Token::MINUS)}),
+        Production(HEAD("A"), {}),
+    });
+    cout << "indirect left recursion eliminated" << endl;
+    indirect.eliminateLeftRecursive().printProductions();
+    check(productionList(indirect) == std::vector<std::string>{"S ::= A id ", "S ::= int_literal ",
+                                                               "A ::= int_literal - A' ", "A ::= A' ",
+                                                               "A' ::= + A' ", "A' ::= id - A' ",
+                                                               "A' ::= EPSILON "},
+          "S substituted into A, then A's direct left recursion eliminated");
+
+    // dangling else: S ::= if ( E ) S | if ( E ) S else S | id, plus an unreachable and an unproductive rule
+    ContextFreeGrammar danglingElse({
+        Production(HEAD("S"), {T(Token::IF), T(Token::LEFT_PAREN), NT("E"), T(Token::RIGHT_PAREN), NT("S")}),
+        Production(HEAD("S"), {T(Token::IF), T(Token::LEFT_PAREN), NT("E"), T(Token::RIGHT_PAREN), NT("S"),
+                               T(Token::ELSE), NT("S")}),
+        Production(HEAD("S"), {T(Token::IDENTIFIER)}),
+        Production(HEAD("S"), {NT("L")}),
+        Production(HEAD("E"), {T(Token::IDENTIFIER)}),
+        Production(HEAD("U"), {T(Token::INTEGER_LITERAL)}),
+        Production(HEAD("L"), {NT("L"), T(Token::SEMICOLON)}),
+    });
+    cout << endl << "dangling else prepared for LL(1)" << endl;
+    danglingElse.prepareForLL1().printProductions();
+    check(productionList(danglingElse) == std::vector<std::string>{"S ::= if ( E ) S S' ", "S ::= id ", "E ::= id ",
+                                                                   "S' ::= EPSILON ", "S' ::= else S "},
+          "U and L removed, the common if ( E ) S factored out");
+
+    // identical alternatives: S ::= id ; | id ; | id ( ) and T ::= int | int factor to S ::= id S' and T ::= int,
+    // without a duplicate S' ::= ; or a T' ::= EPSILON | EPSILON
+    ContextFreeGrammar duplicated({
+        Production(HEAD("S"), {T(Token::IDENTIFIER), T(Token::SEMICOLON)}),
+        Production(HEAD("S"), {T(Token::IDENTIFIER), T(Token::SEMICOLON)}),
+        Production(HEAD("S"), {T(Token::IDENTIFIER), T(Token::LEFT_PAREN), T(Token::RIGHT_PAREN)}),
+        Production(HEAD("T"), {T(Token::INTEGER_LITERAL)}),
+        Production(HEAD("T"), {T(Token::INTEGER_LITERAL)}),
+    });
+    cout << endl << "identical alternatives left factored" << endl;
+    duplicated.leftFactor().printProductions();
+    const std::vector<Production> &factored = duplicated.getProductions();
+    for (std::size_t i = 0; i < factored.size(); i++) {
+        for (std::size_t j = 0; j < i; j++) check(!(factored[i] == factored[j]), "no duplicate production");
+    }
+    check(factored.size() == 4, "S ::= id S', S' ::= ; | ( ) and T ::= int");
+
+    // the textbook left recursive expression grammar, parsed by the table-driven LL(1) parser once prepared
+    ContextFreeGrammar expression(leftRecursiveGrammarDefs);
+    expression.prepareForLL1();
+    cout << endl << "expression grammar prepared for LL(1)" << endl;
+    expression.printProductions();
+    for (const std::string &pathname: {"../test/parser_test_expression", "../test/parser_test_expression_error"}) {
+        std::string actual = parseOutcome<Parser>(pathname, expression);
+        cout << pathname << ": " << actual << endl;
+    }
+    check(parseOutcome<Parser>("../test/parser_test_expression", expression) == "accept",
+          "the prepared expression grammar accepts the clean input");
+    check(parseOutcome<Parser>("../test/parser_test_expression_error", expression) == "error at line 1 at column 5",
+          "the prepared expression grammar rejects the broken input at line 1, column 5");
+}
+
 void grammarTest() {
     // dangling else
     ContextFreeGrammar nearestElse(
@@ -126,3 +705,1929 @@ void lexerTest() {
     lexerTestDriver("this test should tokenlise the java programme correctly",
                     "../test/lexer_test_java_programme");
 }
+
+/**
+ * reads the input again from random checkpoints of an InputBuffer and a Lexer, and compares it with a plain read;
+ * the text is eight copies of the java programme, so the buffer pair is refilled many times on the way
+ */
+void checkpointTest() {
+    std::ifstream fin("../test/lexer_test_java_programme");
+    std::stringstream programme;
+    programme << fin.rdbuf();
+    std::string text;
+    for (int i = 0; i < 8; i++) text += programme.str();
+    std::mt19937 rng(7);
+
+    // characters: after p calls of next(), getChar() is reference[p - 1] and peek() is reference[p]
+    struct Char {
+        char ch;
+        int line;
+        int column;
+    };
+    std::vector<Char> reference;
+    {
+        std::istringstream in(text);
+        InputBuffer plain(in, "<text>");
+        do {
+            plain.next();
+            reference.push_back({plain.getChar(), plain.getLine(), plain.getColumn()});
+        } while (reference.back().ch != EOF);
+    }
+    std::istringstream in(text);
+    InputBuffer inputBuffer(in, "<text>");
+    std::vector<std::pair<std::size_t, InputBuffer::Checkpoint>> charCheckpoints;
+    std::size_t p = 0, read = 0, rewinds = 0, mismatches = 0;
+    while (p < reference.size()) {
+        if (inputBuffer.peek() != reference[p].ch) mismatches++;
+        switch (rng() % 16) {
+            case 0:
+                charCheckpoints.emplace_back(p, inputBuffer.checkpoint());
+                break;
+            case 1:
+                if (charCheckpoints.empty()) break;
+                {
+                    auto &checkpoint = charCheckpoints[rng() % charCheckpoints.size()];
+                    inputBuffer.rewind(checkpoint.second);
+                    p = checkpoint.first;
+                    rewinds++;
+                }
+                break;
+            case 2:
+                if (rng() % 8 == 0) {
+                    inputBuffer.release();
+                    charCheckpoints.clear();
+                }
+                break;
+            default:
+                inputBuffer.next();
+                read++;
+                const Char &expected = reference[p++];
+                if (inputBuffer.getChar() != expected.ch || inputBuffer.getLine() != expected.line
+                    || inputBuffer.getColumn() != expected.column) {
+                    mismatches++;
+                }
+        }
+    }
+    cout << "InputBuffer: " << reference.size() << " characters, " << read << " read, " << rewinds << " rewinds, "
+         << mismatches << " mismatches" << endl;
+    check(mismatches == 0, "InputBuffer: every character, line and column the same after rewinding");
+    check(rewinds > 0, "InputBuffer: rewound at all");
+
+    // tokens, rewound without lexing again
+    std::vector<Token> tokens;
+    {
+        std::istringstream tokenIn(text);
+        InputBuffer plain(tokenIn, "<text>");
+        SymbolTable symbolTable;
+        Lexer lexer(&plain, &symbolTable);
+        do {
+            tokens.push_back(lexer.nextToken());
+        } while (tokens.back().getTokenType() != Token::END_OF_FILE);
+    }
+    std::istringstream tokenIn(text);
+    InputBuffer tokenBuffer(tokenIn, "<text>");
+    SymbolTable symbolTable;
+    Lexer lexer(&tokenBuffer, &symbolTable);
+    std::vector<std::pair<std::size_t, Lexer::Checkpoint>> tokenCheckpoints;
+    std::size_t t = 0;
+    read = rewinds = mismatches = 0;
+    while (t < tokens.size()) {
+        switch (rng() % 8) {
+            case 0:
+                tokenCheckpoints.emplace_back(t, lexer.checkpoint());
+                break;
+            case 1:
+                if (tokenCheckpoints.empty()) break;
+                {
+                    auto &checkpoint = tokenCheckpoints[rng() % tokenCheckpoints.size()];
+                    lexer.rewind(checkpoint.second);
+                    t = checkpoint.first;
+                    rewinds++;
+                }
+                break;
+            case 2:
+                if (rng() % 8 == 0) {
+                    lexer.release();
+                    tokenCheckpoints.clear();
+                }
+                break;
+            default:
+                Token token = lexer.nextToken();
+                read++;
+                const Token &expected = tokens[t++];
+                if (token.getTokenType() != expected.getTokenType() || token.getLexeme() != expected.getLexeme()
+                    || token.getLine() != expected.getLine() || token.getColumn() != expected.getColumn()) {
+                    mismatches++;
+                }
+        }
+    }
+    cout << "Lexer: " << tokens.size() << " tokens, " << read << " read, " << rewinds << " rewinds, " << mismatches
+         << " mismatches" << endl;
+    check(mismatches == 0, "Lexer: every token the same after rewinding");
+    check(rewinds > 0, "Lexer: rewound at all");
+}
+
+void checkpointBenchmark() {
+    // the cost of keeping everything: a checkpoint before every token, released every 64 tokens
+    const std::string pathname = "checkpoint_benchmark_expression";
+    SyntheticInput::writeExpression(pathname, 200000, 42);
+    for (bool speculate: {false, true}) {
+        InputBuffer source(pathname);
+        SymbolTable table;
+        Lexer timed(&source, &table);
+        auto start = std::chrono::steady_clock::now();
+        std::size_t count = 0;
+        for (Token token(Token::INVALID_TOKEN); token.getTokenType() != Token::END_OF_FILE; count++) {
+            if (speculate) {
+                if (count % 64 == 0) timed.release();
+                timed.checkpoint();
+            }
+            token = timed.nextToken();
+        }
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        cout << (speculate ? "lexing with a checkpoint per token: " : "lexing:                             ") << ms
+             << " ms for " << count << " tokens" << endl;
+    }
+    std::remove(pathname.c_str());
+}
+
+void parsingTableBenchmark() {
+    const int LOOKUPS = 20000000;
+    for (int count: {16, 256, 2048}) {
+        ContextFreeGrammar grammar(SyntheticInput::grammar(count, 3, 42));
+        std::vector<std::vector<int>> matrix = grammar.getParsingTableMatrix();
+        CompressedParsingTable compressed = grammar.compressParsingTable();
+        const int rows = (int) matrix.size(), columns = Token::TOKEN_TYPE_COUNT;
+
+        // the uncompressed layout: one flat row-major array
+        std::vector<int> dense;
+        dense.reserve(rows * columns);
+        for (const auto &row: matrix) dense.insert(dense.end(), row.begin(), row.end());
+
+        // the compressed table must agree with the dense one on every non-error entry
+        for (int r = 0; r < rows; r++) {
+            for (int c = 0; c < columns; c++) {
+                if (matrix[r][c] != CompressedParsingTable::NO_ENTRY && matrix[r][c] != compressed.lookup(r, c)) {
+                    throw std::runtime_error("compressed parsing table disagrees with the dense table");
+                }
+            }
+        }
+
+        std::mt19937 rng(7);
+        std::vector<std::pair<int, int>> queries(1 << 16);
+        for (auto &q: queries) q = {(int) (rng() % rows), (int) (rng() % columns)};
+
+        auto measure = [&](auto lookup) {
+            long checksum = 0;
+            auto start = std::chrono::steady_clock::now();
+            for (int i = 0; i < LOOKUPS; i++) {
+                const auto &q = queries[i & (queries.size() - 1)];
+                checksum += lookup(q.first, q.second);
+            }
+            auto end = std::chrono::steady_clock::now();
+            double ns = std::chrono::duration<double, std::nano>(end - start).count() / LOOKUPS;
+            return std::make_pair(ns, checksum);
+        };
+        auto denseResult = measure([&](int r, int c) { return dense[r * columns + c]; });
+        auto compressedResult = measure([&](int r, int c) { return compressed.lookup(r, c); });
+
+        cout << count << " non-terminals" << endl
+             << "\tdense:      " << dense.size() * sizeof(int) << " bytes, "
+             << denseResult.first << " ns/lookup (checksum " << denseResult.second << ")" << endl
+             << "\tcompressed: " << compressed.memoryUsage() << " bytes, "
+             << compressedResult.first << " ns/lookup (checksum " << compressedResult.second << ")" << endl;
+    }
+}
+
+/**
+ * whether two grammars over the same production list agree on FIRST, FOLLOW and the parsing table
+ */
+bool sameAnalysis(ContextFreeGrammar &a, ContextFreeGrammar &b) {
+    if (a.getParsingTableMatrix() != b.getParsingTableMatrix()) return false;
+    for (const GrammarSymbol &nt: a.getNonTerminals()) {
+        auto setOf = [&](const auto &sets) {
+            auto it = sets.find(nt);
+            return it == sets.end() ? ContextFreeGrammar::first_set_entry_t() : it->second;
+        };
+        if (setOf(a.getFirstSets()) != setOf(b.getFirstSets())) return false;
+        if (setOf(a.getFollowSets()) != setOf(b.getFollowSets())) return false;
+    }
+    return true;
+}
+
+/**
+ * after every addProductions and removeProductions the updated analysis equals that of the grammar built from scratch,
+ * also when a removal makes a non-terminal non-nullable or shrinks a FOLLOW set
+ */
+void incrementalAnalysisTest() {
+    ContextFreeGrammar grammar({Production(HEAD("<s>"), {NT("<a>"), NT("<b>")}),
+                                Production(HEAD("<a>"), {T(Token::IDENTIFIER)}),
+                                Production(HEAD("<a>"), {GrammarSymbol::epsilon()}),
+                                Production(HEAD("<b>"), {T(Token::INTEGER_LITERAL)}),
+                                Production(HEAD("<b>"), {T(Token::LEFT_PAREN), NT("<a>"), T(Token::RIGHT_PAREN)})});
+    grammar.getParsingTableMatrix();
+    auto agrees = [&grammar](const std::string &step) {
+        ContextFreeGrammar fromScratch(grammar.getProductions());
+        bool same = sameAnalysis(grammar, fromScratch);
+        cout << step << ": " << (same ? "same analysis" : "ANALYSIS DIFFERS") << endl;
+        check(same, step + ", the same analysis as from scratch");
+    };
+    auto followOfA = [&grammar]() { return grammar.getFollowSets().at(NT("<a>")); };
+
+    // + falls into FOLLOW(<a>)
+    const std::vector<Production> plus = {Production(HEAD("<s>"), {T(Token::SEMICOLON), NT("<a>"), T(Token::PLUS)})};
+    grammar.addProductions(plus);
+    agrees("add <s> ::= ; <a> +");
+    check(followOfA().count(T(Token::PLUS)), "+ is in FOLLOW(<a>) once added");
+
+    grammar.removeProductions(plus);
+    agrees("remove <s> ::= ; <a> +");
+    check(!followOfA().count(T(Token::PLUS)), "FOLLOW(<a>) shrinks when <s> ::= ; <a> + is removed");
+
+    // without its epsilon production <a> is no longer nullable, so FIRST(<s>) loses FIRST(<b>)
+    grammar.removeProductions({Production(HEAD("<a>"), {GrammarSymbol::epsilon()})});
+    agrees("remove <a> ::= EPSILON");
+    check(!grammar.getFirstSets().at(NT("<a>")).count(GrammarSymbol::epsilon()), "<a> is no longer nullable");
+    check(!grammar.getFirstSets().at(NT("<s>")).count(T(Token::INTEGER_LITERAL)), "FIRST(<s>) loses FIRST(<b>)");
+
+    grammar.addProductions({Production(HEAD("<a>"), {GrammarSymbol::epsilon()})});
+    agrees("add <a> ::= EPSILON back");
+    check(grammar.getFirstSets().at(NT("<s>")).count(T(Token::INTEGER_LITERAL)), "FIRST(<s>) regains FIRST(<b>)");
+}
+
+void incrementalAnalysisBenchmark() {
+    for (int count: {256, 2048, 8192}) {
+        std::vector<Production> base = SyntheticInput::grammar(count, 3, 42);
+
+        // a dialect extension: a few alternatives spread over the grammar, one of them reaching into FOLLOW sets
+        std::mt19937 rng(11);
+        std::vector<Production> extension;
+        for (int i = 0; i < 8; i++) {
+            int at = (int) (rng() % count);
+            auto t = (Token::TokenType) (rng() % Token::TokenType::END_OF_FILE);
+            extension.emplace_back(HEAD("<n" + std::to_string(at) + ">"), std::vector<GrammarSymbol>{T(t)});
+        }
+        int at = count - count / 8;
+        extension.emplace_back(HEAD("<n" + std::to_string(at) + ">"),
+                               std::vector<GrammarSymbol>{NT("<n" + std::to_string(at + 1) + ">"), T(Token::AT)});
+
+        ContextFreeGrammar grammar(base);
+        grammar.getParsingTableMatrix();
+
+        auto start = std::chrono::steady_clock::now();
+        grammar.addProductions(extension);
+        grammar.getParsingTableMatrix();
+        double incrementalAdd = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        start = std::chrono::steady_clock::now();
+        ContextFreeGrammar full(grammar.getProductions());
+        full.getParsingTableMatrix();
+        double fullAdd = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        bool addAgrees = sameAnalysis(grammar, full);
+
+        start = std::chrono::steady_clock::now();
+        grammar.removeProductions(extension);
+        grammar.getParsingTableMatrix();
+        double incrementalRemove = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        start = std::chrono::steady_clock::now();
+        ContextFreeGrammar original(grammar.getProductions());
+        original.getParsingTableMatrix();
+        double fullRemove = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        bool removeAgrees = sameAnalysis(grammar, original);
+
+        cout << count << " non-terminals, " << extension.size() << " productions added then removed" << endl
+             << "	add:    incremental " << incrementalAdd << " ms, full " << fullAdd << " ms, "
+             << (addAgrees ? "same analysis" : "ANALYSIS DIFFERS") << endl
+             << "	remove: incremental " << incrementalRemove << " ms, full " << fullRemove << " ms, "
+             << (removeAgrees ? "same analysis" : "ANALYSIS DIFFERS") << endl;
+    }
+}
+
+/**
+ * a machine-generated looking grammar: mostly references to later non-terminals, some back to earlier ones
+ * (forming cycles), some nullable non-terminals
+ */
+std::vector<Production> syntheticDialectGrammar(int count, unsigned seed) {
+    std::mt19937 rng(seed);
+    auto terminal = [&]() { return T((Token::TokenType) (rng() % Token::TokenType::END_OF_FILE)); };
+    auto later = [&](int i) { return NT("<d" + std::to_string(i + 1 + rng() % std::min(64, count - i - 1)) + ">"); };
+    std::vector<Production> productions;
+    for (int i = 0; i < count; i++) {
+        GrammarSymbol head = HEAD("<d" + std::to_string(i) + ">");
+        if (i + 1 == count) {
+            productions.emplace_back(head, std::vector<GrammarSymbol>{terminal()});
+            break;
+        }
+        productions.emplace_back(head, std::vector<GrammarSymbol>{terminal(), later(i)});
+        productions.emplace_back(head, std::vector<GrammarSymbol>{later(i), terminal(), later(i)});
+        if (i > 0 && rng() % 8 == 0) {
+            productions.emplace_back(head, std::vector<GrammarSymbol>{NT("<d" + std::to_string(rng() % i) + ">"),
+                                                                      terminal()});
+        }
+        if (rng() % 3 == 0) productions.emplace_back(head, std::vector<GrammarSymbol>{GrammarSymbol::epsilon()});
+    }
+    return productions;
+}
+
+/**
+ * the parallel analysis on 4 threads equals the sequential one, on the expression grammar and on generated grammars
+ * with cycles and nullable non-terminals
+ */
+void parallelAnalysisTest() {
+    ThreadPool pool(4);
+    auto agrees = [&pool](const std::string &name, const std::vector<Production> &productions) {
+        ContextFreeGrammar sequential(productions);
+        sequential.findParsingTableLL1();
+        ContextFreeGrammar parallel(productions);
+        parallel.analyseInParallel(pool);
+        bool same = sameAnalysis(sequential, parallel);
+        cout << name << ": " << (same ? "same analysis" : "ANALYSIS DIFFERS") << endl;
+        check(same, name + ", the same analysis in parallel as sequentially");
+    };
+    agrees("grammar_def.h", grammarDefs);
+    for (int count: {100, 1000}) {
+        for (unsigned seed: {1u, 42u}) {
+            agrees(std::to_string(count) + " non-terminals, seed " + std::to_string(seed),
+                   syntheticDialectGrammar(count, seed));
+        }
+    }
+}
+
+void parallelAnalysisBenchmark() {
+    ThreadPool pool;
+    for (int count: {1000, 4000, 16000}) {
+        std::vector<Production> productions = syntheticDialectGrammar(count, 42);
+
+        auto start = std::chrono::steady_clock::now();
+        ContextFreeGrammar sequential(productions);
+        sequential.findParsingTableLL1();
+        double sequentialMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        start = std::chrono::steady_clock::now();
+        ContextFreeGrammar parallel(productions);
+        parallel.analyseInParallel(pool);
+        double parallelMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        bool same = sameAnalysis(sequential, parallel);
+        cout << count << " non-terminals, " << productions.size() << " productions" << endl
+             << "	sequential:           " << sequentialMs << " ms" << endl
+             << "	parallel (" << pool.size() << " threads): " << parallelMs << " ms, "
+             << (same ? "same analysis" : "ANALYSIS DIFFERS") << endl;
+    }
+}
+
+/**
+ * the old tracing, std::endl after every line
+ */
+struct FlushingTrace : public ParseObserver {
+    std::ostream &out;
+
+    explicit FlushingTrace(std::ostream &out) : out(out) {}
+
+    void onToken(const Token &token) override { out << "got token: " << token << endl; }
+
+    void onStack(const std::vector<GrammarSymbol> &stack) override {
+        out << "\tstack: ";
+        for (const GrammarSymbol &s: stack) out << s << " ";
+        out << endl;
+    }
+
+    void onPredict(const GrammarSymbol &nt, const GrammarSymbol &input) override {
+        out << "\t\tpredict: " << nt << " on " << input << endl;
+    }
+
+    void onExpand(const Production &p) override { out << "\t\texpand using: " << p << endl; }
+
+    void onAccept() override { out << "accept" << endl; }
+};
+
+void parserTraceBenchmark() {
+    const std::string pathname = "trace_benchmark_expression";
+    SyntheticInput::writeExpression(pathname, 200000, 42);
+    ContextFreeGrammar grammar(grammarDefs);
+    std::ofstream devNull("/dev/null");
+
+    auto measure = [&](ParseObserver *observer) {
+        InputBuffer inputBuffer(pathname);
+        SymbolTable symbolTable;
+        Lexer lexer(&inputBuffer, &symbolTable);
+        Parser parser(grammar, &lexer, &symbolTable);
+        parser.setObserver(observer);
+        auto start = std::chrono::steady_clock::now();
+        parser.parse();
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    };
+    double off = measure(nullptr);
+    FlushingTrace flushing(devNull);
+    double flushed = measure(&flushing);
+    double text, binary;
+    {
+        TextTraceSink sink(devNull);
+        text = measure(&sink);
+    }
+    {
+        BinaryTraceSink sink(devNull, grammar);
+        binary = measure(&sink);
+    }
+    cout << "20000 operands, PARSER_TRACE_LEVEL " << PARSER_TRACE_LEVEL << endl
+         << "	no observer:            " << off << " ms" << endl
+         << "	flushed every line:     " << flushed << " ms" << endl
+         << "	buffered text sink:     " << text << " ms" << endl
+         << "	binary sink:            " << binary << " ms" << endl;
+    std::remove(pathname.c_str());
+}
+
+/**
+ * reduction hooks for grammarDefs building a binary expression AST into `ast`.
+ * The <expr_p> / <term_p> tails become entries of `tails` (operator, operand, rest), folded left by <expr> / <term>.
+ */
+std::vector<ReductionHook> expressionAstHooks(ParseTree &ast, std::vector<std::array<std::uint32_t, 3>> &tails) {
+    auto leaf = [&ast](const ParseTree &tree, std::uint32_t, const std::uint32_t *children) {
+        std::uint32_t n = ast.addNodes(1);
+        Token token = tree.getToken(tree[children[0]].data);
+        ast[n] = {token.getTokenType(), ast.addToken(token), ParseTree::NONE, 0};
+        return n;
+    };
+    auto tail = [&tails](const ParseTree &tree, std::uint32_t, const std::uint32_t *children) {
+        tails.push_back({(std::uint32_t) tree[children[0]].symbol, children[1], children[2]});
+        return (std::uint32_t) tails.size() - 1;
+    };
+    auto none = [](const ParseTree &, std::uint32_t, const std::uint32_t *) { return ParseTree::NONE; };
+    auto fold = [&ast, &tails](const ParseTree &, std::uint32_t, const std::uint32_t *children) {
+        std::uint32_t left = children[0];
+        for (std::uint32_t t = children[1]; t != ParseTree::NONE; t = tails[t][2]) {
+            std::uint32_t n = ast.addNodes(1), operands = ast.addNodes(2);
+            ast[operands] = ast[left];
+            ast[operands + 1] = ast[tails[t][1]];
+            ast[n] = {(std::int32_t) tails[t][0], ParseTree::NONE, operands, 2};
+            left = n;
+        }
+        return left;
+    };
+    auto parenthesised = [](const ParseTree &, std::uint32_t, const std::uint32_t *children) { return children[1]; };
+    // productions in the order of grammar_def.h
+    return {fold, tail, tail, none, fold, tail, tail, tail, none, parenthesised, leaf, leaf, leaf};
+}
+
+void printAst(const ParseTree &ast, const ParseTree::Node &node) {
+    if (node.childCount == 0) {
+        cout << ast.getLexeme(node.data);
+        return;
+    }
+    cout << "(" << Token::tokenTypeAsString((Token::TokenType) node.symbol);
+    for (std::uint32_t i = 0; i < node.childCount; i++) {
+        cout << " ";
+        printAst(ast, ast[node.firstChild + i]);
+    }
+    cout << ")";
+}
+
+void printParseTree(ContextFreeGrammar &grammar, const ParseTree &tree, std::uint32_t index, int depth) {
+    const ParseTree::Node &node = tree[index];
+    cout << std::string(depth * 2, ' ');
+    if (node.symbol >= Token::TOKEN_TYPE_COUNT) {
+        cout << grammar.getNonTerminals()[node.symbol - Token::TOKEN_TYPE_COUNT] << endl;
+        for (std::uint32_t i = 0; i < node.childCount; i++) printParseTree(grammar, tree, node.firstChild + i, depth + 1);
+    } else {
+        cout << tree.getLexeme(node.data) << endl;
+    }
+}
+
+void parseTreeTest() {
+    ContextFreeGrammar grammar(grammarDefs);
+    InputBuffer inputBuffer("../test/parser_test_expression");
+    SymbolTable symbolTable;
+    Lexer lexer(&inputBuffer, &symbolTable);
+    Parser parser(grammar, &lexer, &symbolTable);
+
+    ParseTree tree, ast;
+    std::vector<std::array<std::uint32_t, 3>> tails;
+    std::vector<ReductionHook> hooks = expressionAstHooks(ast, tails);
+    std::uint32_t root = parser.parse(tree, &hooks);
+    printParseTree(grammar, tree, 0, 0);
+    cout << tree.size() << " nodes, " << tree.memoryUsage() << " bytes" << endl << "AST: ";
+    printAst(ast, ast[root]);
+    cout << endl;
+
+    // the leaves hold the tokens the lexer returned, in order
+    InputBuffer again("../test/parser_test_expression");
+    Lexer relexer(&again, &symbolTable);
+    std::uint32_t leaf = 0;
+    for (Token token = relexer.nextToken(); !token.isEOF(); token = relexer.nextToken()) {
+        if (token.isWhitespace()) continue;
+        Token kept = tree.getToken(leaf);
+        bool identifier = token.getTokenType() == Token::IDENTIFIER;
+        check(kept.getTokenType() == token.getTokenType() && kept.getLexeme() == token.getLexeme()
+              && tree.getLexeme(leaf) == token.getLexeme() && kept.getLine() == token.getLine()
+              && kept.getColumn() == token.getColumn()
+              && (!identifier || kept.getSymbolTableIndex() == token.getSymbolTableIndex()),
+              "leaf " + std::to_string(leaf) + " keeps its token");
+        leaf++;
+    }
+    cout << leaf << " leaves keep their tokens" << endl;
+}
+
+void parseTreeBenchmark() {
+    const std::string pathname = "tree_benchmark_expression";
+    SyntheticInput::writeExpression(pathname, 200000, 42);
+    ContextFreeGrammar grammar(grammarDefs);
+
+    auto measure = [&](const std::function<void(Parser &)> &run) {
+        double best = 1e300;
+        for (int i = 0; i < 5; i++) {  // best of 5, the first runs also warm up the allocator
+            InputBuffer inputBuffer(pathname);
+            SymbolTable symbolTable;
+            Lexer lexer(&inputBuffer, &symbolTable);
+            Parser parser(grammar, &lexer, &symbolTable);
+            auto start = std::chrono::steady_clock::now();
+            run(parser);
+            best = std::min(best, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+        }
+        return best;
+    };
+    ParseTree tree, ast;
+    std::vector<std::array<std::uint32_t, 3>> tails;
+    std::vector<ReductionHook> hooks = expressionAstHooks(ast, tails);
+    double validate = measure([](Parser &parser) { parser.parse(); });
+    double cst = measure([&tree](Parser &parser) { parser.parse(tree); });
+    std::uint32_t nodes = tree.size();
+    double withAst = measure([&](Parser &parser) {
+        ast.clear();
+        tails.clear();
+        parser.parse(tree, &hooks);
+    });
+    cout << "200000 operands" << endl
+         << "	validate only:     " << validate << " ms" << endl
+         << "	parse tree:        " << cst << " ms (+" << (cst / validate - 1) * 100 << "%), " << nodes << " nodes, "
+         << tree.memoryUsage() << " bytes" << endl
+         << "	parse tree + AST:  " << withAst << " ms (+" << (withAst / validate - 1) * 100 << "%), "
+         << ast.size() << " AST nodes" << endl;
+    std::remove(pathname.c_str());
+}
+
+/**
+ * the diagnostics of both recovery modes, exactly: on the test input, on one where panic mode skips the second error
+ * that phrase-level recovery reports, and on one ending inside parentheses (the EOF token has the final position)
+ */
+void errorRecoveryTest() {
+    ContextFreeGrammar grammar(grammarDefs);
+    const char *modes[] = {"panic mode", "phrase level"};
+    auto diagnostics = [&](const std::string &pathname, Parser::Recovery recovery) {
+        InputBuffer inputBuffer(pathname);
+        SymbolTable symbolTable;
+        Lexer lexer(&inputBuffer, &symbolTable);
+        Parser parser(grammar, &lexer, &symbolTable);
+        parser.setRecovery(recovery);
+        ParseTree tree;
+        parser.parse(tree);
+        cout << pathname << ", " << modes[recovery - Parser::PANIC_MODE] << ": " << parser.getDiagnostics().size()
+             << " errors, " << tree.size() << " nodes" << endl;
+        std::string text;
+        for (const SyntaxDiagnostic &d: parser.getDiagnostics()) {
+            text += std::to_string(d.line) + ":" + std::to_string(d.column) + " " + d.message + "\n";
+        }
+        cout << text;
+        return text;
+    };
+    auto expect = [&](const std::string &pathname, Parser::Recovery recovery, const std::string &expected) {
+        check(diagnostics(pathname, recovery) == expected,
+              pathname + ", the diagnostics of " + modes[recovery - Parser::PANIC_MODE]);
+    };
+
+    const std::string errors = "1:7 error: unexpected * while parsing <term>\n"
+                               "1:17 error: unexpected id while parsing <term_p>\n"
+                               "2:13 error: unexpected ) while parsing <factor>\n";
+    expect("../test/parser_test_expression_errors", Parser::PANIC_MODE, errors);
+    expect("../test/parser_test_expression_errors", Parser::PHRASE_LEVEL, errors);
+
+    // panic mode discards input up to a synchronising token and misses the second ), phrase level reports it
+    const std::string stray = "recovery_test_stray_parentheses";
+    std::ofstream(stray) << "a * ) b + c ) * d";
+    expect(stray, Parser::PANIC_MODE, "1:6 error: unexpected ) while parsing <factor>\n");
+    expect(stray, Parser::PHRASE_LEVEL, "1:6 error: unexpected ) while parsing <factor>\n"
+                                        "1:14 error: expected EOF got )\n");
+    std::remove(stray.c_str());
+
+    // the missing ) is reported at the end of the input, not at 0:0
+    const std::string unclosed = "recovery_test_unclosed";
+    std::ofstream(unclosed) << "(a + b\n* (c";
+    expect(unclosed, Parser::PANIC_MODE, "2:5 error: expected ) got EOF\n");
+    expect(unclosed, Parser::PHRASE_LEVEL, "2:5 error: expected ) got EOF\n");
+    std::remove(unclosed.c_str());
+}
+
+/**
+ * copies the expression at `from` and breaks every `every`-th line by appending a stray "*"
+ */
+void writeBrokenExpression(const std::string &from, const std::string &to, int every) {
+    std::ifstream fin(from);
+    std::ofstream fout(to, std::ios::out | std::ios::trunc);
+    std::string line;
+    for (int i = 1; std::getline(fin, line); i++) {
+        fout << line << (i % every == 0 ? " *" : "") << "\n";
+    }
+}
+
+void errorRecoveryBenchmark() {
+    const std::string clean = "recovery_benchmark_expression", broken = "recovery_benchmark_expression_broken";
+    SyntheticInput::writeExpression(clean, 200000, 42);
+    writeBrokenExpression(clean, broken, 8);
+    ContextFreeGrammar grammar(grammarDefs);
+    grammar.getParsingTableMatrix();    // analysed once, not in every measured parse
+
+    auto measure = [&](const std::string &pathname, Parser::Recovery recovery, std::size_t &errors) {
+        double best = 1e300;
+        for (int i = 0; i < 5; i++) {
+            InputBuffer inputBuffer(pathname);
+            SymbolTable symbolTable;
+            Lexer lexer(&inputBuffer, &symbolTable);
+            Parser parser(grammar, &lexer, &symbolTable);
+            parser.setRecovery(recovery);
+            auto start = std::chrono::steady_clock::now();
+            parser.parse();
+            best = std::min(best, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+            errors = parser.getDiagnostics().size();
+        }
+        return best;
+    };
+    std::size_t errors = 0;
+    double baseline = measure(clean, Parser::NO_RECOVERY, errors);
+    double cleanRecovering = measure(clean, Parser::PHRASE_LEVEL, errors);
+    cout << "200000 operands" << endl << "\tclean, no recovery:    " << baseline << " ms" << endl
+         << "\tclean, phrase level:   " << cleanRecovering << " ms" << endl;
+    const char *modes[] = {"panic mode", "phrase level"};
+    for (Parser::Recovery recovery: {Parser::PANIC_MODE, Parser::PHRASE_LEVEL}) {
+        double ms = measure(broken, recovery, errors);
+        cout << "\tbroken, " << modes[recovery - Parser::PANIC_MODE] << ": " << (recovery == Parser::PANIC_MODE ? "  " : "")
+             << ms << " ms (x" << ms / baseline << "), " << errors << " errors" << endl;
+    }
+    std::remove(clean.c_str());
+    std::remove(broken.c_str());
+}
+
+/**
+ * every token of the file up to END_OF_FILE (excluded), whitespace included
+ */
+std::vector<Token> readTokens(const std::string &pathname, SymbolTable &symbolTable) {
+    InputBuffer inputBuffer(pathname);
+    Lexer lexer(&inputBuffer, &symbolTable);
+    std::vector<Token> tokens;
+    for (Token token = lexer.nextToken(); token.getTokenType() != Token::TokenType::END_OF_FILE;
+         token = lexer.nextToken()) {
+        tokens.push_back(token);
+    }
+    return tokens;
+}
+
+void pushParserTest() {
+    ContextFreeGrammar analysed(grammarDefs);
+    CompiledGrammar grammar(analysed);
+    SymbolTable symbolTable;
+    std::vector<Token> tokens = readTokens("../test/parser_test_expression", symbolTable);
+    const char *statuses[] = {"need more", "accepted", "failed"};
+
+    // any split of the input parses the same
+    for (std::size_t batch: {(std::size_t) 1, (std::size_t) 2, (std::size_t) 5, tokens.size()}) {
+        PushParser parser(grammar);
+        PushParser::Status status = PushParser::NEED_MORE;
+        bool waiting = true;
+        for (std::size_t i = 0; i < tokens.size(); i += batch) {
+            status = parser.feed(tokens.data() + i, std::min(batch, tokens.size() - i));
+            waiting = waiting && status == PushParser::NEED_MORE;
+        }
+        PushParser::Status finished = parser.finish();
+        cout << "batches of " << batch << ": " << statuses[status] << ", then " << statuses[finished] << endl;
+        check(waiting && finished == PushParser::ACCEPTED,
+              "batches of " + std::to_string(batch) + ": need more after every batch, accepted at the end");
+    }
+
+    // one thread interleaving many parses, a few tokens of each in turn
+    std::vector<PushParser> parsers(1000, PushParser(grammar));
+    int accepted = 0;
+    for (std::size_t i = 0; i < tokens.size(); i += 3) {
+        for (PushParser &parser: parsers) parser.feed(tokens.data() + i, std::min((std::size_t) 3, tokens.size() - i));
+    }
+    for (PushParser &parser: parsers) accepted += parser.finish() == PushParser::ACCEPTED;
+    cout << "interleaved: " << accepted << " of " << parsers.size() << " accepted" << endl;
+    check(accepted == 1000, "every interleaved parse is accepted");
+
+    std::vector<Token> broken = readTokens("../test/parser_test_expression_error", symbolTable);
+    PushParser parser(grammar);
+    parser.feed(broken);
+    const SyntaxDiagnostic &error = parser.getError();
+    PushParser::Status status = parser.finish();
+    cout << "broken input: " << statuses[status] << ", " << error.message << " at line " << error.line
+         << " at column " << error.column << endl;
+    check(status == PushParser::FAILED && error.line == 1 && error.column == 5,
+          "the broken input fails at line 1, column 5");
+}
+
+void pipelinedParserBenchmark() {
+    const std::string pathname = "pipeline_benchmark_expression";
+    SyntheticInput::writeExpression(pathname, 1000000, 42);
+    ContextFreeGrammar grammar(grammarDefs);
+    grammar.getParsingTableMatrix();
+
+    auto measure = [&](const std::function<void(Lexer &)> &run) {
+        double best = 1e300;
+        for (int i = 0; i < 5; i++) {
+            InputBuffer inputBuffer(pathname);
+            SymbolTable symbolTable;
+            Lexer lexer(&inputBuffer, &symbolTable);
+            auto start = std::chrono::steady_clock::now();
+            run(lexer);
+            best = std::min(best, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+        }
+        return best;
+    };
+    double lex = measure([](Lexer &lexer) {
+        while (lexer.nextToken().getTokenType() != Token::TokenType::END_OF_FILE);
+    });
+    auto parse = [&](bool pipelined) {
+        return [&grammar, pipelined](Lexer &lexer) {
+            SymbolTable symbolTable;
+            Parser parser(grammar, &lexer, &symbolTable);
+            parser.setPipelined(pipelined);
+            parser.parse();
+        };
+    };
+    double sequential = measure(parse(false));
+    double pipelined = measure(parse(true));
+    cout << "1000000 operands, " << std::thread::hardware_concurrency() << " hardware threads" << endl
+         << "\tlex only:            " << lex << " ms" << endl
+         << "\tlex + parse:         " << sequential << " ms" << endl
+         << "\tpipelined:           " << pipelined << " ms (lower bound max(lex, parse) = "
+         << std::max(lex, sequential - lex) << " ms)" << endl;
+    std::remove(pathname.c_str());
+}
+
+void compileDriverTest() {
+    CompileDriver::Options options;
+    std::vector<std::string> files = {"../test/parser_test_expression_errors", "../test/parser_test_expression",
+                                      "../test/lexer_test_error_report", "../test/parser_test_expression_error",
+                                      "../test/missing"};
+    // the files sorted by path, a file that cannot be opened reported as an error of its own
+    const std::vector<std::string> sorted = {"../test/lexer_test_error_report", "../test/missing",
+                                             "../test/parser_test_expression", "../test/parser_test_expression_error",
+                                             "../test/parser_test_expression_errors"};
+    const std::string expected = "../test/lexer_test_error_report:1:12: Invalid number\n"
+                                 "../test/missing:0:0: Could not open file ../test/missing\n"
+                                 "../test/parser_test_expression_error:1:5: error: unexpected * while parsing <term>\n"
+                                 "../test/parser_test_expression_errors:1:7: error: unexpected * while parsing <term>\n"
+                                 "../test/parser_test_expression_errors:1:17: error: unexpected id while parsing "
+                                 "<term_p>\n"
+                                 "../test/parser_test_expression_errors:2:13: error: unexpected ) while parsing "
+                                 "<factor>\n";
+    cout << expected;
+
+    // the same diagnostics in the same order whatever the number of threads
+    for (unsigned threads: {1u, 2u, 8u}) {
+        options.threads = threads;
+        CompileDriver driver(grammarDefs, options);
+        std::vector<std::string> collected = driver.collect(files);
+        check(collected == sorted, "the files are compiled in the sorted order of their paths");
+        std::ostringstream out;
+        CompileDriver::print(out, driver.compile(collected));
+        cout << threads << " threads: " << (out.str() == expected ? "same" : "DIFFERENT") << endl;
+        check(out.str() == expected, std::to_string(threads) + " threads: the expected diagnostics, in order");
+    }
+
+    // --grammar-cache: the first driver writes the image, the second compiles its grammar from it
+    const std::string cache = "driver_test_grammar.bin";
+    std::remove(cache.c_str());
+    options.grammarCache = cache;
+    CompileDriver writing(grammarDefs, options);
+    check(std::filesystem::exists(cache), "the driver writes the grammar cache");
+    std::unique_ptr<CompileDriver> loading;
+    std::set<std::string> spans = spansOf([&]() { loading = std::make_unique<CompileDriver>(grammarDefs, options); });
+    check(!spans.count("FIRST") && !spans.count("FOLLOW") && !spans.count("LL(1) table"),
+          "a driver started from the grammar cache analyses nothing");
+    std::ostringstream out;
+    CompileDriver::print(out, loading->compile(loading->collect(files)));
+    cout << "from the grammar cache: " << (out.str() == expected ? "same" : "DIFFERENT") << endl;
+    check(out.str() == expected, "the same diagnostics from the grammar cache");
+    std::remove(cache.c_str());
+}
+
+void compileDriverBenchmark() {
+    namespace fs = std::filesystem;
+    const std::string directory = "driver_benchmark";
+    fs::create_directories(directory);
+    std::mt19937 rng(42);
+    for (int i = 0; i < 64; i++) {     // files of very different sizes
+        SyntheticInput::writeExpression(directory + "/file" + std::to_string(i) + ".expr",
+                                        1000 + (int) (rng() % 40000), i);
+    }
+    for (unsigned threads: {1u, std::max(1u, std::thread::hardware_concurrency())}) {
+        CompileDriver::Options options;
+        options.threads = threads;
+        CompileDriver driver(grammarDefs, options);
+        std::vector<std::string> files = driver.collect({directory});
+        auto start = std::chrono::steady_clock::now();
+        std::vector<CompileDriver::Result> results = driver.compile(files);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        cout << files.size() << " files on " << threads << " threads: " << ms << " ms" << endl;
+    }
+    fs::remove_all(directory);
+}
+
+void compiledGrammarBenchmark() {
+    ContextFreeGrammar grammar(grammarDefs);
+    auto start = std::chrono::steady_clock::now();
+    CompiledGrammar compiled(grammar);
+    double compile = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    InputBuffer inputBuffer("../test/parser_test_expression");
+    SymbolTable symbolTable;
+    Lexer lexer(&inputBuffer, &symbolTable);
+    auto construct = [&](const std::function<void()> &create) {
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < 1000; i++) create();
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    };
+    double copying = construct([&]() { Parser parser(grammar, &lexer, &symbolTable); });
+    double sharing = construct([&]() { Parser parser(compiled, &lexer, &symbolTable); });
+    cout << "compiled once in " << compile << " ms, " << compiled.memoryUsage() << " bytes shared" << endl
+         << "\t1000 parsers compiling their own grammar: " << copying << " ms" << endl
+         << "\t1000 parsers sharing the compiled grammar: " << sharing << " ms, " << sizeof(Parser)
+         << " bytes each before parsing" << endl;
+
+    // the same snapshot parsed from several threads at once
+    std::vector<std::thread> threads;
+    std::atomic<int> accepted{0};
+    for (int t = 0; t < 4; t++) {
+        threads.emplace_back([&compiled, &accepted]() {
+            for (int i = 0; i < 100; i++) {
+                InputBuffer inputBuffer("../test/parser_test_expression");
+                SymbolTable symbolTable;
+                Lexer lexer(&inputBuffer, &symbolTable);
+                Parser parser(compiled, &lexer, &symbolTable);
+                parser.parse();
+                accepted++;
+            }
+        });
+    }
+    for (std::thread &thread: threads) thread.join();
+    cout << "\t" << accepted << " parses on 4 threads sharing it" << endl;
+}
+
+/**
+ * the tree below `node` as (symbol, production, length) in preorder
+ */
+void flattenTree(const IncrementalParser &parser, std::uint32_t node, std::vector<std::array<std::int64_t, 3>> &out) {
+    const IncrementalParser::Node &n = parser[node];
+    out.push_back({n.symbol, n.production, n.length});
+    for (std::uint32_t i = 0; i < n.childCount; i++) flattenTree(parser, n.firstChild + i, out);
+}
+
+std::vector<std::string> readLines(const std::string &pathname) {
+    std::ifstream fin(pathname);
+    std::vector<std::string> lines;
+    for (std::string line; std::getline(fin, line);) lines.push_back(line);
+    return lines;
+}
+
+void incrementalParserTest() {
+    const std::string pathname = "incremental_test_expression";
+    SyntheticInput::writeExpression(pathname, 2000, 7);
+    std::vector<std::string> lines = readLines(pathname);
+    std::string text;
+    for (const std::string &line: lines) text += line + "\n";
+
+    ContextFreeGrammar definition(grammarDefs);
+    CompiledGrammar grammar(definition);
+    IncrementalParser parser(grammar);
+    parser.setText(text);
+    bool accepted = parser.parse();
+    cout << "full parse: " << (accepted ? "accepted" : "rejected") << ", " << parser.getBuiltNodes() << " nodes" << endl;
+    check(accepted, "the synthetic expression is accepted");
+
+    // random edits checked against a parse from scratch; every fourth one breaks the expression and is undone
+    auto sameAsFresh = [&](bool accepted) {
+        IncrementalParser fresh(grammar);
+        std::string all;
+        for (const std::string &line: lines) all += line + "\n";
+        fresh.setText(all);
+        if (accepted != fresh.parse()) return false;
+        if (!accepted) {
+            return parser.getError().line == fresh.getError().line && parser.getError().column == fresh.getError().column;
+        }
+        std::vector<std::array<std::int64_t, 3>> a, b;
+        flattenTree(parser, parser.getRoot(), a);
+        flattenTree(fresh, fresh.getRoot(), b);
+        return a == b;
+    };
+    std::mt19937 rng(1);
+    const char *valid[] = {" * 2", " + (b - 3)", " / c"};
+    const char *breaking[] = {" * *", "(", " 4"};
+    int mismatches = 0, rejected = 0;
+    for (int i = 0; i < 200; i++) {
+        std::size_t line = 1 + rng() % (lines.size() - 2);
+        std::string before = lines[line];
+        bool breaks = i % 4 == 3;
+        lines[line] = i % 3 == 0 && !breaks ? " + x" + before : before + (breaks ? breaking : valid)[rng() % 3];
+        parser.replaceLines(line, 1, {lines[line]});
+        accepted = parser.parse();
+        if (!sameAsFresh(accepted)) mismatches++;
+        if (!accepted) rejected++;
+        if (breaks) {
+            lines[line] = before;
+            parser.replaceLines(line, 1, {before});
+            if (!sameAsFresh(parser.parse())) mismatches++;
+        }
+    }
+    // whole lines inserted and removed, and an edit of the first token
+    lines.insert(lines.begin() + 5, {" + y", " * (z)"});
+    parser.replaceLines(5, 0, {" + y", " * (z)"});
+    if (!sameAsFresh(parser.parse())) mismatches++;
+    lines.erase(lines.begin() + 5, lines.begin() + 7);
+    parser.replaceLines(5, 2, {});
+    if (!sameAsFresh(parser.parse())) mismatches++;
+    lines[0] = "w + " + lines[0];
+    parser.replaceLines(0, 1, {lines[0]});
+    if (!sameAsFresh(parser.parse())) mismatches++;
+    cout << "200 edits, " << rejected << " rejected, " << mismatches << " differing from a full parse" << endl;
+    check(mismatches == 0, "every incremental parse equals a parse from scratch");
+    check(rejected == 50, "every breaking edit is rejected");
+
+    // an error reported at its line, then fixed
+    std::string line3 = lines[3];
+    parser.replaceLines(3, 1, {line3 + " + * b"});
+    accepted = parser.parse();
+    cout << (accepted ? "accepted" : "rejected: " + parser.getError().message + " at line "
+                                     + std::to_string(parser.getError().line)) << endl;
+    check(!accepted && parser.getError().line == 4, "the broken line is rejected at its line");
+    parser.replaceLines(3, 1, {line3 + " + b"});
+    accepted = parser.parse();
+    cout << (accepted ? "accepted after the fix" : "still rejected") << ", " << parser.getReusedNodes()
+         << " subtrees reused, " << parser.getBuiltNodes() << " nodes built" << endl;
+    check(accepted, "accepted after the fix");
+    check(parser.getReusedNodes() > 0, "the fix reuses the subtrees of the unchanged lines");
+
+    // an edit that does not lex is reported at its line and leaves the document as it was
+    std::size_t tokenCount = parser.getTokenCount();
+    bool applied = parser.replaceLines(3, 1, {line3 + " # b"});
+    const SyntaxDiagnostic &lexical = parser.getError();
+    cout << "lexical error: " << (applied ? "applied" : lexical.message + " at line " + std::to_string(lexical.line)
+                                                        + " at column " + std::to_string(lexical.column)) << endl;
+    check(!applied && lexical.line == 4 && lexical.column == (int) line3.size() + 2,
+          "an edit with a lexical error is rejected at its position");
+    check(parser.getTokenCount() == tokenCount && parser.parse(), "the document is unchanged by the rejected edit");
+    check(!parser.setText(text + "'\n") && parser.getError().line == (int) lines.size() + 1
+          && parser.getTokenCount() == tokenCount, "a text with a lexical error is rejected at its line");
+    std::remove(pathname.c_str());
+}
+
+void incrementalParserBenchmark() {
+    const std::string pathname = "incremental_benchmark_expression";
+    SyntheticInput::writeExpression(pathname, 320000, 42);     // 20000 lines
+    std::vector<std::string> lines = readLines(pathname);
+    std::string text;
+    for (const std::string &line: lines) text += line + "\n";
+
+    ContextFreeGrammar definition(grammarDefs);
+    CompiledGrammar grammar(definition);
+    IncrementalParser parser(grammar);
+    auto start = std::chrono::steady_clock::now();
+    parser.setText(text);
+    parser.parse();
+    double full = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    cout << lines.size() << " lines, " << parser.getTokenCount() << " tokens, lexed and parsed in " << full << " ms"
+         << endl;
+
+    // single-line edits: a term put in front of the line or appended to it
+    std::mt19937 rng(3);
+    double total = 0, worst = 0;
+    std::size_t reused = 0, built = 0;
+    const int EDITS = 200;
+    for (int i = 0; i < EDITS; i++) {
+        std::size_t line = 1 + rng() % (lines.size() - 2);
+        std::string edited = i % 2 ? " + y" + std::to_string(i) + lines[line] : lines[line] + " * " + std::to_string(i);
+        start = std::chrono::steady_clock::now();
+        parser.replaceLines(line, 1, {edited});
+        bool accepted = parser.parse();
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        if (!accepted) cout << "rejected: " << parser.getError().message << endl;
+        lines[line] = edited;
+        total += ms;
+        worst = std::max(worst, ms);
+        reused += parser.getReusedNodes();
+        built += parser.getBuiltNodes();
+    }
+    cout << "\t" << EDITS << " single-line edits: " << total / EDITS << " ms on average, " << worst << " ms at most"
+         << endl << "\t" << reused / EDITS << " subtrees reused, " << built / EDITS << " nodes built per edit" << endl;
+    std::remove(pathname.c_str());
+}
+
+/**
+ * Java's binary operators as one precedence level per row, loosest first, as left recursion elimination leaves them:
+ * <e0> ::= <e1> <e0_p>, <e0_p> ::= || <e1> <e0_p> | epsilon, ... down to <factor>
+ */
+std::vector<Production> javaOperatorGrammarDefs() {
+    const std::vector<std::vector<Token::TokenType>> levels = {
+            {Token::LOGICAL_OR}, {Token::LOGICAL_AND}, {Token::PIPE}, {Token::CARET}, {Token::AMPERSAND},
+            {Token::EQUALS, Token::NOT_EQUALS},
+            {Token::LESS_THAN, Token::GREATER_THAN, Token::LESS_THAN_OR_EQUAL, Token::GREATER_THAN_OR_EQUAL},
+            {Token::LEFT_SHIFT, Token::RIGHT_SHIFT}, {Token::PLUS, Token::MINUS},
+            {Token::STAR, Token::SLASH, Token::PERCENT}};
+    std::vector<Production> productions;
+    for (std::size_t i = 0; i < levels.size(); i++) {
+        std::string level = "<e" + std::to_string(i) + ">", tail = "<e" + std::to_string(i) + "_p>";
+        std::string next = i + 1 < levels.size() ? "<e" + std::to_string(i + 1) + ">" : "<factor>";
+        productions.emplace_back(HEAD(level), std::vector<GrammarSymbol>{NT(next), NT(tail)});
+        for (Token::TokenType op: levels[i]) {
+            productions.emplace_back(HEAD(tail), std::vector<GrammarSymbol>{T(op), NT(next), NT(tail)});
+        }
+        productions.emplace_back(HEAD(tail), std::vector<GrammarSymbol>{GrammarSymbol::epsilon()});
+    }
+    productions.emplace_back(HEAD("<factor>"), std::vector<GrammarSymbol>{T(Token::LEFT_PAREN), NT("<e0>"),
+                                                                          T(Token::RIGHT_PAREN)});
+    productions.emplace_back(HEAD("<factor>"), std::vector<GrammarSymbol>{T(Token::INTEGER_LITERAL)});
+    productions.emplace_back(HEAD("<factor>"), std::vector<GrammarSymbol>{T(Token::IDENTIFIER)});
+    return productions;
+}
+
+/**
+ * the outcome of parse() with or without precedence parsing: "accept", the exception, or the diagnostics
+ */
+std::string precedenceOutcome(const CompiledGrammar &grammar, const std::string &pathname, Parser::Recovery recovery,
+                              bool precedence) {
+    InputBuffer inputBuffer(pathname);
+    SymbolTable symbolTable;
+    Lexer lexer(&inputBuffer, &symbolTable);
+    Parser parser(grammar, &lexer, &symbolTable);
+    parser.setRecovery(recovery);
+    parser.setPrecedenceParsing(precedence);
+    try {
+        parser.parse();
+    } catch (SyntacticalError &e) {
+        return e.what();
+    }
+    std::string outcome = "accept";
+    for (const SyntaxDiagnostic &d: parser.getDiagnostics()) {
+        outcome += "; " + std::to_string(d.line) + ":" + std::to_string(d.column) + " " + d.message;
+    }
+    return outcome;
+}
+
+void precedenceParsingTest() {
+    ContextFreeGrammar definition(grammarDefs);
+    CompiledGrammar grammar(definition);
+    const CompiledGrammar::OperatorLevels &levels = grammar.getOperatorLevels(grammar.getStart());
+    cout << grammar.getSymbol(grammar.getStart()) << ": " << levels.tails.size() << " levels, "
+         << levels.operators.count() << " operators, operand " << grammar.getSymbol(levels.operand) << endl;
+    check(levels.tails.size() == 2 && levels.operators.count() == 5, "<expr> has 2 levels of 5 operators");
+
+    // the same outcome, errors and recovery included, with and without precedence parsing
+    SyntheticInput::writeExpression("precedence_test_expression", 2000, 5);
+    writeBrokenExpression("precedence_test_expression", "precedence_test_expression_broken", 3);
+    const char *modes[] = {"no recovery", "panic mode", "phrase level"};
+    for (const std::string &pathname: {"../test/parser_test_expression", "../test/parser_test_expression_error",
+                                       "../test/parser_test_expression_errors", "precedence_test_expression",
+                                       "precedence_test_expression_broken"}) {
+        for (Parser::Recovery recovery: {Parser::NO_RECOVERY, Parser::PANIC_MODE, Parser::PHRASE_LEVEL}) {
+            std::string table = precedenceOutcome(grammar, pathname, recovery, false);
+            std::string flat = precedenceOutcome(grammar, pathname, recovery, true);
+            cout << pathname << ", " << modes[recovery] << ": " << (table == flat ? "same" : "DIFFERENT") << " ("
+                 << table << ")" << endl;
+            check(table == flat, pathname + ", " + modes[recovery] + ": the same outcome with precedence parsing");
+        }
+    }
+
+    // the push parser, and the Java operators whose ten levels become one loop
+    for (const std::string &pathname: {"../test/parser_test_expression_errors", "precedence_test_expression_broken"}) {
+        SymbolTable symbolTable;
+        std::vector<Token> tokens = readTokens(pathname, symbolTable);
+        std::string outcomes[2];
+        for (bool precedence: {false, true}) {
+            PushParser parser(grammar);
+            parser.setPrecedenceParsing(precedence);
+            parser.feed(tokens);
+            parser.finish();
+            const SyntaxDiagnostic &e = parser.getError();
+            outcomes[precedence] = std::to_string(e.line) + ":" + std::to_string(e.column) + " " + e.message;
+        }
+        cout << pathname << ", push parser: " << (outcomes[0] == outcomes[1] ? "same" : "DIFFERENT") << " ("
+             << outcomes[0] << ")" << endl;
+        check(outcomes[0] == outcomes[1], pathname + ": the same push parser outcome with precedence parsing");
+    }
+    ContextFreeGrammar javaDefinition(javaOperatorGrammarDefs());
+    CompiledGrammar java(javaDefinition);
+    const CompiledGrammar::OperatorLevels &javaLevels = java.getOperatorLevels(java.getStart());
+    cout << java.getSymbol(java.getStart()) << ": " << javaLevels.tails.size() << " levels, "
+         << javaLevels.operators.count() << " operators, operand " << java.getSymbol(javaLevels.operand) << endl;
+    check(javaLevels.tails.size() == 10 && javaLevels.operators.count() == 18, "<e0> has 10 levels of 18 operators");
+    std::remove("precedence_test_expression");
+    std::remove("precedence_test_expression_broken");
+}
+
+void precedenceParsingBenchmark() {
+    const std::string arithmetic = "precedence_benchmark_arithmetic", java = "precedence_benchmark_java";
+    SyntheticInput::writeExpression(arithmetic, 200000, 42);
+    {
+        // the same shape with operators of the Java levels (the lexer has no shift operators yet)
+        std::mt19937 rng(42);
+        std::ofstream fout(java, std::ios::out | std::ios::trunc);
+        const char *operators[] = {" || ", " && ", " | ", " ^ ", " & ", " == ", " != ", " < ", " >= ", " <= ",
+                                   " > ", " + ", " - ", " * ", " / ", " % "};
+        int open = 0;
+        for (int i = 0; i < 200000; i++) {
+            if (i > 0) fout << operators[rng() % 16];
+            if (rng() % 4 == 0) {
+                fout << "(";
+                open++;
+            }
+            if (rng() % 2) fout << "a";
+            fout << rng() % 100;
+            if (open > 0 && rng() % 3 == 0) {
+                fout << ")";
+                open--;
+            }
+            if (i % 16 == 15) fout << "\n";
+        }
+        while (open-- > 0) fout << ")";
+        fout << "\n";
+    }
+    ContextFreeGrammar arithmeticDefinition(grammarDefs);
+    ContextFreeGrammar javaDefinition(javaOperatorGrammarDefs());
+    CompiledGrammar arithmeticGrammar(arithmeticDefinition), javaGrammar(javaDefinition);
+
+    // parsing alone, on tokens lexed beforehand, and parse() pulling from the lexer
+    auto measure = [](const CompiledGrammar &grammar, const std::string &pathname, bool precedence, bool pull) {
+        SymbolTable symbolTable;
+        std::vector<Token> tokens = readTokens(pathname, symbolTable);
+        tokens.emplace_back(Token::TokenType::END_OF_FILE);
+        double best = 1e300;
+        for (int i = 0; i < 5; i++) {
+            InputBuffer inputBuffer(pathname);
+            Lexer lexer(&inputBuffer, &symbolTable);
+            Parser parser(grammar, &lexer, &symbolTable);
+            parser.setPrecedenceParsing(precedence);
+            PushParser pushParser(grammar);
+            pushParser.setPrecedenceParsing(precedence);
+            auto start = std::chrono::steady_clock::now();
+            if (pull) {
+                parser.parse();
+            } else if (pushParser.feed(tokens) != PushParser::ACCEPTED) {
+                cout << "rejected: " << pushParser.getError().message << endl;
+            }
+            best = std::min(best, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+        }
+        return best;
+    };
+    cout << "200000 operands, best of 5" << endl;
+    const char *names[] = {"arithmetic, 2 levels", "Java, 10 levels    "};
+    for (int g = 0; g < 2; g++) {
+        const CompiledGrammar &grammar = g == 0 ? arithmeticGrammar : javaGrammar;
+        const std::string &pathname = g == 0 ? arithmetic : java;
+        double table = measure(grammar, pathname, false, false), flat = measure(grammar, pathname, true, false);
+        double tablePull = measure(grammar, pathname, false, true), flatPull = measure(grammar, pathname, true, true);
+        cout << "\t" << names[g] << ": push parser " << table << " ms -> " << flat << " ms (x" << table / flat
+             << "), parse() with lexing " << tablePull << " ms -> " << flatPull << " ms" << endl;
+    }
+    std::remove(arithmetic.c_str());
+    std::remove(java.c_str());
+}
+
+void parseStackAllocationTest() {
+    check(COMPILER_COUNT_ALLOCATIONS, "allocations are counted in compiler_tests only");
+#if COMPILER_COUNT_ALLOCATIONS
+    auto allocations = []() { return AllocationCounter::count(); };
+#else
+    auto allocations = []() -> std::size_t { return 0; };
+#endif
+    // a long expression, and one nested deep enough to outgrow the initial stack
+    const std::string flat = "allocation_test_expression", nested = "allocation_test_nested";
+    SyntheticInput::writeExpression(flat, 200000, 42);
+    {
+        std::ofstream fout(nested, std::ios::out | std::ios::trunc);
+        for (int i = 0; i < 5000; i++) fout << "(a * ";
+        fout << "b";
+        for (int i = 0; i < 5000; i++) fout << ")";
+        fout << "\n";
+    }
+    ContextFreeGrammar definition(grammarDefs);
+    CompiledGrammar grammar(definition);
+    SymbolTable symbolTable;
+
+    for (const std::string &pathname: {flat, nested}) {
+        std::vector<Token> tokens = readTokens(pathname, symbolTable);
+        for (bool precedence: {false, true}) {
+            // the push parser on tokens lexed beforehand: only the first parse may grow the stack
+            PushParser pushParser(grammar);
+            pushParser.setPrecedenceParsing(precedence);
+            std::size_t counts[2];
+            PushParser::Status status = PushParser::FAILED;
+            for (std::size_t &count: counts) {
+                pushParser.reset();
+                std::size_t before = allocations();
+                pushParser.feed(tokens);
+                status = pushParser.finish();
+                count = allocations() - before;
+            }
+
+            // parse() pulling from the lexer, whatever it allocates beyond lexing alone is the parser's
+            InputBuffer lexed(pathname);
+            Lexer lexer(&lexed, &symbolTable);
+            std::size_t before = allocations();
+            while (lexer.nextToken().getTokenType() != Token::TokenType::END_OF_FILE) {}
+            std::size_t lexing = allocations() - before;
+            Parser parser(grammar, nullptr, &symbolTable);
+            parser.setPrecedenceParsing(precedence);
+            std::size_t pulls[2];
+            for (std::size_t &count: pulls) {
+                InputBuffer inputBuffer(pathname);
+                Lexer next(&inputBuffer, &symbolTable);
+                parser.setLexer(&next);
+                before = allocations();
+                parser.parse();
+                count = allocations() - before - lexing;
+            }
+            cout << pathname << (precedence ? ", precedence parsing" : ", table only") << ": "
+                 << (status == PushParser::ACCEPTED ? "accepted" : "rejected") << endl
+                 << "\tpush parser: " << counts[0] << " allocations in the first parse, " << counts[1]
+                 << " in the second" << endl
+                 << "\tparse():     " << pulls[0] << " allocations in the first parse, " << pulls[1]
+                 << " in the second (beyond the " << lexing << " of lexing)" << endl;
+            check(status == PushParser::ACCEPTED, pathname + " accepted");
+            check(counts[1] == 0, "no allocation in the second push parse of " + pathname);
+            check(pulls[1] == 0, "no allocation beyond lexing in the second parse() of " + pathname);
+        }
+    }
+    std::remove(flat.c_str());
+    std::remove(nested.c_str());
+}
+
+/**
+ * arithmetic with Java's casts: `( <type> ) <unary>` and `( <expr> )` both start with `(`, so the LL(1) table has a
+ * conflict there and keeps the parenthesised expression, the production listed first
+ */
+std::vector<Production> castGrammarDefs() {
+    return {
+            Production(HEAD("<expr>"), {NT("<term>"), NT("<expr_p>")}),
+            Production(HEAD("<expr_p>"), {T(Token::PLUS), NT("<term>"), NT("<expr_p>")}),
+            Production(HEAD("<expr_p>"), {T(Token::MINUS), NT("<term>"), NT("<expr_p>")}),
+            Production(HEAD("<expr_p>"), {GrammarSymbol::epsilon()}),
+            Production(HEAD("<term>"), {NT("<unary>"), NT("<term_p>")}),
+            Production(HEAD("<term_p>"), {T(Token::STAR), NT("<unary>"), NT("<term_p>")}),
+            Production(HEAD("<term_p>"), {T(Token::SLASH), NT("<unary>"), NT("<term_p>")}),
+            Production(HEAD("<term_p>"), {T(Token::PERCENT), NT("<unary>"), NT("<term_p>")}),
+            Production(HEAD("<term_p>"), {GrammarSymbol::epsilon()}),
+            Production(HEAD("<unary>"), {NT("<primary>")}),
+            Production(HEAD("<unary>"), {T(Token::LEFT_PAREN), NT("<type>"), T(Token::RIGHT_PAREN), NT("<unary>")}),
+            Production(HEAD("<unary>"), {T(Token::MINUS), NT("<unary>")}),
+            Production(HEAD("<primary>"), {T(Token::LEFT_PAREN), NT("<expr>"), T(Token::RIGHT_PAREN)}),
+            Production(HEAD("<primary>"), {T(Token::IDENTIFIER)}),
+            Production(HEAD("<primary>"), {T(Token::INTEGER_LITERAL)}),
+            Production(HEAD("<primary>"), {T(Token::FLOAT_LITERAL)}),
+            Production(HEAD("<type>"), {T(Token::IDENTIFIER), NT("<dims>")}),
+            Production(HEAD("<type>"), {T(Token::INT), NT("<dims>")}),
+            Production(HEAD("<dims>"), {T(Token::LEFT_BRACKET), T(Token::RIGHT_BRACKET), NT("<dims>")}),
+            Production(HEAD("<dims>"), {GrammarSymbol::epsilon()}),
+    };
+}
+
+/**
+ * the tree with chains of single children collapsed and empty nodes left out, inner nodes in brackets
+ */
+std::string bracketTree(const ParseTree &tree, std::uint32_t index) {
+    const ParseTree::Node *node = &tree[index];
+    while (node->symbol >= Token::TOKEN_TYPE_COUNT && node->childCount == 1) node = &tree[node->firstChild];
+    if (node->symbol < Token::TOKEN_TYPE_COUNT) {
+        std::string_view lexeme = tree.getLexeme(node->data);
+        return lexeme.empty() ? Token::tokenTypeAsString((Token::TokenType) node->symbol) : std::string(lexeme);
+    }
+    std::string text;
+    for (std::uint32_t i = 0; i < node->childCount; i++) {
+        std::string child = bracketTree(tree, node->firstChild + i);
+        if (!child.empty()) text += (text.empty() ? "" : " ") + child;
+    }
+    return node->childCount == 0 || text.empty() ? text : "[" + text + "]";
+}
+
+/**
+ * the tokens a leftmost derivation of `goal` yields, for checking EarleyParser::getDerivation
+ */
+std::vector<int> derivationYield(const CompiledGrammar &grammar, std::int32_t goal, const std::vector<int> &derivation) {
+    std::vector<int> yield;
+    std::vector<std::int32_t> stack{goal};
+    std::size_t next = 0;
+    while (!stack.empty()) {
+        std::int32_t symbol = stack.back();
+        stack.pop_back();
+        if (CompiledGrammar::isTerminal(symbol)) {
+            yield.push_back(symbol);
+            continue;
+        }
+        if (next == derivation.size() || grammar.getHead(derivation[next]) != symbol) return {-1};
+        const std::vector<std::int32_t> &body = grammar.getBody(derivation[next++]);
+        stack.insert(stack.end(), body.rbegin(), body.rend());
+    }
+    if (next != derivation.size()) return {-1};
+    return yield;
+}
+
+void earleyParserTest() {
+    ContextFreeGrammar definition(castGrammarDefs());
+    CompiledGrammar grammar(definition, 1);     // one token of lookahead, every conflict goes to EarleyParser
+    int conflicts = 0;
+    for (std::int32_t n = 0; n < (std::int32_t) grammar.getNonTerminals().size(); n++) {
+        for (int t = 0; t < Token::TOKEN_TYPE_COUNT; t++) {
+            if (grammar.hasConflict(Token::TOKEN_TYPE_COUNT + n, t)) {
+                cout << "conflict: " << grammar.getNonTerminals()[n] << " on "
+                     << Token::tokenTypeAsString((Token::TokenType) t) << endl;
+                conflicts++;
+            }
+        }
+    }
+
+    check(conflicts == 1, "one conflict, <unary> on (");
+
+    // the table alone takes every ( as a parenthesised expression, the Earley regions tell casts apart;
+    // source, tree or error with the table only, then with Earley
+    const std::string pathname = "earley_test_expression";
+    const std::array<std::string, 3> cases[] = {
+            {"(a + b) * c", "[[[( [[a] [+ [b]]] )] [* c]]]", "[[[( [[a] [+ [b]]] )] [* c]]]"},
+            {"(a) b", "error: unexpected id while parsing <term_p> at line 1 at column 6", "[[[( [a] ) b]]]"},
+            {"(int[]) x + 1", "error: unexpected int while parsing <expr> at line 1 at column 5",
+             "[[[( [int [[ ]]] ) x]] [+ [1]]]"},
+            {"(a) (b)", "error: unexpected ( while parsing <term_p> at line 1 at column 6",
+             "[[[( [a] ) [( [[b]] )]]]]"},
+            {"((a)) - (b) c", "error: unexpected id while parsing <term_p> at line 1 at column 14",
+             "[[[( [[[( [[a]] )]]] )]] [- [[( [b] ) c]]]]"},
+            {"-(int) -(a) * (c)", "error: unexpected int while parsing <expr> at line 1 at column 6",
+             "[[[- [( [int] ) [- [( [[a]] )]]]] [* [( [[c]] )]]]]"},
+            {"(a) * b", "[[[( [[a]] )] [* b]]]", "[[[( [[a]] )] [* b]]]"},
+            {"(a) - b", "[[[( [[a]] )]] [- [b]]]", "[[[( [a] ) [- b]]]]"},
+            {"(int) + 1", "error: unexpected int while parsing <expr> at line 1 at column 5",
+             "error: unexpected int while parsing <expr> at line 1 at column 5"},
+            {"(a b)", "error: unexpected id while parsing <term_p> at line 1 at column 5",
+             "error: unexpected id while parsing <term_p> at line 1 at column 5"},
+    };
+    for (const std::array<std::string, 3> &expected: cases) {
+        const std::string &source = expected[0];
+        std::ofstream(pathname, std::ios::out | std::ios::trunc) << source << "\n";
+        std::string outcomes[2];
+        for (bool general: {false, true}) {
+            InputBuffer inputBuffer(pathname);
+            SymbolTable symbolTable;
+            Lexer lexer(&inputBuffer, &symbolTable);
+            Parser parser(grammar, &lexer, &symbolTable);
+            parser.setGeneralParsing(general);
+            ParseTree tree;
+            try {
+                parser.parse(tree);
+                outcomes[general] = bracketTree(tree, 0);
+            } catch (SyntacticalError &e) {
+                outcomes[general] = e.what();
+            }
+        }
+        // parse() without a tree takes the same path, precedence parsing included
+        std::string flat = parseOutcome<Parser>(pathname, grammar);
+        cout << source << endl << "\ttable only: " << outcomes[0] << endl << "\twith Earley: " << outcomes[1]
+             << " (parse(): " << flat << ")" << endl;
+        check(outcomes[0] == expected[1], source + ": with the table only " + outcomes[0]);
+        check(outcomes[1] == expected[2], source + ": with Earley " + outcomes[1]);
+        bool rejected = expected[2].rfind("error", 0) == 0;
+        check((flat == "accept") != rejected, source + ": parse() " + flat);
+    }
+    std::remove(pathname.c_str());
+
+    // EarleyParser alone on an ambiguous grammar with right recursion, nullable symbols and a cycle of unit
+    // productions: with and without Leo's optimisation, every derivation has to yield its input
+    ContextFreeGrammar ambiguousDefinition(
+            {
+                    Production(HEAD("<s>"), {NT("<s>"), T(Token::PLUS), NT("<s>")}),
+                    Production(HEAD("<s>"), {NT("<a>")}),
+                    Production(HEAD("<a>"), {T(Token::IDENTIFIER), NT("<opt>"), NT("<a>")}),
+                    Production(HEAD("<a>"), {T(Token::IDENTIFIER)}),
+                    Production(HEAD("<a>"), {NT("<b>")}),
+                    Production(HEAD("<b>"), {NT("<a>")}),
+                    Production(HEAD("<b>"), {T(Token::LEFT_PAREN), NT("<s>"), T(Token::RIGHT_PAREN)}),
+                    Production(HEAD("<opt>"), {T(Token::COMMA)}),
+                    Production(HEAD("<opt>"), {GrammarSymbol::epsilon()}),
+            });
+    CompiledGrammar ambiguous(ambiguousDefinition);
+    std::mt19937 rng(7);
+    const int pieces[] = {Token::IDENTIFIER, Token::PLUS, Token::COMMA, Token::LEFT_PAREN, Token::RIGHT_PAREN};
+    int accepted = 0, agreed = 0, wrong = 0;
+    for (int i = 0; i < 2000; i++) {
+        std::vector<Token> input;
+        int length = 1 + (int) (rng() % 12);
+        for (int k = 0; k < length; k++) input.emplace_back((Token::TokenType) pieces[rng() % (k % 3 == 0 ? 1 : 5)]);
+        input.emplace_back(Token::TokenType::END_OF_FILE);
+        std::int32_t lengths[2];
+        for (bool leo: {false, true}) {
+            EarleyParser earley(ambiguous);
+            earley.setLeo(leo);
+            std::size_t next = 1;
+            lengths[leo] = earley.parse(ambiguous.getStart(), input[0], [&]() { return input[next++]; },
+                                        [](int terminal) { return terminal == Token::TokenType::END_OF_FILE; });
+            if (lengths[leo] == EarleyParser::NO_PARSE) continue;
+            std::vector<int> expected;
+            for (std::int32_t k = 0; k < lengths[leo]; k++) expected.push_back(input[k].getTokenType());
+            if (derivationYield(ambiguous, ambiguous.getStart(), earley.getDerivation()) != expected) wrong++;
+        }
+        accepted += lengths[1] != EarleyParser::NO_PARSE;
+        agreed += lengths[0] == lengths[1];
+    }
+    cout << conflicts << " conflicts; random inputs: " << accepted << " of 2000 accepted, " << agreed
+         << " alike with and without Leo, " << wrong << " derivations not yielding their input" << endl;
+    check(wrong == 0, "every derivation yields its input");
+    check(agreed == 2000, "the same parses with and without Leo's optimisation");
+    check(accepted == 287, "the same random inputs accepted");
+}
+
+void earleyParserBenchmark() {
+    // right recursion, <list> ::= id , <list> | id has a conflict on id and goes to EarleyParser whole
+    ContextFreeGrammar listDefinition(
+            {
+                    Production(HEAD("<list>"), {T(Token::IDENTIFIER), T(Token::COMMA), NT("<list>")}),
+                    Production(HEAD("<list>"), {T(Token::IDENTIFIER)}),
+            });
+    CompiledGrammar list(listDefinition);
+    for (int n: {1000, 2000, 4000}) {
+        std::vector<Token> input;
+        for (int i = 0; i < n; i++) {
+            if (i > 0) input.emplace_back(Token::TokenType::COMMA);
+            input.emplace_back(Token::TokenType::IDENTIFIER);
+        }
+        input.emplace_back(Token::TokenType::END_OF_FILE);
+        cout << n << " list elements:";
+        for (bool leo: {false, true}) {
+            EarleyParser earley(list);
+            earley.setLeo(leo);
+            std::size_t next = 1;
+            auto start = std::chrono::steady_clock::now();
+            std::int32_t length = earley.parse(list.getStart(), input[0], [&]() { return input[next++]; },
+                                               [](int terminal) { return terminal == Token::TokenType::END_OF_FILE; });
+            double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            cout << (leo ? ", with Leo " : " without Leo ") << ms << " ms, " << earley.getItemCount() << " items"
+                 << (length + 1 == (std::int32_t) input.size() ? "" : " (rejected)");
+        }
+        cout << endl;
+    }
+
+    // expressions where every ( is a conflict: the LL(1) driver with Earley regions, the table alone (which gets
+    // these right, there are no casts) and EarleyParser on the whole input
+    const std::string pathname = "earley_benchmark_expression";
+    SyntheticInput::writeExpression(pathname, 200000, 42);
+    ContextFreeGrammar definition(castGrammarDefs());
+    CompiledGrammar grammar(definition, 1);
+    auto measure = [&](const std::function<std::string(Lexer *, SymbolTable *)> &run) {
+        double best = 1e300;
+        std::string outcome;
+        for (int i = 0; i < 3; i++) {
+            InputBuffer inputBuffer(pathname);
+            SymbolTable symbolTable;
+            Lexer lexer(&inputBuffer, &symbolTable);
+            auto start = std::chrono::steady_clock::now();
+            outcome = run(&lexer, &symbolTable);
+            best = std::min(best, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+        }
+        return std::to_string(best) + " ms" + outcome;
+    };
+    auto parseWith = [&grammar](bool general) {
+        return [&grammar, general](Lexer *lexer, SymbolTable *symbolTable) {
+            Parser parser(grammar, lexer, symbolTable);
+            parser.setGeneralParsing(general);
+            parser.parse();
+            return std::string();
+        };
+    };
+    std::string table = measure(parseWith(false));
+    std::string hybrid = measure(parseWith(true));
+    std::string whole = measure([&grammar](Lexer *lexer, SymbolTable *) {
+        EarleyParser earley(grammar);
+        auto next = [lexer]() {
+            Token token = lexer->nextToken();
+            while (token.isWhitespace()) token = lexer->nextToken();
+            return token;
+        };
+        std::int32_t length = earley.parse(grammar.getStart(), next(), next, [](int terminal) {
+            return terminal == Token::TokenType::END_OF_FILE;
+        });
+        return ", " + std::to_string(earley.getItemCount()) + " items, "
+               + (length + 1 == (std::int32_t) earley.getTokens().size() ? "accepted" : "rejected");
+    });
+    cout << "200000 operands, best of 3" << endl
+         << "\ttable only:         " << table << endl
+         << "\tEarley on conflicts: " << hybrid << endl
+         << "\tEarley on all:       " << whole << endl;
+    std::remove(pathname.c_str());
+}
+
+/**
+ * statements that one token cannot tell apart: an assignment, a call and a declaration all start with id, and
+ * a.b = c; and a.b(); only differ in their fourth token
+ */
+std::vector<Production> statementGrammarDefs() {
+    return {
+            Production(HEAD("<stmts>"), {NT("<stmt>"), NT("<stmts>")}),
+            Production(HEAD("<stmts>"), {T(Token::EPSILON)}),
+            Production(HEAD("<stmt>"), {T(Token::IDENTIFIER), T(Token::ASSIGNMENT), T(Token::IDENTIFIER),
+                                        T(Token::SEMICOLON)}),
+            Production(HEAD("<stmt>"), {T(Token::IDENTIFIER), T(Token::LEFT_PAREN), T(Token::RIGHT_PAREN),
+                                        T(Token::SEMICOLON)}),
+            Production(HEAD("<stmt>"), {T(Token::IDENTIFIER), T(Token::IDENTIFIER), T(Token::SEMICOLON)}),
+            Production(HEAD("<stmt>"), {T(Token::IDENTIFIER), T(Token::DOT), T(Token::IDENTIFIER),
+                                        T(Token::ASSIGNMENT), T(Token::IDENTIFIER), T(Token::SEMICOLON)}),
+            Production(HEAD("<stmt>"), {T(Token::IDENTIFIER), T(Token::DOT), T(Token::IDENTIFIER),
+                                        T(Token::LEFT_PAREN), T(Token::RIGHT_PAREN), T(Token::SEMICOLON)}),
+    };
+}
+
+/**
+ * the statement grammar with k = 1 to 4, with and without EarleyParser where k tokens do not decide and with
+ * PushParser fed one token at a time, then the cast grammar of earleyParserTest on the expressions of
+ * earleyParserBenchmark, where more lookahead leaves fewer ( to EarleyParser
+ */
+void lookaheadTest() {
+    const std::string pathname = "lookahead_test_statements";
+    std::ofstream(pathname, std::ios::out | std::ios::trunc) << "x = y; f(); T v; a.b = c; a.b(); g();\n";
+    ContextFreeGrammar statements(statementGrammarDefs());
+    for (int k = 1; k <= CompiledGrammar::MAX_LOOKAHEAD; k++) {
+        CompiledGrammar grammar(statements, k);
+        std::string outcomes[2];
+        for (bool general: {false, true}) {
+            InputBuffer inputBuffer(pathname);
+            SymbolTable symbolTable;
+            Lexer lexer(&inputBuffer, &symbolTable);
+            Parser parser(grammar, &lexer, &symbolTable);
+            parser.setGeneralParsing(general);
+            ParseTree tree;
+            try {
+                parser.parse(tree);
+                outcomes[general] = bracketTree(tree, 0);
+            } catch (SyntacticalError &e) {
+                outcomes[general] = e.what();
+            }
+        }
+        cout << "k = " << k << ": " << grammar.getUndecidedCount() << " undecided conflicts, " << grammar.memoryUsage()
+             << " bytes" << endl << "	without Earley: " << outcomes[0] << endl << "	with Earley:    " << outcomes[1]
+             << endl;
+
+        // fed one token at a time, PushParser holds them back at a conflict and decides as Parser does
+        SymbolTable symbolTable;
+        std::vector<Token> tokens = readTokens(pathname, symbolTable);
+        PushParser pushParser(grammar);
+        for (const Token &token: tokens) pushParser.feed(&token, 1);
+        PushParser::Status status = pushParser.finish();
+        const SyntaxDiagnostic &error = pushParser.getError();
+        std::string pushOutcome = status == PushParser::ACCEPTED ? "accepted" : error.message + " at line "
+                + std::to_string(error.line) + " at column " + std::to_string(error.column);
+        cout << "	push parser:    " << pushOutcome << endl;
+        check(status == PushParser::ACCEPTED ? outcomes[0].rfind("error", 0) != 0 : outcomes[0] == pushOutcome,
+              "push parser decides as Parser does with k = " + std::to_string(k));
+        check(k < CompiledGrammar::MAX_LOOKAHEAD || status == PushParser::ACCEPTED, "push parser accepts with k = 4");
+    }
+    std::remove(pathname.c_str());
+
+    const std::string expression = "lookahead_test_expression";
+    SyntheticInput::writeExpression(expression, 200000, 42);
+    ContextFreeGrammar casts(castGrammarDefs());
+    for (int k = 1; k <= CompiledGrammar::MAX_LOOKAHEAD; k++) {
+        CompiledGrammar grammar(casts, k);
+        double best = 1e300;
+        std::string outcome;
+        for (int i = 0; i < 3; i++) {
+            auto start = std::chrono::steady_clock::now();
+            outcome = parseOutcome<Parser>(expression, grammar);
+            best = std::min(best, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+        }
+        cout << "200000 operands with casts, k = " << k << ": " << best << " ms, " << outcome << endl;
+    }
+    std::remove(expression.c_str());
+}
+
+/**
+ * lexes a whole input, counting the tokens other than whitespace and the distinct identifiers
+ */
+std::pair<long, std::size_t> lexAll(const std::string &text) {
+    std::istringstream in(text);
+    InputBuffer inputBuffer(in, "corpus");
+    SymbolTable symbolTable;
+    Lexer lexer(&inputBuffer, &symbolTable);
+    long tokens = 0;
+    std::unordered_set<std::string> identifiers;
+    for (Token token = lexer.nextToken(); !token.isEOF(); token = lexer.nextToken()) {
+        if (token.isWhitespace()) continue;
+        tokens++;
+        if (token.getTokenType() == Token::IDENTIFIER) identifiers.insert(token.getLexeme());
+    }
+    return {tokens, identifiers.size()};
+}
+
+/**
+ * the generated Java lexes without errors and uses at most the requested identifiers, grammar sentences parse, the
+ * same seed gives the same bytes, and an injected error is the first one reported, on the line it was injected on
+ */
+void syntheticCorpusTest() {
+    auto generate = [](const SyntheticCorpus::Options &options, const CompiledGrammar *grammar,
+                       SyntheticCorpus::Summary &summary) {
+        std::ostringstream out;
+        SyntheticCorpus corpus(out, options);
+        summary = grammar ? corpus.writeSentences(*grammar) : corpus.writeJava();
+        return out.str();
+    };
+    ContextFreeGrammar definition(grammarDefs);
+    CompiledGrammar grammar(definition);
+    SyntheticCorpus::Summary summary;
+
+    SyntheticCorpus::Options options;
+    options.bytes = 256 << 10;
+    std::string java = generate(options, nullptr, summary);
+    cout << "java, 256 KB asked: " << summary.bytes << " bytes (" << java.size() << " written), " << summary.lines
+         << " lines" << endl;
+    check(summary.bytes == java.size() && summary.bytes >= options.bytes, "java: the bytes asked for are written");
+    SyntheticCorpus::Summary again;
+    bool same = generate(options, nullptr, again) == java;
+    cout << "\tsame seed, same bytes: " << std::boolalpha << same << endl;
+    check(same, "java: the same seed gives the same bytes");
+    options.seed = 43;
+    bool other = generate(options, nullptr, again) == java;
+    cout << "\tother seed, same bytes: " << other << endl;
+    check(!other, "java: another seed gives other bytes");
+    options.seed = 42;
+    for (unsigned identifiers: {10u, 1000u}) {
+        options.identifiers = identifiers;
+        auto lexed = lexAll(generate(options, nullptr, summary));
+        cout << "\t" << identifiers << " identifiers asked: " << lexed.first << " tokens, " << lexed.second
+             << " distinct identifiers" << endl;
+        check(lexed.first > 0 && lexed.second <= identifiers,
+              "java: at most " + std::to_string(identifiers) + " distinct identifiers");
+    }
+    options.identifiers = 1000;
+    options.bytes = 1 << 10;
+    generate(options, nullptr, summary);
+    cout << "java, 1 KB asked: " << (summary.bytes >= 1024) << " at least 1 KB" << endl;
+    check(summary.bytes >= 1024, "java: at least 1 KB of 1 KB asked");
+
+    options.bytes = 256 << 10;
+    std::string sentence = generate(options, &grammar, summary);
+    std::istringstream in(sentence);
+    InputBuffer inputBuffer(in, "sentence");
+    SymbolTable symbolTable;
+    Lexer lexer(&inputBuffer, &symbolTable);
+    Parser(grammar, &lexer, &symbolTable).parse();
+    cout << "grammar_def.h, 256 KB asked: " << summary.bytes << " bytes, " << summary.lines << " lines, accepted"
+         << endl;
+    check(summary.bytes == sentence.size() && summary.bytes >= options.bytes,
+          "sentences: the bytes asked for are written");
+
+    options.errorRate = 0.01;
+    options.syntaxErrors = false;
+    std::string broken = generate(options, nullptr, summary);
+    try {
+        lexAll(broken);
+        cout << "lexical errors: none reported" << endl;
+        check(false, "an injected lexical error is reported");
+    } catch (LexicalError &e) {
+        bool onItsLine = e.getLine() == (int) summary.firstErrorLine;
+        cout << "lexical errors: " << summary.lexicalErrors << " injected, first reported on its line: " << onItsLine
+             << endl;
+        check(summary.lexicalErrors > 0 && onItsLine, "the first lexical error is reported on its line");
+    }
+
+    options.lexicalErrors = false;
+    options.syntaxErrors = true;
+    broken = generate(options, &grammar, summary);
+    std::istringstream brokenIn(broken);
+    InputBuffer brokenBuffer(brokenIn, "broken");
+    Lexer brokenLexer(&brokenBuffer, &symbolTable);
+    Parser parser(grammar, &brokenLexer, &symbolTable);
+    parser.setRecovery(Parser::PHRASE_LEVEL);
+    parser.parse();
+    const std::vector<SyntaxDiagnostic> &diagnostics = parser.getDiagnostics();
+    bool everyOne = diagnostics.size() >= summary.syntaxErrors;
+    bool first = !diagnostics.empty() && diagnostics[0].line == (int) summary.firstErrorLine;
+    cout << "syntax errors: " << summary.syntaxErrors << " injected, every one reported: " << everyOne
+         << ", first on its line: " << first << endl;
+    check(summary.syntaxErrors > 0 && everyOne, "every injected syntax error is reported");
+    check(first, "the first syntax error is reported on its line");
+}
+
+/**
+ * lexing throughput as the input grows, with few and with many distinct identifiers; a cost per token that grows
+ * with the input or with the identifiers shows up as falling MB/s
+ */
+void syntheticCorpusBenchmark() {
+    for (unsigned identifiers: {100u, 10000u}) {
+        for (std::uint64_t bytes: {std::uint64_t(64) << 10, std::uint64_t(1) << 20, std::uint64_t(8) << 20}) {
+            const std::string pathname = "corpus_benchmark.java";
+            SyntheticCorpus::Options options;
+            options.bytes = bytes;
+            options.identifiers = identifiers;
+            std::ofstream out(pathname, std::ios::out | std::ios::trunc | std::ios::binary);
+            SyntheticCorpus::Summary summary = SyntheticCorpus(out, options).writeJava();
+            out.close();
+
+            InputBuffer inputBuffer(pathname);
+            SymbolTable symbolTable;
+            Lexer lexer(&inputBuffer, &symbolTable);
+            long tokens = 0;
+            auto start = std::chrono::steady_clock::now();
+            while (!lexer.nextToken().isEOF()) tokens++;
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            cout << identifiers << " identifiers, " << summary.bytes << " bytes: " << tokens << " tokens, "
+                 << (double) summary.bytes / 1e6 / seconds << " MB/s" << endl;
+            std::remove(pathname.c_str());
+        }
+    }
+}
+
+/**
+ * the counters agree with what the input is known to hold: the bytes of the file, the tokens and the distinct
+ * identifiers the lexer returned, including those counted on a thread that ended before the report
+ */
+void statsTest() {
+    if constexpr (!COMPILER_STATS) {
+        cout << "statistics are compiled out, configure with -DCOMPILER_STATS=ON" << endl;
+        return;
+    }
+    const std::string pathname = "stats_test.java";
+    SyntheticCorpus::Options options;
+    options.bytes = 64 << 10;
+    options.identifiers = 100;
+    std::ofstream out(pathname, std::ios::out | std::ios::trunc | std::ios::binary);
+    SyntheticCorpus::Summary summary = SyntheticCorpus(out, options).writeJava();
+    out.close();
+
+    Stats::reset();
+    std::uint64_t tokens = 0;
+    std::unordered_set<std::string> identifiers;
+    std::thread lexing([&]() {
+        InputBuffer inputBuffer(pathname);
+        SymbolTable symbolTable;
+        Lexer lexer(&inputBuffer, &symbolTable);
+        for (Token token = lexer.nextToken();; token = lexer.nextToken()) {
+            tokens++;
+            if (token.getTokenType() == Token::IDENTIFIER) identifiers.insert(token.getLexeme());
+            if (token.isEOF()) break;
+        }
+    });
+    lexing.join();
+    std::remove(pathname.c_str());
+    Stats::Counters counters = Stats::collect();
+    std::uint64_t counted = 0;
+    for (std::uint64_t count: counters.tokens) counted += count;
+    cout << "java, " << summary.bytes << " bytes lexed on another thread" << endl;
+    check(counters.bytesRead == summary.bytes, "bytes read match the file");
+    check(counted == tokens, "tokens match the lexer");
+    check(counters.interned == identifiers.size(), "interned match the distinct identifiers");
+    check(counters.lookups == counters.tokens[Token::IDENTIFIER], "lookups match the identifier tokens");
+
+    Stats::reset();
+    auto start = std::chrono::steady_clock::now();
+    ContextFreeGrammar definition(grammarDefs);
+    CompiledGrammar grammar(definition);
+    SyntheticInput::writeExpression("stats_test_expression", 1000, 42);
+    InputBuffer inputBuffer("stats_test_expression");
+    SymbolTable symbolTable;
+    Lexer lexer(&inputBuffer, &symbolTable);
+    Parser parser(grammar, &lexer, &symbolTable);
+    parser.setPrecedenceParsing(false);
+    parser.parse();
+    auto wall = (std::uint64_t) std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start).count();
+    std::remove("stats_test_expression");
+    counters = Stats::collect();
+    cout << "grammar_def.h, 1000 operands parsed" << endl;
+    Stats::print(cout, counters);
+    check(counters.firstIterations > 1 && counters.followIterations > 1, "FIRST and FOLLOW iterated");
+    check(counters.expansions == counters.predictions, "an expansion per prediction");
+    check(counters.peakStackDepth > 2, "stack deeper than the start");
+    std::uint64_t phases = 0;
+    for (int phase = 0; phase < Stats::PHASE_COUNT; phase++) {
+        check(counters.nanoseconds[phase] > 0, std::string(Stats::phaseName((Stats::Phase) phase)) + " timed");
+        phases += counters.nanoseconds[phase];
+    }
+    check(phases <= wall, "the phases take no longer than the wall time");
+
+    // compiled from a grammar image, the grammar is not analysed again
+    ContextFreeGrammar(grammarDefs).saveAnalysis("stats_test_grammar.bin");
+    ContextFreeGrammar loaded(grammarDefs);
+    check(loaded.loadAnalysis("stats_test_grammar.bin"), "image loaded");
+    std::remove("stats_test_grammar.bin");
+    Stats::reset();
+    CompiledGrammar fromImage(loaded);
+    counters = Stats::collect();
+    cout << "compiled from an image: " << counters.firstIterations << " FIRST, " << counters.followIterations
+         << " FOLLOW iterations" << endl;
+    check(counters.firstIterations == 0 && counters.followIterations == 0, "no FIRST or FOLLOW iteration");
+}
+
+/**
+ * the complete events of a trace by name, with the thread of each
+ */
+std::vector<std::pair<std::string, std::string>> traceEvents(const std::string &json) {
+    std::vector<std::pair<std::string, std::string>> events;
+    std::istringstream in(json);
+    for (std::string line; std::getline(in, line);) {
+        if (line.find(R"("ph": "X")") == std::string::npos) continue;
+        std::size_t name = line.find("\"name\": \"") + 9;
+        std::size_t tid = line.find("\"tid\": ") + 7;
+        events.emplace_back(line.substr(name, line.find('"', name) - name),
+                            line.substr(tid, line.find(',', tid) - tid));
+    }
+    return events;
+}
+
+/**
+ * a pipelined parse has its spans of loading, lexing, analysis and parsing, lexing on a thread of its own; spans
+ * survive the end of their thread and fill more than one chunk; a sample rate traces that share of the samples
+ */
+void traceTest() {
+    Trace::start();
+    ContextFreeGrammar definition(grammarDefs);
+    definition.findParsingTableLL1();
+    CompiledGrammar grammar(definition);
+    SyntheticInput::writeExpression("trace_test_expression", 100000, 42);
+    {
+        InputBuffer inputBuffer("trace_test_expression");
+        SymbolTable symbolTable;
+        Lexer lexer(&inputBuffer, &symbolTable);
+        Parser parser(grammar, &lexer, &symbolTable);
+        parser.setPipelined(true);
+        parser.parse();
+    }
+    std::remove("trace_test_expression");
+    std::ostringstream out;
+    Trace::write(out);
+    std::map<std::string, std::set<std::string>> threads;
+    for (const auto &[name, tid]: traceEvents(out.str())) threads[name].insert(tid);
+    cout << std::boolalpha << "pipelined parse traced:" << endl;
+    for (const char *name: {"open", "refill", "lex", "FIRST", "FIRST of productions", "FOLLOW", "LL(1) table",
+                            "compile grammar", "parse"}) {
+        cout << "\t" << name << ": " << threads.count(name) << endl;
+        check(threads.count(name) == 1, std::string("a span of ") + name);
+    }
+    bool apart = threads["lex"].size() == 1 && threads["parse"].size() == 1 && threads["lex"] != threads["parse"];
+    bool refills = threads["refill"].count(*threads["lex"].begin()) == 1;
+    cout << "\tlexing on another thread than parsing: " << apart << endl;
+    cout << "\trefills on the lexing thread: " << refills << endl;
+    check(apart, "lexing on a thread of its own, parsing on another");
+    check(refills, "refills on the lexing thread");
+    for (const char *name: {"FIRST", "FIRST of productions", "FOLLOW", "LL(1) table", "compile grammar"}) {
+        check(threads[name] == threads["parse"], std::string(name) + " on the calling thread, as parsing");
+    }
+
+    Trace::start();
+    std::vector<std::thread> workers;
+    for (int t = 0; t < 4; t++) {
+        workers.emplace_back([]() {
+            for (int i = 0; i < 5000; i++) Trace::Span span("test", "span");
+        });
+    }
+    for (std::thread &worker: workers) worker.join();
+    out.str("");
+    Trace::write(out);
+    std::set<std::string> tids;
+    std::vector<std::pair<std::string, std::string>> events = traceEvents(out.str());
+    for (const auto &event: events) tids.insert(event.second);
+    cout << "4 threads of 5000 spans each, ended before writing: " << events.size() << " spans on " << tids.size()
+         << " threads" << endl;
+    check(events.size() == 20000 && tids.size() == 4, "every span of the ended threads, each on its thread");
+
+    Trace::start(0.25);
+    int sampled = 0;
+    for (int i = 0; i < 100; i++) {
+        Trace::Sample sample(Trace::sample());
+        Trace::Span span("test", "sampled");
+        sampled += Trace::isTraced();
+    }
+    Trace::stop();
+    { Trace::Span span("test", "stopped"); }
+    out.str("");
+    Trace::write(out);
+    std::size_t written = traceEvents(out.str()).size();
+    cout << "rate 0.25: " << sampled << " of 100 samples traced, " << written << " spans written" << endl;
+    check(sampled == 25 && written == 25, "a quarter of the samples traced, none after stop()");
+}
+
+/**
+ * the cost of a span: traced, sampled out, and with tracing stopped
+ */
+void traceBenchmark() {
+    const int spans = 1000000;
+    auto measure = [&](const char *label) {
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < spans; i++) Trace::Span span("benchmark", "span");
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        cout << label << ": " << seconds * 1e9 / spans << " ns/span" << endl;
+    };
+    Trace::start();
+    measure("traced");
+    {
+        Trace::Sample sample(false);
+        measure("sampled out");
+    }
+    Trace::stop();
+    measure("stopped");
+    volatile std::uint64_t last = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < spans; i++) last = Trace::now();
+    cout << "reading the clock: " << std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count()
+                                     * 1e9 / spans << " ns" << endl;
+}